@@ -813,7 +813,7 @@ static void *msg_thread_run(esl_thread_t *me, void *obj)
 						}
 					} else if (!strcasecmp(type, "text/disconnect-notice")) {
 						running = -1; thread_running = 0;
-					} else if (!strcasecmp(type, "text/event-plain")) {
+					} else if ((!strcasecmp(type, "text/event-plain") || !strcasecmp(type, "text/event-binary")) && handle->last_ievent) {
 						char *s;
 						esl_event_serialize(handle->last_ievent, &s, ESL_FALSE);
 						if (aok) {
@@ -1471,6 +1471,12 @@ ESL_DECLARE(esl_status_t) esl_recv_event(esl_handle_t *handle, int check_q, esl_
 				}
 			} else if (!esl_safe_strcasecmp(hval, "text/event-json")) {
 				esl_event_create_json(&handle->last_ievent, revent->body);
+			} else if (!esl_safe_strcasecmp(hval, "text/event-binary")) {
+				/* the inner event points into the body, so it takes the buffer over */
+				if ((cl = esl_event_get_header(revent, "content-length"))) {
+					esl_event_create_binary(&handle->last_ievent, revent->body, (esl_size_t) atol(cl));
+					revent->body = NULL;
+				}
 			}
 		}
 
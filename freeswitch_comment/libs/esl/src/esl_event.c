@@ -54,6 +54,24 @@ static char *my_dup(const char *s)
 #define FREE(ptr) esl_safe_free(ptr)
 #endif
 
+/* binary events point into their receive buffer, those pointers must never be freed on their own */
+static int esl_event_wire_owns(esl_event_t *event, const void *ptr)
+{
+	const char *p = (const char *) ptr;
+
+	if (!p || !event->wire) {
+		return 0;
+	}
+
+	if (p >= event->wire && p < event->wire + event->wire_len) {
+		return 1;
+	}
+
+	return (p >= (const char *) event->wire_headers && p < (const char *) (event->wire_headers + event->wire_header_count));
+}
+
+#define EVENT_FREE(event, ptr) do { if (esl_event_wire_owns(event, ptr)) { ptr = NULL; } else { FREE(ptr); } } while(0)
+
 /* make sure this is synced with the esl_event_types_t enum in esl_types.h
    also never put any new ones before EVENT_ALL
 */
@@ -317,20 +335,24 @@ ESL_DECLARE(esl_status_t) esl_event_del_header_val(esl_event_t *event, const cha
 			if (hp == event->last_header || !hp->next) {
 				event->last_header = lp;
 			}
-			FREE(hp->name);
+			EVENT_FREE(event, hp->name);
 
 			if (hp->idx) {
 				int i = 0;
 
 				for (i = 0; i < hp->idx; i++) {
-					FREE(hp->array[i]);
+					EVENT_FREE(event, hp->array[i]);
 				}
 				FREE(hp->array);
 			}
 
-			FREE(hp->value);
+			EVENT_FREE(event, hp->value);
 			
 			memset(hp, 0, sizeof(*hp));
+			if (esl_event_wire_owns(event, hp)) {
+				status = ESL_SUCCESS;
+				continue;
+			}
 #ifdef ESL_EVENT_RECYCLE
 			if (esl_queue_trypush(EVENT_HEADER_RECYCLE_QUEUE, hp) != ESL_SUCCESS) {
 				FREE(hp);
@@ -452,7 +474,7 @@ static esl_status_t esl_event_base_add_header(esl_event_t *event, esl_stack_t st
 			if (index_ptr) {
 				if (index > -1 && index <= 4000) {
 					if (index < header->idx) {
-						FREE(header->array[index]);
+						EVENT_FREE(event, header->array[index]);
 						header->array[index] = DUP(data);
 					} else {
 						int i;
@@ -557,6 +579,9 @@ static esl_status_t esl_event_base_add_header(esl_event_t *event, esl_stack_t st
 
 		if (len) {
 			len += 8;
+			if (esl_event_wire_owns(event, header->value)) {
+				header->value = NULL;
+			}
 			hv = realloc(header->value, len);
 			esl_assert(hv);
 			header->value = hv;
@@ -630,7 +655,7 @@ ESL_DECLARE(esl_status_t) esl_event_add_header_string(esl_event_t *event, esl_st
 
 ESL_DECLARE(esl_status_t) esl_event_set_body(esl_event_t *event, const char *body)
 {
-	esl_safe_free(event->body);
+	EVENT_FREE(event, event->body);
 
 	if (body) {
 		event->body = DUP(body);
@@ -653,7 +678,7 @@ ESL_DECLARE(esl_status_t) esl_event_add_body(esl_event_t *event, const char *fmt
 		if (ret == -1) {
 			return ESL_FAIL;
 		} else {
-			esl_safe_free(event->body);
+			EVENT_FREE(event, event->body);
 			event->body = data;
 			return ESL_SUCCESS;
 		}
@@ -672,19 +697,22 @@ ESL_DECLARE(void) esl_event_destroy(esl_event_t **event)
 		for (hp = ep->headers; hp;) {
 			this = hp;
 			hp = hp->next;
-			FREE(this->name);
+			EVENT_FREE(ep, this->name);
 
 			if (this->idx) {
 				int i = 0;
 
 				for (i = 0; i < this->idx; i++) {
-					FREE(this->array[i]);
+					EVENT_FREE(ep, this->array[i]);
 				}
 				FREE(this->array);
 			}
 
-			FREE(this->value);
+			EVENT_FREE(ep, this->value);
 			
+			if (esl_event_wire_owns(ep, this)) {
+				continue;
+			}
 
 #ifdef ESL_EVENT_RECYCLE
 			if (esl_queue_trypush(EVENT_HEADER_RECYCLE_QUEUE, this) != ESL_SUCCESS) {
@@ -696,8 +724,10 @@ ESL_DECLARE(void) esl_event_destroy(esl_event_t **event)
 
 
 		}
-		FREE(ep->body);
+		EVENT_FREE(ep, ep->body);
 		FREE(ep->subclass_name);
+		FREE(ep->wire_headers);
+		FREE(ep->wire);
 #ifdef ESL_EVENT_RECYCLE
 		if (esl_queue_trypush(EVENT_RECYCLE_QUEUE, ep) != ESL_SUCCESS) {
 			FREE(ep);
@@ -938,6 +968,111 @@ ESL_DECLARE(esl_status_t) esl_event_create_json(esl_event_t **event, const char
 	return ESL_SUCCESS;
 }
 
+static esl_status_t esl_event_wire_get(char **pp, const char *end, char **str, uint32_t *len)
+{
+	const unsigned char *p = (const unsigned char *) *pp;
+
+	if (end - *pp < 4) {
+		return ESL_FAIL;
+	}
+
+	*len = ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+	*pp += 4;
+
+	if (!str) {
+		return ESL_SUCCESS;
+	}
+
+	if ((esl_size_t) (end - *pp) <= *len || (*pp)[*len] != '\0') {
+		return ESL_FAIL;
+	}
+
+	*str = *pp;
+	*pp += *len + 1;
+
+	return ESL_SUCCESS;
+}
+
+ESL_DECLARE(esl_status_t) esl_event_create_binary(esl_event_t **event, char *data, esl_size_t len)
+{
+	esl_event_t *new_event;
+	esl_event_header_t *hp;
+	char *p = data, *end = data + len;
+	char *name, *value;
+	uint32_t count, blen, i, nlen, vlen;
+	esl_ssize_t hlen;
+
+	*event = NULL;
+
+	/* every header takes at least two length words and two terminators */
+	if (esl_event_wire_get(&p, end, NULL, &count) != ESL_SUCCESS || count > len / 10) {
+		esl_safe_free(data);
+		return ESL_FAIL;
+	}
+
+	if (esl_event_create(&new_event, ESL_EVENT_CLONE) != ESL_SUCCESS) {
+		esl_safe_free(data);
+		return ESL_FAIL;
+	}
+
+	new_event->wire = data;
+	new_event->wire_len = len;
+
+	if (count) {
+		new_event->wire_headers = calloc(count, sizeof(esl_event_header_t));
+		esl_assert(new_event->wire_headers);
+		new_event->wire_header_count = count;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (esl_event_wire_get(&p, end, &name, &nlen) != ESL_SUCCESS || esl_event_wire_get(&p, end, &value, &vlen) != ESL_SUCCESS) {
+			goto fail;
+		}
+
+		if (!strncmp(value, "ARRAY::", 7)) {
+			esl_event_add_array(new_event, name, value);
+			continue;
+		}
+
+		if (!strcasecmp(name, "event-name")) {
+			esl_name_event(value, &new_event->event_id);
+		}
+
+		hp = &new_event->wire_headers[i];
+		hp->name = name;
+		hp->value = value;
+		hlen = nlen;
+		hp->hash = esl_ci_hashfunc_default(name, &hlen);
+
+		if (new_event->last_header) {
+			new_event->last_header->next = hp;
+		} else {
+			new_event->headers = hp;
+		}
+		new_event->last_header = hp;
+	}
+
+	if (esl_event_wire_get(&p, end, NULL, &blen) != ESL_SUCCESS) {
+		goto fail;
+	}
+
+	/* a missing body is a bare zero length */
+	if (blen) {
+		if ((esl_size_t) (end - p) <= blen || p[blen] != '\0') {
+			goto fail;
+		}
+		new_event->body = p;
+	}
+
+	*event = new_event;
+	return ESL_SUCCESS;
+
+ fail:
+
+	esl_event_destroy(&new_event);
+	return ESL_FAIL;
+}
+
 ESL_DECLARE(esl_status_t) esl_event_serialize_json(esl_event_t *event, char **str)
 {
 	esl_event_header_t *hp;
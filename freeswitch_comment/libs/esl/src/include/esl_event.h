@@ -186,6 +186,12 @@ struct esl_event {
 	unsigned long key;
 	struct esl_event *next;
 	int flags;
+	/*! receive buffer a binary event points into (see esl_event_create_binary) */
+	char *wire;
+	esl_size_t wire_len;
+	/*! header block allocated for a binary event */
+	esl_event_header_t *wire_headers;
+	esl_size_t wire_header_count;
 };
 
 typedef enum {
@@ -299,6 +305,15 @@ ESL_DECLARE(esl_status_t) esl_name_event(const char *name, esl_event_types_t *ty
 ESL_DECLARE(esl_status_t) esl_event_serialize(esl_event_t *event, char **str, esl_bool_t encode);
 ESL_DECLARE(esl_status_t) esl_event_serialize_json(esl_event_t *event, char **str);
 ESL_DECLARE(esl_status_t) esl_event_create_json(esl_event_t **event, const char *json);
+/*!
+  \brief Create an event from the length-prefixed binary format (text/event-binary)
+  \param event a NULL pointer on which to create the event
+  \param data a malloc()ed buffer holding the serialized event, the event takes ownership of it (even on failure)
+  \param len the length of data
+  \return ESL_SUCCESS on success
+  \note header names, values and the body point into data instead of being copied
+*/
+ESL_DECLARE(esl_status_t) esl_event_create_binary(esl_event_t **event, char *data, esl_size_t len);
 /*!
   \brief Add a body to an event
   \param event the event to add to body to
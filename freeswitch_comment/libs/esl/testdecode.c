@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <esl.h>
+
+/*
+ * Times esl_recv_event() on text/event-plain, text/event-json and text/event-binary
+ * for the same event, fed through a socketpair so the whole receive path is measured.
+ *
+ * usage: testdecode [loops] [headers]
+ */
+
+#define MAX_FORMATS 3
+
+static const char *formats[MAX_FORMATS] = { "text/event-plain", "text/event-json", "text/event-binary" };
+
+typedef struct {
+	esl_socket_t sock;
+	int loops;
+	char *msg[MAX_FORMATS];
+	size_t len[MAX_FORMATS];
+} feeder_t;
+
+static int write_all(esl_socket_t sock, const char *data, size_t len)
+{
+	while (len) {
+		ssize_t r = send(sock, data, len, 0);
+
+		if (r <= 0) {
+			return -1;
+		}
+		data += r;
+		len -= (size_t) r;
+	}
+
+	return 0;
+}
+
+static void *feeder(esl_thread_t *me, void *obj)
+{
+	feeder_t *f = (feeder_t *) obj;
+	const char *reply = "Content-Type: command/reply\nReply-Text: +OK\n\n";
+	char buf[64];
+	int i, x;
+
+	/* swallow the connect esl_attach_handle sends */
+	if (recv(f->sock, buf, sizeof(buf), 0) <= 0 || write_all(f->sock, reply, strlen(reply))) {
+		return NULL;
+	}
+
+	for (i = 0; i < MAX_FORMATS; i++) {
+		for (x = 0; x < f->loops; x++) {
+			if (write_all(f->sock, f->msg[i], f->len[i])) {
+				return NULL;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static char *wire_put(char *p, const char *str, uint32_t len)
+{
+	p[0] = (char) (len >> 24);
+	p[1] = (char) (len >> 16);
+	p[2] = (char) (len >> 8);
+	p[3] = (char) len;
+	p += 4;
+
+	if (str) {
+		memcpy(p, str, len);
+		p += len;
+		*p++ = '\0';
+	}
+
+	return p;
+}
+
+/* same layout as switch_event_serialize_binary() */
+static size_t serialize_binary(esl_event_t *event, char **str)
+{
+	esl_event_header_t *hp;
+	size_t total = 8;
+	uint32_t count = 0;
+	char *p;
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		total += 10 + strlen(hp->name) + strlen(hp->value);
+		count++;
+	}
+
+	*str = p = malloc(total);
+	esl_assert(p);
+
+	p = wire_put(p, NULL, count);
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		p = wire_put(p, hp->name, (uint32_t) strlen(hp->name));
+		p = wire_put(p, hp->value, (uint32_t) strlen(hp->value));
+	}
+
+	wire_put(p, NULL, 0);
+
+	return total;
+}
+
+static size_t frame(const char *type, const char *body, size_t blen, char **msg)
+{
+	char head[128];
+	size_t hlen;
+
+	esl_snprintf(head, sizeof(head), "Content-Length: %ld\nContent-Type: %s\n\n", (long) blen, type);
+	hlen = strlen(head);
+
+	*msg = malloc(hlen + blen);
+	esl_assert(*msg);
+	memcpy(*msg, head, hlen);
+	memcpy(*msg + hlen, body, blen);
+
+	return hlen + blen;
+}
+
+int main(int argc, char *argv[])
+{
+	esl_handle_t handle = {{0}};
+	esl_socket_t socks[2];
+	esl_event_t *event;
+	feeder_t f = { 0 };
+	char name[64], value[128];
+	char *body;
+	size_t blen;
+	struct timeval start, end;
+	int headers, i, x;
+
+	f.loops = argc > 1 ? atoi(argv[1]) : 100000;
+	headers = argc > 2 ? atoi(argv[2]) : 100;
+
+	esl_event_create(&event, ESL_EVENT_CHANNEL_ANSWER);
+	esl_event_add_header_string(event, ESL_STACK_BOTTOM, "Unique-ID", "4b1ad3a6-4c1e-4a5d-8f33-0d5e1c0f2a77");
+
+	for (x = 0; x < headers; x++) {
+		esl_snprintf(name, sizeof(name), "variable_bench_header_%d", x);
+		esl_snprintf(value, sizeof(value), "value %d with spaces, a colon: and 100%% of the usual escapes", x);
+		esl_event_add_header_string(event, ESL_STACK_BOTTOM, name, value);
+	}
+
+	esl_event_serialize(event, &body, ESL_TRUE);
+	f.len[0] = frame(formats[0], body, strlen(body), &f.msg[0]);
+	free(body);
+
+	esl_event_serialize_json(event, &body);
+	f.len[1] = frame(formats[1], body, strlen(body), &f.msg[1]);
+	free(body);
+
+	blen = serialize_binary(event, &body);
+	f.len[2] = frame(formats[2], body, blen, &f.msg[2]);
+	free(body);
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, socks)) {
+		perror("socketpair");
+		return 1;
+	}
+
+	f.sock = socks[1];
+	esl_thread_create_detached(feeder, &f);
+
+	if (esl_attach_handle(&handle, socks[0], NULL) != ESL_SUCCESS) {
+		printf("attach failed\n");
+		return 1;
+	}
+
+	for (i = 0; i < MAX_FORMATS; i++) {
+		gettimeofday(&start, NULL);
+
+		for (x = 0; x < f.loops; x++) {
+			if (esl_recv_event(&handle, 0, NULL) != ESL_SUCCESS || !handle.last_ievent ||
+				!esl_event_get_header(handle.last_ievent, "variable_bench_header_0")) {
+				printf("%s: decode failed at %d\n", formats[i], x);
+				return 1;
+			}
+		}
+
+		gettimeofday(&end, NULL);
+
+		printf("%-18s %6ld bytes %8.2f us/event\n", formats[i], (long) f.len[i],
+			   ((end.tv_sec - start.tv_sec) * 1000000.0 + (end.tv_usec - start.tv_usec)) / f.loops);
+	}
+
+	esl_disconnect(&handle);
+	esl_event_destroy(&event);
+
+	for (i = 0; i < MAX_FORMATS; i++) {
+		free(f.msg[i]);
+	}
+
+	return 0;
+}
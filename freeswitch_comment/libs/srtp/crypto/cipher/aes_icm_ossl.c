@@ -106,6 +106,8 @@ extern cipher_type_t aes_icm_256;
  * value.  The tlen argument is for the AEAD tag length, which
  * isn't used in counter mode.
  */
+err_status_t aes_icm_openssl_dealloc (cipher_t *c);
+
 err_status_t aes_icm_openssl_alloc (cipher_t **c, int key_len, int tlen)
 {
     aes_icm_ctx_t *icm;
@@ -158,7 +160,15 @@ err_status_t aes_icm_openssl_alloc (cipher_t **c, int key_len, int tlen)
 
     /* set key size        */
     (*c)->key_len = key_len;
-    EVP_CIPHER_CTX_init(&icm->ctx);
+
+    /* the context lives on the heap, OpenSSL 1.1 and later keep the struct opaque */
+    icm->key_set = 0;
+    icm->ctx = EVP_CIPHER_CTX_new();
+    if (icm->ctx == NULL) {
+        aes_icm_openssl_dealloc(*c);
+        *c = NULL;
+        return err_status_alloc_fail;
+    }
 
     return err_status_ok;
 }
@@ -180,7 +190,10 @@ err_status_t aes_icm_openssl_dealloc (cipher_t *c)
      */
     ctx = (aes_icm_ctx_t*)c->state;
     if (ctx != NULL) {
-        EVP_CIPHER_CTX_cleanup(&ctx->ctx);
+        if (ctx->ctx) {
+            EVP_CIPHER_CTX_free(ctx->ctx);
+            ctx->ctx = NULL;
+        }
         /* decrement ref_count for the appropriate engine */
         switch (ctx->key_size) {
         case AES_256_KEYSIZE:
@@ -250,7 +263,8 @@ err_status_t aes_icm_openssl_context_init (aes_icm_ctx_t *c, const uint8_t *key)
     debug_print(mod_aes_icm, "key:  %s", v128_hex_string((v128_t*)&c->key));
     debug_print(mod_aes_icm, "offset: %s", v128_hex_string(&c->offset));
 
-    EVP_CIPHER_CTX_cleanup(&c->ctx);
+    EVP_CIPHER_CTX_cleanup(c->ctx);
+    c->key_set = 0;
 
     return err_status_ok;
 }
@@ -289,12 +303,17 @@ err_status_t aes_icm_openssl_set_iv (aes_icm_ctx_t *c, void *iv, int dir)
         break;
     }
 
-    if (!EVP_EncryptInit_ex(&c->ctx, evp,
-                            NULL, c->key.v8, c->counter.v8)) {
+    /* expand the key once, after that only the counter changes per packet */
+    if (!c->key_set) {
+        if (!EVP_EncryptInit_ex(c->ctx, evp, NULL, c->key.v8, c->counter.v8)) {
+            return err_status_fail;
+        }
+        c->key_set = 1;
+    } else if (!EVP_EncryptInit_ex(c->ctx, NULL, NULL, NULL, c->counter.v8)) {
         return err_status_fail;
-    } else {
-        return err_status_ok;
     }
+
+    return err_status_ok;
 }
 
 /*
@@ -311,12 +330,12 @@ err_status_t aes_icm_openssl_encrypt (aes_icm_ctx_t *c, unsigned char *buf, unsi
 
     debug_print(mod_aes_icm, "rs0: %s", v128_hex_string(&c->counter));
 
-    if (!EVP_EncryptUpdate(&c->ctx, buf, &len, buf, *enc_len)) {
+    if (!EVP_EncryptUpdate(c->ctx, buf, &len, buf, *enc_len)) {
         return err_status_cipher_fail;
     }
     *enc_len = len;
 
-    if (!EVP_EncryptFinal_ex(&c->ctx, buf, (int*)&len)) {
+    if (!EVP_EncryptFinal_ex(c->ctx, buf, (int*)&len)) {
         return err_status_cipher_fail;
     }
     *enc_len += len;
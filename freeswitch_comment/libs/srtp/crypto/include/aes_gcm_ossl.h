@@ -55,8 +55,9 @@ typedef struct {
   v256_t   key;
   int      key_size;
   int      tag_len;
-  EVP_CIPHER_CTX ctx;
+  EVP_CIPHER_CTX *ctx;
   cipher_direction_t dir;
+  cipher_direction_t key_dir;  /* direction ctx was keyed for, direction_any when it needs a key */
 } aes_gcm_ctx_t;
 
 #endif /* AES_GCM_OSSL_H */
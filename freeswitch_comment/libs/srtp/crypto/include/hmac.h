@@ -51,11 +51,13 @@
 
 typedef struct {
   uint8_t    opad[64];
+#ifdef OPENSSL
+  /* heap allocated, EVP_MD_CTX is opaque from OpenSSL 1.1 on */
+  sha1_ctx_t *ctx;
+  sha1_ctx_t *init_ctx;
+#else
   sha1_ctx_t ctx;
   sha1_ctx_t init_ctx;
-#ifdef OPENSSL
-  int ctx_initialized;
-  int init_ctx_initialized;
 #endif
 } hmac_ctx_t;
 
@@ -69,8 +69,8 @@ typedef EVP_MD_CTX sha1_ctx_t;
 
 static inline void sha1_init (sha1_ctx_t *ctx)
 {
-    EVP_MD_CTX_init(ctx);
-    EVP_DigestInit(ctx, EVP_sha1());
+    /* the _ex calls reuse the digest state instead of freeing it on every packet */
+    EVP_DigestInit_ex(ctx, EVP_sha1(), NULL);
 }
 
 static inline void sha1_update (sha1_ctx_t *ctx, const uint8_t *M, int octets_in_msg)
@@ -82,7 +82,7 @@ static inline void sha1_final (sha1_ctx_t *ctx, uint32_t *output)
 {
     unsigned int len = 0;
 
-    EVP_DigestFinal(ctx, (unsigned char*)output, &len);
+    EVP_DigestFinal_ex(ctx, (unsigned char*)output, &len);
 }
 #else
 #include "datatypes.h"
@@ -0,0 +1,40 @@
+-- Load a conference with loopback members to exercise the audio mixer. luarun
+-- usage: luarun conference_stress.lua <conference> [members=1000] [speakers=3] [profile=default]
+-- Speakers play a tone, everyone else just listens. Run it again with "hupall" to clean up:
+--   hupall normal_clearing conference_stress true
+
+local conf = argv[1];
+local members = tonumber(argv[2]) or 1000;
+local speakers = tonumber(argv[3]) or 3;
+local profile = argv[4] or "default";
+local api = freeswitch.API();
+
+if (not conf) then
+   freeswitch.console_log("err", "usage: luarun conference_stress.lua <conference> [members] [speakers] [profile]\n");
+   return;
+end
+
+local vars = "{conference_stress=true,ignore_early_media=true,origination_caller_id_name=stress}";
+
+for i = 1, members do
+   local app;
+
+   if (i <= speakers) then
+      app = "&playback(tone_stream://%(1000,0,440);loops=-1)";
+   else
+      app = "&park()";
+   end
+
+   api:execute("bgapi", "originate " .. vars .. "loopback/app=conference:" .. conf .. "@" .. profile .. " " .. app);
+
+   -- stay under sessions-per-second
+   if (i % 25 == 0) then
+      freeswitch.msleep(1000);
+   end
+end
+
+freeswitch.console_log("info", "Started " .. members .. " members in " .. conf .. ", letting the mixer settle\n");
+freeswitch.msleep(10000);
+
+freeswitch.console_log("info", "count: " .. api:execute("conference", conf .. " get count") .. "\n");
+freeswitch.console_log("info", "mix: " .. api:execute("conference", conf .. " get mix_stats") .. "\n");
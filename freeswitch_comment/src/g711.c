@@ -32,6 +32,7 @@
 #endif
 #endif
 
+#include "switch.h"
 #include "g711.h"
 
 /* Copied from the CCITT G.711 specification */
@@ -88,6 +89,338 @@ uint8_t ulaw_to_alaw(uint8_t ulaw)
 	return ulaw_to_alaw_table[ulaw];
 }
 
+/*- End of function --------------------------------------------------------*/
+/*
+ * Bulk conversion.  The table set decodes through 256 entry tables, 512 bytes each, which stay
+ * in cache where the 64K encode tables the note in g711.h warns about would not.  The SIMD
+ * sets find the segment from the exponent of the magnitude converted to float, and do the
+ * per lane shifts as multiplies by a power of two built the same way, so they need neither
+ * a table nor variable shifts.
+ */
+
+static int16_t ulaw_decode_table[256];
+static int16_t alaw_decode_table[256];
+
+static void c_linear_to_ulaw(uint8_t *ulaw, const int16_t *linear, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples; i++)
+		ulaw[i] = linear_to_ulaw(linear[i]);
+}
+
+static void c_ulaw_to_linear(int16_t *linear, const uint8_t *ulaw, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples; i++)
+		linear[i] = ulaw_to_linear(ulaw[i]);
+}
+
+static void c_linear_to_alaw(uint8_t *alaw, const int16_t *linear, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples; i++)
+		alaw[i] = linear_to_alaw(linear[i]);
+}
+
+static void c_alaw_to_linear(int16_t *linear, const uint8_t *alaw, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples; i++)
+		linear[i] = alaw_to_linear(alaw[i]);
+}
+
+static void c_l16_swap(int16_t *out, const int16_t *in, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples; i++)
+		out[i] = (int16_t) (((uint16_t) in[i] >> 8) | ((uint16_t) in[i] << 8));
+}
+
+static void table_ulaw_to_linear(int16_t *linear, const uint8_t *ulaw, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples; i++)
+		linear[i] = ulaw_decode_table[ulaw[i]];
+}
+
+static void table_alaw_to_linear(int16_t *linear, const uint8_t *alaw, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples; i++)
+		linear[i] = alaw_decode_table[alaw[i]];
+}
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define G711_X86_SIMD
+#include <immintrin.h>
+
+#define SSE4_TARGET __attribute__((target("sse4.1")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+/* 2^n per lane for n in 0..30 */
+#define POW2_128(n) _mm_cvttps_epi32(_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32((n), _mm_set1_epi32(127)), 23)))
+#define POW2_256(n) _mm256_cvttps_epi32(_mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32((n), _mm256_set1_epi32(127)), 23)))
+
+/* position of the top set bit of v | 0xFF, v below 2^24 */
+#define TOPBIT_128(v) _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(_mm_cvtepi32_ps(_mm_or_si128((v), _mm_set1_epi32(0xFF)))), 23), _mm_set1_epi32(127))
+#define TOPBIT_256(v) _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(_mm256_or_si256((v), _mm256_set1_epi32(0xFF)))), 23), _mm256_set1_epi32(127))
+
+static SSE4_TARGET inline __m128i sse4_ulaw_enc(__m128i x)
+{
+	__m128i neg = _mm_srai_epi32(x, 31);
+	__m128i mag = _mm_add_epi32(_mm_abs_epi32(x), _mm_set1_epi32(ULAW_BIAS));
+	__m128i seg = _mm_sub_epi32(TOPBIT_128(mag), _mm_set1_epi32(7));
+	/* (mag >> (seg + 3)) as (mag << (8 - seg)) >> 11 */
+	__m128i mant = _mm_srli_epi32(_mm_mullo_epi32(mag, POW2_128(_mm_sub_epi32(_mm_set1_epi32(8), seg))), 11);
+	/* seg 8 is out of range, clipping it to 0x7F is the same as the scalar code */
+	__m128i code = _mm_min_epi32(_mm_or_si128(_mm_slli_epi32(seg, 4), _mm_and_si128(mant, _mm_set1_epi32(0x0F))), _mm_set1_epi32(0x7F));
+
+	return _mm_xor_si128(code, _mm_xor_si128(_mm_set1_epi32(0xFF), _mm_and_si128(neg, _mm_set1_epi32(0x80))));
+}
+
+static SSE4_TARGET inline __m128i sse4_alaw_enc(__m128i x)
+{
+	__m128i neg = _mm_srai_epi32(x, 31);
+	/* negative input is -linear - 8, the scalar code gives -7..-1 the code of 0 */
+	__m128i lin = _mm_max_epi32(_mm_add_epi32(_mm_abs_epi32(x), _mm_and_si128(neg, _mm_set1_epi32(-8))), _mm_setzero_si128());
+	__m128i seg = _mm_sub_epi32(TOPBIT_128(lin), _mm_set1_epi32(7));
+	/* segment 0 shifts by 4 like segment 1 */
+	__m128i sh = _mm_max_epi32(seg, _mm_set1_epi32(1));
+	__m128i mant = _mm_srli_epi32(_mm_mullo_epi32(lin, POW2_128(_mm_sub_epi32(_mm_set1_epi32(8), sh))), 11);
+	__m128i code = _mm_or_si128(_mm_slli_epi32(seg, 4), _mm_and_si128(mant, _mm_set1_epi32(0x0F)));
+
+	return _mm_xor_si128(code, _mm_xor_si128(_mm_set1_epi32(ALAW_AMI_MASK | 0x80), _mm_and_si128(neg, _mm_set1_epi32(0x80))));
+}
+
+static SSE4_TARGET inline __m128i sse4_ulaw_dec(__m128i u)
+{
+	__m128i sign, t;
+
+	u = _mm_xor_si128(u, _mm_set1_epi32(0xFF));
+	t = _mm_add_epi32(_mm_slli_epi32(_mm_and_si128(u, _mm_set1_epi32(0x0F)), 3), _mm_set1_epi32(ULAW_BIAS));
+	t = _mm_mullo_epi32(t, POW2_128(_mm_srli_epi32(_mm_and_si128(u, _mm_set1_epi32(0x70)), 4)));
+	/* -1 where the sign bit is set, 1 elsewhere */
+	sign = _mm_or_si128(_mm_srai_epi32(_mm_slli_epi32(u, 24), 31), _mm_set1_epi32(1));
+
+	return _mm_sign_epi32(_mm_sub_epi32(t, _mm_set1_epi32(ULAW_BIAS)), sign);
+}
+
+static SSE4_TARGET inline __m128i sse4_alaw_dec(__m128i a)
+{
+	__m128i i, seg, zero, sign;
+
+	a = _mm_xor_si128(a, _mm_set1_epi32(ALAW_AMI_MASK));
+	i = _mm_slli_epi32(_mm_and_si128(a, _mm_set1_epi32(0x0F)), 4);
+	seg = _mm_srli_epi32(_mm_and_si128(a, _mm_set1_epi32(0x70)), 4);
+	zero = _mm_cmpeq_epi32(seg, _mm_setzero_si128());
+	i = _mm_add_epi32(i, _mm_blendv_epi8(_mm_set1_epi32(0x108), _mm_set1_epi32(8), zero));
+	i = _mm_mullo_epi32(i, POW2_128(_mm_sub_epi32(_mm_max_epi32(seg, _mm_set1_epi32(1)), _mm_set1_epi32(1))));
+	/* 1 where the sign bit is set, -1 elsewhere */
+	sign = _mm_or_si128(_mm_xor_si128(_mm_srai_epi32(_mm_slli_epi32(a, 24), 31), _mm_set1_epi32(-1)), _mm_set1_epi32(1));
+
+	return _mm_sign_epi32(i, sign);
+}
+
+#define SSE4_ENCODER(name, enc, scalar) \
+static SSE4_TARGET void name(uint8_t *out, const int16_t *linear, int samples) \
+{ \
+	int i; \
+\
+	for (i = 0; i + 8 <= samples; i += 8) { \
+		__m128i x = _mm_loadu_si128((const __m128i *) (linear + i)); \
+		__m128i lo = enc(_mm_cvtepi16_epi32(x)); \
+		__m128i hi = enc(_mm_cvtepi16_epi32(_mm_srli_si128(x, 8))); \
+		__m128i w = _mm_packus_epi32(lo, hi); \
+		_mm_storel_epi64((__m128i *) (out + i), _mm_packus_epi16(w, w)); \
+	} \
+	for (; i < samples; i++) \
+		out[i] = scalar(linear[i]); \
+}
+
+#define SSE4_DECODER(name, dec, scalar) \
+static SSE4_TARGET void name(int16_t *linear, const uint8_t *in, int samples) \
+{ \
+	int i; \
+\
+	for (i = 0; i + 8 <= samples; i += 8) { \
+		__m128i x = _mm_loadl_epi64((const __m128i *) (in + i)); \
+		__m128i lo = dec(_mm_cvtepu8_epi32(x)); \
+		__m128i hi = dec(_mm_cvtepu8_epi32(_mm_srli_si128(x, 4))); \
+		_mm_storeu_si128((__m128i *) (linear + i), _mm_packs_epi32(lo, hi)); \
+	} \
+	for (; i < samples; i++) \
+		linear[i] = scalar(in[i]); \
+}
+
+SSE4_ENCODER(sse4_linear_to_ulaw, sse4_ulaw_enc, linear_to_ulaw)
+SSE4_ENCODER(sse4_linear_to_alaw, sse4_alaw_enc, linear_to_alaw)
+SSE4_DECODER(sse4_ulaw_to_linear, sse4_ulaw_dec, ulaw_to_linear)
+SSE4_DECODER(sse4_alaw_to_linear, sse4_alaw_dec, alaw_to_linear)
+
+static SSE4_TARGET void sse4_l16_swap(int16_t *out, const int16_t *in, int samples)
+{
+	const __m128i swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	int i;
+
+	for (i = 0; i + 8 <= samples; i += 8)
+		_mm_storeu_si128((__m128i *) (out + i), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (in + i)), swap));
+
+	c_l16_swap(out + i, in + i, samples - i);
+}
+
+static AVX2_TARGET inline __m256i avx2_ulaw_enc(__m256i x)
+{
+	__m256i neg = _mm256_srai_epi32(x, 31);
+	__m256i mag = _mm256_add_epi32(_mm256_abs_epi32(x), _mm256_set1_epi32(ULAW_BIAS));
+	__m256i seg = _mm256_sub_epi32(TOPBIT_256(mag), _mm256_set1_epi32(7));
+	__m256i mant = _mm256_srlv_epi32(mag, _mm256_add_epi32(seg, _mm256_set1_epi32(3)));
+	__m256i code = _mm256_min_epi32(_mm256_or_si256(_mm256_slli_epi32(seg, 4), _mm256_and_si256(mant, _mm256_set1_epi32(0x0F))), _mm256_set1_epi32(0x7F));
+
+	return _mm256_xor_si256(code, _mm256_xor_si256(_mm256_set1_epi32(0xFF), _mm256_and_si256(neg, _mm256_set1_epi32(0x80))));
+}
+
+static AVX2_TARGET inline __m256i avx2_alaw_enc(__m256i x)
+{
+	__m256i neg = _mm256_srai_epi32(x, 31);
+	__m256i lin = _mm256_max_epi32(_mm256_add_epi32(_mm256_abs_epi32(x), _mm256_and_si256(neg, _mm256_set1_epi32(-8))), _mm256_setzero_si256());
+	__m256i seg = _mm256_sub_epi32(TOPBIT_256(lin), _mm256_set1_epi32(7));
+	__m256i mant = _mm256_srlv_epi32(lin, _mm256_add_epi32(_mm256_max_epi32(seg, _mm256_set1_epi32(1)), _mm256_set1_epi32(3)));
+	__m256i code = _mm256_or_si256(_mm256_slli_epi32(seg, 4), _mm256_and_si256(mant, _mm256_set1_epi32(0x0F)));
+
+	return _mm256_xor_si256(code, _mm256_xor_si256(_mm256_set1_epi32(ALAW_AMI_MASK | 0x80), _mm256_and_si256(neg, _mm256_set1_epi32(0x80))));
+}
+
+static AVX2_TARGET inline __m256i avx2_ulaw_dec(__m256i u)
+{
+	__m256i sign, t;
+
+	u = _mm256_xor_si256(u, _mm256_set1_epi32(0xFF));
+	t = _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(u, _mm256_set1_epi32(0x0F)), 3), _mm256_set1_epi32(ULAW_BIAS));
+	t = _mm256_sllv_epi32(t, _mm256_srli_epi32(_mm256_and_si256(u, _mm256_set1_epi32(0x70)), 4));
+	sign = _mm256_or_si256(_mm256_srai_epi32(_mm256_slli_epi32(u, 24), 31), _mm256_set1_epi32(1));
+
+	return _mm256_sign_epi32(_mm256_sub_epi32(t, _mm256_set1_epi32(ULAW_BIAS)), sign);
+}
+
+static AVX2_TARGET inline __m256i avx2_alaw_dec(__m256i a)
+{
+	__m256i i, seg, zero, sign;
+
+	a = _mm256_xor_si256(a, _mm256_set1_epi32(ALAW_AMI_MASK));
+	i = _mm256_slli_epi32(_mm256_and_si256(a, _mm256_set1_epi32(0x0F)), 4);
+	seg = _mm256_srli_epi32(_mm256_and_si256(a, _mm256_set1_epi32(0x70)), 4);
+	zero = _mm256_cmpeq_epi32(seg, _mm256_setzero_si256());
+	i = _mm256_add_epi32(i, _mm256_blendv_epi8(_mm256_set1_epi32(0x108), _mm256_set1_epi32(8), zero));
+	i = _mm256_sllv_epi32(i, _mm256_sub_epi32(_mm256_max_epi32(seg, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+	sign = _mm256_or_si256(_mm256_xor_si256(_mm256_srai_epi32(_mm256_slli_epi32(a, 24), 31), _mm256_set1_epi32(-1)), _mm256_set1_epi32(1));
+
+	return _mm256_sign_epi32(i, sign);
+}
+
+/* packus/packs work within 128 bit lanes, the permute puts the 16 results back in order */
+#define AVX2_ENCODER(name, enc, scalar) \
+static AVX2_TARGET void name(uint8_t *out, const int16_t *linear, int samples) \
+{ \
+	int i; \
+\
+	for (i = 0; i + 16 <= samples; i += 16) { \
+		__m256i lo = enc(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (linear + i)))); \
+		__m256i hi = enc(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (linear + i + 8)))); \
+		__m256i w = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8); \
+		_mm_storeu_si128((__m128i *) (out + i), _mm_packus_epi16(_mm256_castsi256_si128(w), _mm256_extracti128_si256(w, 1))); \
+	} \
+	for (; i < samples; i++) \
+		out[i] = scalar(linear[i]); \
+}
+
+#define AVX2_DECODER(name, dec, scalar) \
+static AVX2_TARGET void name(int16_t *linear, const uint8_t *in, int samples) \
+{ \
+	int i; \
+\
+	for (i = 0; i + 16 <= samples; i += 16) { \
+		__m256i lo = dec(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (in + i)))); \
+		__m256i hi = dec(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (in + i + 8)))); \
+		_mm256_storeu_si256((__m256i *) (linear + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8)); \
+	} \
+	for (; i < samples; i++) \
+		linear[i] = scalar(in[i]); \
+}
+
+AVX2_ENCODER(avx2_linear_to_ulaw, avx2_ulaw_enc, linear_to_ulaw)
+AVX2_ENCODER(avx2_linear_to_alaw, avx2_alaw_enc, linear_to_alaw)
+AVX2_DECODER(avx2_ulaw_to_linear, avx2_ulaw_dec, ulaw_to_linear)
+AVX2_DECODER(avx2_alaw_to_linear, avx2_alaw_dec, alaw_to_linear)
+
+static AVX2_TARGET void avx2_l16_swap(int16_t *out, const int16_t *in, int samples)
+{
+	const __m256i swap = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+										  1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	int i;
+
+	for (i = 0; i + 16 <= samples; i += 16)
+		_mm256_storeu_si256((__m256i *) (out + i), _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *) (in + i)), swap));
+
+	c_l16_swap(out + i, in + i, samples - i);
+}
+#endif
+
+/* fastest first */
+static const g711_kernels_t kernel_sets[] = {
+#ifdef G711_X86_SIMD
+	{"avx2", avx2_linear_to_ulaw, avx2_ulaw_to_linear, avx2_linear_to_alaw, avx2_alaw_to_linear, avx2_l16_swap},
+	{"sse4.1", sse4_linear_to_ulaw, sse4_ulaw_to_linear, sse4_linear_to_alaw, sse4_alaw_to_linear, sse4_l16_swap},
+#endif
+	{"table", c_linear_to_ulaw, table_ulaw_to_linear, c_linear_to_alaw, table_alaw_to_linear, c_l16_swap},
+	{"c", c_linear_to_ulaw, c_ulaw_to_linear, c_linear_to_alaw, c_alaw_to_linear, c_l16_swap}
+};
+
+static int kernel_supported(const g711_kernels_t *k)
+{
+#ifdef G711_X86_SIMD
+	if (!strcmp(k->name, "avx2")) {
+		return __builtin_cpu_supports("avx2");
+	}
+	if (!strcmp(k->name, "sse4.1")) {
+		return __builtin_cpu_supports("sse4.1");
+	}
+#endif
+	return 1;
+}
+
+SWITCH_DECLARE(const g711_kernels_t *) g711_kernels(int index)
+{
+	static int ready = 0;
+	size_t i;
+	int x;
+
+	if (!ready) {
+		for (x = 0; x < 256; x++) {
+			ulaw_decode_table[x] = ulaw_to_linear((uint8_t) x);
+			alaw_decode_table[x] = alaw_to_linear((uint8_t) x);
+		}
+#ifdef G711_X86_SIMD
+		__builtin_cpu_init();
+#endif
+		ready = 1;
+	}
+
+	for (i = 0; i < sizeof(kernel_sets) / sizeof(kernel_sets[0]); i++) {
+		if (kernel_supported(&kernel_sets[i]) && !index--) {
+			return &kernel_sets[i];
+		}
+	}
+
+	return NULL;
+}
+
 /*- End of function --------------------------------------------------------*/
 /*- End of file ------------------------------------------------------------*/
 
@@ -335,6 +335,22 @@ extern "C" {
 */
 	uint8_t ulaw_to_alaw(uint8_t ulaw);
 
+/*! \brief Bulk versions of the routines above, plus the L16 byte swap between host and
+    network order.  Every set gives the same output as the per sample routines. */
+	typedef struct {
+		const char *name;
+		void (*linear_to_ulaw) (uint8_t *ulaw, const int16_t *linear, int samples);
+		void (*ulaw_to_linear) (int16_t *linear, const uint8_t *ulaw, int samples);
+		void (*linear_to_alaw) (uint8_t *alaw, const int16_t *linear, int samples);
+		void (*alaw_to_linear) (int16_t *linear, const uint8_t *alaw, int samples);
+		void (*l16_swap) (int16_t *out, const int16_t *in, int samples);
+	} g711_kernels_t;
+
+/*! \brief Get a set of bulk routines the running cpu supports.
+    \param index 0 for the fastest, counting up through slower ones to the plain C set.
+    \return The set, or NULL past the last one. */
+	SWITCH_DECLARE(const g711_kernels_t *) g711_kernels(int index);
+
 #ifdef __cplusplus
 }
 #endif
@@ -184,12 +184,46 @@ struct switch_core_session {
 	uint32_t soft_lock;
 	switch_ivr_dmachine_t *dmachine[2];
 	plc_state_t *plc;
+	/* decoded audio the jitter buffer time stretch has produced ahead of the read */
+	switch_buffer_t *stretch_read_buffer;
+	/* per frame timing of the audio path, allocated the first time tracing is turned on */
+	switch_media_trace_t *media_trace;
 
 	switch_media_handle_t *media_handle;
 	uint32_t decoder_errors;
 	switch_core_video_thread_callback_func_t video_read_callback;
 	void *video_read_user_data;
 	switch_slin_data_t *sdata;
+	/* under the session scheduler: asleep with no thread, the wake that clears it puts the session back on a worker */
+	uint8_t sched_parked;
+	uint32_t sched_worker;
+	uint32_t sched_new_loops;
+};
+
+/* values under 16us get a bucket each, above that 8 buckets per power of two up to 2^31us */
+#define MEDIA_TRACE_BUCKETS (16 + 27 * 8)
+
+typedef struct {
+	uint64_t count;
+	uint64_t max;
+	uint32_t buckets[MEDIA_TRACE_BUCKETS];
+} switch_media_trace_hist_t;
+
+struct switch_media_trace {
+	volatile int on;
+	uint64_t arrival;				/* tick the packet behind the frame being read came off the socket, 0 if none did */
+	uint64_t jb_tick;				/* tick that packet left the jitter buffer, 0 if it did not use one */
+	uint64_t recv_tick;				/* last tick seen from the rtp session */
+	uint64_t read_start;
+	uint64_t read_mark;
+	uint64_t write_mark;
+	uint64_t lap[SMT_STAGE_MAX];	/* ticks the frame in flight spent in each stage */
+	uint32_t read_hits;				/* bit per stage the frame in flight went through, read and write side */
+	uint32_t write_hits;
+	switch_frame_t *read_out;		/* frame read_frame last returned, until something writes it */
+	uint64_t read_out_tick;
+	uint64_t read_out_arrival;
+	switch_media_trace_hist_t hist[SMT_STAGE_MAX];
 };
 
 struct switch_media_bug {
@@ -318,10 +352,20 @@ struct switch_session_manager {
 
 extern struct switch_session_manager session_manager;
 
+typedef enum {
+	SCS_SLICE_PARKED,
+	SCS_SLICE_BLOCKING,
+	SCS_SLICE_DONE
+} switch_core_session_slice_t;
+
+switch_core_session_slice_t switch_core_session_run_slice(switch_core_session_t *session, switch_bool_t dedicated);
+
 
 
 switch_status_t switch_core_sqldb_start(switch_memory_pool_t *pool, switch_bool_t manage);
 void switch_core_sqldb_stop(void);
+void switch_core_channel_store_event(switch_event_t *event);
+void switch_core_channel_store_set_var(const char *uuid, switch_event_t *variables, const char *varname);
 void switch_core_session_init(switch_memory_pool_t *pool);
 void switch_core_session_uninit(void);
 void switch_core_state_machine_init(switch_memory_pool_t *pool);
@@ -424,6 +424,49 @@ SWITCH_DECLARE(void) switch_atomic_inc(volatile switch_atomic_t *mem);
  */
 SWITCH_DECLARE(int)  switch_atomic_dec(volatile switch_atomic_t *mem);
 
+/** Counter type for the 64 bit atomic operations */
+typedef uint64_t switch_atomic64_t;
+
+/**
+ * Uses an atomic operation to read the uint64 value at the location specified
+ * by mem.
+ * @param mem The location of memory which stores the value to read.
+ */
+SWITCH_DECLARE(uint64_t) switch_atomic64_read(volatile switch_atomic64_t *mem);
+
+/**
+ * Uses an atomic operation to set the uint64 value at a specified location of
+ * memory.
+ * @param mem The location of memory to set.
+ * @param val The uint64 value to set the memory location to.
+ */
+SWITCH_DECLARE(void) switch_atomic64_set(volatile switch_atomic64_t *mem, uint64_t val);
+
+/**
+ * Uses an atomic operation to add the uint64 value to the value at the
+ * specified location of memory.
+ * @param mem The location of the value to add to.
+ * @param val The uint64 value to add to the value at the memory location.
+ */
+SWITCH_DECLARE(void) switch_atomic64_add(volatile switch_atomic64_t *mem, uint64_t val);
+
+/**
+ * Uses an atomic operation to increment the value at the specified memory
+ * location.
+ * @param mem The location of the value to increment.
+ * @return the value after the increment
+ */
+SWITCH_DECLARE(uint64_t) switch_atomic64_inc(volatile switch_atomic64_t *mem);
+
+/**
+ * Compare the uint64 value at mem with cmp and swap in with if they match.
+ * @param mem The location of the value.
+ * @param with The value to swap in.
+ * @param cmp The value to compare with.
+ * @return the value at mem before the call, the swap happened if it equals cmp
+ */
+SWITCH_DECLARE(uint64_t) switch_atomic64_cas(volatile switch_atomic64_t *mem, uint64_t with, uint64_t cmp);
+
 /** @} */
 
 /**
@@ -1116,6 +1159,23 @@ SWITCH_DECLARE(int32_t) switch_sockaddr_get_family(switch_sockaddr_t *sa);
 SWITCH_DECLARE(switch_status_t) switch_sockaddr_ip_get(char **addr, switch_sockaddr_t *sa);
 SWITCH_DECLARE(int) switch_sockaddr_equal(const switch_sockaddr_t *sa1, const switch_sockaddr_t *sa2);
 
+/**
+ * Fill in a sockaddr from a native one, the way switch_socket_recvfrom would have
+ * @param sa The sockaddr to fill in
+ * @param native A struct sockaddr_in or sockaddr_in6 as returned by the OS
+ * @param len The length of native
+ */
+SWITCH_DECLARE(switch_status_t) switch_sockaddr_set_native(switch_sockaddr_t *sa, const void *native, uint32_t len);
+
+/**
+ * Copy out the native sockaddr, to hand to the OS directly
+ * @param sa The sockaddr to copy
+ * @param native Where to put the struct sockaddr_in or sockaddr_in6
+ * @param len The room in native
+ * @return the length copied, 0 if it doesn't fit
+ */
+SWITCH_DECLARE(uint32_t) switch_sockaddr_get_native(switch_sockaddr_t *sa, void *native, uint32_t len);
+
 
 /**
  * Create apr_sockaddr_t from hostname, address family, and port.
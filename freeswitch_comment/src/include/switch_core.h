@@ -69,6 +69,39 @@ typedef struct switch_thread_data_s {
 	switch_memory_pool_t *pool;
 } switch_thread_data_t;
 
+/*! \brief Counters from the session scheduler workers, summed over all of them */
+typedef struct switch_core_session_scheduler_stats_s {
+	uint32_t workers;
+	uint32_t parked;
+	uint64_t slices;
+	uint64_t resumes;
+	uint64_t steals;
+	uint64_t handoffs;
+} switch_core_session_scheduler_stats_t;
+
+/*! \brief Memory pools as a whole, see switch_core_memory_pool_stats */
+typedef struct switch_memory_pool_stats_s {
+	uint32_t shards;
+	uint32_t pools;
+	uint32_t idle;
+	uint32_t cache;
+	uint64_t created;
+	uint64_t reused;
+	uint64_t trimmed;
+	switch_size_t bytes;
+} switch_memory_pool_stats_t;
+
+/*! \brief The live pools of one tag (the file:line that created them unless retagged) */
+typedef struct switch_memory_pool_tag_stats_s {
+	const char *tag;
+	uint32_t pools;
+	uint64_t created;
+	switch_size_t bytes;
+	switch_size_t peak;
+} switch_memory_pool_tag_stats_t;
+
+typedef void (*switch_memory_pool_tag_callback_t) (const switch_memory_pool_tag_stats_t *stats, void *pvt);
+
 typedef struct switch_hold_record_s {
 	switch_time_t on;
 	switch_time_t off;
@@ -616,8 +649,33 @@ SWITCH_DECLARE(void) switch_core_remove_state_handler(_In_ const switch_state_ha
 SWITCH_DECLARE(const switch_state_handler_table_t *) switch_core_get_state_handler(_In_ int index);
 ///\}
 
+/*!
+  \brief Tag a memory pool, its allocations are accounted to the tag from then on
+  \param pool the pool to tag
+  \param tag the tag, it has to live as long as the pool
+*/
 SWITCH_DECLARE(void) switch_core_memory_pool_tag(switch_memory_pool_t *pool, const char *tag);
 
+/*!
+  \brief Set how many idle pool allocators are kept warm for new pools
+  \param allocators the number of allocators, 0 gives every pool a fresh one
+*/
+SWITCH_DECLARE(void) switch_core_memory_pool_set_cache(uint32_t allocators);
+
+/*!
+  \brief Get the memory pool counters
+  \param stats filled in, bytes is what the live pools handed out through the switch_core_* allocators
+*/
+SWITCH_DECLARE(void) switch_core_memory_pool_stats(switch_memory_pool_stats_t *stats);
+
+/*!
+  \brief Walk the pool tags
+  \param callback called once per tag that ever had a pool, with no locks held
+  \param pvt passed to the callback
+  \return the number of tags
+*/
+SWITCH_DECLARE(uint32_t) switch_core_memory_pool_tag_stats(switch_memory_pool_tag_callback_t callback, void *pvt);
+
 SWITCH_DECLARE(switch_status_t) switch_core_perform_new_memory_pool(_Out_ switch_memory_pool_t **pool,
 																	_In_z_ const char *file, _In_z_ const char *func, _In_ int line);
 
@@ -847,6 +905,21 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_thread_launch(_In_ switch_co
 SWITCH_DECLARE(switch_status_t) switch_thread_pool_launch_thread(switch_thread_data_t **tdp);
 SWITCH_DECLARE(switch_status_t) switch_core_session_thread_pool_launch(switch_core_session_t *session);
 
+/*!
+  \brief Start the session scheduler
+  \param threads workers with work-stealing queues that run sessions between blocking steps, 0 gives every session a thread of its own
+  \return the number of workers in effect
+  \note the scheduler can only be started once, sessions that sleep on it hold no thread and the
+  states that run applications or media still get a dedicated one from the session thread pool
+*/
+SWITCH_DECLARE(uint32_t) switch_core_session_set_scheduler_threads(uint32_t threads);
+
+/*!
+  \brief Get the session scheduler counters
+  \param stats filled in, all zero when the scheduler isn't running
+*/
+SWITCH_DECLARE(void) switch_core_session_scheduler_stats(switch_core_session_scheduler_stats_t *stats);
+
 /*! 
   \brief Retrieve a pointer to the channel object associated with a given session
   \param session the session to retrieve from
@@ -1340,6 +1413,69 @@ SWITCH_DECLARE(void) switch_core_session_reset(_In_ switch_core_session_t *sessi
 SWITCH_DECLARE(switch_status_t) switch_core_session_write_frame(_In_ switch_core_session_t *session, switch_frame_t *frame, switch_io_flag_t flags,
 																int stream_id);
 
+/*! 
+  \brief Check if audio can go from one session to another as is, without the codec, media bug or hook layers
+  \param session the session that would be read
+  \param peer_session the session that would be written
+  \return SWITCH_TRUE if both legs use the same codec and nothing is watching or altering their media
+  \note cheap enough to ask on every frame, the answer changes as soon as a media bug or hook is added
+*/
+SWITCH_DECLARE(switch_bool_t) switch_core_session_relay_ready(_In_ switch_core_session_t *session, _In_ switch_core_session_t *peer_session);
+
+/*! 
+  \brief Read a frame straight from the endpoint, for relaying with switch_core_session_relay_write
+  \param session the session to read from
+  \param frame a NULL pointer to a frame to aim at the newly read frame
+  \param flags I/O flags to modify behavior (i.e. non blocking)
+  \param stream_id which logical media channel to use
+  \return SWITCH_STATUS_SUCCESS a the frame was read
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_session_relay_read(_In_ switch_core_session_t *session, switch_frame_t **frame, switch_io_flag_t flags,
+															   int stream_id);
+
+/*! 
+  \brief Write a frame from switch_core_session_relay_read straight to the endpoint
+  \param session the session to write to
+  \param frame the frame to write, still encoded with the other leg's codec
+  \param flags I/O flags to modify behavior (i.e. non blocking)
+  \param stream_id which logical media channel to use
+  \return SWITCH_STATUS_SUCCESS a the frame was written
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_session_relay_write(_In_ switch_core_session_t *session, switch_frame_t *frame, switch_io_flag_t flags,
+																int stream_id);
+
+/*!
+  \brief Time every stage of the audio a session reads and writes (see switch_media_trace_stage_t)
+  \param session the session to trace
+  \param on SWITCH_TRUE to start timing, SWITCH_FALSE to stop, the figures gathered so far are kept
+  \return SWITCH_STATUS_SUCCESS or SWITCH_STATUS_MEMERR
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_session_media_trace(_In_ switch_core_session_t *session, switch_bool_t on);
+
+/*!
+  \brief Print count, p50, p90, p99 and max per stage
+  \param session a traced session, or NULL for the totals of every traced session that has hung up
+  \param stream the stream to print to
+*/
+SWITCH_DECLARE(void) switch_core_media_trace_report(switch_core_session_t *session, switch_stream_handle_t *stream);
+
+/*!
+  \brief Clear the totals kept across traced sessions
+*/
+SWITCH_DECLARE(void) switch_core_media_trace_reset(void);
+
+/*!
+  \brief Publish a traced session's figures as media_trace_* channel variables and add them to the totals
+  \param session the session that is hanging up
+*/
+SWITCH_DECLARE(void) switch_core_session_media_trace_hangup(_In_ switch_core_session_t *session);
+
+/*!
+  \brief Read the counter the media trace timestamps with, the tsc where there is one
+  \return the current tick
+*/
+SWITCH_DECLARE(uint64_t) switch_core_media_trace_tick(void);
+
 
 SWITCH_DECLARE(switch_status_t) switch_core_session_perform_kill_channel(_In_ switch_core_session_t *session,
 																		 const char *file, const char *func, int line, switch_signal_t sig);
@@ -2694,6 +2830,57 @@ SWITCH_DECLARE(void) switch_sql_queue_manager_resume(switch_sql_queue_manager_t
 SWITCH_DECLARE(int) switch_sql_queue_manager_size(switch_sql_queue_manager_t *qm, uint32_t index);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup);
+/*!
+  \brief Register a statement template with ? placeholders on a queue manager
+  \param qm the queue manager
+  \param sql the template, each ? is bound from the values given to switch_sql_queue_manager_push_bound
+  \return the statement id or -1 on failure
+  \note the queue thread prepares it once per handle and runs every push as a bind inside the batch transaction
+*/
+SWITCH_DECLARE(int) switch_sql_queue_manager_prepare(switch_sql_queue_manager_t *qm, const char *sql);
+/*!
+  \brief Queue one execution of a registered statement template
+  \param qm the queue manager
+  \param stmt_id the id from switch_sql_queue_manager_prepare
+  \param pos the queue to use
+  \param ... one const char * per placeholder, NULL binds SQL NULL
+  \return SWITCH_STATUS_SUCCESS if the values were queued
+*/
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_bound(switch_sql_queue_manager_t *qm, int stmt_id, uint32_t pos, ...);
+
+typedef enum {
+	SCS_VIEW_CHANNELS,
+	SCS_VIEW_BASIC_CALLS,
+	SCS_VIEW_DETAILED_CALLS,
+	SCS_VIEW_MAX
+} switch_channel_store_view_t;
+
+typedef enum {
+	SCSQ_COUNT = (1 << 0),
+	SCSQ_BRIDGED = (1 << 1),
+	SCSQ_ORDER_CALL = (1 << 2)
+} switch_channel_store_query_flag_enum_t;
+typedef uint32_t switch_channel_store_query_flag_t;
+
+typedef struct {
+	switch_channel_store_view_t view;
+	const char *hostname;
+	const char *call_uuid;
+	const char *state;
+	const char *like;
+	switch_channel_store_query_flag_t flags;
+} switch_channel_store_query_t;
+
+/*!
+  \brief Read the in-memory copy of the channels table or the basic_calls/detailed_calls views
+  \param query the view and filters, hostname/call_uuid/state are exact matches, like follows the show channels like rules
+  \param callback called once per row with the same columns the sql would return, or once with count(*) for SCSQ_COUNT
+  \param pArg user data for the callback
+  \return SWITCH_STATUS_FALSE if the store is not running
+  \note the matching rows are copied before the callback runs, the store is not locked while it does
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_channel_store_query(const switch_channel_store_query_t *query,
+																switch_core_db_callback_func_t callback, void *pArg);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_destroy(switch_sql_queue_manager_t **qmp);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *name,
 																   switch_sql_queue_manager_t **qmp, 
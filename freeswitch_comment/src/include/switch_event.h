@@ -73,6 +73,8 @@ SWITCH_BEGIN_EXTERN_C
 	int idx;
 	/*! hash of the header name */
 	unsigned long hash;
+	/*! which of the name, value and the header itself belong to the event's arena rather than malloc */
+	uint32_t flags;
 	struct switch_event_header *next;
 };
 
@@ -100,6 +102,14 @@ struct switch_event {
 	unsigned long key;
 	struct switch_event *next;
 	int flags;
+	/*! number of headers in the list */
+	uint32_t header_count;
+	/*! open addressed index of the headers by name hash, built once the event is big enough */
+	switch_event_header_t **index;
+	/*! number of slots in the index (a power of two, 0 when there is no index) */
+	uint32_t index_size;
+	/*! block allocator the headers of this event are carved from (NULL for events that are edited in place for a long time) */
+	struct switch_event_arena *arena;
 };
 
 typedef struct switch_serial_event_s {
@@ -315,6 +325,15 @@ SWITCH_DECLARE(switch_status_t) switch_event_binary_deserialize(switch_event_t *
 SWITCH_DECLARE(switch_status_t) switch_event_binary_serialize(switch_event_t *event, void **data, switch_size_t *len);
 SWITCH_DECLARE(switch_status_t) switch_event_serialize(switch_event_t *event, char **str, switch_bool_t encode);
 SWITCH_DECLARE(switch_status_t) switch_event_serialize_json(switch_event_t *event, char **str);
+/*!
+  \brief Render an event in the length-prefixed binary wire format used by the event socket "binary" format
+  \param event the event to render
+  \param str a string pointer to point at the allocated data
+  \param len the length of the rendered data
+  \return SWITCH_STATUS_SUCCESS if the operation was successful
+  \note you must free the resulting data when you are finished with it
+*/
+SWITCH_DECLARE(switch_status_t) switch_event_serialize_binary(switch_event_t *event, char **str, switch_size_t *len);
 SWITCH_DECLARE(switch_status_t) switch_event_serialize_json_obj(switch_event_t *event, cJSON **json);
 SWITCH_DECLARE(switch_status_t) switch_event_create_json(switch_event_t **event, const char *json);
 SWITCH_DECLARE(switch_status_t) switch_event_create_brackets(char *data, char a, char b, char c, switch_event_t **event, char **new_data, switch_bool_t dup);
@@ -399,7 +418,8 @@ static inline switch_status_t switch_event_create_plain(switch_event_t **event,
 /*!
   \brief Deliver an event to all of the registered event listeners
   \param event the event to send (will be nulled)
-  \note normaly use switch_event_fire for delivering events (only use this when you wish to deliver the event blocking on your thread)
+  \note normaly use switch_event_fire for delivering events, this one skips the dispatch queues.  Each listener
+  gets the event on its own bounded queue and runs on a pool thread, a listener whose queue is full misses it.
 */
 SWITCH_DECLARE(void) switch_event_deliver(switch_event_t **event);
 
@@ -425,8 +445,18 @@ SWITCH_DECLARE(int) switch_event_check_permission_list(switch_event_t *list, con
 SWITCH_DECLARE(void) switch_event_add_presence_data_cols(switch_channel_t *channel, switch_event_t *event, const char *prefix);
 SWITCH_DECLARE(void) switch_json_add_presence_data_cols(switch_event_t *event, cJSON *json, const char *prefix);
 
+/*!
+  \brief Start the event dispatch threads, one per shard
+  \param max the number of shards, only honoured before the first event is dispatched
+*/
 SWITCH_DECLARE(void) switch_event_launch_dispatch_threads(uint32_t max);
 
+/*!
+  \brief Write the dispatch shard counters and per-binding queue depth, drops and delivery times to a stream
+  \param stream the stream to write to
+*/
+SWITCH_DECLARE(void) switch_event_dispatch_status(switch_stream_handle_t *stream);
+
 SWITCH_DECLARE(switch_status_t) switch_event_channel_broadcast(const char *event_channel, cJSON **json, const char *key, switch_event_channel_id_t id);
 SWITCH_DECLARE(uint32_t) switch_event_channel_unbind(const char *event_channel, switch_event_channel_func_t func);
 SWITCH_DECLARE(switch_status_t) switch_event_channel_bind(const char *event_channel, switch_event_channel_func_t func, switch_event_channel_id_t *id);
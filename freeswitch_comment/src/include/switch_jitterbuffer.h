@@ -34,7 +34,9 @@
 #define SWITCH_VIDDERBUFFER_H
 
 typedef enum {
-	SJB_QUEUE_ONLY = (1 << 0)
+	SJB_QUEUE_ONLY = (1 << 0),
+	SJB_TIME_STRETCH = (1 << 1),
+	SJB_MEDIA_TRACE = (1 << 2)
 } switch_jb_flag_t;
 
 typedef enum {
@@ -66,6 +68,8 @@ SWITCH_DECLARE(int) switch_jb_poll(switch_jb_t *jb);
 SWITCH_DECLARE(switch_status_t) switch_jb_put_packet(switch_jb_t *jb, switch_rtp_packet_t *packet, switch_size_t len);
 
 SWITCH_DECLARE(switch_size_t) switch_jb_get_last_read_len(switch_jb_t *jb);
+/* media trace tick of the put of the packet last read, 0 unless SJB_MEDIA_TRACE was set then */
+SWITCH_DECLARE(uint64_t) switch_jb_get_last_read_tick(switch_jb_t *jb);
 
 /* ȡ */
 SWITCH_DECLARE(switch_status_t) switch_jb_get_packet(switch_jb_t *jb, switch_rtp_packet_t *packet, switch_size_t *len);
@@ -79,6 +83,16 @@ SWITCH_DECLARE(void) switch_jb_set_session(switch_jb_t *jb, switch_core_session_
 SWITCH_DECLARE(void) switch_jb_ts_mode(switch_jb_t *jb, uint32_t samples_per_frame, uint32_t samples_per_second);
 SWITCH_DECLARE(void) switch_jb_set_flag(switch_jb_t *jb, switch_jb_flag_t flag);
 SWITCH_DECLARE(void) switch_jb_clear_flag(switch_jb_t *jb, switch_jb_flag_t flag);
+SWITCH_DECLARE(switch_bool_t) switch_jb_test_flag(switch_jb_t *jb, switch_jb_flag_t flag);
+
+/* audio only: estimate the playout delay and let the reader time stretch toward it */
+SWITCH_DECLARE(void) switch_jb_stretch_mode(switch_jb_t *jb, uint32_t samples_per_frame, uint32_t samples_per_second);
+/* 1 to accelerate, -1 to decelerate, 0 when the buffer is at the estimate */
+SWITCH_DECLARE(int) switch_jb_stretch_advice(switch_jb_t *jb);
+/* the next get returns NOTFOUND (plc) without consuming a packet */
+SWITCH_DECLARE(void) switch_jb_stretch_hold(switch_jb_t *jb);
+/* take the next in order packet early if it is buffered and of payload type pt */
+SWITCH_DECLARE(switch_status_t) switch_jb_stretch_pull(switch_jb_t *jb, uint8_t pt, switch_rtp_packet_t *packet, switch_size_t *len);
 
 SWITCH_END_EXTERN_C
 #endif
@@ -65,6 +65,29 @@ SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_SQLSetAutoCommitAttr(switch_odb
 SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_SQLEndTran(switch_odbc_handle_t *handle, switch_bool_t commit);
 SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_statement_handle_free(switch_odbc_statement_handle_t *stmt);
 
+#define SWITCH_ODBC_MAX_PARAMS 64
+
+/*!
+  \brief Prepare a statement with ? placeholders for repeated execution
+  \param handle the handle to prepare on
+  \param sql the statement text
+  \param rstmt the prepared statement, free it with switch_odbc_statement_handle_free
+  \return SWITCH_ODBC_SUCCESS if the statement was prepared
+*/
+SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_statement_prepare(switch_odbc_handle_t *handle, const char *sql, switch_odbc_statement_handle_t *rstmt);
+
+/*!
+  \brief Bind text values to a prepared statement and execute it
+  \param handle the handle the statement was prepared on
+  \param rstmt the prepared statement
+  \param argc the number of values (at most SWITCH_ODBC_MAX_PARAMS)
+  \param argv the values, NULL binds SQL NULL
+  \param err an optional pointer to the error string, free it when done
+  \return SWITCH_ODBC_SUCCESS if the statement was executed
+*/
+SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_statement_execute(switch_odbc_handle_t *handle, switch_odbc_statement_handle_t rstmt,
+																   int argc, const char * const *argv, char **err);
+
 /*!
   \brief Execute the sql query and issue a callback for each row returned
   \param file the file from which this function is called
@@ -112,6 +112,26 @@ SWITCH_DECLARE(switch_pgsql_status_t) switch_pgsql_handle_exec_base_detailed(con
 
 SWITCH_DECLARE(switch_pgsql_state_t) switch_pgsql_handle_get_state(switch_pgsql_handle_t *handle);
 
+/*!
+  \brief Prepare a named statement with $1..$n placeholders on the connection
+  \param handle the handle to prepare on
+  \param name the statement name, unique per connection
+  \param sql the statement text
+  \param nparams the number of placeholders
+  \return SWITCH_PGSQL_SUCCESS if the statement was prepared
+*/
+SWITCH_DECLARE(switch_pgsql_status_t) switch_pgsql_handle_prepare(switch_pgsql_handle_t *handle, const char *name, const char *sql, int nparams);
+
+/*!
+  \brief Execute a statement prepared with switch_pgsql_handle_prepare, inside the open transaction when auto commit is off
+  \param handle the handle the statement was prepared on
+  \param name the statement name
+  \param nparams the number of values
+  \param values the text values to bind, NULL binds SQL NULL
+  \return SWITCH_PGSQL_SUCCESS if the statement was executed
+*/
+SWITCH_DECLARE(switch_pgsql_status_t) switch_pgsql_handle_exec_prepared(switch_pgsql_handle_t *handle, const char *name, int nparams, const char * const *values);
+
 SWITCH_DECLARE(switch_pgsql_status_t) switch_pgsql_handle_exec_detailed(const char *file, const char *func, int line,
 															   switch_pgsql_handle_t *handle, const char *sql, char **err);
 #define switch_pgsql_handle_exec(handle, sql, err) switch_pgsql_handle_exec_detailed(__FILE__, (char * )__SWITCH_FUNC__, __LINE__, handle, sql, err)
@@ -42,6 +42,34 @@ SWITCH_BEGIN_EXTERN_C
  */
 	typedef struct real_pcre switch_regex_t;
 
+/*! \brief Counters of the compiled pattern cache */
+	typedef struct {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+		/*! patterns that failed to compile */
+		uint64_t errors;
+		/*! patterns held by the cache */
+		uint32_t entries;
+		/*! of those, how many a caller holds right now */
+		uint32_t in_use;
+		/*! most patterns the cache holds, 0 when it is off */
+		uint32_t size;
+		/*! patterns are jit compiled */
+		int jit;
+	} switch_regex_cache_stats_t;
+
+SWITCH_DECLARE(void) switch_regex_init(switch_memory_pool_t *pool);
+SWITCH_DECLARE(void) switch_regex_shutdown(void);
+
+/*!
+ \brief Set how many compiled patterns switch_regex_perform and switch_regex_match keep
+ \param size the number of patterns, 0 compiles every time
+*/
+SWITCH_DECLARE(void) switch_regex_cache_set_size(uint32_t size);
+SWITCH_DECLARE(void) switch_regex_cache_stats(switch_regex_cache_stats_t *stats);
+SWITCH_DECLARE(void) switch_regex_cache_flush(void);
+
 SWITCH_DECLARE(switch_regex_t *) switch_regex_compile(const char *pattern, int options, const char **errorptr, int *erroroffset,
 													  const unsigned char *tables);
 
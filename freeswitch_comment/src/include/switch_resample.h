@@ -69,9 +69,22 @@ SWITCH_BEGIN_EXTERN_C
 	uint32_t to_size;
 	/*! the number of channels */
 	int channels;
+	/*! the shared table polyphase state used in place of resampler for small ratios */
+	void *poly;
 
 } switch_audio_resampler_t;
 
+/*!
+  \brief Set up the cache of filter tables shared by resamplers
+  \param pool the pool to use for the cache lock
+ */
+SWITCH_DECLARE(void) switch_resample_init(switch_memory_pool_t *pool);
+
+/*!
+  \brief Free the shared filter tables, once no resampler is left
+ */
+SWITCH_DECLARE(void) switch_resample_shutdown(void);
+
 /*!
   \brief Prepare a new resampler handle
   \param new_resampler NULL pointer to aim at the new handle
@@ -169,6 +182,25 @@ SWITCH_DECLARE(void) switch_change_sln_volume(int16_t *data, uint32_t samples, i
   \param vol the volume factor -12 -> 12
  */
 SWITCH_DECLARE(void) switch_change_sln_volume_granular(int16_t *data, uint32_t samples, int32_t vol);
+
+/*!
+  \brief Shorten a signed linear frame by one pitch period, cross fading the seam
+  \param data the audio data
+  \param samples the number of 2 byte samples, at least two frames worth is best
+  \param rate the sample rate
+  \return the new number of samples, unchanged when no period can be cut cleanly
+ */
+SWITCH_DECLARE(uint32_t) switch_accelerate_sln(int16_t *data, uint32_t samples, uint32_t rate);
+
+/*!
+  \brief Lengthen a signed linear frame by repeating one pitch period, cross fading the seam
+  \param data the audio data, with room for max_samples
+  \param samples the number of 2 byte samples
+  \param max_samples the most samples data can hold
+  \param rate the sample rate
+  \return the new number of samples, unchanged when no period can be repeated cleanly
+ */
+SWITCH_DECLARE(uint32_t) switch_decelerate_sln(int16_t *data, uint32_t samples, uint32_t max_samples, uint32_t rate);
 ///\}
 
 SWITCH_DECLARE(uint32_t) switch_merge_sln(int16_t *data, uint32_t samples, int16_t *other_data, uint32_t other_samples, int channels);
@@ -112,6 +112,18 @@ typedef struct ice_s {
 
 } ice_t;
 
+/*! \brief Counters from the RTP reactor threads, summed over all of them */
+typedef struct switch_rtp_reactor_stats_s {
+	uint32_t threads;
+	uint32_t sockets;
+	uint64_t packets;
+	uint64_t batches;
+	uint64_t wakeups;
+	/*! session threads woken from their inbox wait */
+	uint64_t signals;
+	uint64_t dropped;
+} switch_rtp_reactor_stats_t;
+
 typedef enum { /* RTCP Control Packet types (PT) http://www.iana.org/assignments/rtp-parameters/rtp-parameters.xhtml#rtp-parameters-4 */
 	_RTCP_PT_IJ    = 195, /* IJ: Extended inter-arrival jitter report RFC5450*/
 	_RTCP_PT_SR    = 200, /* SR: sender report RFC3550 */
@@ -204,6 +216,28 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_set_remote_ssrc(switch_rtp_t *rtp_ses
 */
 SWITCH_DECLARE(switch_port_t) switch_rtp_set_end_port(switch_port_t port);
 
+/*!
+  \brief Set/Get the number of RTP reactor threads
+  \param threads threads that own the rtp sockets through epoll, 0 leaves each session polling its own socket
+  \return the number in effect
+  \note only takes effect before switch_rtp_init and where epoll and recvmmsg are available
+*/
+SWITCH_DECLARE(uint32_t) switch_rtp_set_reactor_threads(uint32_t threads);
+
+/*!
+  \brief Get the RTP reactor counters
+  \param stats filled in, all zero when the reactor isn't running
+*/
+SWITCH_DECLARE(void) switch_rtp_get_reactor_stats(switch_rtp_reactor_stats_t *stats);
+
+/*!
+  \brief Set/Get how many packets a video session may queue for one sendmmsg
+  \param packets the batch size, 0 or 1 sends every packet on its own
+  \return the size in effect
+  \note batch counters are in switch_rtp_stats_t tx_batch, where sendmmsg is available
+*/
+SWITCH_DECLARE(uint32_t) switch_rtp_set_tx_batch(uint32_t packets);
+
 /*! 
   \brief Request a new port to be used for media
   \param ip the ip to request a port from
@@ -351,6 +385,14 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_deactivate_jitter_buffer(switch_rtp_t
 SWITCH_DECLARE(switch_status_t) switch_rtp_pause_jitter_buffer(switch_rtp_t *rtp_session, switch_bool_t pause);
 SWITCH_DECLARE(switch_jb_t *) switch_rtp_get_jitter_buffer(switch_rtp_t *rtp_session);
 
+/*!
+  \brief Get the media trace ticks of the last packet handed up
+  \param rtp_session the RTP session
+  \param jb_tick set to the tick the packet left the jitter buffer, 0 if it did not go through one
+  \return the tick the packet came off the socket (its jitter buffer put), 0 unless SWITCH_RTP_FLAG_MEDIA_TRACE is set
+*/
+SWITCH_DECLARE(uint64_t) switch_rtp_get_recv_tick(switch_rtp_t *rtp_session, uint64_t *jb_tick);
+
 
 
 
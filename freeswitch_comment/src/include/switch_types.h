@@ -373,7 +373,8 @@ typedef enum {
 	SCF_DEBUG_SQL = (1 << 21),
 	SCF_API_EXPANSION = (1 << 22),
 	SCF_SESSION_THREAD_POOL = (1 << 23),
-	SCF_DIALPLAN_TIMESTAMPS = (1 << 24)
+	SCF_DIALPLAN_TIMESTAMPS = (1 << 24),
+	SCF_NO_CHANNEL_SQL = (1 << 25)
 } switch_core_flag_enum_t;
 typedef uint32_t switch_core_flag_t;
 
@@ -723,11 +724,22 @@ typedef struct {
 	uint32_t init;
 } switch_rtcp_numbers_t;
 
+typedef struct {
+	uint32_t flushes;             /* batches handed to the kernel, one sendmmsg or gso send each */
+	uint32_t packets;             /* packets sent through a batch */
+	uint32_t max_batch;           /* largest batch sent */
+	uint32_t gso_flushes;         /* batches sent as a single gso datagram */
+	uint32_t errors;              /* queued packets the kernel refused */
+	int64_t latency;        /* total us between the first packet of a batch being queued and the flush */
+	int64_t max_latency;
+} switch_rtp_tx_batch_numbers_t;
+
 typedef struct {
 	switch_rtp_numbers_t inbound;               /* 뷽ͳ */
 	switch_rtp_numbers_t outbound;              /* ͳ */
 	switch_rtcp_numbers_t rtcp;                 /* rtcpصͳ */
 	uint32_t read_count;
+	switch_rtp_tx_batch_numbers_t tx_batch;     /* batched transmit, see rtp-tx-batch */
 } switch_rtp_stats_t;
 
 typedef enum {
@@ -805,6 +817,7 @@ typedef enum {
 	SWITCH_RTP_FLAG_TMMBR,
 	SWITCH_RTP_FLAG_GEN_TS_DELTA,
 	SWITCH_RTP_FLAG_DETECT_SSRC,
+	SWITCH_RTP_FLAG_MEDIA_TRACE,
 	SWITCH_RTP_FLAG_INVALID
 } switch_rtp_flag_t;
 
@@ -1550,6 +1563,7 @@ typedef enum {
 	CF_3P_NOMEDIA_REQUESTED_BLEG,
 	CF_IMAGE_SDP,
 	CF_VIDEO_SDP_RECVD,
+	CF_JITTERBUFFER_STRETCH,
 	/* WARNING: DO NOT ADD ANY FLAGS BELOW THIS LINE */
 	/* IF YOU ADD NEW ONES CHECK IF THEY SHOULD PERSIST OR ZERO THEM IN switch_core_session.c switch_core_session_request_xml() */
 	CF_FLAG_MAX
@@ -1755,6 +1769,46 @@ typedef enum {
 } switch_media_type_t;
 #define SWITCH_MEDIA_TYPE_TOTAL 2
 
+/*!
+  \enum switch_media_trace_stage_t
+  \brief Stages of the audio path timed by switch_core_session_media_trace
+<pre>
+SMT_JITTER_BUFFER  - rtp packet put in the jitter buffer until it comes back out
+SMT_RTP_IN         - rtp packet off the socket, or out of the jitter buffer, until its frame is handed to the core
+SMT_DECODE         - decode, plc and time stretch of the read frame
+SMT_READ_BUGS      - media bugs on the read side
+SMT_READ_RESAMPLE  - read resampler
+SMT_READ_ENCODE    - encode back to the session's read codec
+SMT_READ           - switch_core_session_read_frame from the endpoint read to its return
+SMT_APP            - read_frame returning the frame until it is given to switch_core_session_write_frame
+SMT_WRITE_DECODE   - decode of a frame in a foreign codec on the write side
+SMT_WRITE_RESAMPLE - write resampler
+SMT_WRITE_BUGS     - media bugs on the write side
+SMT_ENCODE         - encode to the session's write codec
+SMT_RTP_OUT        - the endpoint write, rtp and srtp included
+SMT_WRITE          - switch_core_session_write_frame
+SMT_TOTAL          - rtp packet off the socket until the frame it became leaves write_frame, jitter buffer included
+</pre>
+ */
+typedef enum {
+	SMT_JITTER_BUFFER,
+	SMT_RTP_IN,
+	SMT_DECODE,
+	SMT_READ_BUGS,
+	SMT_READ_RESAMPLE,
+	SMT_READ_ENCODE,
+	SMT_READ,
+	SMT_APP,
+	SMT_WRITE_DECODE,
+	SMT_WRITE_RESAMPLE,
+	SMT_WRITE_BUGS,
+	SMT_ENCODE,
+	SMT_RTP_OUT,
+	SMT_WRITE,
+	SMT_TOTAL,
+	SMT_STAGE_MAX
+} switch_media_trace_stage_t;
+
 
 /*!
   \enum switch_timer_flag_t
@@ -2528,6 +2582,7 @@ struct sql_queue_manager;
 
 struct switch_media_handle_s;
 typedef struct switch_media_handle_s switch_media_handle_t;
+typedef struct switch_media_trace switch_media_trace_t;
 
 typedef uint32_t switch_event_channel_id_t;
 typedef void (*switch_event_channel_func_t)(const char *event_channel, cJSON *json, const char *key, switch_event_channel_id_t id);
@@ -2542,8 +2597,11 @@ typedef enum {
 
 
 typedef enum {
+	/* the _8 suites stay ahead of the RFC 7714 names they prefix, crypto_str2type matches by prefix */
 	AEAD_AES_256_GCM_8,
 	AEAD_AES_128_GCM_8,
+	AEAD_AES_256_GCM,
+	AEAD_AES_128_GCM,
 	AES_CM_256_HMAC_SHA1_80,
 	AES_CM_192_HMAC_SHA1_80,
 	AES_CM_128_HMAC_SHA1_80,
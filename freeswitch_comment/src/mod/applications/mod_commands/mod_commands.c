@@ -685,6 +685,12 @@ end:
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_STANDARD_API(event_stats_function)
+{
+	switch_event_dispatch_status(stream);
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_STANDARD_API(db_cache_function)
 {
 	int argc;
@@ -1886,6 +1892,118 @@ SWITCH_STANDARD_API(replace_function)
 
 }
 
+#define REGEX_CACHE_SYNTAX "[show|flush|size <patterns>]"
+SWITCH_STANDARD_API(regex_cache_function)
+{
+	switch_regex_cache_stats_t stats;
+
+	if (zstr(cmd) || !strcasecmp(cmd, "show")) {
+		switch_regex_cache_stats(&stats);
+		stream->write_function(stream, "size: %u\nentries: %u\nin use: %u\njit: %s\n", stats.size, stats.entries, stats.in_use, stats.jit ? "yes" : "no");
+		stream->write_function(stream, "hits: %" SWITCH_UINT64_T_FMT "\nmisses: %" SWITCH_UINT64_T_FMT "\nhit rate: %.1f%%\n", stats.hits, stats.misses,
+							   stats.hits + stats.misses ? stats.hits * 100.0 / (stats.hits + stats.misses) : 0.0);
+		stream->write_function(stream, "evictions: %" SWITCH_UINT64_T_FMT "\ncompile errors: %" SWITCH_UINT64_T_FMT "\n", stats.evictions, stats.errors);
+	} else if (!strcasecmp(cmd, "flush")) {
+		switch_regex_cache_flush();
+		stream->write_function(stream, "+OK Success\n");
+	} else if (!strncasecmp(cmd, "size ", 5) && switch_is_number(cmd + 5)) {
+		switch_regex_cache_set_size((uint32_t) atoi(cmd + 5));
+		stream->write_function(stream, "+OK Success\n");
+	} else {
+		stream->write_function(stream, "-USAGE: %s\n", REGEX_CACHE_SYNTAX);
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+#define SESSION_SCHEDULER_SYNTAX "[show]"
+SWITCH_STANDARD_API(session_scheduler_function)
+{
+	switch_core_session_scheduler_stats_t stats;
+
+	if (zstr(cmd) || !strcasecmp(cmd, "show")) {
+		switch_core_session_scheduler_stats(&stats);
+		if (!stats.workers) {
+			stream->write_function(stream, "-ERR the session scheduler is not running\n");
+			return SWITCH_STATUS_SUCCESS;
+		}
+		stream->write_function(stream, "workers: %u\nparked: %u\nsessions: %u\n", stats.workers, stats.parked, switch_core_session_count());
+		stream->write_function(stream, "slices: %" SWITCH_UINT64_T_FMT "\nresumes: %" SWITCH_UINT64_T_FMT "\nsteals: %" SWITCH_UINT64_T_FMT
+							   "\nhandoffs: %" SWITCH_UINT64_T_FMT "\n", stats.slices, stats.resumes, stats.steals, stats.handoffs);
+	} else {
+		stream->write_function(stream, "-USAGE: %s\n", SESSION_SCHEDULER_SYNTAX);
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+typedef struct {
+	switch_memory_pool_tag_stats_t *tags;
+	uint32_t count;
+	uint32_t size;
+	int all;
+} memory_pool_tags_t;
+
+static void memory_pool_tag_callback(const switch_memory_pool_tag_stats_t *stats, void *pvt)
+{
+	memory_pool_tags_t *mt = (memory_pool_tags_t *) pvt;
+
+	if (!stats->pools && !mt->all) {
+		return;
+	}
+
+	if (mt->count == mt->size) {
+		mt->size = mt->size ? mt->size * 2 : 64;
+		switch_assert((mt->tags = realloc(mt->tags, mt->size * sizeof(*mt->tags))));
+	}
+
+	mt->tags[mt->count++] = *stats;
+}
+
+static int memory_pool_tag_cmp(const void *a, const void *b)
+{
+	const switch_memory_pool_tag_stats_t *x = a, *y = b;
+
+	if (x->bytes != y->bytes) {
+		return x->bytes < y->bytes ? 1 : -1;
+	}
+
+	return (int) y->pools - (int) x->pools;
+}
+
+#define MEMORY_POOLS_SYNTAX "[show|tags [all]]"
+SWITCH_STANDARD_API(memory_pools_function)
+{
+	switch_memory_pool_stats_t stats;
+	memory_pool_tags_t mt = { 0 };
+	uint32_t x;
+
+	if (zstr(cmd) || !strcasecmp(cmd, "show")) {
+		switch_core_memory_pool_stats(&stats);
+		stream->write_function(stream, "pools: %u\nbytes: %" SWITCH_SIZE_T_FMT "\nidle allocators: %u of %u\nshards: %u\n",
+							   stats.pools, stats.bytes, stats.idle, stats.cache, stats.shards);
+		stream->write_function(stream, "created: %" SWITCH_UINT64_T_FMT "\nreused: %" SWITCH_UINT64_T_FMT "\ntrimmed: %" SWITCH_UINT64_T_FMT "\n",
+							   stats.created, stats.reused, stats.trimmed);
+	} else if (!strcasecmp(cmd, "tags") || !strcasecmp(cmd, "tags all")) {
+		mt.all = !strcasecmp(cmd, "tags all");
+		switch_core_memory_pool_tag_stats(memory_pool_tag_callback, &mt);
+		if (mt.count) {
+			qsort(mt.tags, mt.count, sizeof(*mt.tags), memory_pool_tag_cmp);
+		}
+		stream->write_function(stream, "%-48s %8s %12s %12s %10s\n", "tag", "pools", "bytes", "created", "peak");
+		for (x = 0; x < mt.count; x++) {
+			stream->write_function(stream, "%-48s %8u %12" SWITCH_SIZE_T_FMT " %12" SWITCH_UINT64_T_FMT " %10" SWITCH_SIZE_T_FMT "\n",
+								   mt.tags[x].tag, mt.tags[x].pools, mt.tags[x].bytes, mt.tags[x].created, mt.tags[x].peak);
+		}
+		stream->write_function(stream, "\n%u tags\n", mt.count);
+		switch_safe_free(mt.tags);
+	} else {
+		stream->write_function(stream, "-USAGE: %s\n", MEMORY_POOLS_SYNTAX);
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_STANDARD_API(regex_function)
 {
 	switch_regex_t *re = NULL;
@@ -4336,6 +4454,58 @@ SWITCH_STANDARD_API(uuid_debug_media_function)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+#define MEDIA_TRACE_SYNTAX "<uuid> <on|off|show>"
+SWITCH_STANDARD_API(uuid_media_trace_function)
+{
+	char *mycmd = NULL, *argv[2] = { 0 };
+	int argc = 0;
+	switch_core_session_t *lsession = NULL;
+
+	if (!zstr(cmd) && (mycmd = strdup(cmd))) {
+		argc = switch_separate_string(mycmd, ' ', argv, (sizeof(argv) / sizeof(argv[0])));
+	}
+
+	if (zstr(cmd) || argc < 2 || zstr(argv[0]) || zstr(argv[1])) {
+		stream->write_function(stream, "-USAGE: %s\n", MEDIA_TRACE_SYNTAX);
+		goto done;
+	}
+
+	if (!(lsession = switch_core_session_locate(argv[0]))) {
+		stream->write_function(stream, "-ERR No such channel!\n");
+		goto done;
+	}
+
+	if (!strcasecmp(argv[1], "show")) {
+		switch_core_media_trace_report(lsession, stream);
+	} else if (switch_core_session_media_trace(lsession, switch_true(argv[1])) == SWITCH_STATUS_SUCCESS) {
+		stream->write_function(stream, "+OK Success\n");
+	} else {
+		stream->write_function(stream, "-ERR Operation failed\n");
+	}
+
+	switch_core_session_rwunlock(lsession);
+
+  done:
+
+	switch_safe_free(mycmd);
+	return SWITCH_STATUS_SUCCESS;
+}
+
+#define MEDIA_TRACE_TOTALS_SYNTAX "[show|reset]"
+SWITCH_STANDARD_API(media_trace_function)
+{
+	if (zstr(cmd) || !strcasecmp(cmd, "show")) {
+		switch_core_media_trace_report(NULL, stream);
+	} else if (!strcasecmp(cmd, "reset")) {
+		switch_core_media_trace_reset();
+		stream->write_function(stream, "+OK Success\n");
+	} else {
+		stream->write_function(stream, "-USAGE: %s\n", MEDIA_TRACE_TOTALS_SYNTAX);
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 #define UUID_SYNTAX "<uuid> <other_uuid>"
 SWITCH_STANDARD_API(uuid_bridge_function)
 {
@@ -5290,13 +5460,26 @@ SWITCH_STANDARD_API(coalesce_function)
 	return status;
 }
 
+/* channels and calls are read from the core channel store, everything else or a store that is not running goes to sql */
+static void show_execute(switch_cache_db_handle_t *db, const switch_channel_store_query_t *squery, const char *sql,
+						 switch_core_db_callback_func_t callback, struct holder *holder, char **errmsg)
+{
+	if (squery && switch_core_channel_store_query(squery, callback, holder) == SWITCH_STATUS_SUCCESS) {
+		return;
+	}
+
+	switch_cache_db_execute_sql_callback(db, sql, callback, holder, errmsg);
+}
+
 #define SHOW_SYNTAX "codec|endpoint|application|api|dialplan|file|timer|calls [count]|channels [count|like <match string>]|calls|detailed_calls|bridged_calls|detailed_bridged_calls|aliases|complete|chat|management|modules|nat_map|say|interfaces|interface_types|tasks|limits|status"
 SWITCH_STANDARD_API(show_function)
 {
 	char sql[1024];
-	char *errmsg;
+	char *errmsg = NULL;
 	switch_cache_db_handle_t *db;
 	struct holder holder = { 0 };
+	switch_channel_store_query_t squery = { 0 };
+	switch_channel_store_query_t *sq = NULL;
 	int help = 0;
 	char *mydata = NULL, *argv[6] = { 0 };
 	char *command = NULL, *as = NULL;
@@ -5418,10 +5601,16 @@ SWITCH_STANDARD_API(show_function)
 			}
 		}
 
+		squery.hostname = switch_core_get_switchname();
+
 		if (!strcasecmp(command, "calls")) {
 			sprintf(sql, "select * from basic_calls where hostname='%s' order by call_created_epoch", switch_core_get_switchname());
+			squery.view = SCS_VIEW_BASIC_CALLS;
+			squery.flags = SCSQ_ORDER_CALL;
+			sq = &squery;
 			if (argv[1] && !strcasecmp(argv[1], "count")) {
 				sprintf(sql, "select count(*) from basic_calls where hostname='%s'", switch_core_get_switchname());
+				squery.flags |= SCSQ_COUNT;
 				holder.justcount = 1;
 				if (argv[3] && !strcasecmp(argv[2], "as")) {
 					as = argv[3];
@@ -5437,6 +5626,8 @@ SWITCH_STANDARD_API(show_function)
 				}
 			}
 		} else if (!strcasecmp(command, "channels") && argv[1] && !strcasecmp(argv[1], "like")) {
+			squery.view = SCS_VIEW_CHANNELS;
+			sq = &squery;
 			if (argv[2]) {
 				char *p;
 				for (p = argv[2]; p && *p; p++) {
@@ -5453,6 +5644,7 @@ SWITCH_STANDARD_API(show_function)
 						"select * from channels where hostname='%s' and uuid like '%%%s%%' or name like '%%%s%%' or cid_name like '%%%s%%' or cid_num like '%%%s%%' or presence_data like '%%%s%%' or accountcode like '%%%s%%' order by created_epoch",
 						switch_core_get_switchname(), argv[2], argv[2], argv[2], argv[2], argv[2], argv[2]);
 				}
+				squery.like = argv[2];
 				if (argv[4] && !strcasecmp(argv[3], "as")) {
 					as = argv[4];
 				}
@@ -5461,8 +5653,11 @@ SWITCH_STANDARD_API(show_function)
 			}
 		} else if (!strcasecmp(command, "channels")) {
 			sprintf(sql, "select * from channels where hostname='%s' order by created_epoch", switch_core_get_switchname());
+			squery.view = SCS_VIEW_CHANNELS;
+			sq = &squery;
 			if (argv[1] && !strcasecmp(argv[1], "count")) {
 				sprintf(sql, "select count(*) from channels where hostname='%s'", switch_core_get_switchname());
+				squery.flags |= SCSQ_COUNT;
 				holder.justcount = 1;
 				if (argv[3] && !strcasecmp(argv[2], "as")) {
 					as = argv[3];
@@ -5470,16 +5665,24 @@ SWITCH_STANDARD_API(show_function)
 			}
 		} else if (!strcasecmp(command, "detailed_calls")) {
 			sprintf(sql, "select * from detailed_calls where hostname='%s' order by created_epoch", switch_core_get_switchname());
+			squery.view = SCS_VIEW_DETAILED_CALLS;
+			sq = &squery;
 			if (argv[2] && !strcasecmp(argv[1], "as")) {
 				as = argv[2];
 			}
 		} else if (!strcasecmp(command, "bridged_calls")) {
 			sprintf(sql, "select * from basic_calls where b_uuid is not null and hostname='%s' order by created_epoch", switch_core_get_switchname());
+			squery.view = SCS_VIEW_BASIC_CALLS;
+			squery.flags = SCSQ_BRIDGED;
+			sq = &squery;
 			if (argv[2] && !strcasecmp(argv[1], "as")) {
 				as = argv[2];
 			}
 		} else if (!strcasecmp(command, "detailed_bridged_calls")) {
 			sprintf(sql, "select * from detailed_calls where b_uuid is not null and hostname='%s' order by created_epoch", switch_core_get_switchname());
+			squery.view = SCS_VIEW_DETAILED_CALLS;
+			squery.flags = SCSQ_BRIDGED;
+			sq = &squery;
 			if (argv[2] && !strcasecmp(argv[1], "as")) {
 				as = argv[2];
 			}
@@ -5516,7 +5719,7 @@ SWITCH_STANDARD_API(show_function)
 				holder.delim = ",";
 			}
 		}
-		switch_cache_db_execute_sql_callback(db, sql, show_callback, &holder, &errmsg);
+		show_execute(db, sq, sql, show_callback, &holder, &errmsg);
 		if (html) {
 			holder.stream->write_function(holder.stream, "</table>");
 		}
@@ -5532,7 +5735,7 @@ SWITCH_STANDARD_API(show_function)
 			stream->write_function(stream, "%s%u total.%s", nl, holder.count, nl);
 		}
 	} else if (!strcasecmp(as, "xml")) {
-		switch_cache_db_execute_sql_callback(db, sql, show_as_xml_callback, &holder, &errmsg);
+		show_execute(db, sq, sql, show_as_xml_callback, &holder, &errmsg);
 
 		if (errmsg) {
 			stream->write_function(stream, "-ERR SQL error [%s]\n", errmsg);
@@ -5560,7 +5763,7 @@ SWITCH_STANDARD_API(show_function)
 		}
 	} else if (!strcasecmp(as, "json")) {
 
-		switch_cache_db_execute_sql_callback(db, sql, show_as_json_callback, &holder, &errmsg);
+		show_execute(db, sq, sql, show_as_json_callback, &holder, &errmsg);
 
 		if (errmsg) {
 			stream->write_function(stream, "-ERR SQL Error [%s]\n", errmsg);
@@ -7125,6 +7328,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	SWITCH_ADD_API(commands_api_interface, "db_cache", "Manage db cache", db_cache_function, "status");
 	SWITCH_ADD_API(commands_api_interface, "domain_exists", "Check if a domain exists", domain_exists_function, "<domain>");
 	SWITCH_ADD_API(commands_api_interface, "echo", "Echo", echo_function, "<data>");
+	SWITCH_ADD_API(commands_api_interface, "event_stats", "Show event dispatch statistics", event_stats_function, "");
 	SWITCH_ADD_API(commands_api_interface, "event_channel_broadcast", "Broadcast", event_channel_broadcast_api_function, "<channel> <json>");
 	SWITCH_ADD_API(commands_api_interface, "escape", "Escape a string", escape_function, "<data>");
 	SWITCH_ADD_API(commands_api_interface, "eval", "eval (noop)", eval_function, "[uuid:<uuid> ]<expression>");
@@ -7163,6 +7367,9 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	SWITCH_ADD_API(commands_api_interface, "pause", "Pause media on a channel", pause_function, PAUSE_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "quote_shell_arg", "Quote/escape a string for use on shell command line", quote_shell_arg_function, "<data>");
 	SWITCH_ADD_API(commands_api_interface, "regex", "Evaluate a regex", regex_function, "<data>|<pattern>[|<subst string>][n|b]");
+	SWITCH_ADD_API(commands_api_interface, "regex_cache", "Compiled regex cache statistics", regex_cache_function, REGEX_CACHE_SYNTAX);
+	SWITCH_ADD_API(commands_api_interface, "session_scheduler", "Session scheduler statistics", session_scheduler_function, SESSION_SCHEDULER_SYNTAX);
+	SWITCH_ADD_API(commands_api_interface, "memory_pools", "Memory pool statistics", memory_pools_function, MEMORY_POOLS_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "reloadacl", "Reload XML", reload_acl_function, "");
 	SWITCH_ADD_API(commands_api_interface, "reload", "Reload module", reload_function, UNLOAD_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "reloadxml", "Reload XML", reload_xml_function, "");
@@ -7200,6 +7407,8 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	SWITCH_ADD_API(commands_api_interface, "uuid_codec_debug", "Send codec a debug message", uuid_codec_debug_function, CODEC_DEBUG_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "uuid_codec_param", "Send codec a param", uuid_codec_param_function, CODEC_PARAM_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "uuid_debug_media", "Debug media", uuid_debug_media_function, DEBUG_MEDIA_SYNTAX);
+	SWITCH_ADD_API(commands_api_interface, "uuid_media_trace", "Time the stages of a session's media path", uuid_media_trace_function, MEDIA_TRACE_SYNTAX);
+	SWITCH_ADD_API(commands_api_interface, "media_trace", "Media path stage timings of every traced session", media_trace_function, MEDIA_TRACE_TOTALS_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "uuid_deflect", "Send a deflect", uuid_deflect, UUID_DEFLECT_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "uuid_displace", "Displace audio", session_displace_function, "<uuid> [start|stop] <path> [<limit>] [mux]");
 	SWITCH_ADD_API(commands_api_interface, "uuid_display", "Update phone display", uuid_display_function, DISPLAY_SYNTAX);
@@ -7321,10 +7530,19 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	switch_console_set_complete("add interface_ip ipv4 ::console::list_interfaces");
 	switch_console_set_complete("add interface_ip ipv6 ::console::list_interfaces");
 	switch_console_set_complete("add load ::console::list_available_modules");
+	switch_console_set_complete("add media_trace show");
+	switch_console_set_complete("add media_trace reset");
 	switch_console_set_complete("add nat_map reinit");
 	switch_console_set_complete("add nat_map republish");
 	switch_console_set_complete("add nat_map status");
 	switch_console_set_complete("add reload ::console::list_loaded_modules");
+	switch_console_set_complete("add regex_cache show");
+	switch_console_set_complete("add regex_cache flush");
+	switch_console_set_complete("add regex_cache size");
+	switch_console_set_complete("add session_scheduler show");
+	switch_console_set_complete("add memory_pools show");
+	switch_console_set_complete("add memory_pools tags");
+	switch_console_set_complete("add memory_pools tags all");
 	switch_console_set_complete("add reloadacl reloadxml");
 	switch_console_set_complete("add show aliases");
 	switch_console_set_complete("add show api");
@@ -7415,6 +7633,9 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	switch_console_set_complete("add uuid_media off ::console::list_uuid");
 	switch_console_set_complete("add uuid_media_3p ::console::list_uuid");
 	switch_console_set_complete("add uuid_media_3p off ::console::list_uuid");
+	switch_console_set_complete("add uuid_media_trace ::console::list_uuid on");
+	switch_console_set_complete("add uuid_media_trace ::console::list_uuid off");
+	switch_console_set_complete("add uuid_media_trace ::console::list_uuid show");
 	switch_console_set_complete("add uuid_park ::console::list_uuid");
 	switch_console_set_complete("add uuid_media_reneg ::console::list_uuid");
 	switch_console_set_complete("add uuid_phone_event ::console::list_uuid talk");
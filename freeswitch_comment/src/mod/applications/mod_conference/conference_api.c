@@ -2779,6 +2779,28 @@ switch_status_t conference_api_sub_get(conference_obj_t *conference,
 		} else if (strcasecmp(argv[2], "wait_mod") == 0) {
 			stream->write_function(stream, "%s",
 								   conference_utils_test_flag(conference, CFLAG_WAIT_MOD) ? "true" : "");
+		} else if (strcasecmp(argv[2], "mix_threads") == 0) {
+			stream->write_function(stream, "%u",
+								   conference->mix_threads);
+		} else if (strcasecmp(argv[2], "audio_codecs") == 0) {
+			int i;
+
+			switch_mutex_lock(conference->mutex);
+			for (i = 0; i < MAX_MUX_CODECS && conference->audio_codecs[i]; i++) {
+				conference_audio_codec_set_t *set = conference->audio_codecs[i];
+
+				stream->write_function(stream, "%s%s@%uhz members=%u encodes=%u", i ? "\n" : "",
+									   set->codec.implementation->iananame, set->codec.implementation->actual_samples_per_second,
+									   set->members, set->encodes);
+			}
+			switch_mutex_unlock(conference->mutex);
+		} else if (strcasecmp(argv[2], "mix_stats") == 0) {
+			stream->write_function(stream, "engine=%s threads=%u ticks=%u last=%" SWITCH_TIME_T_FMT " max=%" SWITCH_TIME_T_FMT " avg=%" SWITCH_TIME_T_FMT
+								   " max_speakers=%u dropped=%u",
+								   conference_mix_engine(), conference->mix_threads, conference->mix_ticks,
+								   conference->mix_usec_last, conference->mix_usec_max,
+								   conference->mix_ticks ? conference->mix_usec_total / conference->mix_ticks : 0,
+								   conference->mix_max_speakers, conference->mix_dropped);
 		} else {
 			ret_status = SWITCH_STATUS_FALSE;
 		}
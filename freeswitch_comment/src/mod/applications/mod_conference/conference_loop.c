@@ -1098,7 +1098,7 @@ void conference_loop_launch_input(conference_member_t *member, switch_memory_poo
 void conference_loop_output(conference_member_t *member)
 {
 	switch_channel_t *channel;
-	switch_frame_t write_frame = { 0 };
+	switch_frame_t write_frame = { 0 }, shared_frame = { 0 };
 	uint8_t *data = NULL;
 	switch_timer_t timer = { 0 };
 	uint32_t interval;
@@ -1147,6 +1147,9 @@ void conference_loop_output(conference_member_t *member)
 
 	write_frame.codec = &member->write_codec;
 
+	shared_frame.data = switch_core_session_alloc(member->session, SWITCH_RECOMMENDED_BUFFER_SIZE);
+	shared_frame.buflen = SWITCH_RECOMMENDED_BUFFER_SIZE;
+
 	/* Start the input thread */
 	conference_loop_launch_input(member, switch_core_session_get_pool(member->session));
 
@@ -1327,7 +1330,13 @@ void conference_loop_output(conference_member_t *member)
 			low_count = 0;
 
 			if ((write_frame.datalen = (uint32_t) switch_buffer_read(use_buffer, write_frame.data, bytes))) {
-				if (write_frame.datalen) {
+				if (member->enc_buffer && conference_mix_codec_read(member, &shared_frame)) {
+					/* the conference already encoded this one for everyone on our codec */
+					if (switch_core_session_write_frame(member->session, &shared_frame, SWITCH_IO_FLAG_NONE, 0) != SWITCH_STATUS_SUCCESS) {
+						switch_mutex_unlock(member->audio_out_mutex);
+						break;
+					}
+				} else if (write_frame.datalen) {
 					write_frame.samples = write_frame.datalen / 2 / member->conference->channels;
 
 					if( !conference_utils_member_test_flag(member, MFLAG_CAN_HEAR)) {
@@ -1358,6 +1367,9 @@ void conference_loop_output(conference_member_t *member)
 			if (switch_buffer_inuse(member->mux_buffer)) {
 				switch_mutex_lock(member->audio_out_mutex);
 				switch_buffer_zero(member->mux_buffer);
+				if (member->enc_buffer) {
+					switch_buffer_zero(member->enc_buffer);
+				}
 				switch_mutex_unlock(member->audio_out_mutex);
 			}
 			conference_utils_member_clear_flag_locked(member, MFLAG_FLUSH_BUFFER);
@@ -705,6 +705,7 @@ switch_status_t conference_member_add(conference_obj_t *conference, conference_m
 	member->score_iir = 0;
 	member->verbose_events = conference->verbose_events;
 	member->video_layer_id = -1;
+	member->audio_codec_index = -1;
 	member->layer_timeout = DEFAULT_LAYER_TIMEOUT;
 
 	switch_queue_create(&member->dtmf_queue, 100, member->pool);
@@ -817,6 +818,8 @@ switch_status_t conference_member_add(conference_obj_t *conference, conference_m
 				}
 			}
 		}
+
+		conference_mix_codec_join(conference, member);
 		
 		switch_channel_set_variable_printf(channel, "conference_member_id", "%d", member->id);
 		switch_channel_set_variable_printf(channel, "conference_moderator", "%s", conference_utils_member_test_flag(member, MFLAG_MOD) ? "true" : "false");
@@ -1256,6 +1259,8 @@ switch_status_t conference_member_del(conference_obj_t *conference, conference_m
 		conference_video_destroy_canvas(&member->canvas);
 	}
 
+	conference_mix_codec_leave(conference, member);
+
 	member->conference = NULL;
 
 	switch_mutex_unlock(conference->member_mutex);
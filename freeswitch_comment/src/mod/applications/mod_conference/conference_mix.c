@@ -0,0 +1,787 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2014, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Neal Horman <neal at wanlink dot com>
+ * Bret McDanel <trixter at 0xdecafbad dot com>
+ * Dale Thatcher <freeswitch at dalethatcher dot com>
+ * Chris Danielson <chris at maxpowersoft dot com>
+ * Rupa Schomaker <rupa@rupa.com>
+ * David Weekly <david@weekly.org>
+ * Joao Mesquita <jmesquita@gmail.com>
+ * Raymond Chandler <intralanman@freeswitch.org>
+ * Seven Du <dujinfang@gmail.com>
+ * Emmanuel Schmidbauer <e.schmidbauer@gmail.com>
+ * William King <william.king@quentustech.com>
+ *
+ * mod_conference.c -- Software Conference Bridge
+ *
+ */
+#include <mod_conference.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONFERENCE_MIX_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(CONFERENCE_MIX_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+	(__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) || defined(__clang__))
+#define CONFERENCE_MIX_AVX2
+#include <immintrin.h>
+#endif
+
+/* The main frame is kept in 32 bits so the sum of every speaker is exact,
+   listeners get it back minus whatever they must not hear, saturated to 16 bits. */
+
+static void mix_add_scalar(int32_t *acc, const int16_t *in, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		acc[x] += in[x];
+	}
+}
+
+static void mix_sub_scalar(int32_t *acc, const int16_t *in, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		acc[x] -= in[x];
+	}
+}
+
+static void mix_minus_scalar(int16_t *out, const int32_t *acc, const int16_t *self, uint32_t samples)
+{
+	uint32_t x;
+	int32_t z;
+
+	for (x = 0; x < samples; x++) {
+		z = acc[x];
+		if (self) {
+			z -= self[x];
+		}
+		switch_normalize_to_16bit(z);
+		out[x] = (int16_t) z;
+	}
+}
+
+#ifdef CONFERENCE_MIX_SSE2
+/* sign extend 8 samples into two vectors of 4 */
+#define MIX_WIDEN_LO(_v) _mm_srai_epi32(_mm_unpacklo_epi16(_v, _v), 16)
+#define MIX_WIDEN_HI(_v) _mm_srai_epi32(_mm_unpackhi_epi16(_v, _v), 16)
+
+static void mix_add_sse2(int32_t *acc, const int16_t *in, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 8 <= samples; x += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (in + x));
+		__m128i a0 = _mm_loadu_si128((const __m128i *) (acc + x));
+		__m128i a1 = _mm_loadu_si128((const __m128i *) (acc + x + 4));
+
+		_mm_storeu_si128((__m128i *) (acc + x), _mm_add_epi32(a0, MIX_WIDEN_LO(v)));
+		_mm_storeu_si128((__m128i *) (acc + x + 4), _mm_add_epi32(a1, MIX_WIDEN_HI(v)));
+	}
+
+	mix_add_scalar(acc + x, in + x, samples - x);
+}
+
+static void mix_sub_sse2(int32_t *acc, const int16_t *in, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 8 <= samples; x += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (in + x));
+		__m128i a0 = _mm_loadu_si128((const __m128i *) (acc + x));
+		__m128i a1 = _mm_loadu_si128((const __m128i *) (acc + x + 4));
+
+		_mm_storeu_si128((__m128i *) (acc + x), _mm_sub_epi32(a0, MIX_WIDEN_LO(v)));
+		_mm_storeu_si128((__m128i *) (acc + x + 4), _mm_sub_epi32(a1, MIX_WIDEN_HI(v)));
+	}
+
+	mix_sub_scalar(acc + x, in + x, samples - x);
+}
+
+static void mix_minus_sse2(int16_t *out, const int32_t *acc, const int16_t *self, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 8 <= samples; x += 8) {
+		__m128i a0 = _mm_loadu_si128((const __m128i *) (acc + x));
+		__m128i a1 = _mm_loadu_si128((const __m128i *) (acc + x + 4));
+
+		if (self) {
+			__m128i v = _mm_loadu_si128((const __m128i *) (self + x));
+
+			a0 = _mm_sub_epi32(a0, MIX_WIDEN_LO(v));
+			a1 = _mm_sub_epi32(a1, MIX_WIDEN_HI(v));
+		}
+
+		/* packs saturates exactly like switch_normalize_to_16bit */
+		_mm_storeu_si128((__m128i *) (out + x), _mm_packs_epi32(a0, a1));
+	}
+
+	mix_minus_scalar(out + x, acc + x, self ? self + x : NULL, samples - x);
+}
+#endif
+
+#ifdef CONFERENCE_MIX_AVX2
+#define MIX_AVX2 __attribute__((target("avx2")))
+
+MIX_AVX2 static void mix_add_avx2(int32_t *acc, const int16_t *in, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 16 <= samples; x += 16) {
+		__m256i v0 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + x)));
+		__m256i v1 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + x + 8)));
+		__m256i a0 = _mm256_loadu_si256((const __m256i *) (acc + x));
+		__m256i a1 = _mm256_loadu_si256((const __m256i *) (acc + x + 8));
+
+		_mm256_storeu_si256((__m256i *) (acc + x), _mm256_add_epi32(a0, v0));
+		_mm256_storeu_si256((__m256i *) (acc + x + 8), _mm256_add_epi32(a1, v1));
+	}
+
+	mix_add_sse2(acc + x, in + x, samples - x);
+}
+
+MIX_AVX2 static void mix_sub_avx2(int32_t *acc, const int16_t *in, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 16 <= samples; x += 16) {
+		__m256i v0 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + x)));
+		__m256i v1 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + x + 8)));
+		__m256i a0 = _mm256_loadu_si256((const __m256i *) (acc + x));
+		__m256i a1 = _mm256_loadu_si256((const __m256i *) (acc + x + 8));
+
+		_mm256_storeu_si256((__m256i *) (acc + x), _mm256_sub_epi32(a0, v0));
+		_mm256_storeu_si256((__m256i *) (acc + x + 8), _mm256_sub_epi32(a1, v1));
+	}
+
+	mix_sub_sse2(acc + x, in + x, samples - x);
+}
+
+MIX_AVX2 static void mix_minus_avx2(int16_t *out, const int32_t *acc, const int16_t *self, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 16 <= samples; x += 16) {
+		__m256i a0 = _mm256_loadu_si256((const __m256i *) (acc + x));
+		__m256i a1 = _mm256_loadu_si256((const __m256i *) (acc + x + 8));
+
+		if (self) {
+			a0 = _mm256_sub_epi32(a0, _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (self + x))));
+			a1 = _mm256_sub_epi32(a1, _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (self + x + 8))));
+		}
+
+		/* packs works per 128 bit lane, put the quadwords back in sample order */
+		_mm256_storeu_si256((__m256i *) (out + x), _mm256_permute4x64_epi64(_mm256_packs_epi32(a0, a1), 0xd8));
+	}
+
+	mix_minus_sse2(out + x, acc + x, self ? self + x : NULL, samples - x);
+}
+#endif
+
+static struct {
+	const char *name;
+	void (*add)(int32_t *acc, const int16_t *in, uint32_t samples);
+	void (*sub)(int32_t *acc, const int16_t *in, uint32_t samples);
+	void (*minus)(int16_t *out, const int32_t *acc, const int16_t *self, uint32_t samples);
+} mix_engine = { "scalar", mix_add_scalar, mix_sub_scalar, mix_minus_scalar };
+
+void conference_mix_init(void)
+{
+#ifdef CONFERENCE_MIX_SSE2
+	mix_engine.name = "sse2";
+	mix_engine.add = mix_add_sse2;
+	mix_engine.sub = mix_sub_sse2;
+	mix_engine.minus = mix_minus_sse2;
+#endif
+
+#ifdef CONFERENCE_MIX_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		mix_engine.name = "avx2";
+		mix_engine.add = mix_add_avx2;
+		mix_engine.sub = mix_sub_avx2;
+		mix_engine.minus = mix_minus_avx2;
+	}
+#endif
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Conference mixer using %s kernels\n", mix_engine.name);
+}
+
+const char *conference_mix_engine(void)
+{
+	return mix_engine.name;
+}
+
+void conference_mix_add(int32_t *acc, const int16_t *in, uint32_t samples)
+{
+	mix_engine.add(acc, in, samples);
+}
+
+void conference_mix_sub(int32_t *acc, const int16_t *in, uint32_t samples)
+{
+	mix_engine.sub(acc, in, samples);
+}
+
+void conference_mix_minus(int16_t *out, const int32_t *acc, const int16_t *self, uint32_t samples)
+{
+	mix_engine.minus(out, acc, self, samples);
+}
+
+/* true when listener must not hear speaker, same rules the mixer used to apply per sample */
+static switch_bool_t conference_mix_excluded(conference_member_t *listener, conference_member_t *speaker)
+{
+	conference_relationship_t *rel;
+
+	for (rel = speaker->relationships; rel; rel = rel->next) {
+		if ((rel->id == listener->id || rel->id == 0) && !switch_test_flag(rel, RFLAG_CAN_SPEAK)) {
+			return SWITCH_TRUE;
+		}
+	}
+
+	for (rel = listener->relationships; rel; rel = rel->next) {
+		if ((rel->id == speaker->id || rel->id == 0) && !switch_test_flag(rel, RFLAG_CAN_HEAR)) {
+			return SWITCH_TRUE;
+		}
+	}
+
+	return SWITCH_FALSE;
+}
+
+/* keep the mix to the loudest mix_max_speakers members by the score_iir the input thread keeps.
+   members holding a slot get an edge and keep it through short pauses so the mix doesn't flap,
+   everyone else loses MFLAG_HAS_AUDIO for this tick and costs nothing to mix. conference->mutex held.
+*/
+void conference_mix_select(conference_obj_t *conference)
+{
+	conference_member_t *top[CONFERENCE_MIX_SPEAKERS_MAX], *imember;
+	uint32_t key[CONFERENCE_MIX_SPEAKERS_MAX];
+	uint32_t max = conference->mix_max_speakers, n = 0, i, hold;
+
+	hold = CONFERENCE_MIX_HOLD_MS / (conference->interval ? conference->interval : 20);
+
+	for (imember = conference->members; imember; imember = imember->next) {
+		uint32_t k;
+
+		if (!imember->mix_hold && !conference_utils_member_test_flag(imember, MFLAG_HAS_AUDIO)) {
+			continue;
+		}
+
+		k = imember->score_iir;
+
+		if (imember->mix_hold) {
+			k += CONFERENCE_MIX_HOLD_BONUS(k);
+		}
+
+		/* top stays sorted loudest first */
+		if (n < max) {
+			i = n++;
+		} else if (k > key[max - 1]) {
+			i = max - 1;
+		} else {
+			continue;
+		}
+
+		while (i > 0 && key[i - 1] < k) {
+			top[i] = top[i - 1];
+			key[i] = key[i - 1];
+			i--;
+		}
+
+		top[i] = imember;
+		key[i] = k;
+	}
+
+	for (imember = conference->members; imember; imember = imember->next) {
+		int has_audio = conference_utils_member_test_flag(imember, MFLAG_HAS_AUDIO);
+
+		if (!imember->mix_hold && !has_audio) {
+			continue;
+		}
+
+		for (i = 0; i < n; i++) {
+			if (top[i] == imember) {
+				break;
+			}
+		}
+
+		if (i == n) {
+			if (has_audio) {
+				conference_utils_member_clear_flag_locked(imember, MFLAG_HAS_AUDIO);
+				conference->mix_dropped++;
+			}
+			imember->mix_hold = 0;
+		} else if (has_audio) {
+			imember->mix_hold = hold;
+		} else {
+			imember->mix_hold--;
+		}
+	}
+}
+
+uint32_t conference_mix_build_mask(conference_member_t *listener, conference_member_t **speakers, uint32_t speaker_count, uint32_t *mask)
+{
+	uint32_t i, excluded = 0;
+
+	memset(mask, 0, CONFERENCE_MIX_MASK_WORDS(speaker_count) * sizeof(*mask));
+
+	for (i = 0; i < speaker_count; i++) {
+		if (speakers[i] == listener || (!listener->relationships && !speakers[i]->relationships)) {
+			continue;
+		}
+
+		if (conference_mix_excluded(listener, speakers[i])) {
+			mask[i / 32] |= (1u << (i % 32));
+			excluded++;
+		}
+	}
+
+	return excluded;
+}
+
+/* one listener's frame for this tick, 0 when its mux buffer would not take it */
+switch_size_t conference_mix_output(conference_mix_tick_t *tick, conference_member_t *member, conference_mix_worker_t *worker)
+{
+	conference_obj_t *conference = member->conference;
+	int16_t *self = NULL, *out = worker->write_frame;
+	conference_audio_codec_set_t *set = NULL;
+
+	if (!conference_utils_member_test_flag(member, MFLAG_CAN_HEAR)) {
+		memset(out, 255, tick->bytes);
+		conference_mix_queue(member, out, tick->bytes, NULL);
+		/* a deaf member falling behind never stopped the mixer */
+		return 1;
+	}
+
+	/* my own contribution comes out of the main frame so we don't hear ourselves */
+	if (conference_utils_member_test_flag(member, MFLAG_HAS_AUDIO)) {
+		self = (int16_t *) member->frame;
+	}
+
+	/* relationships are resolved into a mask of speakers once per listener per tick,
+	   then only the speakers we must not hear cost an extra pass over the frame.
+	*/
+	if (conference->relationship_total && tick->speaker_count &&
+		conference_mix_build_mask(member, tick->speakers, tick->speaker_count, worker->mask)) {
+		uint32_t i;
+
+		memcpy(worker->rel_frame, tick->main_frame, tick->samples * sizeof(worker->rel_frame[0]));
+
+		for (i = 0; i < tick->speaker_count; i++) {
+			if ((worker->mask[i / 32] & (1u << (i % 32)))) {
+				conference_mix_sub(worker->rel_frame, (int16_t *) tick->speakers[i]->frame, tick->speakers[i]->read / 2);
+			}
+		}
+
+		conference_mix_minus(out, worker->rel_frame, self, tick->samples);
+	} else if (!self) {
+		/* listener only, everyone like us hears the same frame */
+		out = tick->shared_frame;
+
+		if (member->audio_codec_index >= 0) {
+			set = conference->audio_codecs[member->audio_codec_index];
+		}
+	} else {
+		conference_mix_minus(out, tick->main_frame, self, tick->samples);
+	}
+
+	return conference_mix_queue(member, out, tick->bytes, set);
+}
+
+static void conference_mix_worker_tick(conference_mix_worker_t *worker, conference_mix_tick_t *tick)
+{
+	uint32_t i;
+
+	for (i = 0; i < worker->listener_count; i++) {
+		if (!conference_mix_output(tick, worker->listeners[i], worker)) {
+			worker->failed = 1;
+			break;
+		}
+	}
+}
+
+static void *SWITCH_THREAD_FUNC conference_mix_worker_run(switch_thread_t *thread, void *obj)
+{
+	conference_mix_worker_t *worker = (conference_mix_worker_t *) obj;
+	conference_obj_t *conference = worker->conference;
+
+	switch_mutex_lock(conference->mix_mutex);
+
+	while (conference->mix_running) {
+		if (conference->mix_generation == worker->generation) {
+			switch_thread_cond_wait(conference->mix_cond, conference->mix_mutex);
+			continue;
+		}
+
+		worker->generation = conference->mix_generation;
+		switch_mutex_unlock(conference->mix_mutex);
+
+		conference_mix_worker_tick(worker, conference->mix_tick);
+
+		switch_mutex_lock(conference->mix_mutex);
+		if (!--conference->mix_pending) {
+			switch_thread_cond_signal(conference->mix_done_cond);
+		}
+	}
+
+	switch_mutex_unlock(conference->mix_mutex);
+
+	return NULL;
+}
+
+void conference_mix_workers_start(conference_obj_t *conference)
+{
+	switch_threadattr_t *thd_attr = NULL;
+	uint32_t i;
+
+	conference->mix_workers = switch_core_alloc(conference->pool, sizeof(conference_mix_worker_t) * (conference->mix_threads + 1));
+
+	for (i = 0; i <= conference->mix_threads; i++) {
+		conference->mix_workers[i].conference = conference;
+	}
+
+	if (!conference->mix_threads) {
+		return;
+	}
+
+	switch_mutex_init(&conference->mix_mutex, SWITCH_MUTEX_DEFAULT, conference->pool);
+	switch_thread_cond_create(&conference->mix_cond, conference->pool);
+	switch_thread_cond_create(&conference->mix_done_cond, conference->pool);
+	conference->mix_running = 1;
+
+	switch_threadattr_create(&thd_attr, conference->pool);
+	switch_threadattr_priority_set(thd_attr, SWITCH_PRI_REALTIME);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	/* worker 0 is the conference thread itself, the rest start from the generation as it is now so a tick
+	   that runs before a thread first gets the mutex is still seen as new */
+	for (i = 1; i <= conference->mix_threads; i++) {
+		conference->mix_workers[i].generation = conference->mix_generation;
+
+		if (switch_thread_create(&conference->mix_workers[i].thread, thd_attr, conference_mix_worker_run, &conference->mix_workers[i],
+								 conference->pool) != SWITCH_STATUS_SUCCESS) {
+			/* a worker that never runs would leave mix_pending above 0 for good */
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Conference %s could only start %u mix threads\n", conference->name, i - 1);
+			conference->mix_workers[i].thread = NULL;
+			conference->mix_threads = i - 1;
+			break;
+		}
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Conference %s mixing on %u extra threads\n", conference->name, conference->mix_threads);
+}
+
+void conference_mix_workers_stop(conference_obj_t *conference)
+{
+	switch_status_t st;
+	uint32_t i;
+
+	if (!conference->mix_workers) {
+		return;
+	}
+
+	if (conference->mix_threads) {
+		switch_mutex_lock(conference->mix_mutex);
+		conference->mix_running = 0;
+		switch_thread_cond_broadcast(conference->mix_cond);
+		switch_mutex_unlock(conference->mix_mutex);
+
+		for (i = 1; i <= conference->mix_threads; i++) {
+			if (conference->mix_workers[i].thread) {
+				switch_thread_join(&st, conference->mix_workers[i].thread);
+			}
+		}
+	}
+
+	for (i = 0; i <= conference->mix_threads; i++) {
+		switch_safe_free(conference->mix_workers[i].listeners);
+		switch_safe_free(conference->mix_workers[i].mask);
+	}
+
+	conference->mix_workers = NULL;
+}
+
+static void conference_mix_worker_reserve(conference_mix_worker_t *worker, uint32_t listeners, uint32_t speakers)
+{
+	uint32_t words = CONFERENCE_MIX_MASK_WORDS(speakers);
+
+	if (listeners > worker->listener_max) {
+		worker->listener_max = listeners + 32;
+		worker->listeners = realloc(worker->listeners, worker->listener_max * sizeof(*worker->listeners));
+		switch_assert(worker->listeners);
+	}
+
+	if (!worker->mask || words > worker->mask_words) {
+		worker->mask_words = words + 4;
+		worker->mask = realloc(worker->mask, worker->mask_words * sizeof(*worker->mask));
+		switch_assert(worker->mask);
+	}
+}
+
+/* write every listener's frame for this tick, fanned out over the workers once the room is big enough */
+switch_bool_t conference_mix_workers_run(conference_obj_t *conference, conference_mix_tick_t *tick)
+{
+	conference_member_t *member;
+	uint32_t listeners = 0, n = 1, per, i;
+	switch_bool_t ok = SWITCH_TRUE;
+
+	for (member = conference->members; member; member = member->next) {
+		if (conference_utils_member_test_flag(member, MFLAG_RUNNING)) {
+			listeners++;
+		}
+	}
+
+	if (conference->mix_threads && listeners >= CONFERENCE_MIX_PARALLEL_MIN) {
+		n = conference->mix_threads + 1;
+	}
+
+	/* contiguous slices keep each worker on its own members */
+	per = (listeners + n - 1) / n;
+	member = conference->members;
+
+	for (i = 0; i < n; i++) {
+		conference_mix_worker_t *worker = &conference->mix_workers[i];
+
+		conference_mix_worker_reserve(worker, per, tick->speaker_count);
+		worker->listener_count = 0;
+		worker->failed = 0;
+
+		for (; member && worker->listener_count < per; member = member->next) {
+			if (conference_utils_member_test_flag(member, MFLAG_RUNNING)) {
+				worker->listeners[worker->listener_count++] = member;
+			}
+		}
+	}
+
+	if (n > 1) {
+		switch_mutex_lock(conference->mix_mutex);
+		conference->mix_tick = tick;
+		conference->mix_pending = n - 1;
+		conference->mix_generation++;
+		switch_thread_cond_broadcast(conference->mix_cond);
+		switch_mutex_unlock(conference->mix_mutex);
+	}
+
+	conference_mix_worker_tick(&conference->mix_workers[0], tick);
+
+	if (n > 1) {
+		switch_mutex_lock(conference->mix_mutex);
+		while (conference->mix_pending) {
+			switch_thread_cond_wait(conference->mix_done_cond, conference->mix_mutex);
+		}
+		switch_mutex_unlock(conference->mix_mutex);
+	}
+
+	for (i = 0; i < n; i++) {
+		if (conference->mix_workers[i].failed) {
+			ok = SWITCH_FALSE;
+		}
+	}
+
+	return ok;
+}
+
+/* queue one frame for a member, and its encoded copy when it has a codec group */
+switch_size_t conference_mix_queue(conference_member_t *member, void *data, uint32_t bytes, conference_audio_codec_set_t *set)
+{
+	switch_size_t ok;
+	uint32_t len = set ? set->datalen : 0;
+
+	switch_mutex_lock(member->audio_out_mutex);
+	ok = switch_buffer_write(member->mux_buffer, data, bytes);
+
+	/* records stay in step with the mux buffer, the output loop pops one for every frame it reads */
+	if (ok && member->enc_buffer) {
+		switch_buffer_write(member->enc_buffer, &len, sizeof(len));
+
+		if (len) {
+			switch_buffer_write(member->enc_buffer, set->data, len);
+		}
+	}
+	switch_mutex_unlock(member->audio_out_mutex);
+
+	return ok;
+}
+
+/* conference->mutex held */
+void conference_mix_codec_join(conference_obj_t *conference, conference_member_t *member)
+{
+	switch_codec_t *check_codec;
+	const switch_codec_implementation_t *impl;
+	switch_codec_implementation_t read_impl = { 0 };
+	conference_audio_codec_set_t *set;
+	int i;
+
+	member->audio_codec_index = -1;
+
+	if (!conference_utils_test_flag(conference, CFLAG_MINIMIZE_AUDIO_ENCODING) ||
+		conference_utils_member_test_flag(member, MFLAG_NO_MINIMIZE_ENCODING) ||
+		conference_utils_member_test_flag(member, MFLAG_NOCHANNEL) || !member->session) {
+		return;
+	}
+
+	check_codec = switch_core_session_get_write_codec(member->session);
+
+	if (!switch_core_codec_ready(check_codec)) {
+		return;
+	}
+
+	impl = check_codec->implementation;
+	switch_core_session_get_read_impl(member->session, &read_impl);
+
+	/* the shared frame is only usable as is, no resampling, reframing or channel mapping */
+	if (impl->actual_samples_per_second != conference->rate || impl->number_of_channels != conference->channels ||
+		impl->microseconds_per_packet != conference->interval * 1000 ||
+		read_impl.microseconds_per_packet != conference->interval * 1000) {
+		return;
+	}
+
+	for (i = 0; i < MAX_MUX_CODECS && conference->audio_codecs[i]; i++) {
+		set = conference->audio_codecs[i];
+
+		if (set->codec.implementation == impl && !strcmp(switch_str_nil(set->codec.fmtp_in), switch_str_nil(check_codec->fmtp_in))) {
+			break;
+		}
+	}
+
+	if (i == MAX_MUX_CODECS) {
+		return;
+	}
+
+	if (!conference->audio_codecs[i]) {
+		set = switch_core_alloc(conference->pool, sizeof(*set));
+
+		if (switch_core_codec_copy(check_codec, &set->codec, NULL, conference->pool) != SWITCH_STATUS_SUCCESS) {
+			return;
+		}
+
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Setting up audio write codec %s at slot %d\n", impl->iananame, i);
+		conference->audio_codecs[i] = set;
+	}
+
+	/* unbounded, it never holds more records than the mux buffer holds frames */
+	if (!member->enc_buffer && switch_buffer_create_dynamic(&member->enc_buffer, CONF_DBLOCK_SIZE, CONF_DBUFFER_SIZE, 0) != SWITCH_STATUS_SUCCESS) {
+		return;
+	}
+
+	conference->audio_codecs[i]->members++;
+	member->audio_codec_index = i;
+}
+
+/* conference->mutex held */
+void conference_mix_codec_leave(conference_obj_t *conference, conference_member_t *member)
+{
+	if (member->audio_codec_index >= 0) {
+		conference->audio_codecs[member->audio_codec_index]->members--;
+		member->audio_codec_index = -1;
+	}
+}
+
+void conference_mix_codec_encode(conference_obj_t *conference, conference_mix_tick_t *tick)
+{
+	int i;
+
+	for (i = 0; i < MAX_MUX_CODECS && conference->audio_codecs[i]; i++) {
+		conference_audio_codec_set_t *set = conference->audio_codecs[i];
+		uint32_t rate = set->codec.implementation->actual_samples_per_second;
+		unsigned int flag = 0;
+
+		set->datalen = 0;
+
+		if (!set->members) {
+			continue;
+		}
+
+		set->datalen = sizeof(set->data);
+
+		if (switch_core_codec_encode(&set->codec, NULL, tick->shared_frame, tick->bytes, conference->rate,
+									 set->data, &set->datalen, &rate, &flag) != SWITCH_STATUS_SUCCESS) {
+			set->datalen = 0;
+			continue;
+		}
+
+		set->encodes++;
+	}
+}
+
+void conference_mix_codec_destroy(conference_obj_t *conference)
+{
+	int i;
+
+	for (i = 0; i < MAX_MUX_CODECS && conference->audio_codecs[i]; i++) {
+		if (switch_core_codec_ready(&conference->audio_codecs[i]->codec)) {
+			switch_core_codec_destroy(&conference->audio_codecs[i]->codec);
+		}
+		conference->audio_codecs[i] = NULL;
+	}
+}
+
+/* pop the record for the frame just read from the mux buffer, audio_out_mutex held.
+   true when frame holds a payload we can send as is instead of encoding our own copy.
+*/
+switch_bool_t conference_mix_codec_read(conference_member_t *member, switch_frame_t *frame)
+{
+	conference_audio_codec_set_t *set;
+	switch_codec_t *write_codec;
+	uint32_t len = 0;
+
+	if (switch_buffer_read(member->enc_buffer, &len, sizeof(len)) != sizeof(len) || !len) {
+		return SWITCH_FALSE;
+	}
+
+	if (len > frame->buflen || switch_buffer_read(member->enc_buffer, frame->data, len) != len) {
+		switch_buffer_zero(member->enc_buffer);
+		return SWITCH_FALSE;
+	}
+
+	if (member->audio_codec_index < 0 || !(set = member->conference->audio_codecs[member->audio_codec_index])) {
+		return SWITCH_FALSE;
+	}
+
+	/* anything that would touch the pcm on its way out needs the per member path */
+	if (!conference_utils_member_test_flag(member, MFLAG_CAN_HEAR) || member->volume_out_level || member->fnode ||
+		switch_core_media_bug_count(member->session, NULL)) {
+		return SWITCH_FALSE;
+	}
+
+	/* the session may have renegotiated since we joined the group */
+	write_codec = switch_core_session_get_write_codec(member->session);
+
+	if (!write_codec || write_codec->implementation != set->codec.implementation) {
+		return SWITCH_FALSE;
+	}
+
+	frame->datalen = len;
+	frame->codec = write_codec;
+	frame->samples = write_codec->implementation->samples_per_packet;
+	frame->rate = write_codec->implementation->actual_samples_per_second;
+
+	return SWITCH_TRUE;
+}
@@ -208,6 +208,8 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 	int member_score_sum = 0;
 	int divisor = 0;
 	conference_cdr_node_t *np;
+	conference_member_t **speakers = NULL;
+	uint32_t speaker_count = 0, speaker_max = 0;
 
 	if (!(divisor = conference->rate / 8000)) {
 		divisor = 1;
@@ -230,6 +232,8 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 	conference->auto_recording = 0;
 	conference->record_count = 0;
 
+	conference_mix_workers_start(conference);
+
 	while (conference_globals.running && !conference_utils_test_flag(conference, CFLAG_DESTRUCT)) {
 		switch_size_t file_sample_len = samples;
 		switch_size_t file_data_len = samples * 2 * conference->channels;
@@ -320,6 +324,10 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 		conference->members_seeing_video = members_seeing_video;
 		conference->members_with_avatar = members_with_avatar;
 
+		if (conference->mix_max_speakers) {
+			conference_mix_select(conference);
+		}
+
 		if (floor_holder != conference->floor_holder) {
 			conference_member_set_floor_holder(conference, floor_holder);
 		}
@@ -462,8 +470,11 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 
 		if (ready || has_file_data) {
 			/* Use more bits in the main_frame to preserve the exact sum of the audio samples. */
-			int main_frame[SWITCH_RECOMMENDED_BUFFER_SIZE] = { 0 };
-			int16_t write_frame[SWITCH_RECOMMENDED_BUFFER_SIZE] = { 0 };
+			int32_t main_frame[SWITCH_RECOMMENDED_BUFFER_SIZE] = { 0 };
+			int16_t shared_frame[SWITCH_RECOMMENDED_BUFFER_SIZE];
+			conference_mix_tick_t tick = { 0 };
+			switch_time_t mix_start = switch_time_now(), mix_usec;
+			switch_bool_t ok;
 
 
 			/* Init the main frame with file data if there is any. */
@@ -482,6 +493,7 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 			member_score_sum = 0;
 			conference->mux_loop_count = 0;
 			conference->member_loop_count = 0;
+			speaker_count = 0;
 
 
 			/* Copy audio from every member known to be producing audio into the main frame. */
@@ -499,10 +511,14 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 					}
 				}
 
-				bptr = (int16_t *) omember->frame;
-				for (x = 0; x < omember->read / 2; x++) {
-					main_frame[x] += (int32_t) bptr[x];
+				if (speaker_count == speaker_max) {
+					speaker_max = speaker_max ? speaker_max * 2 : 64;
+					speakers = realloc(speakers, speaker_max * sizeof(*speakers));
+					switch_assert(speakers);
 				}
+
+				speakers[speaker_count++] = omember;
+				conference_mix_add(main_frame, (int16_t *) omember->frame, omember->read / 2);
 			}
 
 			if (conference->agc_level && conference->member_loop_count) {
@@ -524,74 +540,32 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 			   check if our audio is involved and if so, subtract it from the sample so we don't hear ourselves.
 			   Since main frame was 32 bit int, we did not lose any detail, now that we have to convert to 16 bit we can
 			   cut it off at the min and max range if need be and write the frame to the output buffer.
+			   Members who add nothing and have no relationships all get the same frame, made once here.
 			*/
-			for (omember = conference->members; omember; omember = omember->next) {
-				switch_size_t ok = 1;
-
-				if (!conference_utils_member_test_flag(omember, MFLAG_RUNNING)) {
-					continue;
-				}
-
-				if (!conference_utils_member_test_flag(omember, MFLAG_CAN_HEAR)) {
-					switch_mutex_lock(omember->audio_out_mutex);
-					memset(write_frame, 255, bytes);
-					ok = switch_buffer_write(omember->mux_buffer, write_frame, bytes);
-					switch_mutex_unlock(omember->audio_out_mutex);
-					continue;
-				}
+			conference_mix_minus(shared_frame, main_frame, NULL, bytes / 2);
 
-				bptr = (int16_t *) omember->frame;
+			tick.main_frame = main_frame;
+			tick.shared_frame = shared_frame;
+			tick.speakers = speakers;
+			tick.speaker_count = speaker_count;
+			tick.samples = bytes / 2;
+			tick.bytes = bytes;
 
-				for (x = 0; x < bytes / 2 ; x++) {
-					z = main_frame[x];
-
-					/* bptr[x] represents my own contribution to this audio sample */
-					if (conference_utils_member_test_flag(omember, MFLAG_HAS_AUDIO) && x <= omember->read / 2) {
-						z -= (int32_t) bptr[x];
-					}
-
-					/* when there are relationships, we have to do more work by scouring all the members to see if there are any
-					   reasons why we should not be hearing a paticular member, and if not, delete their samples as well.
-					*/
-					if (conference->relationship_total) {
-						for (imember = conference->members; imember; imember = imember->next) {
-							if (imember != omember && conference_utils_member_test_flag(imember, MFLAG_HAS_AUDIO)) {
-								conference_relationship_t *rel;
-								switch_size_t found = 0;
-								int16_t *rptr = (int16_t *) imember->frame;
-								for (rel = imember->relationships; rel; rel = rel->next) {
-									if ((rel->id == omember->id || rel->id == 0) && !switch_test_flag(rel, RFLAG_CAN_SPEAK)) {
-										z -= (int32_t) rptr[x];
-										found = 1;
-										break;
-									}
-								}
-								if (!found) {
-									for (rel = omember->relationships; rel; rel = rel->next) {
-										if ((rel->id == imember->id || rel->id == 0) && !switch_test_flag(rel, RFLAG_CAN_HEAR)) {
-											z -= (int32_t) rptr[x];
-											break;
-										}
-									}
-								}
-
-							}
-						}
-					}
+			conference_mix_codec_encode(conference, &tick);
 
-					/* Now we can convert to 16 bit. */
-					switch_normalize_to_16bit(z);
-					write_frame[x] = (int16_t) z;
-				}
+			ok = conference_mix_workers_run(conference, &tick);
 
-				switch_mutex_lock(omember->audio_out_mutex);
-				ok = switch_buffer_write(omember->mux_buffer, write_frame, bytes);
-				switch_mutex_unlock(omember->audio_out_mutex);
+			mix_usec = switch_time_now() - mix_start;
+			conference->mix_usec_last = mix_usec;
+			conference->mix_usec_total += mix_usec;
+			conference->mix_ticks++;
+			if (mix_usec > conference->mix_usec_max) {
+				conference->mix_usec_max = mix_usec;
+			}
 
-				if (!ok) {
-					switch_mutex_unlock(conference->mutex);
-					goto end;
-				}
+			if (!ok) {
+				switch_mutex_unlock(conference->mutex);
+				goto end;
 			}
 		} else { /* There is no source audio.  Push silence into all of the buffers */
 			int16_t write_frame[SWITCH_RECOMMENDED_BUFFER_SIZE] = { 0 };
@@ -609,9 +583,7 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 					continue;
 				}
 
-				switch_mutex_lock(omember->audio_out_mutex);
-				ok = switch_buffer_write(omember->mux_buffer, write_frame, bytes);
-				switch_mutex_unlock(omember->audio_out_mutex);
+				ok = conference_mix_queue(omember, write_frame, bytes, NULL);
 
 				if (!ok) {
 					switch_mutex_unlock(conference->mutex);
@@ -679,6 +651,9 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 		}
 	}
 
+	conference_mix_workers_stop(conference);
+	switch_safe_free(speakers);
+
 	conference_send_presence(conference);
 
 	switch_mutex_lock(conference->mutex);
@@ -784,6 +759,8 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 	switch_thread_rwlock_unlock(conference->rwlock);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Write Lock OFF\n");
 
+	conference_mix_codec_destroy(conference);
+
 	if (conference->la) {
 		switch_live_array_destroy(&conference->la);
 	}
@@ -2247,6 +2224,7 @@ SWITCH_STANDARD_APP(conference_function)
 	switch_buffer_destroy(&member.resample_buffer);
 	switch_buffer_destroy(&member.audio_buffer);
 	switch_buffer_destroy(&member.mux_buffer);
+	switch_buffer_destroy(&member.enc_buffer);
 
 	if (member.fb) {
 		switch_frame_buffer_destroy(&member.fb);
@@ -2416,6 +2394,8 @@ conference_obj_t *conference_new(char *name, conference_xml_cfg_t cfg, switch_co
 	char *maxmember_sound = NULL;
 	uint32_t rate = 8000, interval = 20;
 	uint32_t channels = 1;
+	uint32_t mix_threads = 0;
+	uint32_t mix_max_speakers = 0;
 	int broadcast_chat_messages = 1;
 	int comfort_noise_level = 0;
 	int pin_retries = 3;
@@ -2558,6 +2538,24 @@ conference_obj_t *conference_new(char *name, conference_xml_cfg_t cfg, switch_co
 										  "Interval must be multipe of 10 and less than %d, Using default of 20\n", SWITCH_MAX_INTERVAL);
 					}
 				}
+			} else if (!strcasecmp(var, "audio-mix-threads") && !zstr(val)) {
+				int tmp = atoi(val);
+
+				if (tmp >= 0 && tmp <= CONFERENCE_MIX_THREADS_MAX) {
+					mix_threads = tmp;
+				} else {
+					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING,
+									  "audio-mix-threads must be between 0 and %d, mixing on the conference thread\n", CONFERENCE_MIX_THREADS_MAX);
+				}
+			} else if (!strcasecmp(var, "max-active-speakers") && !zstr(val)) {
+				int tmp = atoi(val);
+
+				if (tmp >= 0 && tmp <= CONFERENCE_MIX_SPEAKERS_MAX) {
+					mix_max_speakers = tmp;
+				} else {
+					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING,
+									  "max-active-speakers must be between 0 and %d, mixing everyone\n", CONFERENCE_MIX_SPEAKERS_MAX);
+				}
 			} else if (!strcasecmp(var, "timer-name") && !zstr(val)) {
 				timer_name = val;
 			} else if (!strcasecmp(var, "tts-engine") && !zstr(val)) {
@@ -3161,6 +3159,8 @@ conference_obj_t *conference_new(char *name, conference_xml_cfg_t cfg, switch_co
 	conference->channels = channels;
 	conference->rate = rate;
 	conference->interval = interval;
+	conference->mix_threads = mix_threads;
+	conference->mix_max_speakers = mix_max_speakers;
 	conference->ivr_dtmf_timeout = ivr_dtmf_timeout;
 	conference->ivr_input_timeout = ivr_input_timeout;
 
@@ -3428,6 +3428,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_conference_load)
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
 
 	memset(&conference_globals, 0, sizeof(conference_globals));
+	conference_mix_init();
 
 	/* Connect my internal structure to the blank pointer passed to me */
 	*module_interface = switch_loadable_module_create_module_interface(pool, modname);
@@ -251,6 +251,7 @@ typedef enum {
 	CFLAG_PERSONAL_CANVAS,
 	CFLAG_REFRESH_LAYOUT,
 	CFLAG_VIDEO_MUTE_EXIT_CANVAS,
+	CFLAG_MINIMIZE_AUDIO_ENCODING,
 	/////////////////////////////////
 	CFLAG_MAX
 } conference_flag_t;
@@ -368,6 +369,40 @@ typedef struct al_handle_s {
 #endif
 struct conference_obj;
 
+/* everything a listener's output needs from one mixing tick */
+typedef struct conference_mix_tick {
+	int32_t *main_frame;
+	/* main frame saturated once, shared by every listener that adds nothing to it */
+	int16_t *shared_frame;
+	conference_member_t **speakers;
+	uint32_t speaker_count;
+	uint32_t samples;
+	uint32_t bytes;
+} conference_mix_tick_t;
+
+typedef struct conference_mix_worker {
+	struct conference_obj *conference;
+	switch_thread_t *thread;
+	conference_member_t **listeners;
+	uint32_t listener_count;
+	uint32_t listener_max;
+	uint32_t *mask;
+	uint32_t mask_words;
+	uint32_t generation;
+	int failed;
+	int32_t rel_frame[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	int16_t write_frame[SWITCH_RECOMMENDED_BUFFER_SIZE];
+} conference_mix_worker_t;
+
+/* listeners on the same write codec, the shared frame is encoded once per tick for all of them */
+typedef struct conference_audio_codec_set {
+	switch_codec_t codec;
+	uint8_t data[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	uint32_t datalen;
+	uint32_t members;
+	uint32_t encodes;
+} conference_audio_codec_set_t;
+
 typedef struct conference_file_node {
 	switch_file_handle_t fh;
 	switch_speech_handle_t *sh;
@@ -680,6 +715,25 @@ typedef struct conference_obj {
 	int scale_h264_canvas_height;
 	int scale_h264_canvas_fps_divisor;
 	char *scale_h264_canvas_bandwidth;
+
+	/* listener output split across mix_threads workers plus the conference thread */
+	uint32_t mix_threads;
+	conference_mix_worker_t *mix_workers;
+	switch_mutex_t *mix_mutex;
+	switch_thread_cond_t *mix_cond;
+	switch_thread_cond_t *mix_done_cond;
+	conference_mix_tick_t *mix_tick;
+	uint32_t mix_generation;
+	uint32_t mix_pending;
+	int mix_running;
+	switch_time_t mix_usec_last;
+	switch_time_t mix_usec_max;
+	switch_time_t mix_usec_total;
+	uint32_t mix_ticks;
+	/* only the loudest this many members are mixed, 0 mixes everyone */
+	uint32_t mix_max_speakers;
+	uint32_t mix_dropped;
+	conference_audio_codec_set_t *audio_codecs[MAX_MUX_CODECS];
 } conference_obj_t;
 
 /* Relationship with another member */
@@ -698,11 +752,15 @@ struct conference_member {
 	switch_memory_pool_t *pool;
 	switch_buffer_t *audio_buffer;
 	switch_buffer_t *mux_buffer;
+	/* one record per frame in mux_buffer: uint32_t len, then len bytes already encoded for us (len 0 = encode it ourselves) */
+	switch_buffer_t *enc_buffer;
 	switch_buffer_t *resample_buffer;
 	member_flag_t flags[MFLAG_MAX];
 	uint32_t score;
 	uint32_t last_score;
 	uint32_t score_iir;
+	/* holding one of the conference's mix_max_speakers slots, ticks left before it lapses */
+	uint32_t mix_hold;
 	switch_mutex_t *flag_mutex;
 	switch_mutex_t *write_mutex;
 	switch_mutex_t *audio_in_mutex;
@@ -763,6 +821,7 @@ struct conference_member {
 	int layer_timeout;
 	int video_codec_index;
 	int video_codec_id;
+	int audio_codec_index;
 	char *video_banner_text;
 	char *video_logo;
 	char *video_mute_png;
@@ -1008,6 +1067,32 @@ void conference_list(conference_obj_t *conference, switch_stream_handle_t *strea
 const char *conference_utils_combine_flag_var(switch_core_session_t *session, const char *var_name);
 int conference_loop_mapping_len();
 
+#define CONFERENCE_MIX_MASK_WORDS(_n) (((_n) + 31) / 32)
+/* below this many listeners the hand-off costs more than it saves */
+#define CONFERENCE_MIX_PARALLEL_MIN 64
+#define CONFERENCE_MIX_THREADS_MAX 16
+#define CONFERENCE_MIX_SPEAKERS_MAX 32
+/* how long a selected speaker keeps its slot through pauses, and the edge it holds it with */
+#define CONFERENCE_MIX_HOLD_MS 1000
+#define CONFERENCE_MIX_HOLD_BONUS(_s) ((_s) / 4 + 1)
+void conference_mix_init(void);
+const char *conference_mix_engine(void);
+void conference_mix_add(int32_t *acc, const int16_t *in, uint32_t samples);
+void conference_mix_sub(int32_t *acc, const int16_t *in, uint32_t samples);
+void conference_mix_minus(int16_t *out, const int32_t *acc, const int16_t *self, uint32_t samples);
+void conference_mix_select(conference_obj_t *conference);
+uint32_t conference_mix_build_mask(conference_member_t *listener, conference_member_t **speakers, uint32_t speaker_count, uint32_t *mask);
+switch_size_t conference_mix_output(conference_mix_tick_t *tick, conference_member_t *member, conference_mix_worker_t *worker);
+void conference_mix_workers_start(conference_obj_t *conference);
+void conference_mix_workers_stop(conference_obj_t *conference);
+switch_bool_t conference_mix_workers_run(conference_obj_t *conference, conference_mix_tick_t *tick);
+switch_size_t conference_mix_queue(conference_member_t *member, void *data, uint32_t bytes, conference_audio_codec_set_t *set);
+void conference_mix_codec_join(conference_obj_t *conference, conference_member_t *member);
+void conference_mix_codec_leave(conference_obj_t *conference, conference_member_t *member);
+void conference_mix_codec_encode(conference_obj_t *conference, conference_mix_tick_t *tick);
+void conference_mix_codec_destroy(conference_obj_t *conference);
+switch_bool_t conference_mix_codec_read(conference_member_t *member, switch_frame_t *frame);
+
 switch_status_t conference_outcall(conference_obj_t *conference,
 								   char *conference_name,
 								   switch_core_session_t *session,
@@ -35,7 +35,8 @@
 #include <fcntl.h>
 
 SWITCH_MODULE_LOAD_FUNCTION(mod_dialplan_xml_load);
-SWITCH_MODULE_DEFINITION(mod_dialplan_xml, mod_dialplan_xml_load, NULL, NULL);
+SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_dialplan_xml_shutdown);
+SWITCH_MODULE_DEFINITION(mod_dialplan_xml, mod_dialplan_xml_load, mod_dialplan_xml_shutdown, NULL);
 
 typedef enum {
 	BREAK_ON_TRUE,
@@ -598,6 +599,514 @@ static int parse_exten(switch_core_session_t *session, switch_caller_profile_t *
 	return proceed;
 }
 
+/*
+ * Decision index for the contexts of the main xml registry, compiled at load and on every reloadxml.
+ *
+ * An extension can be left out of a hunt when its first condition is a plain regex on
+ * destination_number or context (no variables, no date/time, no regex="all|any|xor", no anti-actions,
+ * break on-false or always) whose expression starts with a literal: for any other value of the field
+ * parse_exten would fail that condition, break and return 0 with nothing else done. Those extensions
+ * are filed under their literal in a hash per field, everything else is a candidate on every call, and
+ * a hunt merges the two in document order so continue, anti-actions and break modes are evaluated
+ * exactly as before, just on fewer extensions. Inline actions of a continue="true" extension can change
+ * either field mid hunt, the cursor is then reopened on the new values from the next extension on.
+ */
+
+#define DP_INDEX_MAX_KEY 64
+#define DP_INDEX_MAX_LISTS (2 * (DP_INDEX_MAX_KEY + 1))
+
+typedef enum {
+	DP_FIELD_DESTINATION_NUMBER,
+	DP_FIELD_CONTEXT,
+	DP_FIELD_MAX
+} dp_field_t;
+
+static const char *dp_field_names[DP_FIELD_MAX] = { "destination_number", "context" };
+
+typedef struct dp_index_post_s {
+	uint32_t ord;
+	uint8_t exact;
+	struct dp_index_post_s *next;
+} dp_index_post_t;
+
+typedef struct {
+	dp_index_post_t *head;
+	dp_index_post_t *tail;
+} dp_index_slot_t;
+
+typedef struct dp_index_context_s {
+	switch_xml_t xcontext;
+	switch_xml_t *extens;
+	uint32_t nexten;
+	uint32_t *always;
+	uint32_t nalways;
+	switch_hash_t *keys[DP_FIELD_MAX];
+	size_t max_key[DP_FIELD_MAX];
+	struct dp_index_context_s *next;
+} dp_index_context_t;
+
+typedef struct {
+	switch_xml_t root;
+	switch_memory_pool_t *pool;
+	dp_index_context_t *contexts;
+	uint32_t ncontexts;
+	uint32_t extens;
+	uint32_t indexed;
+	uint32_t exact;
+	switch_time_t built;
+	switch_time_t usec;
+	int refs;
+} dp_index_t;
+
+typedef struct {
+	dp_index_context_t *ctx;
+	dp_index_post_t *lists[DP_INDEX_MAX_LISTS];
+	size_t lens[DP_INDEX_MAX_LISTS];
+	size_t vlens[DP_INDEX_MAX_LISTS];
+	const char *vals[DP_INDEX_MAX_LISTS];
+	const char *fields[DP_FIELD_MAX];
+	int nlists;
+	uint32_t always_pos;
+	uint32_t from;
+	uint32_t last;
+} dp_index_cursor_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	dp_index_t *index;
+	switch_event_node_t *node;
+	int disabled;
+} globals;
+
+/* the literal every subject matching expression has to start with, 0 when there is none */
+static size_t dp_index_literal(const char *expression, char *buf, size_t len, int *exact)
+{
+	const char *p;
+	size_t n = 0;
+	int quant = 0;
+
+	*exact = 0;
+
+	if (*expression != '^' || strchr(expression, '|')) {
+		return 0;
+	}
+
+	for (p = expression + 1; *p && n < len - 1; ) {
+		char c = *p;
+
+		if (c == '\\') {
+			if (!p[1] || isalnum((unsigned char) p[1])) {
+				break;
+			}
+			c = p[1];
+			p += 2;
+		} else if (strchr("^$.[]()?*+{}", c)) {
+			break;
+		} else {
+			p++;
+		}
+
+		buf[n++] = c;
+
+		if (*p == '?' || *p == '*' || *p == '{') {
+			n--;
+			quant = 1;
+			break;
+		} else if (*p == '+') {
+			quant = 1;
+			break;
+		}
+	}
+
+	buf[n] = '\0';
+
+	if (n && !quant && *p == '$' && !p[1]) {
+		*exact = 1;
+	}
+
+	return n;
+}
+
+/* which field and literal an extension can be filed under, -1 when it has to be tried on every call */
+static int dp_index_key(switch_xml_t xexten, char *buf, size_t len, int *exact)
+{
+	switch_xml_t xcond, xexpression;
+	const char *field = NULL, *expression, *brk = NULL;
+	int i, f;
+
+	if (!(xcond = switch_xml_child(xexten, "condition")) || switch_xml_child(xcond, "anti-action")) {
+		return -1;
+	}
+
+	for (i = 0; xcond->attr[i]; i += 2) {
+		if (!strcasecmp(xcond->attr[i], "field")) {
+			field = xcond->attr[i + 1];
+		} else if (!strcasecmp(xcond->attr[i], "break")) {
+			brk = xcond->attr[i + 1];
+		} else if (strcasecmp(xcond->attr[i], "expression")) {
+			return -1;
+		}
+	}
+
+	if (!field || (brk && (!strcasecmp(brk, "on-true") || !strcasecmp(brk, "never")))) {
+		return -1;
+	}
+
+	for (f = 0; f < DP_FIELD_MAX; f++) {
+		if (!strcasecmp(field, dp_field_names[f])) {
+			break;
+		}
+	}
+
+	if (f == DP_FIELD_MAX) {
+		return -1;
+	}
+
+	if ((xexpression = switch_xml_child(xcond, "expression"))) {
+		expression = switch_str_nil(xexpression->txt);
+	} else {
+		expression = switch_xml_attr_soft(xcond, "expression");
+	}
+
+	/* anything switch_channel_expand_variables would touch depends on the channel */
+	if (switch_string_var_check_const(expression) || switch_string_has_escaped_data(expression)) {
+		return -1;
+	}
+
+	if (!dp_index_literal(expression, buf, len, exact)) {
+		return -1;
+	}
+
+	return f;
+}
+
+static dp_index_context_t *dp_index_compile_context(dp_index_t *index, switch_xml_t xcontext)
+{
+	dp_index_context_t *ctx = switch_core_alloc(index->pool, sizeof(*ctx));
+	switch_xml_t xexten;
+	char key[DP_INDEX_MAX_KEY];
+	uint32_t n = 0;
+	int f, exact;
+
+	ctx->xcontext = xcontext;
+
+	for (xexten = switch_xml_child(xcontext, "extension"); xexten; xexten = xexten->next) {
+		n++;
+	}
+
+	ctx->extens = switch_core_alloc(index->pool, sizeof(*ctx->extens) * (n + 1));
+	ctx->always = switch_core_alloc(index->pool, sizeof(*ctx->always) * (n + 1));
+
+	for (f = 0; f < DP_FIELD_MAX; f++) {
+		switch_core_hash_init(&ctx->keys[f]);
+	}
+
+	for (xexten = switch_xml_child(xcontext, "extension"); xexten; xexten = xexten->next) {
+		uint32_t ord = ctx->nexten++;
+
+		ctx->extens[ord] = xexten;
+
+		if ((f = dp_index_key(xexten, key, sizeof(key), &exact)) < 0) {
+			ctx->always[ctx->nalways++] = ord;
+		} else {
+			dp_index_slot_t *slot = switch_core_hash_find(ctx->keys[f], key);
+			dp_index_post_t *post = switch_core_alloc(index->pool, sizeof(*post));
+			size_t klen = strlen(key);
+
+			if (!slot) {
+				slot = switch_core_alloc(index->pool, sizeof(*slot));
+				switch_core_hash_insert(ctx->keys[f], key, slot);
+			}
+
+			post->ord = ord;
+			post->exact = (uint8_t) exact;
+
+			if (slot->tail) {
+				slot->tail->next = post;
+			} else {
+				slot->head = post;
+			}
+			slot->tail = post;
+
+			if (klen > ctx->max_key[f]) {
+				ctx->max_key[f] = klen;
+			}
+
+			index->indexed++;
+			if (exact) index->exact++;
+		}
+	}
+
+	index->extens += ctx->nexten;
+	index->ncontexts++;
+
+	return ctx;
+}
+
+static void dp_index_destroy(dp_index_t **indexp)
+{
+	dp_index_t *index = *indexp;
+	switch_memory_pool_t *pool;
+	dp_index_context_t *ctx;
+	int f;
+
+	*indexp = NULL;
+
+	if (!index) {
+		return;
+	}
+
+	for (ctx = index->contexts; ctx; ctx = ctx->next) {
+		for (f = 0; f < DP_FIELD_MAX; f++) {
+			if (ctx->keys[f]) {
+				switch_core_hash_destroy(&ctx->keys[f]);
+			}
+		}
+	}
+
+	switch_xml_free(index->root);
+	pool = index->pool;
+	switch_core_destroy_memory_pool(&pool);
+}
+
+/* takes over the caller's reference on root, the index points into it */
+static dp_index_t *dp_index_compile(switch_xml_t root)
+{
+	switch_memory_pool_t *pool = NULL;
+	switch_xml_t xsection, xdialplan, xcontext;
+	dp_index_context_t *ctx, *last = NULL;
+	dp_index_t *index;
+	switch_time_t start = switch_time_now();
+
+	switch_core_new_memory_pool(&pool);
+	index = switch_core_alloc(pool, sizeof(*index));
+	index->pool = pool;
+	index->root = root;
+	index->refs = 1;
+
+	if ((xsection = switch_xml_find_child(root, "section", "name", "dialplan"))) {
+		for (xdialplan = switch_xml_child(xsection, "dialplan"); xdialplan; xdialplan = xdialplan->next) {
+			for (xcontext = switch_xml_child(xdialplan, "context"); xcontext; xcontext = xcontext->next) {
+				ctx = dp_index_compile_context(index, xcontext);
+
+				if (last) {
+					last->next = ctx;
+				} else {
+					index->contexts = ctx;
+				}
+				last = ctx;
+			}
+		}
+	}
+
+	index->built = switch_time_now();
+	index->usec = index->built - start;
+
+	return index;
+}
+
+static void dp_index_release(dp_index_t **indexp)
+{
+	dp_index_t *index = *indexp;
+	int refs;
+
+	*indexp = NULL;
+
+	if (!index) {
+		return;
+	}
+
+	switch_mutex_lock(globals.mutex);
+	refs = --index->refs;
+	switch_mutex_unlock(globals.mutex);
+
+	if (!refs) {
+		dp_index_destroy(&index);
+	}
+}
+
+/* the index for the registry a hunt is reading, NULL when xml came from a binding or is stale */
+static dp_index_t *dp_index_acquire(switch_xml_t xml)
+{
+	dp_index_t *index = NULL;
+
+	switch_mutex_lock(globals.mutex);
+	if (!globals.disabled && globals.index && globals.index->root == xml) {
+		index = globals.index;
+		index->refs++;
+	}
+	switch_mutex_unlock(globals.mutex);
+
+	return index;
+}
+
+static void dp_index_rebuild(void)
+{
+	dp_index_t *index, *old;
+
+	index = dp_index_compile(switch_xml_root());
+
+	switch_mutex_lock(globals.mutex);
+	old = globals.index;
+	globals.index = index;
+	switch_mutex_unlock(globals.mutex);
+
+	dp_index_release(&old);
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Indexed %u of %u extensions (%u exact) in %u contexts in %dus\n",
+					  index->indexed, index->extens, index->exact, index->ncontexts, (int) index->usec);
+}
+
+static void dp_index_event_handler(switch_event_t *event)
+{
+	dp_index_rebuild();
+}
+
+static dp_index_context_t *dp_index_find(dp_index_t *index, switch_xml_t xcontext)
+{
+	dp_index_context_t *ctx;
+
+	for (ctx = index->contexts; ctx; ctx = ctx->next) {
+		if (ctx->xcontext == xcontext) {
+			return ctx;
+		}
+	}
+
+	return NULL;
+}
+
+static dp_index_post_t *dp_index_skip(dp_index_cursor_t *cursor, int i, dp_index_post_t *post)
+{
+	for (; post; post = post->next) {
+		if (post->ord < cursor->from) {
+			continue;
+		}
+
+		/* pcre's $ also matches before a trailing newline */
+		if (post->exact && cursor->lens[i] != cursor->vlens[i] &&
+			!(cursor->lens[i] + 1 == cursor->vlens[i] && cursor->vals[i][cursor->lens[i]] == '\n')) {
+			continue;
+		}
+
+		break;
+	}
+
+	return post;
+}
+
+/* gathers the literals the caller profile can match, SWITCH_STATUS_FALSE when it has to walk everything */
+static switch_status_t dp_index_open(dp_index_cursor_t *cursor, dp_index_context_t *ctx, switch_caller_profile_t *caller_profile,
+									 switch_xml_t xstart)
+{
+	char buf[DP_INDEX_MAX_KEY];
+	int f;
+
+	memset(cursor, 0, sizeof(*cursor));
+	cursor->ctx = ctx;
+
+	if (xstart != switch_xml_child(ctx->xcontext, "extension")) {
+		for (cursor->from = 0; cursor->from < ctx->nexten && ctx->extens[cursor->from] != xstart; cursor->from++);
+
+		if (cursor->from == ctx->nexten) {
+			return SWITCH_STATUS_FALSE;
+		}
+	}
+
+	for (f = 0; f < DP_FIELD_MAX; f++) {
+		const char *val = switch_caller_get_field_by_name(caller_profile, dp_field_names[f]);
+		size_t vlen, l;
+
+		if (!val) {
+			val = "";
+		}
+
+		cursor->fields[f] = val;
+		vlen = strlen(val);
+
+		for (l = 1; l <= vlen && l <= ctx->max_key[f]; l++) {
+			dp_index_slot_t *slot;
+			dp_index_post_t *post;
+
+			memcpy(buf, val, l);
+			buf[l] = '\0';
+
+			if (!(slot = switch_core_hash_find(ctx->keys[f], buf))) {
+				continue;
+			}
+
+			cursor->lens[cursor->nlists] = l;
+			cursor->vlens[cursor->nlists] = vlen;
+			cursor->vals[cursor->nlists] = val;
+
+			if ((post = dp_index_skip(cursor, cursor->nlists, slot->head))) {
+				cursor->lists[cursor->nlists++] = post;
+			}
+		}
+	}
+
+	for (cursor->always_pos = 0; cursor->always_pos < ctx->nalways && ctx->always[cursor->always_pos] < cursor->from; cursor->always_pos++);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+/* the next extension in document order the index could not rule out */
+static switch_xml_t dp_index_next(dp_index_cursor_t *cursor)
+{
+	dp_index_context_t *ctx = cursor->ctx;
+	uint32_t best = ctx->nexten;
+	int i, pick = -1;
+
+	if (cursor->always_pos < ctx->nalways) {
+		best = ctx->always[cursor->always_pos];
+	}
+
+	for (i = 0; i < cursor->nlists; i++) {
+		if (cursor->lists[i] && cursor->lists[i]->ord < best) {
+			best = cursor->lists[i]->ord;
+			pick = i;
+		}
+	}
+
+	if (best == ctx->nexten) {
+		return NULL;
+	}
+
+	if (pick < 0) {
+		cursor->always_pos++;
+	} else {
+		cursor->lists[pick] = dp_index_skip(cursor, pick, cursor->lists[pick]->next);
+	}
+
+	cursor->last = best;
+
+	return ctx->extens[best];
+}
+
+/* dp_index_next for the rest of a hunt, reopening the cursor when the fields it was opened on have changed */
+static switch_xml_t dp_index_follow(dp_index_cursor_t *cursor, switch_caller_profile_t *caller_profile)
+{
+	dp_index_context_t *ctx = cursor->ctx;
+	int f;
+
+	for (f = 0; f < DP_FIELD_MAX; f++) {
+		const char *val = switch_caller_get_field_by_name(caller_profile, dp_field_names[f]);
+
+		if (strcmp(val ? val : "", cursor->fields[f])) {
+			break;
+		}
+	}
+
+	if (f == DP_FIELD_MAX) {
+		return dp_index_next(cursor);
+	}
+
+	if (cursor->last + 1 >= ctx->nexten || dp_index_open(cursor, ctx, caller_profile, ctx->extens[cursor->last + 1]) != SWITCH_STATUS_SUCCESS) {
+		return NULL;
+	}
+
+	return dp_index_next(cursor);
+}
+
 static switch_status_t dialplan_xml_locate(switch_core_session_t *session, switch_caller_profile_t *caller_profile, switch_xml_t *root,
 										   switch_xml_t *node)
 {
@@ -622,6 +1131,9 @@ SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 	switch_xml_t alt_root = NULL, cfg, xml = NULL, xcontext, xexten = NULL;
 	char *alt_path = (char *) arg;
 	const char *hunt = NULL;
+	dp_index_t *index = NULL;
+	dp_index_context_t *ictx = NULL;
+	dp_index_cursor_t cursor;
 
 	if (!caller_profile) {
 		if (!(caller_profile = switch_channel_get_caller_profile(channel))) {
@@ -677,6 +1189,13 @@ SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 		xexten = switch_xml_child(xcontext, "extension");
 	}
 
+	if (xexten && (index = dp_index_acquire(xml)) && (ictx = dp_index_find(index, xcontext)) &&
+		dp_index_open(&cursor, ictx, caller_profile, xexten) == SWITCH_STATUS_SUCCESS) {
+		xexten = dp_index_next(&cursor);
+	} else {
+		ictx = NULL;
+	}
+
 	while (xexten) {
 		int proceed = 0;
 		const char *cont = switch_xml_attr(xexten, "continue");
@@ -702,9 +1221,10 @@ SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 			break;
 		}
 
-		xexten = xexten->next;
+		xexten = ictx ? dp_index_follow(&cursor, caller_profile) : xexten->next;
 	}
 
+	dp_index_release(&index);
 	switch_xml_free(xml);
 	xml = NULL;
 
@@ -713,18 +1233,93 @@ SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 	return extension;
 }
 
+#define XML_DIALPLAN_INDEX_SYNTAX "[show|rebuild|enable|disable]"
+SWITCH_STANDARD_API(xml_dialplan_index_function)
+{
+	dp_index_t *index = NULL;
+	dp_index_context_t *ctx;
+
+	if (!zstr(cmd) && !strcasecmp(cmd, "rebuild")) {
+		dp_index_rebuild();
+	} else if (!zstr(cmd) && !strcasecmp(cmd, "enable")) {
+		globals.disabled = 0;
+	} else if (!zstr(cmd) && !strcasecmp(cmd, "disable")) {
+		globals.disabled = 1;
+	} else if (!zstr(cmd) && strcasecmp(cmd, "show")) {
+		stream->write_function(stream, "-USAGE: %s\n", XML_DIALPLAN_INDEX_SYNTAX);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	switch_mutex_lock(globals.mutex);
+	if ((index = globals.index)) {
+		index->refs++;
+	}
+	switch_mutex_unlock(globals.mutex);
+
+	if (!index) {
+		stream->write_function(stream, "-ERR no index\n");
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	stream->write_function(stream, "index %s, built in %dus\n", globals.disabled ? "disabled" : "enabled", (int) index->usec);
+
+	for (ctx = index->contexts; ctx; ctx = ctx->next) {
+		stream->write_function(stream, "context %s: %u extensions, %u indexed, %u on every call\n",
+							   switch_xml_attr_soft(ctx->xcontext, "name"), ctx->nexten, ctx->nexten - ctx->nalways, ctx->nalways);
+	}
+
+	stream->write_function(stream, "total: %u extensions, %u indexed (%u exact) in %u contexts\n",
+						   index->extens, index->indexed, index->exact, index->ncontexts);
+
+	dp_index_release(&index);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_MODULE_LOAD_FUNCTION(mod_dialplan_xml_load)
 {
 	switch_dialplan_interface_t *dp_interface;
+	switch_api_interface_t *api_interface;
+
+	memset(&globals, 0, sizeof(globals));
+	switch_mutex_init(&globals.mutex, SWITCH_MUTEX_NESTED, pool);
+
+	if ((switch_event_bind_removable(modname, SWITCH_EVENT_RELOADXML, NULL, dp_index_event_handler, NULL, &globals.node) != SWITCH_STATUS_SUCCESS)) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't bind!\n");
+	}
+
+	dp_index_rebuild();
 
 	/* connect my internal structure to the blank pointer passed to me */
 	*module_interface = switch_loadable_module_create_module_interface(pool, modname);
 	SWITCH_ADD_DIALPLAN(dp_interface, "XML", dialplan_hunt);
+	SWITCH_ADD_API(api_interface, "xml_dialplan_index", "XML dialplan index", xml_dialplan_index_function, XML_DIALPLAN_INDEX_SYNTAX);
+	switch_console_set_complete("add xml_dialplan_index show");
+	switch_console_set_complete("add xml_dialplan_index rebuild");
+	switch_console_set_complete("add xml_dialplan_index enable");
+	switch_console_set_complete("add xml_dialplan_index disable");
 
 	/* indicate that the module should continue to be loaded */
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_dialplan_xml_shutdown)
+{
+	dp_index_t *index;
+
+	switch_event_unbind(&globals.node);
+	switch_console_set_complete("del xml_dialplan_index");
+
+	switch_mutex_lock(globals.mutex);
+	index = globals.index;
+	globals.index = NULL;
+	switch_mutex_unlock(globals.mutex);
+
+	dp_index_release(&index);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 /* For Emacs:
  * Local Variables:
  * mode:c
@@ -64,7 +64,8 @@ typedef enum {
 typedef enum {
 	EVENT_FORMAT_PLAIN,
 	EVENT_FORMAT_XML,
-	EVENT_FORMAT_JSON
+	EVENT_FORMAT_JSON,
+	EVENT_FORMAT_BINARY
 } event_format_t;
 
 struct listener {
@@ -141,6 +142,8 @@ static const char *format2str(event_format_t format)
 		return "xml";
 	case EVENT_FORMAT_JSON:
 		return "json";
+	case EVENT_FORMAT_BINARY:
+		return "binary";
 	}
 
 	return "invalid";
@@ -851,6 +854,12 @@ SWITCH_STANDARD_API(event_sink_function)
 			goto end;
 		}
 
+		/* binary frames carry NULs and a length prefix, they can't ride inside the text envelopes below */
+		if (switch_stristr("binary", format)) {
+			stream->write_function(stream, "<data><reply type=\"error\">Binary format not supported over HTTP</reply></data>\n");
+			goto end;
+		}
+
 		switch_core_new_memory_pool(&pool);
 		listener = switch_core_alloc(pool, sizeof(*listener));
 		listener->pool = pool;
@@ -1011,6 +1020,16 @@ SWITCH_STANDARD_API(event_sink_function)
 			goto end;
 		}
 
+		if (listener->format == EVENT_FORMAT_BINARY) {
+			switch_thread_rwlock_unlock(listener->rwlock);
+			if (switch_stristr("json", format)) {
+				stream->write_function(stream, "{\"reply\": \"error\", \"reply_text\":\"Binary format not supported over HTTP\"}");
+			} else {
+				stream->write_function(stream, "<data><reply type=\"error\">Binary format not supported over HTTP</reply></data>\n");
+			}
+			goto end;
+		}
+
 		listener->last_flush = switch_epoch_time_now(NULL);
 
 		if (listener->format == EVENT_FORMAT_JSON) {
@@ -1384,6 +1403,7 @@ static switch_status_t read_packet(listener_t *listener, switch_event_t **event,
 					char hbuf[512];
 					switch_event_t *pevent = (switch_event_t *) pop;
 					char *etype;
+					switch_size_t elen = 0;
 
 					do_sleep = 0;
 					if (listener->format == EVENT_FORMAT_PLAIN) {
@@ -1392,6 +1412,9 @@ static switch_status_t read_packet(listener_t *listener, switch_event_t **event,
 					} else if (listener->format == EVENT_FORMAT_JSON) {
 						etype = "json";
 						switch_event_serialize_json(pevent, &listener->ebuf);
+					} else if (listener->format == EVENT_FORMAT_BINARY) {
+						etype = "binary";
+						switch_event_serialize_binary(pevent, &listener->ebuf, &elen);
 					} else {
 						switch_xml_t xml;
 						etype = "xml";
@@ -1407,14 +1430,16 @@ static switch_status_t read_packet(listener_t *listener, switch_event_t **event,
 
 					switch_assert(listener->ebuf);
 
-					len = strlen(listener->ebuf);
+					if (listener->format != EVENT_FORMAT_BINARY) {
+						elen = strlen(listener->ebuf);
+					}
 
-					switch_snprintf(hbuf, sizeof(hbuf), "Content-Length: %" SWITCH_SSIZE_T_FMT "\n" "Content-Type: text/event-%s\n" "\n", len, etype);
+					switch_snprintf(hbuf, sizeof(hbuf), "Content-Length: %" SWITCH_SSIZE_T_FMT "\n" "Content-Type: text/event-%s\n" "\n", elen, etype);
 
 					len = strlen(hbuf);
 					switch_socket_send(listener->sock, hbuf, &len);
 
-					len = strlen(listener->ebuf);
+					len = elen;
 					switch_socket_send(listener->sock, listener->ebuf, &len);
 
 					switch_safe_free(listener->ebuf);
@@ -2060,6 +2085,8 @@ static switch_status_t parse_command(listener_t *listener, switch_event_t **even
 							listener->format = EVENT_FORMAT_PLAIN;
 						} else if (!strcasecmp(fmt, "json")) {
 							listener->format = EVENT_FORMAT_JSON;
+						} else if (!strcasecmp(fmt, "binary")) {
+							listener->format = EVENT_FORMAT_BINARY;
 						}						
 					}
 
@@ -2101,6 +2128,9 @@ static switch_status_t parse_command(listener_t *listener, switch_event_t **even
 			if (strstr(cmd, "json") || strstr(cmd, "JSON")) {
 				listener->format = EVENT_FORMAT_JSON;
 			}
+			if (strstr(cmd, "binary") || strstr(cmd, "BINARY")) {
+				listener->format = EVENT_FORMAT_BINARY;
+			}
 			switch_snprintf(reply, reply_len, "+OK Events Enabled");
 			goto done;
 		}
@@ -2457,6 +2487,9 @@ static switch_status_t parse_command(listener_t *listener, switch_event_t **even
 					} else if (!strcasecmp(cur, "json")) {
 						listener->format = EVENT_FORMAT_JSON;
 						goto end;
+					} else if (!strcasecmp(cur, "binary")) {
+						listener->format = EVENT_FORMAT_BINARY;
+						goto end;
 					}
 				}
 
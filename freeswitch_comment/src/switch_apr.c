@@ -820,6 +820,47 @@ SWITCH_DECLARE(switch_status_t) switch_sockaddr_create(switch_sockaddr_t **sa, s
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_DECLARE(switch_status_t) switch_sockaddr_set_native(switch_sockaddr_t *sa, const void *native, uint32_t len)
+{
+	const struct sockaddr *in = (const struct sockaddr *) native;
+
+	if (!sa || !in || len > sizeof(sa->sa)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	memcpy(&sa->sa, native, len);
+	sa->salen = len;
+	sa->family = in->sa_family;
+
+#if APR_HAVE_IPV6
+	if (in->sa_family == AF_INET6) {
+		sa->port = ntohs(sa->sa.sin6.sin6_port);
+		sa->addr_str_len = 46;
+		sa->ipaddr_ptr = &(sa->sa.sin6.sin6_addr);
+		sa->ipaddr_len = sizeof(struct in6_addr);
+		return SWITCH_STATUS_SUCCESS;
+	}
+#endif
+
+	sa->port = ntohs(sa->sa.sin.sin_port);
+	sa->addr_str_len = 16;
+	sa->ipaddr_ptr = &(sa->sa.sin.sin_addr);
+	sa->ipaddr_len = sizeof(struct in_addr);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(uint32_t) switch_sockaddr_get_native(switch_sockaddr_t *sa, void *native, uint32_t len)
+{
+	if (!sa || !native || len < (uint32_t) sa->salen) {
+		return 0;
+	}
+
+	memcpy(native, &sa->sa, sa->salen);
+
+	return (uint32_t) sa->salen;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_sockaddr_info_get(switch_sockaddr_t ** sa, const char *hostname, int32_t family,
 														 switch_port_t port, int32_t flags, switch_memory_pool_t *pool)
 {
@@ -1342,6 +1383,54 @@ SWITCH_DECLARE(int) switch_atomic_dec(volatile switch_atomic_t *mem)
 #endif
 }
 
+/* apr has no 64 bit atomics before 1.7 */
+SWITCH_DECLARE(uint64_t) switch_atomic64_read(volatile switch_atomic64_t *mem)
+{
+#ifdef _MSC_VER
+	return (uint64_t) InterlockedCompareExchange64((volatile LONGLONG *) mem, 0, 0);
+#else
+	return __atomic_load_n(mem, __ATOMIC_RELAXED);
+#endif
+}
+
+SWITCH_DECLARE(void) switch_atomic64_set(volatile switch_atomic64_t *mem, uint64_t val)
+{
+#ifdef _MSC_VER
+	InterlockedExchange64((volatile LONGLONG *) mem, (LONGLONG) val);
+#else
+	__atomic_store_n(mem, val, __ATOMIC_RELAXED);
+#endif
+}
+
+SWITCH_DECLARE(void) switch_atomic64_add(volatile switch_atomic64_t *mem, uint64_t val)
+{
+#ifdef _MSC_VER
+	InterlockedExchangeAdd64((volatile LONGLONG *) mem, (LONGLONG) val);
+#else
+	__atomic_fetch_add(mem, val, __ATOMIC_RELAXED);
+#endif
+}
+
+SWITCH_DECLARE(uint64_t) switch_atomic64_inc(volatile switch_atomic64_t *mem)
+{
+#ifdef _MSC_VER
+	return (uint64_t) InterlockedIncrement64((volatile LONGLONG *) mem);
+#else
+	return __atomic_add_fetch(mem, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+SWITCH_DECLARE(uint64_t) switch_atomic64_cas(volatile switch_atomic64_t *mem, uint64_t with, uint64_t cmp)
+{
+#ifdef _MSC_VER
+	return (uint64_t) InterlockedCompareExchange64((volatile LONGLONG *) mem, (LONGLONG) with, (LONGLONG) cmp);
+#else
+	/* cmp comes back holding what was there when the swap fails */
+	__atomic_compare_exchange_n(mem, &cmp, with, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+	return cmp;
+#endif
+}
+
 SWITCH_DECLARE(char *) switch_strerror(switch_status_t statcode, char *buf, switch_size_t bufsize)
 {
 	return apr_strerror(statcode, buf, bufsize);
@@ -34,6 +34,7 @@
 #include <switch.h>
 #include <switch_channel.h>
 #include <pcre.h>
+#include "private/switch_core_pvt.h"
 
 struct switch_cause_table {
 	const char *name;
@@ -1437,6 +1438,10 @@ SWITCH_DECLARE(switch_status_t) switch_channel_set_variable_var_check(switch_cha
 			}
 		}
 		status = SWITCH_STATUS_SUCCESS;
+
+		if (channel->session) {
+			switch_core_channel_store_set_var(switch_core_session_get_uuid(channel->session), channel->variables, varname);
+		}
 	}
 	switch_mutex_unlock(channel->profile_mutex);
 
@@ -1468,6 +1473,10 @@ SWITCH_DECLARE(switch_status_t) switch_channel_add_variable_var_check(switch_cha
 			}
 		}
 		status = SWITCH_STATUS_SUCCESS;
+
+		if (channel->session) {
+			switch_core_channel_store_set_var(switch_core_session_get_uuid(channel->session), channel->variables, varname);
+		}
 	}
 	switch_mutex_unlock(channel->profile_mutex);
 
@@ -1957,6 +1957,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 	switch_console_init(runtime.memory_pool);
 	switch_event_init(runtime.memory_pool);
 	switch_channel_global_init(runtime.memory_pool);
+	switch_resample_init(runtime.memory_pool);
+	switch_regex_init(runtime.memory_pool);
 
 	if (switch_xml_init(runtime.memory_pool, err) != SWITCH_STATUS_SUCCESS) {
 		apr_terminate();
@@ -2289,6 +2291,16 @@ static void switch_load_core_config(const char *file)
 					} else {
 						runtime.timer_affinity = atoi(val);
 					}
+				} else if (!strcasecmp(var, "rtp-reactor-threads") && !zstr(val)) {
+					switch_rtp_set_reactor_threads((uint32_t) atoi(val));
+				} else if (!strcasecmp(var, "regex-cache-size") && !zstr(val)) {
+					switch_regex_cache_set_size((uint32_t) atoi(val));
+				} else if (!strcasecmp(var, "memory-pool-cache") && !zstr(val)) {
+					switch_core_memory_pool_set_cache((uint32_t) atoi(val));
+				} else if (!strcasecmp(var, "rtp-tx-batch") && !zstr(val)) {
+					switch_rtp_set_tx_batch((uint32_t) atoi(val));
+				} else if (!strcasecmp(var, "session-scheduler-threads") && !zstr(val)) {
+					switch_core_session_set_scheduler_threads(!strcasecmp(val, "auto") ? switch_core_cpu_count() : (uint32_t) atoi(val));
 				} else if (!strcasecmp(var, "rtp-start-port") && !zstr(val)) {
 					switch_rtp_set_start_port((switch_port_t) atoi(val));
 				} else if (!strcasecmp(var, "rtp-end-port") && !zstr(val)) {
@@ -2303,6 +2315,8 @@ static void switch_load_core_config(const char *file)
 					} else {
 						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "ODBC AND PGSQL ARE NOT AVAILABLE!\n");
 					}
+				} else if (!strcasecmp(var, "core-db-channels-mirror") && switch_false(val)) {
+					switch_set_flag((&runtime), SCF_NO_CHANNEL_SQL);
 				} else if (!strcasecmp(var, "core-non-sqlite-db-required") && !zstr(val)) {
 					switch_set_flag((&runtime), SCF_CORE_NON_SQLITE_DB_REQ);
 				} else if (!strcasecmp(var, "core-dbtype") && !zstr(val)) {
@@ -2920,6 +2934,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_destroy(void)
 	switch_log_shutdown();
 
 	switch_core_session_uninit();
+	switch_resample_shutdown();
+	switch_regex_shutdown();
 	switch_core_unset_variables();
 	switch_core_memory_stop();
 
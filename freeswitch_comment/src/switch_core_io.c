@@ -35,6 +35,9 @@
 
 #include <switch.h>
 #include "private/switch_core_pvt.h"
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
 
 SWITCH_DECLARE(void) switch_core_gen_encoded_silence(unsigned char *data, const switch_codec_implementation_t *read_impl, switch_size_t len)
 {
@@ -64,6 +67,424 @@ SWITCH_DECLARE(void) switch_core_gen_encoded_silence(unsigned char *data, const
 
 }
 
+/*
+  Time stretch the decoded frame toward the audio jitter buffer's playout delay estimate.
+  To catch up the next packet is pulled early and a pitch period is cut from the pair, to fall back
+  a period is repeated; whatever runs over a frame waits in stretch_read_buffer and is played
+  in a slot the jitter buffer is told to hold.
+*/
+static void read_stretch(switch_core_session_t *session, switch_codec_t *codec, switch_frame_t *read_frame)
+{
+	int16_t work[SWITCH_RECOMMENDED_BUFFER_SIZE / 2];
+	uint32_t frame_bytes = session->raw_read_frame.datalen, samples = frame_bytes / 2;
+	uint32_t rate = session->raw_read_frame.rate ? session->raw_read_frame.rate : codec->implementation->actual_samples_per_second;
+	switch_size_t inuse;
+	switch_jb_t *jb;
+	int advice;
+
+	if (frame_bytes != codec->implementation->decoded_bytes_per_packet || frame_bytes * 3 > sizeof(work) ||
+		!(jb = switch_core_session_get_jb(session, SWITCH_MEDIA_TYPE_AUDIO))) {
+		return;
+	}
+
+	if (!session->stretch_read_buffer && switch_buffer_create_dynamic(&session->stretch_read_buffer, frame_bytes, frame_bytes * 4, frame_bytes * 4) != SWITCH_STATUS_SUCCESS) {
+		return;
+	}
+
+	inuse = switch_buffer_inuse(session->stretch_read_buffer);
+	advice = inuse < frame_bytes ? switch_jb_stretch_advice(jb) : 0;
+
+	if (!advice && !inuse) {
+		return;
+	}
+
+	memcpy(work, session->raw_read_frame.data, frame_bytes);
+
+	if (advice > 0) {
+		switch_rtp_packet_t packet;
+		switch_size_t len = sizeof(packet), hlen;
+		uint32_t extra = sizeof(work) - frame_bytes, extra_rate = 0, extra_flags = 0;
+
+		if (switch_jb_stretch_pull(jb, (uint8_t) read_frame->payload, &packet, &len) == SWITCH_STATUS_SUCCESS) {
+			hlen = 12 + packet.header.cc * 4;
+
+			if (packet.header.x && len > hlen + 4) {
+				hlen += 4 + ntohs((uint16_t) ((switch_rtp_hdr_ext_t *) ((char *) &packet + hlen))->length) * 4;
+			}
+
+			if (len > hlen && switch_core_codec_decode(codec, session->read_codec, (char *) &packet + hlen, (uint32_t) (len - hlen),
+													   session->read_impl.actual_samples_per_second, work + samples, &extra, &extra_rate,
+													   &extra_flags) == SWITCH_STATUS_SUCCESS && extra == frame_bytes) {
+				/* if no period can be cut both frames are kept and the next slot is held, no harm done */
+				samples = switch_accelerate_sln(work, samples * 2, rate);
+			}
+		}
+	} else if (advice < 0) {
+		samples = switch_decelerate_sln(work, samples, sizeof(work) / 2, rate);
+	}
+
+	switch_buffer_write(session->stretch_read_buffer, work, samples * 2);
+	switch_buffer_read(session->stretch_read_buffer, session->raw_read_frame.data, frame_bytes);
+
+	if (switch_buffer_inuse(session->stretch_read_buffer) >= frame_bytes) {
+		switch_jb_stretch_hold(jb);
+	}
+}
+
+/*
+  Media trace.  Each stage is timed as a lap: the ticks since the last lap on the same side (read
+  or write) are charged to it.  The laps of a frame are summed and land in the stage histograms
+  when the frame leaves read_frame or write_frame, so a stage that runs twice for one frame still
+  counts as one sample.
+*/
+
+static const char *TRACE_STAGE_NAMES[] = {
+	"jitter_buffer",
+	"rtp_in",
+	"decode",
+	"read_bugs",
+	"read_resample",
+	"read_encode",
+	"read",
+	"app",
+	"write_decode",
+	"write_resample",
+	"write_bugs",
+	"encode",
+	"rtp_out",
+	"write",
+	"total"
+};
+
+static double trace_usec_per_tick = 0;
+static switch_media_trace_hist_t trace_totals[SMT_STAGE_MAX];
+static uint32_t trace_sessions = 0;
+
+static inline uint64_t trace_tick(void)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	return __rdtsc();
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	uint32_t lo, hi;
+
+	__asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((uint64_t) hi << 32) | lo;
+#else
+	return (uint64_t) switch_time_ref();
+#endif
+}
+
+SWITCH_DECLARE(uint64_t) switch_core_media_trace_tick(void)
+{
+	return trace_tick();
+}
+
+/*
+  Measure the tick rate against the time reference once, the first time anything is traced.  The
+  20ms sleep runs without a lock; two sessions turning trace on together both measure and the first
+  result is kept.
+*/
+static void trace_calibrate(void)
+{
+	uint64_t t0, t1;
+	switch_time_t r0, r1;
+	double rate;
+
+	if (trace_usec_per_tick) {
+		return;
+	}
+
+	r0 = switch_time_ref();
+	t0 = trace_tick();
+	switch_sleep(20000);
+	r1 = switch_time_ref();
+	t1 = trace_tick();
+	rate = (t1 > t0 && r1 > r0) ? (double) (r1 - r0) / (double) (t1 - t0) : 1;
+
+	switch_mutex_lock(runtime.global_mutex);
+	if (!trace_usec_per_tick) {
+		trace_usec_per_tick = rate;
+	}
+	switch_mutex_unlock(runtime.global_mutex);
+}
+
+static inline uint32_t trace_bucket(uint64_t usec)
+{
+	uint32_t e = 4;
+
+	if (usec < 16) {
+		return (uint32_t) usec;
+	}
+
+	if (usec >> 31) {
+		return MEDIA_TRACE_BUCKETS - 1;
+	}
+
+	while (usec >> (e + 1)) {
+		e++;
+	}
+
+	return 16 + (e - 4) * 8 + (uint32_t) ((usec >> (e - 3)) & 7);
+}
+
+/* the largest value that falls in a bucket */
+static uint64_t trace_bucket_top(uint32_t b)
+{
+	uint32_t e, sub;
+
+	if (b < 16) {
+		return b;
+	}
+
+	e = 4 + (b - 16) / 8;
+	sub = (b - 16) % 8;
+
+	return ((uint64_t) (9 + sub) << (e - 3)) - 1;
+}
+
+static inline void trace_record(switch_media_trace_hist_t *hist, uint64_t ticks)
+{
+	uint64_t usec = (uint64_t) (ticks * trace_usec_per_tick);
+
+	hist->count++;
+	if (usec > hist->max) {
+		hist->max = usec;
+	}
+	hist->buckets[trace_bucket(usec)]++;
+}
+
+static uint64_t trace_percentile(const switch_media_trace_hist_t *hist, uint32_t pct)
+{
+	uint64_t want = (hist->count * pct + 99) / 100, seen = 0, top;
+	uint32_t b;
+
+	for (b = 0; b < MEDIA_TRACE_BUCKETS; b++) {
+		seen += hist->buckets[b];
+		if (seen && seen >= want) {
+			top = trace_bucket_top(b);
+			return top < hist->max ? top : hist->max;
+		}
+	}
+
+	return hist->max;
+}
+
+static inline switch_media_trace_t *trace_on(switch_core_session_t *session)
+{
+	switch_media_trace_t *trace = session->media_trace;
+
+	return (trace && trace->on) ? trace : NULL;
+}
+
+static inline void media_trace_lap(switch_core_session_t *session, switch_media_trace_stage_t stage)
+{
+	switch_media_trace_t *trace;
+	uint64_t now, *mark;
+
+	if (!(trace = trace_on(session))) {
+		return;
+	}
+
+	if (stage < SMT_APP) {
+		mark = &trace->read_mark;
+		trace->read_hits |= 1 << stage;
+	} else {
+		mark = &trace->write_mark;
+		trace->write_hits |= 1 << stage;
+	}
+
+	now = trace_tick();
+	if (*mark) {
+		trace->lap[stage] += now - *mark;
+	}
+	*mark = now;
+}
+
+/* the endpoint has handed over a frame */
+static void media_trace_read_in(switch_core_session_t *session)
+{
+	switch_media_trace_t *trace;
+	uint64_t now;
+
+	if (!(trace = trace_on(session))) {
+		return;
+	}
+
+	now = trace_tick();
+	trace->read_start = trace->read_mark = now;
+
+	if (trace->arrival && now > trace->arrival) {
+		uint64_t from = trace->arrival;
+
+		if (trace->jb_tick > from && now > trace->jb_tick) {
+			trace->lap[SMT_JITTER_BUFFER] = trace->jb_tick - from;
+			trace->read_hits |= 1 << SMT_JITTER_BUFFER;
+			from = trace->jb_tick;
+		}
+
+		trace->lap[SMT_RTP_IN] = now - from;
+		trace->read_hits |= 1 << SMT_RTP_IN;
+	}
+}
+
+static void media_trace_read_out(switch_core_session_t *session, switch_frame_t *frame)
+{
+	switch_media_trace_t *trace;
+	uint64_t now;
+	int i;
+
+	if (!(trace = trace_on(session)) || !trace->read_start) {
+		return;
+	}
+
+	now = trace_tick();
+
+	for (i = 0; i < SMT_READ; i++) {
+		if ((trace->read_hits & (1 << i))) {
+			trace_record(&trace->hist[i], trace->lap[i]);
+			trace->lap[i] = 0;
+		}
+	}
+	trace_record(&trace->hist[SMT_READ], now - trace->read_start);
+
+	trace->read_hits = 0;
+	trace->read_start = trace->read_mark = 0;
+
+	/* wait for whoever writes the frame to finish its journey */
+	if (frame && !switch_test_flag(frame, SFF_CNG)) {
+		trace->read_out = frame;
+		trace->read_out_tick = now;
+		trace->read_out_arrival = trace->arrival;
+	} else {
+		trace->read_out = NULL;
+	}
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_session_media_trace(switch_core_session_t *session, switch_bool_t on)
+{
+	switch_assert(session);
+
+	if (on && !session->media_trace) {
+		switch_media_trace_t *trace;
+
+		trace_calibrate();
+
+		if (!(trace = switch_core_session_alloc(session, sizeof(*trace)))) {
+			return SWITCH_STATUS_MEMERR;
+		}
+		session->media_trace = trace;
+	}
+
+	if (!session->media_trace) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	session->media_trace->on = on ? 1 : 0;
+
+	if (on) {
+		switch_core_media_set_rtp_flag(session, SWITCH_MEDIA_TYPE_AUDIO, SWITCH_RTP_FLAG_MEDIA_TRACE);
+	} else {
+		switch_core_media_clear_rtp_flag(session, SWITCH_MEDIA_TYPE_AUDIO, SWITCH_RTP_FLAG_MEDIA_TRACE);
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void trace_print(const switch_media_trace_hist_t *hist, switch_stream_handle_t *stream)
+{
+	int i;
+
+	stream->write_function(stream, "%-16s %10s %10s %10s %10s %10s\n", "stage", "count", "p50_usec", "p90_usec", "p99_usec", "max_usec");
+
+	for (i = 0; i < SMT_STAGE_MAX; i++) {
+		if (!hist[i].count) {
+			continue;
+		}
+
+		stream->write_function(stream, "%-16s %10" SWITCH_UINT64_T_FMT " %10" SWITCH_UINT64_T_FMT " %10" SWITCH_UINT64_T_FMT
+							   " %10" SWITCH_UINT64_T_FMT " %10" SWITCH_UINT64_T_FMT "\n",
+							   TRACE_STAGE_NAMES[i], hist[i].count, trace_percentile(&hist[i], 50), trace_percentile(&hist[i], 90),
+							   trace_percentile(&hist[i], 99), hist[i].max);
+	}
+}
+
+SWITCH_DECLARE(void) switch_core_media_trace_report(switch_core_session_t *session, switch_stream_handle_t *stream)
+{
+	switch_media_trace_hist_t *totals;
+	uint32_t sessions;
+
+	if (session) {
+		if (!session->media_trace) {
+			stream->write_function(stream, "-ERR media trace is not on for this session\n");
+			return;
+		}
+		trace_print(session->media_trace->hist, stream);
+		return;
+	}
+
+	switch_zmalloc(totals, sizeof(trace_totals));
+
+	switch_mutex_lock(runtime.global_mutex);
+	memcpy(totals, trace_totals, sizeof(trace_totals));
+	sessions = trace_sessions;
+	switch_mutex_unlock(runtime.global_mutex);
+
+	stream->write_function(stream, "sessions: %u\n", sessions);
+	trace_print(totals, stream);
+
+	free(totals);
+}
+
+SWITCH_DECLARE(void) switch_core_media_trace_reset(void)
+{
+	switch_mutex_lock(runtime.global_mutex);
+	memset(trace_totals, 0, sizeof(trace_totals));
+	trace_sessions = 0;
+	switch_mutex_unlock(runtime.global_mutex);
+}
+
+SWITCH_DECLARE(void) switch_core_session_media_trace_hangup(switch_core_session_t *session)
+{
+	switch_media_trace_t *trace = session->media_trace;
+	int i, b;
+
+	if (!trace) {
+		return;
+	}
+
+	trace->on = 0;
+
+	for (i = 0; i < SMT_STAGE_MAX; i++) {
+		const switch_media_trace_hist_t *hist = &trace->hist[i];
+
+		if (!hist->count) {
+			continue;
+		}
+
+		switch_channel_set_variable_printf(session->channel, switch_core_session_sprintf(session, "media_trace_%s_count", TRACE_STAGE_NAMES[i]),
+										   "%" SWITCH_UINT64_T_FMT, hist->count);
+		switch_channel_set_variable_printf(session->channel, switch_core_session_sprintf(session, "media_trace_%s_p50_usec", TRACE_STAGE_NAMES[i]),
+										   "%" SWITCH_UINT64_T_FMT, trace_percentile(hist, 50));
+		switch_channel_set_variable_printf(session->channel, switch_core_session_sprintf(session, "media_trace_%s_p99_usec", TRACE_STAGE_NAMES[i]),
+										   "%" SWITCH_UINT64_T_FMT, trace_percentile(hist, 99));
+		switch_channel_set_variable_printf(session->channel, switch_core_session_sprintf(session, "media_trace_%s_max_usec", TRACE_STAGE_NAMES[i]),
+										   "%" SWITCH_UINT64_T_FMT, hist->max);
+	}
+
+	switch_mutex_lock(runtime.global_mutex);
+	for (i = 0; i < SMT_STAGE_MAX; i++) {
+		trace_totals[i].count += trace->hist[i].count;
+		if (trace->hist[i].max > trace_totals[i].max) {
+			trace_totals[i].max = trace->hist[i].max;
+		}
+		for (b = 0; b < MEDIA_TRACE_BUCKETS; b++) {
+			trace_totals[i].buckets[b] += trace->hist[i].buckets[b];
+		}
+	}
+	trace_sessions++;
+	switch_mutex_unlock(runtime.global_mutex);
+}
+
 SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_session_t *session, switch_frame_t **frame, switch_io_flag_t flags,
 															   int stream_id)
 {
@@ -178,6 +599,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 					break;
 				}
 			}
+			media_trace_read_in(session);
 		}
 
 		if (status == SWITCH_STATUS_INUSE) {
@@ -280,6 +702,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 		if (prune) {
 			switch_core_media_bug_prune(session);
 		}
+
+		media_trace_lap(session, SMT_READ_BUGS);
 	}
 
 	codec_impl = *(*frame)->codec->implementation;
@@ -473,7 +897,16 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 					session->plc = plc_init(NULL);
 				}
 				
-				if (!switch_test_flag(read_frame->codec, SWITCH_CODEC_FLAG_HAS_PLC) && session->plc && switch_test_flag(read_frame, SFF_PLC)) {
+				if (session->stretch_read_buffer && switch_test_flag(read_frame, SFF_PLC) &&
+					switch_buffer_inuse(session->stretch_read_buffer) >= read_frame->codec->implementation->decoded_bytes_per_packet) {
+					/* a slot the jitter buffer held for us, play what the time stretch has queued */
+					session->raw_read_frame.datalen = (uint32_t) switch_buffer_read(session->stretch_read_buffer, session->raw_read_frame.data,
+																					read_frame->codec->implementation->decoded_bytes_per_packet);
+					session->raw_read_frame.samples = session->raw_read_frame.datalen / 2;
+					session->raw_read_frame.channels = 1;
+					switch_clear_flag(read_frame, SFF_PLC);
+					status = SWITCH_STATUS_SUCCESS;
+				} else if (!switch_test_flag(read_frame->codec, SWITCH_CODEC_FLAG_HAS_PLC) && session->plc && switch_test_flag(read_frame, SFF_PLC)) {
 					session->raw_read_frame.datalen = read_frame->codec->implementation->decoded_bytes_per_packet;
 					session->raw_read_frame.samples = session->raw_read_frame.datalen / sizeof(int16_t) / session->read_impl.number_of_channels;
 					session->raw_read_frame.channels = session->read_impl.number_of_channels;
@@ -512,6 +945,11 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 					session->raw_read_frame.channels = codec->implementation->number_of_channels;
 					codec->cur_frame = NULL;
 					session->read_codec->cur_frame = NULL;
+
+					if (status == SWITCH_STATUS_SUCCESS && session->raw_read_frame.channels == 1 && session->read_impl.number_of_channels == 1 &&
+						switch_channel_test_flag(session->channel, CF_JITTERBUFFER_STRETCH)) {
+						read_stretch(session, codec, read_frame);
+					}
 					switch_thread_rwlock_unlock(session->bug_rwlock);
 
 				}
@@ -527,6 +965,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 					}
 				}
 
+				media_trace_lap(session, SMT_DECODE);
+
 
 			}
 
@@ -753,6 +1193,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 			if (prune) {
 				switch_core_media_bug_prune(session);
 			}
+
+			media_trace_lap(session, SMT_READ_BUGS);
 		}
 
 		if (do_bugs || tap_only) {
@@ -770,6 +1212,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 				read_frame->datalen = session->read_resampler->to_len * 2 * session->read_resampler->channels;
 				read_frame->rate = session->read_resampler->to_rate;
 				switch_mutex_unlock(session->resample_mutex);
+				media_trace_lap(session, SMT_READ_RESAMPLE);
 			}
 
 			if (read_frame->datalen == session->read_impl.decoded_bytes_per_packet) {
@@ -819,6 +1262,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 
 				session->read_codec->cur_frame = NULL;
 				enc_frame->codec->cur_frame = NULL;
+				media_trace_lap(session, SMT_READ_ENCODE);
 				switch (status) {
 				case SWITCH_STATUS_RESAMPLE:
 					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Fixme 1\n");
@@ -922,6 +1366,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 			if (prune) {
 				switch_core_media_bug_prune(session);
 			}
+
+			media_trace_lap(session, SMT_READ_BUGS);
 		}
 	}
 
@@ -933,6 +1379,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(switch_core_sessi
 		*frame = &runtime.dummy_cng_frame;
 	}
 
+	media_trace_read_out(session, *frame);
+
 	switch_mutex_unlock(session->read_codec->mutex);
 	switch_mutex_unlock(session->codec_read_mutex);
 
@@ -993,6 +1441,8 @@ static switch_status_t perform_write(switch_core_session_t *session, switch_fram
 		if (prune) {
 			switch_core_media_bug_prune(session);
 		}
+
+		media_trace_lap(session, SMT_WRITE_BUGS);
 	}
 
 
@@ -1004,13 +1454,119 @@ static switch_status_t perform_write(switch_core_session_t *session, switch_fram
 				}
 			}
 		}
+		media_trace_lap(session, SMT_RTP_OUT);
 	}
 
 	return status;
 }
 
-SWITCH_DECLARE(switch_status_t) switch_core_session_write_frame(switch_core_session_t *session, switch_frame_t *frame, switch_io_flag_t flags,
+SWITCH_DECLARE(switch_bool_t) switch_core_session_relay_ready(switch_core_session_t *session, switch_core_session_t *peer_session)
+{
+	const switch_codec_implementation_t *a, *b;
+
+	if (session->bugs || peer_session->bugs || session->event_hooks.read_frame || peer_session->event_hooks.write_frame) {
+		return SWITCH_FALSE;
+	}
+
+	/* things the full read path does per frame that relaying would skip */
+	if (session->dmachine[0] || session->dmachine[1] || session->track_duration || switch_channel_test_flag(session->channel, CF_HOLD)) {
+		return SWITCH_FALSE;
+	}
+
+	/* a traced leg has to go the long way for its stages to be timed */
+	if (trace_on(session) || trace_on(peer_session)) {
+		return SWITCH_FALSE;
+	}
+
+	if (!session->endpoint_interface->io_routines->read_frame || !peer_session->endpoint_interface->io_routines->write_frame) {
+		return SWITCH_FALSE;
+	}
+
+	/* proxied packets are forwarded whatever their payload */
+	if (switch_channel_test_flag(session->channel, CF_PROXY_MEDIA) && switch_channel_test_flag(peer_session->channel, CF_PROXY_MEDIA)) {
+		return SWITCH_TRUE;
+	}
+
+	if (!session->read_codec || session->read_codec != session->real_read_codec || !switch_core_codec_ready(session->read_codec) ||
+		!peer_session->write_codec || (peer_session->real_write_codec && peer_session->write_codec != peer_session->real_write_codec) ||
+		!switch_core_codec_ready(peer_session->write_codec)) {
+		return SWITCH_FALSE;
+	}
+
+	a = session->read_codec->implementation;
+	b = peer_session->write_codec->implementation;
+
+	if (a->ianacode != b->ianacode || strcasecmp(a->iananame, b->iananame) || a->actual_samples_per_second != b->actual_samples_per_second ||
+		a->microseconds_per_packet != b->microseconds_per_packet || a->number_of_channels != b->number_of_channels) {
+		return SWITCH_FALSE;
+	}
+
+	if (strcasecmp(switch_str_nil(session->read_codec->fmtp_in), switch_str_nil(peer_session->write_codec->fmtp_in))) {
+		return SWITCH_FALSE;
+	}
+
+	return SWITCH_TRUE;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_session_relay_read(switch_core_session_t *session, switch_frame_t **frame, switch_io_flag_t flags,
+															   int stream_id)
+{
+	switch_status_t status;
+
+	/* someone is changing the codec, the full path will take it from here */
+	if (switch_mutex_trylock(session->codec_read_mutex) == SWITCH_STATUS_SUCCESS) {
+		switch_mutex_unlock(session->codec_read_mutex);
+	} else {
+		switch_cond_next();
+		*frame = &runtime.dummy_cng_frame;
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (switch_channel_down(session->channel)) {
+		*frame = NULL;
+		return SWITCH_STATUS_FALSE;
+	}
+
+	*frame = NULL;
+
+	status = session->endpoint_interface->io_routines->read_frame(session, frame, flags, stream_id);
+
+	if (status == SWITCH_STATUS_SUCCESS && !*frame) {
+		*frame = &runtime.dummy_cng_frame;
+	}
+
+	return status;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_session_relay_write(switch_core_session_t *session, switch_frame_t *frame, switch_io_flag_t flags,
 																int stream_id)
+{
+	switch_status_t status;
+
+	if (!switch_channel_ready(session->channel)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (switch_test_flag(frame, SFF_CNG) && !switch_channel_test_flag(session->channel, CF_ACCEPT_CNG)) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (switch_channel_test_flag(session->channel, CF_AUDIO_PAUSE) || switch_channel_test_flag(session->channel, CF_HOLD)) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (switch_mutex_trylock(session->codec_write_mutex) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	status = session->endpoint_interface->io_routines->write_frame(session, frame, flags, stream_id);
+
+	switch_mutex_unlock(session->codec_write_mutex);
+
+	return status;
+}
+
+static switch_status_t session_write_frame(switch_core_session_t *session, switch_frame_t *frame, switch_io_flag_t flags, int stream_id)
 {
 
 	switch_status_t status = SWITCH_STATUS_FALSE;
@@ -1165,6 +1721,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_write_frame(switch_core_sess
 										  session->raw_write_frame.data, &session->raw_write_frame.datalen, &session->raw_write_frame.rate, &frame->flags);
 		frame->codec->cur_frame = NULL;
 		session->write_codec->cur_frame = NULL;
+		media_trace_lap(session, SMT_WRITE_DECODE);
 		if (do_resample && status == SWITCH_STATUS_SUCCESS) {
 			status = SWITCH_STATUS_RESAMPLE;
 		}
@@ -1290,6 +1847,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_write_frame(switch_core_sess
 			did_write_resample = 1;
 		}
 		switch_mutex_unlock(session->resample_mutex);
+		media_trace_lap(session, SMT_WRITE_RESAMPLE);
 	}
 
 
@@ -1354,6 +1912,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_write_frame(switch_core_sess
 		if (prune) {
 			switch_core_media_bug_prune(session);
 		}
+
+		media_trace_lap(session, SMT_WRITE_BUGS);
 	}
 
 	if (do_bugs) {
@@ -1394,6 +1954,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_write_frame(switch_core_sess
 
 			session->write_codec->cur_frame = NULL;
 			frame->codec->cur_frame = NULL;
+			media_trace_lap(session, SMT_ENCODE);
 			switch (status) {
 			case SWITCH_STATUS_RESAMPLE:
 				resample++;
@@ -1505,6 +2066,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_write_frame(switch_core_sess
 
 				session->write_codec->cur_frame = NULL;
 				frame->codec->cur_frame = NULL;
+				media_trace_lap(session, SMT_ENCODE);
 				switch (status) {
 				case SWITCH_STATUS_RESAMPLE:
 					resample++;
@@ -1647,6 +2209,60 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_write_frame(switch_core_sess
 	return status;
 }
 
+SWITCH_DECLARE(switch_status_t) switch_core_session_write_frame(switch_core_session_t *session, switch_frame_t *frame, switch_io_flag_t flags,
+																int stream_id)
+{
+	switch_media_trace_t *trace, *read_trace = NULL;
+	switch_status_t status;
+	uint64_t start, now;
+	int i;
+
+	switch_assert(session != NULL);
+	switch_assert(frame != NULL);
+
+	/* the frame some traced session read last, whichever session writes it */
+	if (frame->codec && frame->codec->session && (read_trace = trace_on(frame->codec->session)) && read_trace->read_out != frame) {
+		read_trace = NULL;
+	}
+
+	if (!(trace = trace_on(session)) && !read_trace) {
+		return session_write_frame(session, frame, flags, stream_id);
+	}
+
+	start = trace_tick();
+
+	if (read_trace) {
+		trace_record(&read_trace->hist[SMT_APP], start - read_trace->read_out_tick);
+		read_trace->read_out = NULL;
+	}
+
+	if (trace) {
+		trace->write_mark = start;
+	}
+
+	status = session_write_frame(session, frame, flags, stream_id);
+
+	now = trace_tick();
+
+	if (trace) {
+		for (i = SMT_APP + 1; i < SMT_WRITE; i++) {
+			if ((trace->write_hits & (1 << i))) {
+				trace_record(&trace->hist[i], trace->lap[i]);
+				trace->lap[i] = 0;
+			}
+		}
+		trace_record(&trace->hist[SMT_WRITE], now - start);
+		trace->write_hits = 0;
+		trace->write_mark = 0;
+	}
+
+	if (read_trace && read_trace->read_out_arrival) {
+		trace_record(&read_trace->hist[SMT_TOTAL], now - read_trace->read_out_arrival);
+	}
+
+	return status;
+}
+
 static char *SIG_NAMES[] = {
 	"NONE",
 	"KILL",
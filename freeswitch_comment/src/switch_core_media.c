@@ -241,6 +241,8 @@ struct switch_media_handle_s {
 static switch_srtp_crypto_suite_t SUITES[CRYPTO_INVALID] = {
 	{ "AEAD_AES_256_GCM_8", AEAD_AES_256_GCM_8, 44},
 	{ "AEAD_AES_128_GCM_8", AEAD_AES_128_GCM_8, 28},
+	{ "AEAD_AES_256_GCM", AEAD_AES_256_GCM, 44},
+	{ "AEAD_AES_128_GCM", AEAD_AES_128_GCM, 28},
 	{ "AES_CM_256_HMAC_SHA1_80", AES_CM_256_HMAC_SHA1_80, 46},
 	{ "AES_CM_192_HMAC_SHA1_80", AES_CM_192_HMAC_SHA1_80, 38},
 	{ "AES_CM_128_HMAC_SHA1_80", AES_CM_128_HMAC_SHA1_80, 30},
@@ -1540,6 +1542,16 @@ static void set_stats(switch_core_session_t *session, switch_media_type_t type,
 		add_stat(stats->rtcp.packet_count, "rtcp_packet_count");
 		add_stat(stats->rtcp.octet_count, "rtcp_octet_count");
 
+		if (stats->tx_batch.flushes) {
+			add_stat(stats->tx_batch.flushes, "out_batch_flushes");
+			add_stat(stats->tx_batch.max_batch, "out_batch_max");
+			add_stat_double((double) stats->tx_batch.packets / stats->tx_batch.flushes, "out_batch_avg");
+			add_stat(stats->tx_batch.gso_flushes, "out_batch_gso_flushes");
+			add_stat(stats->tx_batch.errors, "out_batch_errors");
+			add_stat_double((double) stats->tx_batch.latency / stats->tx_batch.flushes, "out_batch_flush_latency_avg");
+			add_stat(stats->tx_batch.max_latency, "out_batch_flush_latency_max");
+		}
+
 	}
 }
 
@@ -2002,6 +2014,11 @@ static void check_jb(switch_core_session_t *session, const char *input, int32_t
 				if (!switch_false(switch_channel_get_variable(session->channel, "rtp_jitter_buffer_plc"))) {
 					switch_channel_set_flag(session->channel, CF_JITTERBUFFER_PLC);
 				}
+				if (switch_true(switch_channel_get_variable(session->channel, "rtp_jitter_buffer_stretch"))) {
+					switch_jb_stretch_mode(switch_rtp_get_jitter_buffer(a_engine->rtp_session),
+										   a_engine->read_impl.samples_per_packet, a_engine->read_impl.samples_per_second);
+					switch_channel_set_flag(session->channel, CF_JITTERBUFFER_STRETCH);
+				}
 			} else if (!silent) {
 				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), 
 								  SWITCH_LOG_WARNING, "Error Setting Jitterbuffer to %dms (%d frames)\n", jb_msec, qlen);
@@ -2216,6 +2233,19 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_read_frame(switch_core_session
 			goto end;
 		}
 
+		if (type == SWITCH_MEDIA_TYPE_AUDIO && session->media_trace && session->media_trace->on) {
+			uint64_t jb_tick, tick = switch_rtp_get_recv_tick(engine->rtp_session, &jb_tick);
+
+			/* a frame with no new packet behind it (plc, cng) has no arrival to time */
+			if (tick != session->media_trace->recv_tick) {
+				session->media_trace->arrival = tick;
+				session->media_trace->jb_tick = jb_tick;
+			} else {
+				session->media_trace->arrival = session->media_trace->jb_tick = 0;
+			}
+			session->media_trace->recv_tick = tick;
+		}
+
 		if (type == SWITCH_MEDIA_TYPE_VIDEO) {
 			if (engine->read_frame.m) {
 				if (!smh->vid_started) {
@@ -6850,6 +6880,10 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_activate_rtp(switch_core_sessi
 
 		check_jb(session, NULL, 0, 0, SWITCH_FALSE);
 
+		if ((session->media_trace && session->media_trace->on) || switch_true(switch_channel_get_variable(session->channel, "media_trace"))) {
+			switch_core_session_media_trace(session, SWITCH_TRUE);
+		}
+
 		if ((val = switch_channel_get_variable(session->channel, "rtp_timeout_sec"))) {
 			int v = atoi(val);
 			if (v >= 0) {
@@ -49,6 +49,71 @@
 #ifndef DEBUG_ALLOC_CUTOFF
 #define DEBUG_ALLOC_CUTOFF 500
 #endif
+#define POOL_TAG_LEN 128
+
+#ifdef PER_POOL_LOCK
+/* pools are spread over this many parents so creating and destroying them never meets on one lock */
+#ifndef POOL_SHARDS
+#define POOL_SHARDS 16
+#endif
+/* node memory an idle allocator keeps for the next pool, beyond that it goes back to malloc */
+#ifndef POOL_ALLOCATOR_MAX_FREE
+#define POOL_ALLOCATOR_MAX_FREE (32 * 1024)
+#endif
+#ifndef POOL_SHARD_WARM
+#define POOL_SHARD_WARM 32
+#endif
+#define POOL_SHARD_WARM_MAX 256
+/* how long a destroyed pool is kept around in case something still touches it */
+#define POOL_DESTROY_DELAY 1000000
+#define POOL_TAG_MAX 1024
+
+typedef struct pool_tag_s {
+	char name[POOL_TAG_LEN];
+	uint32_t pools;
+	uint64_t created;
+	uint64_t peak;
+	uint64_t bytes;				/* scratch for the stats walk */
+	struct pool_tag_s *next;
+} pool_tag_t;
+
+struct pool_shard_s;
+
+/*
+  An allocator and its lock, handed from pool to pool. The allocator keeps the nodes of the last
+  pool in its size buckets so the next one runs without touching malloc. The slot is stored as
+  the allocator owner, APR only ever compares the owner to the pool being destroyed.
+*/
+typedef struct pool_slot_s {
+	struct pool_slot_s *self;	/* first, a real apr_pool_t never points at itself here */
+	apr_allocator_t *allocator;
+	apr_thread_mutex_t *mutex;
+	apr_pool_t *pool;
+	pool_tag_t *tag;
+	switch_atomic64_t bytes;	/* 64 bits, one long lived pool can hand out more than 4GB */
+	switch_time_t destroyed;
+	struct pool_shard_s *shard;
+	struct pool_slot_s *prev;
+	struct pool_slot_s *next;
+} pool_slot_t;
+
+typedef struct pool_shard_s {
+	apr_pool_t *parent;
+	apr_thread_mutex_t *mutex;	/* also the parent allocator mutex APR takes to link a child */
+	pool_slot_t *live;
+	pool_slot_t *warm;
+	pool_slot_t *cold;
+	uint32_t nwarm;
+	uint32_t nlive;
+	switch_hash_t *tags;
+	pool_tag_t *tag_list;
+	pool_tag_t other;
+	uint32_t ntags;
+	uint64_t created;
+	uint64_t reused;
+	uint64_t trimmed;
+} pool_shard_t;
+#endif
 
 static struct {
 #ifdef USE_MEM_LOCK
@@ -58,8 +123,32 @@ static struct {
 	switch_queue_t *pool_recycle_queue;
 	switch_memory_pool_t *memory_pool;
 	int pool_thread_running;
+#ifdef PER_POOL_LOCK
+	pool_shard_t shards[POOL_SHARDS];
+	uint32_t warm_max;
+#endif
 } memory_manager;
 
+#ifdef PER_POOL_LOCK
+static inline pool_slot_t *pool_slot(apr_pool_t *pool)
+{
+	pool_slot_t *slot = (pool_slot_t *) apr_allocator_owner_get(apr_pool_allocator_get(pool));
+
+	return slot && slot->self == slot ? slot : NULL;
+}
+
+static inline void pool_account(apr_pool_t *pool, switch_size_t bytes)
+{
+	pool_slot_t *slot = pool_slot(pool);
+
+	if (slot) {
+		switch_atomic64_add(&slot->bytes, bytes);
+	}
+}
+#else
+#define pool_account(_pool, _bytes)
+#endif
+
 SWITCH_DECLARE(switch_memory_pool_t *) switch_core_session_get_pool(switch_core_session_t *session)
 {
 	switch_assert(session != NULL);
@@ -90,6 +179,7 @@ SWITCH_DECLARE(void *) switch_core_perform_session_alloc(switch_core_session_t *
 
 	ptr = apr_palloc(session->pool, memory);
 	switch_assert(ptr != NULL);
+	pool_account(session->pool, memory);
 
 	memset(ptr, 0, memory);
 
@@ -203,6 +293,7 @@ SWITCH_DECLARE(char *) switch_core_vsprintf(switch_memory_pool_t *pool, const ch
 
 	result = apr_pvsprintf(pool, fmt, ap);
 	switch_assert(result != NULL);
+	pool_account(pool, strlen(result) + 1);
 
 #ifdef LOCK_MORE
 #ifdef USE_MEM_LOCK
@@ -258,6 +349,7 @@ SWITCH_DECLARE(char *) switch_core_perform_session_strdup(switch_core_session_t
 
 	duped = apr_pstrdup(session->pool, todup);
 	switch_assert(duped != NULL);
+	pool_account(session->pool, strlen(duped) + 1);
 
 #ifdef LOCK_MORE
 #ifdef USE_MEM_LOCK
@@ -297,6 +389,7 @@ SWITCH_DECLARE(char *) switch_core_perform_strdup(switch_memory_pool_t *pool, co
 
 	duped = apr_pstrmemdup(pool, todup, len);
 	switch_assert(duped != NULL);
+	pool_account(pool, len);
 
 #ifdef LOCK_MORE
 #ifdef USE_MEM_LOCK
@@ -321,15 +414,334 @@ SWITCH_DECLARE(void *) switch_core_memory_pool_get_data(switch_memory_pool_t *po
 	return data;
 }
 
+#ifdef PER_POOL_LOCK
+static inline pool_shard_t *pool_shard(void)
+{
+	uint64_t id = (uint64_t) (uintptr_t) switch_thread_self();
+
+	return &memory_manager.shards[((id * 0x9E3779B97F4A7C15ULL) >> 32) % POOL_SHARDS];
+}
+
+/* call with the shard locked */
+static pool_tag_t *pool_tag_get(pool_shard_t *shard, const char *name)
+{
+	char key[POOL_TAG_LEN];
+	pool_tag_t *tag;
+
+	switch_copy_string(key, name, sizeof(key));
+
+	if ((tag = switch_core_hash_find(shard->tags, key))) {
+		return tag;
+	}
+
+	if (shard->ntags >= POOL_TAG_MAX || !(tag = calloc(1, sizeof(*tag)))) {
+		return &shard->other;
+	}
+
+	switch_copy_string(tag->name, key, sizeof(tag->name));
+	switch_core_hash_insert(shard->tags, tag->name, tag);
+	tag->next = shard->tag_list;
+	shard->tag_list = tag;
+	shard->ntags++;
+
+	return tag;
+}
+
+static pool_slot_t *pool_slot_take(pool_shard_t *shard, const char *tag)
+{
+	pool_slot_t *slot;
+
+	apr_thread_mutex_lock(shard->mutex);
+
+	if ((slot = shard->warm)) {
+		shard->warm = slot->next;
+		shard->nwarm--;
+		shard->reused++;
+	} else if ((slot = shard->cold)) {
+		shard->cold = slot->next;
+	} else {
+		switch_zmalloc(slot, sizeof(*slot));
+		slot->self = slot;
+		slot->shard = shard;
+
+		if ((apr_thread_mutex_create(&slot->mutex, APR_THREAD_MUTEX_NESTED, shard->parent)) != APR_SUCCESS) {
+			abort();
+		}
+	}
+
+	if (!slot->allocator) {
+		if ((apr_allocator_create(&slot->allocator)) != APR_SUCCESS) {
+			abort();
+		}
+
+		apr_allocator_mutex_set(slot->allocator, slot->mutex);
+		apr_allocator_owner_set(slot->allocator, (apr_pool_t *) slot);
+		apr_allocator_max_free_set(slot->allocator, POOL_ALLOCATOR_MAX_FREE);
+	}
+
+	if ((apr_pool_create_ex(&slot->pool, shard->parent, NULL, slot->allocator)) != APR_SUCCESS) {
+		abort();
+	}
+
+	apr_pool_mutex_set(slot->pool, slot->mutex);
+
+	switch_atomic64_set(&slot->bytes, 0);
+	slot->tag = pool_tag_get(shard, tag);
+	slot->tag->pools++;
+	slot->tag->created++;
+
+	slot->prev = NULL;
+	if ((slot->next = shard->live)) {
+		shard->live->prev = slot;
+	}
+	shard->live = slot;
+	shard->nlive++;
+	shard->created++;
+
+	apr_thread_mutex_unlock(shard->mutex);
+
+	return slot;
+}
+
+/* hand idle allocators beyond keep back to malloc */
+static void pool_shard_trim(pool_shard_t *shard, uint32_t keep)
+{
+	apr_allocator_t *trim[POOL_SHARD_WARM];
+	pool_slot_t *slot;
+	uint32_t x, n;
+
+	do {
+		n = 0;
+		apr_thread_mutex_lock(shard->mutex);
+		while (shard->nwarm > keep && n < POOL_SHARD_WARM && (slot = shard->warm)) {
+			shard->warm = slot->next;
+			shard->nwarm--;
+			trim[n++] = slot->allocator;
+			slot->allocator = NULL;
+			slot->next = shard->cold;
+			shard->cold = slot;
+			shard->trimmed++;
+		}
+		apr_thread_mutex_unlock(shard->mutex);
+
+		for (x = 0; x < n; x++) {
+			apr_allocator_destroy(trim[x]);
+		}
+	} while (n == POOL_SHARD_WARM);
+}
+#endif
+
+static void pool_release(apr_pool_t *pool)
+{
+#ifdef PER_POOL_LOCK
+	pool_slot_t *slot = pool_slot(pool);
+	apr_allocator_t *trim = NULL;
+	pool_shard_t *shard;
+#endif
+
+	/* cleanups run in here, keep the shard unlocked */
+	apr_pool_destroy(pool);
+
+#ifdef PER_POOL_LOCK
+	if (!slot) {
+		return;
+	}
+
+	shard = slot->shard;
+	apr_thread_mutex_lock(shard->mutex);
+
+	if (slot->prev) {
+		slot->prev->next = slot->next;
+	} else {
+		shard->live = slot->next;
+	}
+	if (slot->next) {
+		slot->next->prev = slot->prev;
+	}
+	shard->nlive--;
+
+	slot->tag->pools--;
+	if (switch_atomic64_read(&slot->bytes) > slot->tag->peak) {
+		slot->tag->peak = switch_atomic64_read(&slot->bytes);
+	}
+	slot->tag = NULL;
+	slot->pool = NULL;
+	slot->prev = NULL;
+
+	if (shard->nwarm < memory_manager.warm_max) {
+		slot->next = shard->warm;
+		shard->warm = slot;
+		shard->nwarm++;
+	} else {
+		trim = slot->allocator;
+		slot->allocator = NULL;
+		slot->next = shard->cold;
+		shard->cold = slot;
+		shard->trimmed++;
+	}
+
+	apr_thread_mutex_unlock(shard->mutex);
+
+	if (trim) {
+		apr_allocator_destroy(trim);
+	}
+#endif
+}
+
 SWITCH_DECLARE(void) switch_core_memory_pool_tag(switch_memory_pool_t *pool, const char *tag)
 {
+#ifdef PER_POOL_LOCK
+	pool_slot_t *slot;
+
+	if (tag && (slot = pool_slot(pool))) {
+		apr_thread_mutex_lock(slot->shard->mutex);
+		slot->tag->pools--;
+		slot->tag = pool_tag_get(slot->shard, tag);
+		slot->tag->pools++;
+		apr_thread_mutex_unlock(slot->shard->mutex);
+	}
+#endif
+
 	apr_pool_tag(pool, tag);
 }
 
+SWITCH_DECLARE(void) switch_core_memory_pool_set_cache(uint32_t allocators)
+{
+#ifdef PER_POOL_LOCK
+	int x;
+
+	if (allocators > POOL_SHARD_WARM_MAX * POOL_SHARDS) {
+		allocators = POOL_SHARD_WARM_MAX * POOL_SHARDS;
+	}
+
+	memory_manager.warm_max = allocators / POOL_SHARDS;
+
+	for (x = 0; x < POOL_SHARDS; x++) {
+		pool_shard_trim(&memory_manager.shards[x], memory_manager.warm_max);
+	}
+#endif
+}
+
+SWITCH_DECLARE(void) switch_core_memory_pool_stats(switch_memory_pool_stats_t *stats)
+{
+#ifdef PER_POOL_LOCK
+	pool_slot_t *slot;
+	int x;
+#endif
+
+	memset(stats, 0, sizeof(*stats));
+
+#ifdef PER_POOL_LOCK
+	stats->shards = POOL_SHARDS;
+	stats->cache = memory_manager.warm_max * POOL_SHARDS;
+
+	for (x = 0; x < POOL_SHARDS; x++) {
+		pool_shard_t *shard = &memory_manager.shards[x];
+
+		apr_thread_mutex_lock(shard->mutex);
+		stats->pools += shard->nlive;
+		stats->idle += shard->nwarm;
+		stats->created += shard->created;
+		stats->reused += shard->reused;
+		stats->trimmed += shard->trimmed;
+		for (slot = shard->live; slot; slot = slot->next) {
+			stats->bytes += (switch_size_t) switch_atomic64_read(&slot->bytes);
+		}
+		apr_thread_mutex_unlock(shard->mutex);
+	}
+#endif
+}
+
+#ifdef PER_POOL_LOCK
+static void pool_tag_merge(switch_hash_t *merged, pool_tag_t *tag)
+{
+	switch_memory_pool_tag_stats_t *ts;
+
+	if (!tag->created && !tag->pools && !tag->peak) {
+		return;
+	}
+
+	if (!(ts = switch_core_hash_find(merged, tag->name))) {
+		switch_zmalloc(ts, sizeof(*ts));
+		ts->tag = tag->name;
+		switch_core_hash_insert(merged, tag->name, ts);
+	}
+
+	ts->pools += tag->pools;
+	ts->created += tag->created;
+	ts->bytes += (switch_size_t) tag->bytes;
+	if (tag->peak > ts->peak) {
+		ts->peak = (switch_size_t) tag->peak;
+	}
+}
+#endif
+
+SWITCH_DECLARE(uint32_t) switch_core_memory_pool_tag_stats(switch_memory_pool_tag_callback_t callback, void *pvt)
+{
+	uint32_t count = 0;
+#ifdef PER_POOL_LOCK
+	switch_memory_pool_tag_stats_t *ts;
+	switch_hash_index_t *hi;
+	switch_hash_t *merged;
+	pool_slot_t *slot;
+	pool_tag_t *tag;
+	void *val;
+	int x;
+
+	switch_core_hash_init(&merged);
+
+	/* a tag has a record in every shard that created a pool for it, add them up by name */
+	for (x = 0; x < POOL_SHARDS; x++) {
+		pool_shard_t *shard = &memory_manager.shards[x];
+
+		apr_thread_mutex_lock(shard->mutex);
+
+		shard->other.bytes = 0;
+		for (tag = shard->tag_list; tag; tag = tag->next) {
+			tag->bytes = 0;
+		}
+
+		for (slot = shard->live; slot; slot = slot->next) {
+			slot->tag->bytes += switch_atomic64_read(&slot->bytes);
+		}
+
+		for (tag = shard->tag_list; tag; tag = tag->next) {
+			pool_tag_merge(merged, tag);
+		}
+		pool_tag_merge(merged, &shard->other);
+
+		apr_thread_mutex_unlock(shard->mutex);
+	}
+
+	for (hi = switch_core_hash_first(merged); hi; hi = switch_core_hash_next(&hi)) {
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		ts = (switch_memory_pool_tag_stats_t *) val;
+		if (callback) {
+			callback(ts, pvt);
+		}
+		count++;
+		free(ts);
+	}
+
+	switch_core_hash_destroy(&merged);
+#endif
+
+	return count;
+}
+
 SWITCH_DECLARE(void) switch_pool_clear(switch_memory_pool_t *p)
 {
 #ifdef PER_POOL_LOCK
 	apr_thread_mutex_t *my_mutex;
+	pool_slot_t *slot;
+
+	/* the slot lock lives outside the pool, it stays put */
+	if ((slot = pool_slot(p))) {
+		apr_pool_clear(p);
+		switch_atomic64_set(&slot->bytes, 0);
+		return;
+	}
+
 	apr_pool_mutex_set(p, NULL);
 #endif
 
@@ -351,23 +763,22 @@ SWITCH_DECLARE(void) switch_pool_clear(switch_memory_pool_t *p)
 
 SWITCH_DECLARE(switch_status_t) switch_core_perform_new_memory_pool(switch_memory_pool_t **pool, const char *file, const char *func, int line)
 {
-	char *tmp;
+	char tag[POOL_TAG_LEN];
+#if !defined(PER_POOL_LOCK) && !defined(INSTANTLY_DESTROY_POOLS)
+	void *pop = NULL;
+#endif
+
+	switch_assert(pool != NULL);
+	switch_snprintf(tag, sizeof(tag), "%s:%d", file, line);
+
 #ifdef INSTANTLY_DESTROY_POOLS
 	apr_pool_create(pool, NULL);
 	switch_assert(*pool != NULL);
 #else
 
-#ifdef PER_POOL_LOCK
-	apr_allocator_t *my_allocator = NULL;
-	apr_thread_mutex_t *my_mutex;
-#else
-	void *pop = NULL;
-#endif
-
 #ifdef USE_MEM_LOCK
 	switch_mutex_lock(memory_manager.mem_lock);
 #endif
-	switch_assert(pool != NULL);
 
 #ifndef PER_POOL_LOCK
 	if (switch_queue_trypop(memory_manager.pool_recycle_queue, &pop) == SWITCH_STATUS_SUCCESS && pop) {
@@ -376,23 +787,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_new_memory_pool(switch_memor
 #endif
 
 #ifdef PER_POOL_LOCK
-		if ((apr_allocator_create(&my_allocator)) != APR_SUCCESS) {
-			abort();
-		}
-
-		if ((apr_pool_create_ex(pool, NULL, NULL, my_allocator)) != APR_SUCCESS) {
-			abort();
-		}
-
-		if ((apr_thread_mutex_create(&my_mutex, APR_THREAD_MUTEX_NESTED, *pool)) != APR_SUCCESS) {
-			abort();
-		}
-
-		apr_allocator_mutex_set(my_allocator, my_mutex);
-		apr_allocator_owner_set(my_allocator, *pool);
-
-		apr_pool_mutex_set(*pool, my_mutex);
-
+		*pool = pool_slot_take(pool_shard(), tag)->pool;
 #else
 		apr_pool_create(pool, NULL);
 		switch_assert(*pool != NULL);
@@ -400,8 +795,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_new_memory_pool(switch_memor
 #endif
 #endif
 
-	tmp = switch_core_sprintf(*pool, "%s:%d", file, line);
-	apr_pool_tag(*pool, tmp);
+	apr_pool_tag(*pool, switch_core_strdup(*pool, tag));
 
 #ifdef DEBUG_ALLOC2
 	switch_log_printf(SWITCH_CHANNEL_ID_LOG, file, func, line, NULL, SWITCH_LOG_CONSOLE, "%p New Pool %s\n", (void *) *pool, apr_pool_tag(*pool, NULL));
@@ -417,6 +811,10 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_new_memory_pool(switch_memor
 
 SWITCH_DECLARE(switch_status_t) switch_core_perform_destroy_memory_pool(switch_memory_pool_t **pool, const char *file, const char *func, int line)
 {
+#if defined(PER_POOL_LOCK) && !defined(INSTANTLY_DESTROY_POOLS)
+	pool_slot_t *slot;
+#endif
+
 	switch_assert(pool != NULL);
 
 #ifdef DEBUG_ALLOC2
@@ -427,16 +825,21 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_destroy_memory_pool(switch_m
 #ifdef USE_MEM_LOCK
 	switch_mutex_lock(memory_manager.mem_lock);
 #endif
-	apr_pool_destroy(*pool);
+	pool_release(*pool);
 #ifdef USE_MEM_LOCK
 	switch_mutex_unlock(memory_manager.mem_lock);
 #endif
 #else
+#ifdef PER_POOL_LOCK
+	if ((slot = pool_slot(*pool))) {
+		slot->destroyed = switch_micro_time_now();
+	}
+#endif
 	if ((memory_manager.pool_thread_running != 1) || (switch_queue_push(memory_manager.pool_queue, *pool) != SWITCH_STATUS_SUCCESS)) {
 #ifdef USE_MEM_LOCK
 		switch_mutex_lock(memory_manager.mem_lock);
 #endif
-		apr_pool_destroy(*pool);
+		pool_release(*pool);
 #ifdef USE_MEM_LOCK
 		switch_mutex_unlock(memory_manager.mem_lock);
 #endif
@@ -469,6 +872,7 @@ SWITCH_DECLARE(void *) switch_core_perform_alloc(switch_memory_pool_t *pool, swi
 
 	ptr = apr_palloc(pool, memory);
 	switch_assert(ptr != NULL);
+	pool_account(pool, memory);
 	memset(ptr, 0, memory);
 
 #ifdef LOCK_MORE
@@ -482,6 +886,9 @@ SWITCH_DECLARE(void *) switch_core_perform_alloc(switch_memory_pool_t *pool, swi
 
 SWITCH_DECLARE(void) switch_core_memory_reclaim(void)
 {
+#ifdef PER_POOL_LOCK
+	int x;
+#endif
 #if !defined(PER_POOL_LOCK) && !defined(INSTANTLY_DESTROY_POOLS)
 	switch_memory_pool_t *pool;
 	void *pop = NULL;
@@ -501,6 +908,11 @@ SWITCH_DECLARE(void) switch_core_memory_reclaim(void)
 		switch_mutex_unlock(memory_manager.mem_lock);
 #endif
 	}
+#endif
+#ifdef PER_POOL_LOCK
+	for (x = 0; x < POOL_SHARDS; x++) {
+		pool_shard_trim(&memory_manager.shards[x], 0);
+	}
 #endif
 	return;
 }
@@ -510,6 +922,31 @@ static void *SWITCH_THREAD_FUNC pool_thread(switch_thread_t *thread, void *obj)
 	memory_manager.pool_thread_running = 1;
 
 	while (memory_manager.pool_thread_running == 1) {
+#ifdef PER_POOL_LOCK
+		void *pop = NULL;
+		switch_interval_time_t wait;
+		pool_slot_t *slot;
+
+		/* every pool still gets its second, but it goes when that is up rather than with a batch so the allocator is back for the next call */
+		if (switch_queue_pop_timeout(memory_manager.pool_queue, &pop, POOL_DESTROY_DELAY) != SWITCH_STATUS_SUCCESS) {
+			continue;
+		}
+
+		if (!pop) {
+			goto done;
+		}
+
+		wait = (slot = pool_slot(pop)) ? slot->destroyed + POOL_DESTROY_DELAY - switch_micro_time_now() : POOL_DESTROY_DELAY;
+
+		if (wait > 0) {
+			switch_yield(wait);
+		}
+
+#ifdef DEBUG_ALLOC
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "%p DESTROY POOL\n", (void *) pop);
+#endif
+		pool_release(pop);
+#else
 		int len = switch_queue_size(memory_manager.pool_queue);
 
 		if (len) {
@@ -533,7 +970,7 @@ static void *SWITCH_THREAD_FUNC pool_thread(switch_thread_t *thread, void *obj)
 #ifdef DEBUG_ALLOC
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "%p DESTROY POOL\n", (void *) pop);	
 #endif
-				apr_pool_destroy(pop);
+				pool_release(pop);
 #ifdef USE_MEM_LOCK
 				switch_mutex_unlock(memory_manager.mem_lock);
 #endif
@@ -568,6 +1005,7 @@ static void *SWITCH_THREAD_FUNC pool_thread(switch_thread_t *thread, void *obj)
 		} else {
 			switch_yield(1000000);
 		}
+#endif
 	}
 
   done:
@@ -579,7 +1017,7 @@ static void *SWITCH_THREAD_FUNC pool_thread(switch_thread_t *thread, void *obj)
 #ifdef USE_MEM_LOCK
 			switch_mutex_lock(memory_manager.mem_lock);
 #endif
-			apr_pool_destroy(pop);
+			pool_release(pop);
 			pop = NULL;
 #ifdef USE_MEM_LOCK
 			switch_mutex_unlock(memory_manager.mem_lock);
@@ -610,42 +1048,74 @@ void switch_core_memory_stop(void)
 	
 	
 	while (switch_queue_trypop(memory_manager.pool_queue, &pop) == SWITCH_STATUS_SUCCESS && pop) {
-		apr_pool_destroy(pop);
+		pool_release(pop);
 	}
 #endif
-}
 
-switch_memory_pool_t *switch_core_memory_init(void)
-{
-#ifndef INSTANTLY_DESTROY_POOLS
-	switch_threadattr_t *thd_attr;
+#ifdef PER_POOL_LOCK
+	/* whatever is destroyed from here on goes straight back to malloc */
+	switch_core_memory_pool_set_cache(0);
 #endif
+}
+
 #ifdef PER_POOL_LOCK
+/* a pool with an allocator of its own that goes away with it */
+static apr_pool_t *pool_create_private(const char *tag, apr_thread_mutex_t **mutex)
+{
 	apr_allocator_t *my_allocator = NULL;
 	apr_thread_mutex_t *my_mutex;
-#endif
+	apr_pool_t *pool = NULL;
 
-	memset(&memory_manager, 0, sizeof(memory_manager));
-
-#ifdef PER_POOL_LOCK
 	if ((apr_allocator_create(&my_allocator)) != APR_SUCCESS) {
 		abort();
 	}
 
-	if ((apr_pool_create_ex(&memory_manager.memory_pool, NULL, NULL, my_allocator)) != APR_SUCCESS) {
+	if ((apr_pool_create_ex(&pool, NULL, NULL, my_allocator)) != APR_SUCCESS) {
 		apr_allocator_destroy(my_allocator);
 		my_allocator = NULL;
 		abort();
 	}
 
-	if ((apr_thread_mutex_create(&my_mutex, APR_THREAD_MUTEX_NESTED, memory_manager.memory_pool)) != APR_SUCCESS) {
+	if ((apr_thread_mutex_create(&my_mutex, APR_THREAD_MUTEX_NESTED, pool)) != APR_SUCCESS) {
 		abort();
 	}
 
 	apr_allocator_mutex_set(my_allocator, my_mutex);
-	apr_pool_mutex_set(memory_manager.memory_pool, my_mutex);
-	apr_allocator_owner_set(my_allocator, memory_manager.memory_pool);
-	apr_pool_tag(memory_manager.memory_pool, "core_pool");
+	apr_pool_mutex_set(pool, my_mutex);
+	apr_allocator_owner_set(my_allocator, pool);
+	apr_pool_tag(pool, tag);
+
+	if (mutex) {
+		*mutex = my_mutex;
+	}
+
+	return pool;
+}
+#endif
+
+switch_memory_pool_t *switch_core_memory_init(void)
+{
+#ifndef INSTANTLY_DESTROY_POOLS
+	switch_threadattr_t *thd_attr;
+#endif
+#ifdef PER_POOL_LOCK
+	int x;
+#endif
+
+	memset(&memory_manager, 0, sizeof(memory_manager));
+
+#ifdef PER_POOL_LOCK
+	memory_manager.memory_pool = pool_create_private("core_pool", NULL);
+
+	for (x = 0; x < POOL_SHARDS; x++) {
+		pool_shard_t *shard = &memory_manager.shards[x];
+
+		shard->parent = pool_create_private("pool_shard", &shard->mutex);
+		switch_core_hash_init(&shard->tags);
+		switch_copy_string(shard->other.name, "other", sizeof(shard->other.name));
+	}
+
+	memory_manager.warm_max = POOL_SHARD_WARM;
 #else
 	apr_pool_create(&memory_manager.memory_pool, NULL);
 	switch_assert(memory_manager.memory_pool != NULL);
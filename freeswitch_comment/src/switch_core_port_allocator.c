@@ -35,16 +35,38 @@
 #include <switch.h>
 #include "private/switch_core_pvt.h"
 
+/*
+ * Free ports sit in per shard FIFO rings, so a request pops one instead of scanning the whole range.
+ * A port index always belongs to shard (index % shard_count); a thread starts at the shard its id
+ * hashes to and only walks to the others when that one has nothing ready.  Released ports go to the
+ * back of their ring with a timestamp and are not handed out again before PORT_QUARANTINE has passed,
+ * unless every free port is still that fresh, so stray packets of a finished call can't land in the
+ * next one.
+ */
+#define PORT_QUARANTINE 2000000
+#define PORT_SHARD_MAX 16
+#define PORT_SHARD_MIN_PORTS 64
+
+typedef struct {
+	switch_mutex_t *mutex;
+	uint32_t *ring;
+	switch_time_t *freed;
+	uint32_t size;
+	uint32_t head;
+	uint32_t count;
+} port_shard_t;
+
 struct switch_core_port_allocator {
 	char *ip;
 	switch_port_t start;
 	switch_port_t end;
-	switch_port_t next;
-	int8_t *track;
+	uint8_t *track;
 	uint32_t track_len;
-	uint32_t track_used;
+	uint32_t shard_count;
+	port_shard_t *shards;
+	struct sockaddr_storage probe_addr;
+	uint32_t probe_addr_len;
 	switch_port_flag_t flags;
-	switch_mutex_t *mutex;
 	switch_memory_pool_t *pool;
 };
 
@@ -54,6 +76,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_port_allocator_new(const char *ip, s
 	switch_status_t status;
 	switch_memory_pool_t *pool;
 	switch_core_port_allocator_t *alloc;
+	switch_sockaddr_t *addr = NULL;
+	uint32_t i, shards;
 	int even, odd;
 
 	if ((status = switch_core_new_memory_pool(&pool)) != SWITCH_STATUS_SUCCESS) {
@@ -104,39 +128,124 @@ SWITCH_DECLARE(switch_status_t) switch_core_port_allocator_new(const char *ip, s
 	alloc->track = switch_core_alloc(pool, (alloc->track_len + 2) * sizeof(switch_byte_t));
 
 	alloc->start = start;
-	alloc->next = start;
 	alloc->end = end;
 
+	shards = switch_core_cpu_count();
+
+	if (shards > PORT_SHARD_MAX) {
+		shards = PORT_SHARD_MAX;
+	}
+
+	if (shards > alloc->track_len / PORT_SHARD_MIN_PORTS) {
+		shards = alloc->track_len / PORT_SHARD_MIN_PORTS;
+	}
+
+	if (!shards) {
+		shards = 1;
+	}
+
+	alloc->shard_count = shards;
+	alloc->shards = switch_core_alloc(pool, shards * sizeof(port_shard_t));
+
+	for (i = 0; i < shards; i++) {
+		port_shard_t *shard = &alloc->shards[i];
+
+		shard->size = (alloc->track_len + shards - 1) / shards;
+		shard->ring = switch_core_alloc(pool, shard->size * sizeof(uint32_t));
+		shard->freed = switch_core_alloc(pool, shard->size * sizeof(switch_time_t));
+		switch_mutex_init(&shard->mutex, SWITCH_MUTEX_NESTED, pool);
+	}
+
+	srand((unsigned) ((unsigned) (intptr_t) alloc + switch_micro_time_now()));
+
+	/* start every ring out in random order, ports should not be predictable */
+	for (i = 0; i < alloc->track_len; i++) {
+		port_shard_t *shard = &alloc->shards[i % shards];
+		uint32_t j = rand() % (shard->count + 1);
+
+		shard->ring[shard->count] = shard->ring[j];
+		shard->ring[j] = i;
+		shard->count++;
+	}
+
+	/* resolve the address once, the robustness probe then only costs a socket and a bind */
+	if (switch_sockaddr_info_get(&addr, alloc->ip, SWITCH_UNSPEC, 0, 0, pool) == SWITCH_STATUS_SUCCESS && addr) {
+		alloc->probe_addr_len = switch_sockaddr_get_native(addr, &alloc->probe_addr, sizeof(alloc->probe_addr));
+	}
 
-	switch_mutex_init(&alloc->mutex, SWITCH_MUTEX_NESTED, pool);
 	alloc->pool = pool;
 	*new_allocator = alloc;
 
 	return SWITCH_STATUS_SUCCESS;
 }
 
-static switch_bool_t test_port(switch_core_port_allocator_t *alloc, int family, int type, switch_port_t port)
+static switch_bool_t test_port(switch_core_port_allocator_t *alloc, int type, switch_port_t port)
 {
-	switch_memory_pool_t *pool = NULL;
-	switch_sockaddr_t *local_addr = NULL;
-	switch_socket_t *sock = NULL;
+	struct sockaddr_storage ss;
 	switch_bool_t r = SWITCH_FALSE;
+	int fd;
 
-	if (switch_core_new_memory_pool(&pool) != SWITCH_STATUS_SUCCESS) {
+	if (!alloc->probe_addr_len) {
 		return SWITCH_FALSE;
 	}
-	
-	if (switch_sockaddr_info_get(&local_addr, alloc->ip, SWITCH_UNSPEC, port, 0, pool) == SWITCH_STATUS_SUCCESS) {
-		if (switch_socket_create(&sock, family, type, 0, pool) == SWITCH_STATUS_SUCCESS) {
-			if (switch_socket_bind(sock, local_addr) == SWITCH_STATUS_SUCCESS) {
-				r = SWITCH_TRUE;
-			}
-			switch_socket_close(sock);
+
+	memcpy(&ss, &alloc->probe_addr, alloc->probe_addr_len);
+
+	if (ss.ss_family == AF_INET6) {
+		((struct sockaddr_in6 *) &ss)->sin6_port = htons(port);
+	} else {
+		((struct sockaddr_in *) &ss)->sin_port = htons(port);
+	}
+
+	if ((fd = (int) socket(ss.ss_family, type, 0)) >= 0) {
+		if (!bind(fd, (struct sockaddr *) &ss, alloc->probe_addr_len)) {
+			r = SWITCH_TRUE;
 		}
+#ifdef WIN32
+		closesocket(fd);
+#else
+		close(fd);
+#endif
 	}
-	
-	switch_core_destroy_memory_pool(&pool);
-	
+
+	return r;
+}
+
+static inline switch_port_t index_to_port(switch_core_port_allocator_t *alloc, uint32_t index)
+{
+	if (switch_test_flag(alloc, SPF_EVEN) && switch_test_flag(alloc, SPF_ODD)) {
+		return (switch_port_t) (index + alloc->start);
+	}
+
+	return (switch_port_t) ((index + (alloc->start / 2)) * 2);
+}
+
+/* shard mutex held */
+static inline void shard_push(port_shard_t *shard, uint32_t index, switch_time_t now)
+{
+	uint32_t tail = (shard->head + shard->count) % shard->size;
+
+	shard->ring[tail] = index;
+	shard->freed[tail] = now;
+	shard->count++;
+}
+
+/* pop the oldest free index, one still in quarantine only when fresh_ok is set */
+static switch_bool_t shard_pop(port_shard_t *shard, switch_time_t now, int fresh_ok, uint32_t *index)
+{
+	switch_bool_t r = SWITCH_FALSE;
+
+	switch_mutex_lock(shard->mutex);
+
+	if (shard->count && (fresh_ok || !shard->freed[shard->head] || now - shard->freed[shard->head] >= PORT_QUARANTINE)) {
+		*index = shard->ring[shard->head];
+		shard->head = (shard->head + 1) % shard->size;
+		shard->count--;
+		r = SWITCH_TRUE;
+	}
+
+	switch_mutex_unlock(shard->mutex);
+
 	return r;
 }
 
@@ -144,66 +253,58 @@ SWITCH_DECLARE(switch_status_t) switch_core_port_allocator_request_port(switch_c
 {
 	switch_port_t port = 0;
 	switch_status_t status = SWITCH_STATUS_FALSE;
-	int even = switch_test_flag(alloc, SPF_EVEN);
-	int odd = switch_test_flag(alloc, SPF_ODD);
+	uint32_t home, index = 0, tries = 0, i;
+	switch_time_t now = switch_micro_time_now();
+	int fresh_ok = 0;
 
-	switch_mutex_lock(alloc->mutex);
-	srand((unsigned) ((unsigned) (intptr_t) port_ptr + (unsigned) (intptr_t) switch_thread_self() + switch_micro_time_now()));
+	home = (uint32_t) (((uint64_t) (intptr_t) switch_thread_self() * 0x9E3779B97F4A7C15ULL) >> 32) % alloc->shard_count;
 
-	while (alloc->track_used < alloc->track_len) {
-		uint32_t index;
-		uint32_t tries = 0;
+	while (tries < alloc->track_len) {
+		switch_bool_t found = SWITCH_FALSE, r = SWITCH_TRUE;
+		port_shard_t *shard;
 
-		/* randomly pick a port */
-		index = rand() % alloc->track_len;
+		for (i = 0; i < alloc->shard_count && !found; i++) {
+			found = shard_pop(&alloc->shards[(home + i) % alloc->shard_count], now, fresh_ok, &index);
+		}
 
-		/* if it is used walk up the list to find a free one */
-		while (alloc->track[index] && tries < alloc->track_len) {
-			tries++;
-			if (alloc->track[index] < 0) {
-				alloc->track[index]++;
-			}
-			if (++index >= alloc->track_len) {
-				index = 0;
+		if (!found) {
+			if (fresh_ok) {
+				break;
 			}
+			/* nothing has served its quarantine, better a fresh port than no call */
+			fresh_ok = 1;
+			continue;
 		}
 
-		if (tries < alloc->track_len) {
-			switch_bool_t r = SWITCH_TRUE;
+		tries++;
+		port = index_to_port(alloc, index);
 
-			if ((even && odd)) {
-				port = (switch_port_t) (index + alloc->start);
-			} else {
-				port = (switch_port_t) (index + (alloc->start / 2));
-				port *= 2;
-			}
+		if ((alloc->flags & SPF_ROBUST_UDP)) {
+			r = test_port(alloc, SOCK_DGRAM, port);
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "UDP port robustness check for port %d %s\n", port, r ? "pass" : "fail");
+		}
 
-			if ((alloc->flags & SPF_ROBUST_UDP)) {
-				r = test_port(alloc, AF_INET, SOCK_DGRAM, port);
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "UDP port robustness check for port %d %s\n", port, r ? "pass" : "fail");
-			}
+		if ((alloc->flags & SPF_ROBUST_TCP)) {
+			r = test_port(alloc, SOCK_STREAM, port);
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "TCP port robustness check for port %d %s\n", port, r ? "pass" : "fail");
+		}
 
-			if ((alloc->flags & SPF_ROBUST_TCP)) {
-				r = test_port(alloc, AF_INET, SOCK_STREAM, port);
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "TCP port robustness check for port %d %s\n", port, r ? "pass" : "fail");
-			}
+		shard = &alloc->shards[index % alloc->shard_count];
+		switch_mutex_lock(shard->mutex);
+		if (r) {
+			alloc->track[index] = 1;
+		} else {
+			/* somebody else has it, park it at the back like a released port */
+			shard_push(shard, index, switch_micro_time_now());
+		}
+		switch_mutex_unlock(shard->mutex);
 
-			if (r) {
-				alloc->track[index] = 1;
-				alloc->track_used++;
-				status = SWITCH_STATUS_SUCCESS;
-				goto end;
-			} else {
-				alloc->track[index] = -4;
-			}
+		if (r) {
+			status = SWITCH_STATUS_SUCCESS;
+			break;
 		}
 	}
 
-
-  end:
-
-	switch_mutex_unlock(alloc->mutex);
-
 	if (status == SWITCH_STATUS_SUCCESS) {
 		*port_ptr = port;
 	} else {
@@ -220,7 +321,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_port_allocator_free_port(switch_core
 	switch_status_t status = SWITCH_STATUS_FALSE;
 	int even = switch_test_flag(alloc, SPF_EVEN);
 	int odd = switch_test_flag(alloc, SPF_ODD);
-	int index;
+	port_shard_t *shard;
+	uint32_t index;
 
 	if (port < alloc->start) {
 		return SWITCH_STATUS_GENERR;
@@ -232,13 +334,19 @@ SWITCH_DECLARE(switch_status_t) switch_core_port_allocator_free_port(switch_core
 		index /= 2;
 	}
 
-	switch_mutex_lock(alloc->mutex);
-	if (alloc->track[index] > 0) {
-		alloc->track[index] = -4;
-		alloc->track_used--;
+	if (index >= alloc->track_len) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	shard = &alloc->shards[index % alloc->shard_count];
+
+	switch_mutex_lock(shard->mutex);
+	if (alloc->track[index]) {
+		alloc->track[index] = 0;
+		shard_push(shard, index, switch_micro_time_now());
 		status = SWITCH_STATUS_SUCCESS;
 	}
-	switch_mutex_unlock(alloc->mutex);
+	switch_mutex_unlock(shard->mutex);
 
 	return status;
 }
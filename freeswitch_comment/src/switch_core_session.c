@@ -1328,6 +1328,7 @@ SWITCH_DECLARE(void) switch_core_session_reset(switch_core_session_t *session, s
 
 	switch_mutex_lock(session->codec_read_mutex);
 	switch_buffer_destroy(&session->raw_read_buffer);
+	switch_buffer_destroy(&session->stretch_read_buffer);
 	switch_mutex_unlock(session->codec_read_mutex);
 
 	switch_mutex_lock(session->video_codec_write_mutex);
@@ -1364,6 +1365,8 @@ SWITCH_DECLARE(switch_mutex_t *) switch_core_session_get_mutex(switch_core_sessi
 	return session->mutex;
 }
 
+static void session_sched_resume(switch_core_session_t *session);
+
 SWITCH_DECLARE(switch_status_t) switch_core_session_wake_session_thread(switch_core_session_t *session)
 {
 	switch_status_t status;
@@ -1376,7 +1379,11 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_wake_session_thread(switch_c
 	status = switch_mutex_trylock(session->mutex);
 	
 	if (status == SWITCH_STATUS_SUCCESS) {
-		switch_thread_cond_signal(session->cond);
+		if (session->sched_parked) {
+			session_sched_resume(session);
+		} else {
+			switch_thread_cond_signal(session->cond);
+		}
 		switch_mutex_unlock(session->mutex);
 	} else {
 		if (switch_channel_state_thread_trylock(session->channel) == SWITCH_STATUS_SUCCESS) {
@@ -1502,6 +1509,7 @@ SWITCH_DECLARE(void) switch_core_session_perform_destroy(switch_core_session_t *
 	switch_core_session_destroy_state(*session);
 
 	switch_buffer_destroy(&(*session)->raw_read_buffer);
+	switch_buffer_destroy(&(*session)->stretch_read_buffer);
 	switch_buffer_destroy(&(*session)->raw_write_buffer);
 	switch_ivr_clear_speech_cache(*session);
 	switch_channel_uninit((*session)->channel);
@@ -1617,17 +1625,12 @@ SWITCH_DECLARE(switch_bool_t) switch_core_session_in_thread(switch_core_session_
 	return switch_thread_equal(switch_thread_self(), session->thread_id) ? SWITCH_TRUE : SWITCH_FALSE;
 }
 
-static void *SWITCH_THREAD_FUNC switch_core_session_thread(switch_thread_t *thread, void *obj)
+static void session_thread_end(switch_core_session_t *session)
 {
-	switch_core_session_t *session = obj;
 	switch_event_t *event;
 	char *event_str = NULL;
 	const char *val;
 
-	session->thread = thread;
-	session->thread_id = switch_thread_self();
-
-	switch_core_session_run(session);
 	switch_core_media_bug_remove_all(session);
 
 	if (session->soft_lock) {
@@ -1667,6 +1670,18 @@ static void *SWITCH_THREAD_FUNC switch_core_session_thread(switch_thread_t *thre
 
 	switch_set_flag(session, SSF_DESTROYABLE);
 	switch_core_session_destroy(&session);
+}
+
+static void *SWITCH_THREAD_FUNC switch_core_session_thread(switch_thread_t *thread, void *obj)
+{
+	switch_core_session_t *session = obj;
+
+	session->thread = thread;
+	session->thread_id = switch_thread_self();
+
+	switch_core_session_run(session);
+	session_thread_end(session);
+
 	return NULL;
 }
 
@@ -1832,6 +1847,318 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_thread_pool_launch(switch_co
 }
 
 
+#define SESSION_SCHED_MAX_WORKERS 64
+#define SESSION_SCHED_RING 1024
+
+typedef struct {
+	switch_mutex_t *mutex;
+	switch_core_session_t **ring;
+	uint32_t size;
+	uint32_t head;				/* thieves take the oldest from here */
+	uint32_t tail;				/* the owner pushes and pops here */
+	uint32_t id;
+	switch_thread_t *thread;
+	uint64_t slices;
+	uint64_t steals;
+} session_sched_worker_t;
+
+static struct {
+	session_sched_worker_t workers[SESSION_SCHED_MAX_WORKERS];
+	uint32_t count;
+	uint32_t next;
+	uint32_t idle;
+	uint64_t parks;
+	uint64_t resumes;
+	uint64_t handoffs;
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+	volatile int running;
+} session_sched;
+
+static void session_sched_push(session_sched_worker_t *worker, switch_core_session_t *session)
+{
+	switch_mutex_lock(worker->mutex);
+
+	if (worker->tail - worker->head == worker->size) {
+		switch_core_session_t **ring;
+		uint32_t x;
+
+		switch_zmalloc(ring, worker->size * 2 * sizeof(*ring));
+		for (x = 0; x < worker->size; x++) {
+			ring[x] = worker->ring[(worker->head + x) & (worker->size - 1)];
+		}
+		free(worker->ring);
+		worker->ring = ring;
+		worker->head = 0;
+		worker->tail = worker->size;
+		worker->size *= 2;
+	}
+
+	worker->ring[worker->tail++ & (worker->size - 1)] = session;
+	switch_mutex_unlock(worker->mutex);
+
+	switch_mutex_lock(session_sched.mutex);
+	if (session_sched.idle) {
+		switch_thread_cond_signal(session_sched.cond);
+	}
+	switch_mutex_unlock(session_sched.mutex);
+}
+
+/* our own newest first, otherwise the oldest session of the first busy worker after us */
+static switch_core_session_t *session_sched_take(session_sched_worker_t *worker)
+{
+	switch_core_session_t *session = NULL;
+	uint32_t x;
+
+	switch_mutex_lock(worker->mutex);
+	if (worker->tail != worker->head) {
+		session = worker->ring[--worker->tail & (worker->size - 1)];
+	}
+	switch_mutex_unlock(worker->mutex);
+
+	for (x = 1; !session && x < session_sched.count; x++) {
+		session_sched_worker_t *victim = &session_sched.workers[(worker->id + x) % session_sched.count];
+
+		if (victim->tail == victim->head) {
+			continue;
+		}
+
+		switch_mutex_lock(victim->mutex);
+		if (victim->tail != victim->head) {
+			session = victim->ring[victim->head++ & (victim->size - 1)];
+			worker->steals++;
+		}
+		switch_mutex_unlock(victim->mutex);
+	}
+
+	return session;
+}
+
+static void *SWITCH_THREAD_FUNC session_sched_dedicated_thread(switch_thread_t *thread, void *obj)
+{
+	switch_core_session_t *session = (switch_core_session_t *) obj;
+	switch_core_session_slice_t slice;
+
+	switch_mutex_lock(session->mutex);
+	session->thread = thread;
+	session->thread_id = switch_thread_self();
+
+	if ((slice = switch_core_session_run_slice(session, SWITCH_TRUE)) == SCS_SLICE_DONE) {
+		session->thread_id = switch_thread_self();
+		session_thread_end(session);
+	} else if (slice == SCS_SLICE_PARKED) {
+		switch_mutex_lock(session_sched.mutex);
+		session_sched.parks++;
+		switch_mutex_unlock(session_sched.mutex);
+	}
+
+	return NULL;
+}
+
+/* the next step may block, give the session a pool thread until it sleeps again */
+static void session_sched_handoff(switch_core_session_t *session)
+{
+	switch_thread_data_t *td;
+
+	switch_zmalloc(td, sizeof(*td));
+	td->func = session_sched_dedicated_thread;
+	td->obj = session;
+	td->alloc = 1;
+
+	switch_mutex_lock(session_sched.mutex);
+	session_sched.handoffs++;
+	switch_mutex_unlock(session_sched.mutex);
+
+	switch_thread_pool_launch_thread(&td);
+}
+
+/*
+  called by a wake with session->mutex held.  Sessions are only pushed with session_sched.mutex held
+  and the scheduler running, so session_sched_stop finds every one of them in a ring.
+*/
+static void session_sched_resume(switch_core_session_t *session)
+{
+	session->sched_parked = 0;
+
+	switch_mutex_lock(session_sched.mutex);
+	session_sched.resumes++;
+
+	if (session_sched.running) {
+		session_sched_push(&session_sched.workers[session->sched_worker % session_sched.count], session);
+	} else {
+		session_sched_handoff(session);
+	}
+	switch_mutex_unlock(session_sched.mutex);
+}
+
+static void *SWITCH_THREAD_FUNC session_sched_worker_thread(switch_thread_t *thread, void *obj)
+{
+	session_sched_worker_t *worker = (session_sched_worker_t *) obj;
+	switch_core_session_t *session;
+
+	while (session_sched.running) {
+		if (!(session = session_sched_take(worker))) {
+			switch_mutex_lock(session_sched.mutex);
+			/* anything pushed before we got the mutex is found here, anything after signals us */
+			if (session_sched.running && !(session = session_sched_take(worker))) {
+				session_sched.idle++;
+				switch_thread_cond_wait(session_sched.cond, session_sched.mutex);
+				session_sched.idle--;
+			}
+			switch_mutex_unlock(session_sched.mutex);
+
+			if (!session) {
+				continue;
+			}
+		}
+
+		switch_mutex_lock(session->mutex);
+		session->thread = thread;
+		session->thread_id = switch_thread_self();
+		session->sched_worker = worker->id;
+		worker->slices++;
+
+		switch (switch_core_session_run_slice(session, SWITCH_FALSE)) {
+		case SCS_SLICE_PARKED:
+			switch_mutex_lock(session_sched.mutex);
+			session_sched.parks++;
+			switch_mutex_unlock(session_sched.mutex);
+			break;
+		case SCS_SLICE_BLOCKING:
+		case SCS_SLICE_DONE:
+			session_sched_handoff(session);
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/* SWITCH_STATUS_FALSE when the scheduler stopped in the meantime, the caller launches the session the usual way */
+static switch_status_t session_sched_launch(switch_core_session_t *session)
+{
+	switch_status_t status = SWITCH_STATUS_INUSE;
+
+	switch_mutex_lock(session->mutex);
+	if (switch_test_flag(session, SSF_THREAD_RUNNING)) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_CRIT, "Cannot double-launch thread!\n");
+	} else if (switch_test_flag(session, SSF_THREAD_STARTED)) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_CRIT, "Cannot launch thread again after it has already been run!\n");
+	} else {
+		switch_mutex_lock(session_sched.mutex);
+		if (session_sched.running) {
+			switch_set_flag(session, SSF_THREAD_RUNNING);
+			switch_set_flag(session, SSF_THREAD_STARTED);
+			session->sched_new_loops = 500;
+			session->sched_worker = session_sched.next++ % session_sched.count;
+			session_sched_push(&session_sched.workers[session->sched_worker], session);
+			status = SWITCH_STATUS_SUCCESS;
+		} else {
+			status = SWITCH_STATUS_FALSE;
+		}
+		switch_mutex_unlock(session_sched.mutex);
+	}
+	switch_mutex_unlock(session->mutex);
+
+	return status;
+}
+
+SWITCH_DECLARE(uint32_t) switch_core_session_set_scheduler_threads(uint32_t threads)
+{
+	switch_threadattr_t *thd_attr;
+	uint32_t x;
+
+	if (session_sched.running || !threads || !session_manager.memory_pool) {
+		return session_sched.count;
+	}
+
+	if (threads > SESSION_SCHED_MAX_WORKERS) {
+		threads = SESSION_SCHED_MAX_WORKERS;
+	}
+
+	switch_mutex_init(&session_sched.mutex, SWITCH_MUTEX_NESTED, session_manager.memory_pool);
+	switch_thread_cond_create(&session_sched.cond, session_manager.memory_pool);
+	switch_threadattr_create(&thd_attr, session_manager.memory_pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	for (x = 0; x < threads; x++) {
+		session_sched_worker_t *worker = &session_sched.workers[x];
+
+		worker->id = x;
+		worker->size = SESSION_SCHED_RING;
+		switch_zmalloc(worker->ring, worker->size * sizeof(*worker->ring));
+		switch_mutex_init(&worker->mutex, SWITCH_MUTEX_NESTED, session_manager.memory_pool);
+	}
+
+	session_sched.count = threads;
+	session_sched.running = 1;
+
+	for (x = 0; x < threads; x++) {
+		switch_thread_create(&session_sched.workers[x].thread, thd_attr, session_sched_worker_thread, &session_sched.workers[x], session_manager.memory_pool);
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Session scheduler started with %u workers\n", threads);
+
+	return session_sched.count;
+}
+
+SWITCH_DECLARE(void) switch_core_session_scheduler_stats(switch_core_session_scheduler_stats_t *stats)
+{
+	uint32_t x;
+
+	memset(stats, 0, sizeof(*stats));
+
+	if (!session_sched.running) {
+		return;
+	}
+
+	switch_mutex_lock(session_sched.mutex);
+	stats->workers = session_sched.count;
+	/* a wake can be counted before the park it ends */
+	stats->parked = session_sched.parks > session_sched.resumes ? (uint32_t) (session_sched.parks - session_sched.resumes) : 0;
+	stats->resumes = session_sched.resumes;
+	stats->handoffs = session_sched.handoffs;
+	switch_mutex_unlock(session_sched.mutex);
+
+	for (x = 0; x < session_sched.count; x++) {
+		stats->slices += session_sched.workers[x].slices;
+		stats->steals += session_sched.workers[x].steals;
+	}
+}
+
+static void session_sched_stop(void)
+{
+	switch_status_t st;
+	uint32_t x;
+
+	if (!session_sched.running) {
+		return;
+	}
+
+	switch_mutex_lock(session_sched.mutex);
+	session_sched.running = 0;
+	switch_thread_cond_broadcast(session_sched.cond);
+	switch_mutex_unlock(session_sched.mutex);
+
+	for (x = 0; x < session_sched.count; x++) {
+		switch_thread_join(&st, session_sched.workers[x].thread);
+	}
+
+	/* nothing is pushed once running is off, whatever the workers left queued goes to a thread of its own */
+	switch_mutex_lock(session_sched.mutex);
+	for (x = 0; x < session_sched.count; x++) {
+		session_sched_worker_t *worker = &session_sched.workers[x];
+
+		while (worker->tail != worker->head) {
+			session_sched_handoff(worker->ring[worker->head++ & (worker->size - 1)]);
+		}
+
+		switch_safe_free(worker->ring);
+	}
+	switch_mutex_unlock(session_sched.mutex);
+}
+
+
 SWITCH_DECLARE(switch_status_t) switch_core_session_thread_launch(switch_core_session_t *session)
 {
 	switch_status_t status = SWITCH_STATUS_FALSE;
@@ -1844,6 +2171,10 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_thread_launch(switch_core_se
 	}
 
 
+	if (session_sched.running && (status = session_sched_launch(session)) != SWITCH_STATUS_FALSE) {
+		return status;
+	}
+
 	if (switch_test_flag((&runtime), SCF_SESSION_THREAD_POOL)) {
 		return switch_core_session_thread_pool_launch(session);
 	}
@@ -2066,6 +2397,7 @@ SWITCH_DECLARE(switch_core_session_t *) switch_core_session_request_xml(switch_e
 	flags[CF_RECOVERED] = 0;
 	flags[CF_JITTERBUFFER] = 0;
 	flags[CF_JITTERBUFFER_PLC] = 0;
+	flags[CF_JITTERBUFFER_STRETCH] = 0;
 	flags[CF_DIALPLAN] = 0;
 	flags[CF_BLOCK_BROADCAST_UNTIL_MEDIA] = 0;
 	flags[CF_CNG_PLC] = 0;
@@ -2474,6 +2806,7 @@ void switch_core_session_init(switch_memory_pool_t *pool)
 
 void switch_core_session_uninit(void)
 {
+	session_sched_stop();
 	switch_queue_term(session_manager.thread_queue);
 	switch_mutex_lock(session_manager.mutex);
 	if (session_manager.running)
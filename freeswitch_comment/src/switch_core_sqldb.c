@@ -38,6 +38,7 @@
 
 #define SWITCH_SQL_QUEUE_LEN 100000
 #define SWITCH_SQL_QUEUE_PAUSE_LEN 90000
+#define SWITCH_SQL_QUEUE_MAX_STMTS 64
 
 struct switch_cache_db_handle {
 	char name[CACHE_DB_LEN];
@@ -57,6 +58,48 @@ struct switch_cache_db_handle {
 	struct switch_cache_db_handle *next;
 };
 
+/* statements core_event_handler sends as bound values instead of formatted sql */
+typedef enum {
+	CORE_STMT_CHANNEL_CREATE,
+	CORE_STMT_CHANNEL_DELETE,
+	CORE_STMT_CHANNEL_UUID,
+	CORE_STMT_CHANNEL_CALL_UUID_RENAME,
+	CORE_STMT_CHANNEL_CODEC,
+	CORE_STMT_CHANNEL_APPLICATION,
+	CORE_STMT_CHANNEL_CALL_UPDATE,
+	CORE_STMT_CHANNEL_CALLSTATE,
+	CORE_STMT_CHANNEL_STATE,
+	CORE_STMT_CHANNEL_STATE_ROUTING,
+	CORE_STMT_CHANNEL_BRIDGE,
+	CORE_STMT_CHANNEL_UNBRIDGE,
+	CORE_STMT_CHANNEL_ORIGINATE,
+	CORE_STMT_CHANNEL_SECURE,
+	CORE_STMT_CALLS_INSERT,
+	CORE_STMT_CALLS_DELETE,
+	CORE_STMT_MAX
+} core_stmt_t;
+
+static const char *CORE_STMT_SQL[CORE_STMT_MAX] = {
+	"insert into channels (uuid,direction,created,created_epoch, name,state,callstate,dialplan,context,hostname,initial_cid_name,initial_cid_num,initial_ip_addr,initial_dest,initial_dialplan,initial_context) "
+	"values(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)",
+	"delete from channels where uuid=?",
+	"update channels set uuid=? where uuid=?",
+	"update channels set call_uuid=? where call_uuid=?",
+	"update channels set read_codec=?,read_rate=?,read_bit_rate=?,write_codec=?,write_rate=?,write_bit_rate=? where uuid=?",
+	"update channels set application=?,application_data=?,presence_id=?,presence_data=?,accountcode=? where uuid=?",
+	"update channels set callee_name=?,callee_num=?,sent_callee_name=?,sent_callee_num=?,callee_direction=?,cid_name=?,cid_num=? where uuid=?",
+	"update channels set callstate=? where uuid=?",
+	"update channels set state=? where uuid=?",
+	"update channels set state=?,cid_name=?,cid_num=?,callee_name=?,callee_num=?,sent_callee_name=?,sent_callee_num=?,"
+	"ip_addr=?,dest=?,dialplan=?,context=?,presence_id=?,presence_data=?,accountcode=? where uuid=?",
+	"update channels set call_uuid=? where uuid=? or uuid=?",
+	"update channels set call_uuid=uuid where call_uuid=?",
+	"update channels set presence_id=?,presence_data=?,accountcode=?,call_uuid=? where uuid=?",
+	"update channels set secure=? where uuid=?",
+	"insert into calls (call_uuid,call_created,call_created_epoch,caller_uuid,callee_uuid,hostname) values (?,?,?,?,?,?)",
+	"delete from calls where (caller_uuid=? or callee_uuid=?)"
+};
+
 static struct {
 	switch_memory_pool_t *memory_pool;
 	switch_thread_t *db_thread;
@@ -71,6 +114,8 @@ static struct {
 	switch_cache_db_handle_t *dbh;
 	switch_sql_queue_manager_t *qm;
 	int paused;
+	uint32_t qm_ids;
+	int stmts[CORE_STMT_MAX];
 } sql_manager;
 
 
@@ -1402,6 +1447,31 @@ static void *SWITCH_THREAD_FUNC switch_core_sql_db_thread(switch_thread_t *threa
 
 static void *SWITCH_THREAD_FUNC switch_user_sql_thread(switch_thread_t *thread, void *obj);
 
+/* pgsql templates get this many tries between transactions before they fall back to plain sql for good */
+#define QM_STMT_MAX_FAILURES 3
+
+/* a statement template registered with switch_sql_queue_manager_prepare, prepared lazily on the queue thread's handle */
+typedef struct {
+	char *sql;
+	char *pgsql;
+	int argc;
+	char name[64];
+	char stale[64];
+	uint32_t generation;
+	void *prepared;
+	uint8_t ready;
+	uint8_t disabled;
+	uint8_t wanted;
+	uint8_t failures;
+} qm_stmt_t;
+
+/* what sits on the queues, either raw sql or a template index and its bound values */
+typedef struct {
+	int stmt;
+	char *sql;
+	char *argv[1];
+} qm_item_t;
+
 struct switch_sql_queue_manager {
 	const char *name;
 	switch_cache_db_handle_t *event_db;
@@ -1424,6 +1494,10 @@ struct switch_sql_queue_manager {
 	uint32_t max_trans;
 	uint32_t confirm;
 	uint8_t paused;
+	uint32_t id;
+	qm_stmt_t *stmts;
+	int stmt_count;
+	uint64_t bound_written;
 };
 
 static int qm_wake(switch_sql_queue_manager_t *qm)
@@ -1465,6 +1539,217 @@ static uint32_t qm_ttl(switch_sql_queue_manager_t *qm)
 	return ttl;
 }
 
+static qm_item_t *qm_item_new(char *sql)
+{
+	qm_item_t *item;
+
+	switch_zmalloc(item, sizeof(*item));
+	item->stmt = -1;
+	item->sql = sql;
+
+	return item;
+}
+
+static void qm_item_free(qm_item_t **itemp)
+{
+	qm_item_t *item = *itemp;
+
+	if (item) {
+		if (item->stmt < 0) {
+			switch_safe_free(item->sql);
+		}
+		free(item);
+	}
+
+	*itemp = NULL;
+}
+
+/* render a bound item as plain sql, for handles that cannot run the prepared form */
+static char *qm_render(qm_stmt_t *stmt, qm_item_t *item)
+{
+	switch_stream_handle_t stream = { 0 };
+	const char *p, *q;
+	int i = 0;
+
+	SWITCH_STANDARD_STREAM(stream);
+
+	for (p = stmt->sql; (q = strchr(p, '?')); p = q + 1) {
+		stream.write_function(&stream, "%.*s", (int) (q - p), p);
+
+		if (item->argv[i]) {
+			stream.write_function(&stream, "'%q'", item->argv[i]);
+		} else {
+			stream.write_function(&stream, "NULL");
+		}
+		i++;
+	}
+
+	stream.write_function(&stream, "%s", p);
+
+	return (char *) stream.data;
+}
+
+static void qm_stmt_release(switch_sql_queue_manager_t *qm, qm_stmt_t *stmt)
+{
+	if (stmt->prepared) {
+		switch (qm->event_db->type) {
+		case SCDB_TYPE_CORE_DB:
+			switch_core_db_finalize((switch_core_db_stmt_t *) stmt->prepared);
+			break;
+		case SCDB_TYPE_ODBC:
+			switch_odbc_statement_handle_free(&stmt->prepared);
+			break;
+		case SCDB_TYPE_PGSQL:
+			break;
+		}
+	}
+
+	/* the server keeps the old name unless the connection went away, drop it before the next prepare */
+	if (stmt->ready && qm->event_db->type == SCDB_TYPE_PGSQL) {
+		switch_copy_string(stmt->stale, stmt->name, sizeof(stmt->stale));
+	}
+
+	stmt->prepared = NULL;
+	stmt->ready = 0;
+}
+
+static void qm_stmt_prepare(switch_sql_queue_manager_t *qm, qm_stmt_t *stmt)
+{
+	int ok = 0;
+
+	switch (qm->event_db->type) {
+	case SCDB_TYPE_CORE_DB:
+		{
+			switch_core_db_stmt_t *dbstmt = NULL;
+
+			if (switch_core_db_prepare(qm->event_db->native_handle.core_db_dbh, stmt->sql, -1, &dbstmt, NULL) == SWITCH_CORE_DB_OK) {
+				stmt->prepared = dbstmt;
+				ok = 1;
+			}
+		}
+		break;
+	case SCDB_TYPE_ODBC:
+		ok = switch_odbc_statement_prepare(qm->event_db->native_handle.odbc_dbh, stmt->sql, &stmt->prepared) == SWITCH_ODBC_SUCCESS;
+		break;
+	case SCDB_TYPE_PGSQL:
+		if (*stmt->stale) {
+			char sql[128];
+
+			/* fails harmlessly when a reconnect already dropped it */
+			switch_snprintf(sql, sizeof(sql), "DEALLOCATE %s", stmt->stale);
+			switch_pgsql_handle_exec(qm->event_db->native_handle.pgsql_dbh, sql, NULL);
+			*stmt->stale = '\0';
+		}
+
+		/* server side names die with the connection, a new generation gets a fresh name after a failure */
+		switch_snprintf(stmt->name, sizeof(stmt->name), "fs_qm%u_%d_%u", qm->id, (int) (stmt - qm->stmts), ++stmt->generation);
+		ok = switch_pgsql_handle_prepare(qm->event_db->native_handle.pgsql_dbh, stmt->name, stmt->pgsql, stmt->argc) == SWITCH_PGSQL_SUCCESS;
+		break;
+	}
+
+	if (ok) {
+		stmt->ready = 1;
+		stmt->failures = 0;
+	} else if (qm->event_db->type == SCDB_TYPE_PGSQL && ++stmt->failures < QM_STMT_MAX_FAILURES) {
+		/* likely the connection, not the statement, try again before the next transaction */
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "%s cannot prepare [%s] yet, sending it as plain sql\n", qm->name, stmt->sql);
+	} else {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "%s cannot prepare [%s], sending it as plain sql\n", qm->name, stmt->sql);
+		stmt->disabled = 1;
+	}
+}
+
+/* a failed statement aborts a pgsql transaction and every later prepare in it, so pgsql templates are only prepared here, between transactions */
+static void qm_stmts_prepare_wanted(switch_sql_queue_manager_t *qm)
+{
+	int i;
+
+	for (i = 0; i < qm->stmt_count; i++) {
+		qm_stmt_t *stmt = &qm->stmts[i];
+
+		if (stmt->wanted && !stmt->ready && !stmt->disabled) {
+			qm_stmt_prepare(qm, stmt);
+		}
+	}
+}
+
+static switch_status_t qm_exec_bound(switch_sql_queue_manager_t *qm, qm_item_t *item)
+{
+	qm_stmt_t *stmt = &qm->stmts[item->stmt];
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	if (!stmt->ready && !stmt->disabled) {
+		if (qm->event_db->type == SCDB_TYPE_PGSQL) {
+			stmt->wanted = 1;
+		} else {
+			qm_stmt_prepare(qm, stmt);
+		}
+	}
+
+	if (!stmt->ready) {
+		char *sql = qm_render(stmt, item);
+		status = switch_cache_db_execute_sql(qm->event_db, sql, NULL);
+		free(sql);
+		return status;
+	}
+
+	switch (qm->event_db->type) {
+	case SCDB_TYPE_CORE_DB:
+		{
+			switch_core_db_stmt_t *dbstmt;
+			int i, result, running = 0, retry = 1;
+
+		again:
+			dbstmt = (switch_core_db_stmt_t *) stmt->prepared;
+
+			for (i = 0; i < stmt->argc; i++) {
+				switch_core_db_bind_text(dbstmt, i + 1, item->argv[i], -1, SWITCH_CORE_DB_STATIC);
+			}
+
+			while ((result = switch_core_db_step(dbstmt)) == SWITCH_CORE_DB_BUSY && ++running < 5000) {
+				switch_cond_next();
+			}
+
+			if (result == SWITCH_CORE_DB_DONE || result == SWITCH_CORE_DB_ROW) {
+				status = SWITCH_STATUS_SUCCESS;
+				switch_core_db_reset(dbstmt);
+			} else if (switch_core_db_reset(dbstmt) == SWITCH_CORE_DB_SCHEMA && retry--) {
+				/* the table was recreated under the statement */
+				qm_stmt_release(qm, stmt);
+				qm_stmt_prepare(qm, stmt);
+				if (stmt->ready) {
+					goto again;
+				}
+			} else {
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "NATIVE SQL ERR [%s]\n%s\n",
+								  switch_core_db_errmsg(qm->event_db->native_handle.core_db_dbh), stmt->sql);
+			}
+		}
+		break;
+	case SCDB_TYPE_ODBC:
+		if (switch_odbc_statement_execute(qm->event_db->native_handle.odbc_dbh, stmt->prepared, stmt->argc,
+										  (const char * const *) item->argv, NULL) == SWITCH_ODBC_SUCCESS) {
+			status = SWITCH_STATUS_SUCCESS;
+		}
+		break;
+	case SCDB_TYPE_PGSQL:
+		if (switch_pgsql_handle_exec_prepared(qm->event_db->native_handle.pgsql_dbh, stmt->name, stmt->argc,
+											  (const char * const *) item->argv) == SWITCH_PGSQL_SUCCESS) {
+			status = SWITCH_STATUS_SUCCESS;
+		}
+		break;
+	}
+
+	if (status == SWITCH_STATUS_SUCCESS) {
+		qm->bound_written++;
+	} else {
+		/* the connection may have been reset under us, prepare again next time */
+		qm_stmt_release(qm, stmt);
+	}
+
+	return status;
+}
+
 struct db_job {
 	switch_sql_queue_manager_t *qm;
 	char *sql;
@@ -1602,10 +1887,18 @@ static void do_flush(switch_sql_queue_manager_t *qm, int i, switch_cache_db_hand
 	switch_mutex_lock(qm->mutex);
 	while (switch_queue_trypop(q, &pop) == SWITCH_STATUS_SUCCESS) {
 		if (pop) {
+			qm_item_t *item = (qm_item_t *) pop;
+
 			if (dbh) {
-				switch_cache_db_execute_sql(dbh, (char *) pop, NULL);
+				if (item->stmt < 0) {
+					switch_cache_db_execute_sql(dbh, item->sql, NULL);
+				} else {
+					char *sql = qm_render(&qm->stmts[item->stmt], item);
+					switch_cache_db_execute_sql(dbh, sql, NULL);
+					free(sql);
+				}
 			}
-			switch_safe_free(pop);
+			qm_item_free(&item);
 		}
 	}
 	switch_mutex_unlock(qm->mutex);
@@ -1728,33 +2021,18 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_destroy(switch_sql_queu
 	return status;
 }
 
-SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup)
+static void qm_push(switch_sql_queue_manager_t *qm, qm_item_t *item, uint32_t pos)
 {
-	char *sqlptr = NULL;
 	switch_status_t status;
 	int x = 0;
 
-	if (sql_manager.paused || qm->thread_running != 1) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "DROP [%s]\n", sql);
-		if (!dup) free((char *)sql);
-		qm_wake(qm);
-		return SWITCH_STATUS_SUCCESS;
-	}
-
-	if (qm->thread_running != 1) {
-		if (!dup) free((char *)sql);
-		return SWITCH_STATUS_FALSE;
-	}
-
 	if (pos > qm->numq - 1) {
 		pos = 0;
 	}
 
-	sqlptr = dup ? strdup(sql) : (char *)sql;
-
 	do {
 		switch_mutex_lock(qm->mutex);
-		status = switch_queue_trypush(qm->sql_queue[pos], sqlptr);
+		status = switch_queue_trypush(qm->sql_queue[pos], item);
 		switch_mutex_unlock(qm->mutex);
 		if (status != SWITCH_STATUS_SUCCESS) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "Delay %d sending sql\n", x);
@@ -1765,10 +2043,131 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_m
 	} while(status != SWITCH_STATUS_SUCCESS);
 	
 	qm_wake(qm);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup)
+{
+	if (sql_manager.paused || qm->thread_running != 1) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "DROP [%s]\n", sql);
+		if (!dup) free((char *)sql);
+		qm_wake(qm);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	qm_push(qm, qm_item_new(dup ? strdup(sql) : (char *)sql), pos);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(int) switch_sql_queue_manager_prepare(switch_sql_queue_manager_t *qm, const char *sql)
+{
+	qm_stmt_t *stmt;
+	switch_stream_handle_t stream = { 0 };
+	const char *p, *q;
+	int id = -1;
+
+	switch_mutex_lock(qm->mutex);
+
+	if (qm->stmt_count >= SWITCH_SQL_QUEUE_MAX_STMTS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "%s has no room for another statement\n", qm->name);
+		goto end;
+	}
+
+	stmt = &qm->stmts[qm->stmt_count];
+	stmt->sql = switch_core_strdup(qm->pool, sql);
+
+	/* postgres wants numbered placeholders */
+	SWITCH_STANDARD_STREAM(stream);
+	for (p = sql; (q = strchr(p, '?')); p = q + 1) {
+		stream.write_function(&stream, "%.*s$%d", (int) (q - p), p, ++stmt->argc);
+	}
+	stream.write_function(&stream, "%s", p);
+	stmt->pgsql = switch_core_strdup(qm->pool, (char *) stream.data);
+	switch_safe_free(stream.data);
+
+	if (stmt->argc > SWITCH_ODBC_MAX_PARAMS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "%s too many placeholders in [%s]\n", qm->name, sql);
+		memset(stmt, 0, sizeof(*stmt));
+		goto end;
+	}
+
+	id = qm->stmt_count++;
+
+ end:
+
+	switch_mutex_unlock(qm->mutex);
+
+	return id;
+}
+
+static switch_status_t qm_push_bound(switch_sql_queue_manager_t *qm, int stmt_id, uint32_t pos, const char **args)
+{
+	qm_stmt_t *stmt;
+	qm_item_t *item;
+	switch_size_t len;
+	char *p;
+	int i;
+
+	if (stmt_id < 0 || stmt_id >= qm->stmt_count) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (sql_manager.paused || qm->thread_running != 1) {
+		qm_wake(qm);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	stmt = &qm->stmts[stmt_id];
+	len = sizeof(*item) + sizeof(char *) * stmt->argc;
+
+	for (i = 0; i < stmt->argc; i++) {
+		if (args[i]) {
+			len += strlen(args[i]) + 1;
+		}
+	}
+
+	/* one block for the item, the argv array and the values */
+	item = malloc(len);
+	switch_assert(item);
+	item->stmt = stmt_id;
+	item->sql = NULL;
+	p = (char *) &item->argv[stmt->argc + 1];
+
+	for (i = 0; i < stmt->argc; i++) {
+		if (args[i]) {
+			switch_size_t vlen = strlen(args[i]) + 1;
+			memcpy(p, args[i], vlen);
+			item->argv[i] = p;
+			p += vlen;
+		} else {
+			item->argv[i] = NULL;
+		}
+	}
+
+	qm_push(qm, item, pos);
 
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_bound(switch_sql_queue_manager_t *qm, int stmt_id, uint32_t pos, ...)
+{
+	const char *args[SWITCH_ODBC_MAX_PARAMS];
+	va_list ap;
+	int i;
+
+	if (stmt_id < 0 || stmt_id >= qm->stmt_count) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	va_start(ap, pos);
+	for (i = 0; i < qm->stmts[stmt_id].argc; i++) {
+		args[i] = va_arg(ap, const char *);
+	}
+	va_end(ap);
+
+	return qm_push_bound(qm, stmt_id, pos, args);
+}
+
 
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup)
 {
@@ -1812,7 +2211,7 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql
 
 	switch_mutex_lock(qm->mutex);
 	qm->confirm++;
-	switch_queue_push(qm->sql_queue[pos], dup ? strdup(sql) : (char *)sql);
+	switch_queue_push(qm->sql_queue[pos], qm_item_new(dup ? strdup(sql) : (char *)sql));
 	written = qm->pre_written[pos];
 	size = switch_sql_queue_manager_size(qm, pos);
 	want = written + size;
@@ -1866,6 +2265,11 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *n
 	qm->dsn = switch_core_strdup(qm->pool, dsn);
 	qm->name = switch_core_strdup(qm->pool, name);
 	qm->max_trans = max_trans;
+	qm->stmts = switch_core_alloc(qm->pool, sizeof(qm_stmt_t) * SWITCH_SQL_QUEUE_MAX_STMTS);
+
+	switch_mutex_lock(sql_manager.ctl_mutex);
+	qm->id = ++sql_manager.qm_ids;
+	switch_mutex_unlock(sql_manager.ctl_mutex);
 
 	switch_mutex_init(&qm->cond_mutex, SWITCH_MUTEX_NESTED, qm->pool);
 	switch_mutex_init(&qm->cond2_mutex, SWITCH_MUTEX_NESTED, qm->pool);
@@ -1910,6 +2314,10 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 
 	if (io_mutex) switch_mutex_lock(io_mutex);
 
+	if (qm->event_db->type == SCDB_TYPE_PGSQL) {
+		qm_stmts_prepare_wanted(qm);
+	}
+
 	if (!zstr(qm->pre_trans_execute)) {
 		switch_cache_db_execute_sql_real(qm->event_db, qm->pre_trans_execute, &errmsg);
 		if (errmsg) {
@@ -1975,13 +2383,21 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 		}
 
 		if (pop) {
-			if ((status = switch_cache_db_execute_sql(qm->event_db, (char *) pop, NULL)) == SWITCH_STATUS_SUCCESS) {
+			qm_item_t *item = (qm_item_t *) pop;
+
+			if (item->stmt < 0) {
+				status = switch_cache_db_execute_sql(qm->event_db, item->sql, NULL);
+			} else {
+				status = qm_exec_bound(qm, item);
+			}
+
+			if (status == SWITCH_STATUS_SUCCESS) {
 				switch_mutex_lock(qm->mutex);
 				qm->pre_written[i]++;
 				switch_mutex_unlock(qm->mutex);
 				ttl++;
 			}
-			switch_safe_free(pop);
+			qm_item_free(&item);
 			if (status != SWITCH_STATUS_SUCCESS) break;
 		} else {
 			break;
@@ -2146,6 +2562,10 @@ static void *SWITCH_THREAD_FUNC switch_user_sql_thread(switch_thread_t *thread,
 		do_flush(qm, i, qm->event_db);
 	}
 
+	for (i = 0; i < (uint32_t) qm->stmt_count; i++) {
+		qm_stmt_release(qm, &qm->stmts[i]);
+	}
+
 	switch_cache_db_release_db_handle(&qm->event_db);
 
 	qm->thread_running = 0;
@@ -2200,49 +2620,1096 @@ static char *parse_presence_data_cols(switch_event_t *event)
 }
 
 
-#define MAX_SQL 5
-#define new_sql()   switch_assert(sql_idx+1 < MAX_SQL); if (exists) sql[sql_idx++]
-#define new_sql_a() switch_assert(sql_idx+1 < MAX_SQL); sql[sql_idx++]
+/* same split as the text statements below: "update channels" and "delete from channels" go on queue 1, inserts and calls on 0 */
+#define core_stmt(_s) sql_manager.qm, sql_manager.stmts[_s], \
+	((_s) == CORE_STMT_CHANNEL_CREATE || (_s) == CORE_STMT_CALLS_INSERT || (_s) == CORE_STMT_CALLS_DELETE ? 0 : 1)
+
+/* in-memory copy of the channels and calls tables, fed on the thread that changes the channel and read by show channels|calls */
+typedef enum {
+	CS_COL_UUID,
+	CS_COL_DIRECTION,
+	CS_COL_CREATED,
+	CS_COL_CREATED_EPOCH,
+	CS_COL_NAME,
+	CS_COL_STATE,
+	CS_COL_CID_NAME,
+	CS_COL_CID_NUM,
+	CS_COL_IP_ADDR,
+	CS_COL_DEST,
+	CS_COL_APPLICATION,
+	CS_COL_APPLICATION_DATA,
+	CS_COL_DIALPLAN,
+	CS_COL_CONTEXT,
+	CS_COL_READ_CODEC,
+	CS_COL_READ_RATE,
+	CS_COL_READ_BIT_RATE,
+	CS_COL_WRITE_CODEC,
+	CS_COL_WRITE_RATE,
+	CS_COL_WRITE_BIT_RATE,
+	CS_COL_SECURE,
+	CS_COL_HOSTNAME,
+	CS_COL_PRESENCE_ID,
+	CS_COL_PRESENCE_DATA,
+	CS_COL_ACCOUNTCODE,
+	CS_COL_CALLSTATE,
+	CS_COL_CALLEE_NAME,
+	CS_COL_CALLEE_NUM,
+	CS_COL_CALLEE_DIRECTION,
+	CS_COL_CALL_UUID,
+	CS_COL_SENT_CALLEE_NAME,
+	CS_COL_SENT_CALLEE_NUM,
+	CS_COL_INITIAL_CID_NAME,
+	CS_COL_INITIAL_CID_NUM,
+	CS_COL_INITIAL_IP_ADDR,
+	CS_COL_INITIAL_DEST,
+	CS_COL_INITIAL_DIALPLAN,
+	CS_COL_INITIAL_CONTEXT,
+	CS_COL_MAX
+} cs_col_t;
+
+static const char *CS_COL_NAMES[CS_COL_MAX] = {
+	"uuid", "direction", "created", "created_epoch", "name", "state", "cid_name", "cid_num", "ip_addr", "dest",
+	"application", "application_data", "dialplan", "context", "read_codec", "read_rate", "read_bit_rate",
+	"write_codec", "write_rate", "write_bit_rate", "secure", "hostname", "presence_id", "presence_data",
+	"accountcode", "callstate", "callee_name", "callee_num", "callee_direction", "call_uuid", "sent_callee_name",
+	"sent_callee_num", "initial_cid_name", "initial_cid_num", "initial_ip_addr", "initial_dest", "initial_dialplan",
+	"initial_context"
+};
 
-static void core_event_handler(switch_event_t *event)
-{
-	char *sql[MAX_SQL] = { 0 };
-	int sql_idx = 0;
-	char *extra_cols;
-	int exists = 1;
-	char *uuid = NULL;
+/* secondary indexes, each a hash of value -> chain of rows */
+typedef enum {
+	CS_IDX_CALL_UUID,
+	CS_IDX_HOSTNAME,
+	CS_IDX_STATE,
+	CS_IDX_MAX
+} cs_idx_t;
+
+static const cs_col_t CS_IDX_COL[CS_IDX_MAX] = { CS_COL_CALL_UUID, CS_COL_HOSTNAME, CS_COL_STATE };
+
+typedef enum {
+	CS_CALL_CALL_UUID,
+	CS_CALL_CREATED,
+	CS_CALL_CREATED_EPOCH,
+	CS_CALL_CALLER_UUID,
+	CS_CALL_CALLEE_UUID,
+	CS_CALL_HOSTNAME,
+	CS_CALL_MAX
+} cs_call_col_t;
+
+typedef struct cs_call_s {
+	char *col[CS_CALL_MAX];
+	uint64_t seq;
+} cs_call_t;
+
+typedef struct cs_row_s cs_row_t;
+struct cs_row_s {
+	char *col[CS_COL_MAX];
+	uint64_t seq;
+	cs_row_t *next;
+	cs_row_t *prev;
+	cs_row_t *inext[CS_IDX_MAX];
+	cs_row_t *iprev[CS_IDX_MAX];
+};
 
-	switch_assert(event);
+typedef enum {
+	CS_OP_CREATE,
+	CS_OP_DELETE,
+	CS_OP_RENAME,
+	CS_OP_CALL_UUID_RENAME,
+	CS_OP_UPDATE,
+	CS_OP_BRIDGE,
+	CS_OP_UNBRIDGE,
+	CS_OP_CALL_INSERT,
+	CS_OP_CALL_DELETE
+} cs_op_t;
+
+#define CS_MAX_STMT_COLS 16
+
+/* what each core statement does to the store, cols are the columns its leading ? set */
+static const struct {
+	cs_op_t op;
+	int ncols;
+	cs_col_t cols[CS_MAX_STMT_COLS];
+} CS_STMT_OPS[CORE_STMT_MAX] = {
+	/* CORE_STMT_CHANNEL_CREATE */
+	{ CS_OP_CREATE, 16, { CS_COL_UUID, CS_COL_DIRECTION, CS_COL_CREATED, CS_COL_CREATED_EPOCH, CS_COL_NAME, CS_COL_STATE,
+						  CS_COL_CALLSTATE, CS_COL_DIALPLAN, CS_COL_CONTEXT, CS_COL_HOSTNAME, CS_COL_INITIAL_CID_NAME,
+						  CS_COL_INITIAL_CID_NUM, CS_COL_INITIAL_IP_ADDR, CS_COL_INITIAL_DEST, CS_COL_INITIAL_DIALPLAN,
+						  CS_COL_INITIAL_CONTEXT } },
+	/* CORE_STMT_CHANNEL_DELETE */
+	{ CS_OP_DELETE, 0, { 0 } },
+	/* CORE_STMT_CHANNEL_UUID */
+	{ CS_OP_RENAME, 0, { 0 } },
+	/* CORE_STMT_CHANNEL_CALL_UUID_RENAME */
+	{ CS_OP_CALL_UUID_RENAME, 0, { 0 } },
+	/* CORE_STMT_CHANNEL_CODEC */
+	{ CS_OP_UPDATE, 6, { CS_COL_READ_CODEC, CS_COL_READ_RATE, CS_COL_READ_BIT_RATE, CS_COL_WRITE_CODEC, CS_COL_WRITE_RATE,
+						 CS_COL_WRITE_BIT_RATE } },
+	/* CORE_STMT_CHANNEL_APPLICATION */
+	{ CS_OP_UPDATE, 5, { CS_COL_APPLICATION, CS_COL_APPLICATION_DATA, CS_COL_PRESENCE_ID, CS_COL_PRESENCE_DATA,
+						 CS_COL_ACCOUNTCODE } },
+	/* CORE_STMT_CHANNEL_CALL_UPDATE */
+	{ CS_OP_UPDATE, 7, { CS_COL_CALLEE_NAME, CS_COL_CALLEE_NUM, CS_COL_SENT_CALLEE_NAME, CS_COL_SENT_CALLEE_NUM,
+						 CS_COL_CALLEE_DIRECTION, CS_COL_CID_NAME, CS_COL_CID_NUM } },
+	/* CORE_STMT_CHANNEL_CALLSTATE */
+	{ CS_OP_UPDATE, 1, { CS_COL_CALLSTATE } },
+	/* CORE_STMT_CHANNEL_STATE */
+	{ CS_OP_UPDATE, 1, { CS_COL_STATE } },
+	/* CORE_STMT_CHANNEL_STATE_ROUTING */
+	{ CS_OP_UPDATE, 14, { CS_COL_STATE, CS_COL_CID_NAME, CS_COL_CID_NUM, CS_COL_CALLEE_NAME, CS_COL_CALLEE_NUM,
+						  CS_COL_SENT_CALLEE_NAME, CS_COL_SENT_CALLEE_NUM, CS_COL_IP_ADDR, CS_COL_DEST, CS_COL_DIALPLAN,
+						  CS_COL_CONTEXT, CS_COL_PRESENCE_ID, CS_COL_PRESENCE_DATA, CS_COL_ACCOUNTCODE } },
+	/* CORE_STMT_CHANNEL_BRIDGE */
+	{ CS_OP_BRIDGE, 0, { 0 } },
+	/* CORE_STMT_CHANNEL_UNBRIDGE */
+	{ CS_OP_UNBRIDGE, 0, { 0 } },
+	/* CORE_STMT_CHANNEL_ORIGINATE */
+	{ CS_OP_UPDATE, 4, { CS_COL_PRESENCE_ID, CS_COL_PRESENCE_DATA, CS_COL_ACCOUNTCODE, CS_COL_CALL_UUID } },
+	/* CORE_STMT_CHANNEL_SECURE */
+	{ CS_OP_UPDATE, 1, { CS_COL_SECURE } },
+	/* CORE_STMT_CALLS_INSERT */
+	{ CS_OP_CALL_INSERT, 0, { 0 } },
+	/* CORE_STMT_CALLS_DELETE */
+	{ CS_OP_CALL_DELETE, 0, { 0 } }
+};
 
-	switch (event->event_id) {
-	case SWITCH_EVENT_CHANNEL_UUID:
-	case SWITCH_EVENT_CHANNEL_CREATE:
-	case SWITCH_EVENT_CHANNEL_ANSWER:
-	case SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA:
-	case SWITCH_EVENT_CHANNEL_HOLD:
-	case SWITCH_EVENT_CHANNEL_UNHOLD:
-	case SWITCH_EVENT_CHANNEL_EXECUTE:
-	case SWITCH_EVENT_CHANNEL_ORIGINATE:
-	case SWITCH_EVENT_CALL_UPDATE:
-	case SWITCH_EVENT_CHANNEL_CALLSTATE:
-	case SWITCH_EVENT_CHANNEL_STATE:
-	case SWITCH_EVENT_CHANNEL_BRIDGE:
-	case SWITCH_EVENT_CHANNEL_UNBRIDGE:
-	case SWITCH_EVENT_CALL_SECURE:
-		{
-			if ((uuid = switch_event_get_header(event, "unique-id"))) {
-				exists = switch_ivr_uuid_exists(uuid);
-			}
-		}
-		break;
-	default:
-		break;
-	}
+#define CS_VIEW_MAX_COLS 96
 
-	switch (event->event_id) {
-	case SWITCH_EVENT_ADD_SCHEDULE:
-		{
-			const char *id = switch_event_get_header(event, "task-id");
+typedef struct {
+	int count;
+	char src[CS_VIEW_MAX_COLS];
+	int col[CS_VIEW_MAX_COLS];
+	char *name[CS_VIEW_MAX_COLS];
+} cs_view_t;
+
+typedef struct {
+	cs_row_t *a;
+	cs_row_t *b;
+	cs_call_t *c;
+	long created;
+	long call_created;
+} cs_match_t;
+
+static struct {
+	switch_thread_rwlock_t *rwlock;
+	switch_hash_t *rows;
+	switch_hash_t *index[CS_IDX_MAX];
+	switch_hash_t *callers;
+	switch_hash_t *callees;
+	cs_row_t *head;
+	cs_row_t *tail;
+	uint32_t count;
+	uint64_t seq;
+	int argc[CORE_STMT_MAX];
+	cs_view_t views[SCS_VIEW_MAX];
+	int running;
+} channel_store;
+
+static int cs_col_index(int col)
+{
+	int i;
+
+	for (i = 0; i < CS_IDX_MAX; i++) {
+		if ((int) CS_IDX_COL[i] == col) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static void cs_index_unlink(cs_row_t *row, int idx)
+{
+	const char *key = row->col[CS_IDX_COL[idx]];
+
+	if (!key) {
+		return;
+	}
+
+	if (row->iprev[idx]) {
+		row->iprev[idx]->inext[idx] = row->inext[idx];
+	} else if (row->inext[idx]) {
+		switch_core_hash_insert(channel_store.index[idx], key, row->inext[idx]);
+	} else {
+		switch_core_hash_delete(channel_store.index[idx], key);
+	}
+
+	if (row->inext[idx]) {
+		row->inext[idx]->iprev[idx] = row->iprev[idx];
+	}
+
+	row->inext[idx] = row->iprev[idx] = NULL;
+}
+
+static void cs_index_link(cs_row_t *row, int idx)
+{
+	const char *key = row->col[CS_IDX_COL[idx]];
+	cs_row_t *head;
+
+	if (!key) {
+		return;
+	}
+
+	if ((head = switch_core_hash_find(channel_store.index[idx], key))) {
+		head->iprev[idx] = row;
+		row->inext[idx] = head;
+	}
+
+	switch_core_hash_insert(channel_store.index[idx], key, row);
+}
+
+static void cs_set(cs_row_t *row, int col, const char *val)
+{
+	int idx;
+
+	if (row->col[col] && val && !strcmp(row->col[col], val)) {
+		return;
+	}
+
+	if ((idx = cs_col_index(col)) > -1) {
+		cs_index_unlink(row, idx);
+	}
+
+	switch_safe_free(row->col[col]);
+	row->col[col] = val ? strdup(val) : NULL;
+
+	if (idx > -1) {
+		cs_index_link(row, idx);
+	}
+}
+
+static void cs_row_delete(cs_row_t *row)
+{
+	int i;
+
+	for (i = 0; i < CS_IDX_MAX; i++) {
+		cs_index_unlink(row, i);
+	}
+
+	if (row->col[CS_COL_UUID]) {
+		switch_core_hash_delete(channel_store.rows, row->col[CS_COL_UUID]);
+	}
+
+	if (row->prev) {
+		row->prev->next = row->next;
+	} else {
+		channel_store.head = row->next;
+	}
+
+	if (row->next) {
+		row->next->prev = row->prev;
+	} else {
+		channel_store.tail = row->prev;
+	}
+
+	for (i = 0; i < CS_COL_MAX; i++) {
+		switch_safe_free(row->col[i]);
+	}
+
+	channel_store.count--;
+	free(row);
+}
+
+static void cs_call_delete(cs_call_t *call)
+{
+	int i;
+
+	if (call->col[CS_CALL_CALLER_UUID] && switch_core_hash_find(channel_store.callers, call->col[CS_CALL_CALLER_UUID]) == call) {
+		switch_core_hash_delete(channel_store.callers, call->col[CS_CALL_CALLER_UUID]);
+	}
+
+	if (call->col[CS_CALL_CALLEE_UUID] && switch_core_hash_find(channel_store.callees, call->col[CS_CALL_CALLEE_UUID]) == call) {
+		switch_core_hash_delete(channel_store.callees, call->col[CS_CALL_CALLEE_UUID]);
+	}
+
+	for (i = 0; i < CS_CALL_MAX; i++) {
+		switch_safe_free(call->col[i]);
+	}
+
+	free(call);
+}
+
+/* re-point every row on one call_uuid chain, to_uuid NULL means each row's own uuid */
+static void cs_call_uuid_move(const char *from, const char *to)
+{
+	cs_row_t *row, *next;
+
+	if (zstr(from)) {
+		return;
+	}
+
+	for (row = switch_core_hash_find(channel_store.index[CS_IDX_CALL_UUID], from); row; row = next) {
+		next = row->inext[CS_IDX_CALL_UUID];
+		cs_set(row, CS_COL_CALL_UUID, to ? to : row->col[CS_COL_UUID]);
+	}
+}
+
+static void channel_store_apply(core_stmt_t s, const char **argv)
+{
+	int ncols = CS_STMT_OPS[s].ncols;
+	cs_row_t *row;
+	cs_call_t *call;
+	int i;
+
+	if (!channel_store.running) {
+		return;
+	}
+
+	switch_thread_rwlock_wrlock(channel_store.rwlock);
+
+	/* channel threads race channel_store_destroy here, look again under the lock */
+	if (!channel_store.running) {
+		switch_thread_rwlock_unlock(channel_store.rwlock);
+		return;
+	}
+
+	switch (CS_STMT_OPS[s].op) {
+	case CS_OP_CREATE:
+		if (zstr(argv[0])) {
+			break;
+		}
+
+		if ((row = switch_core_hash_find(channel_store.rows, argv[0]))) {
+			cs_row_delete(row);
+		}
+
+		switch_zmalloc(row, sizeof(*row));
+		row->seq = ++channel_store.seq;
+
+		if ((row->prev = channel_store.tail)) {
+			channel_store.tail->next = row;
+		} else {
+			channel_store.head = row;
+		}
+		channel_store.tail = row;
+		channel_store.count++;
+
+		for (i = 0; i < ncols; i++) {
+			cs_set(row, CS_STMT_OPS[s].cols[i], argv[i]);
+		}
+
+		switch_core_hash_insert(channel_store.rows, row->col[CS_COL_UUID], row);
+		break;
+	case CS_OP_DELETE:
+		if (!zstr(argv[0]) && (row = switch_core_hash_find(channel_store.rows, argv[0]))) {
+			cs_row_delete(row);
+		}
+		break;
+	case CS_OP_RENAME:
+		if (!zstr(argv[0]) && !zstr(argv[1]) && (row = switch_core_hash_find(channel_store.rows, argv[1]))) {
+			switch_core_hash_delete(channel_store.rows, argv[1]);
+			cs_set(row, CS_COL_UUID, argv[0]);
+			switch_core_hash_insert(channel_store.rows, argv[0], row);
+		}
+		break;
+	case CS_OP_CALL_UUID_RENAME:
+		cs_call_uuid_move(argv[1], argv[0]);
+		break;
+	case CS_OP_UPDATE:
+		if (!zstr(argv[ncols]) && (row = switch_core_hash_find(channel_store.rows, argv[ncols]))) {
+			for (i = 0; i < ncols; i++) {
+				cs_set(row, CS_STMT_OPS[s].cols[i], argv[i]);
+			}
+		}
+		break;
+	case CS_OP_BRIDGE:
+		for (i = 1; i < 3; i++) {
+			if (!zstr(argv[i]) && (row = switch_core_hash_find(channel_store.rows, argv[i]))) {
+				cs_set(row, CS_COL_CALL_UUID, argv[0]);
+			}
+		}
+		break;
+	case CS_OP_UNBRIDGE:
+		cs_call_uuid_move(argv[0], NULL);
+		break;
+	case CS_OP_CALL_INSERT:
+		if (zstr(argv[CS_CALL_CALLER_UUID])) {
+			break;
+		}
+
+		if ((call = switch_core_hash_find(channel_store.callers, argv[CS_CALL_CALLER_UUID]))) {
+			cs_call_delete(call);
+		}
+
+		if (!zstr(argv[CS_CALL_CALLEE_UUID]) && (call = switch_core_hash_find(channel_store.callees, argv[CS_CALL_CALLEE_UUID]))) {
+			cs_call_delete(call);
+		}
+
+		switch_zmalloc(call, sizeof(*call));
+		call->seq = ++channel_store.seq;
+
+		for (i = 0; i < CS_CALL_MAX; i++) {
+			call->col[i] = argv[i] ? strdup(argv[i]) : NULL;
+		}
+
+		switch_core_hash_insert(channel_store.callers, call->col[CS_CALL_CALLER_UUID], call);
+
+		if (!zstr(call->col[CS_CALL_CALLEE_UUID])) {
+			switch_core_hash_insert(channel_store.callees, call->col[CS_CALL_CALLEE_UUID], call);
+		}
+		break;
+	case CS_OP_CALL_DELETE:
+		if (!zstr(argv[0]) && (call = switch_core_hash_find(channel_store.callers, argv[0]))) {
+			cs_call_delete(call);
+		}
+		if (!zstr(argv[1]) && (call = switch_core_hash_find(channel_store.callees, argv[1]))) {
+			cs_call_delete(call);
+		}
+		break;
+	}
+
+	switch_thread_rwlock_unlock(channel_store.rwlock);
+}
+
+static void channel_store_flush(void)
+{
+	switch_hash_index_t *hi;
+	void *val;
+
+	if (!channel_store.running) {
+		return;
+	}
+
+	switch_thread_rwlock_wrlock(channel_store.rwlock);
+
+	while (channel_store.head) {
+		cs_row_delete(channel_store.head);
+	}
+
+	while ((hi = switch_core_hash_first(channel_store.callers))) {
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		free(hi);
+		cs_call_delete((cs_call_t *) val);
+	}
+
+	while ((hi = switch_core_hash_first(channel_store.callees))) {
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		free(hi);
+		cs_call_delete((cs_call_t *) val);
+	}
+
+	switch_thread_rwlock_unlock(channel_store.rwlock);
+}
+
+static void cs_view_add(cs_view_t *view, char src, int col, const char *name)
+{
+	switch_assert(view->count < CS_VIEW_MAX_COLS);
+	view->src[view->count] = src;
+	view->col[view->count] = col;
+	view->name[view->count] = switch_core_sprintf(sql_manager.memory_pool, "%s%s", src == 'b' ? "b_" : "", name);
+	view->count++;
+}
+
+/* column lists must match basic_calls_sql and detailed_calls_sql */
+static void cs_views_init(void)
+{
+	static const cs_col_t basic_a[] = {
+		CS_COL_UUID, CS_COL_DIRECTION, CS_COL_CREATED, CS_COL_CREATED_EPOCH, CS_COL_NAME, CS_COL_STATE, CS_COL_CID_NAME,
+		CS_COL_CID_NUM, CS_COL_IP_ADDR, CS_COL_DEST, CS_COL_PRESENCE_ID, CS_COL_PRESENCE_DATA, CS_COL_ACCOUNTCODE,
+		CS_COL_CALLSTATE, CS_COL_CALLEE_NAME, CS_COL_CALLEE_NUM, CS_COL_CALLEE_DIRECTION, CS_COL_CALL_UUID,
+		CS_COL_HOSTNAME, CS_COL_SENT_CALLEE_NAME, CS_COL_SENT_CALLEE_NUM
+	};
+	static const cs_col_t basic_b[] = {
+		CS_COL_UUID, CS_COL_DIRECTION, CS_COL_CREATED, CS_COL_CREATED_EPOCH, CS_COL_NAME, CS_COL_STATE, CS_COL_CID_NAME,
+		CS_COL_CID_NUM, CS_COL_IP_ADDR, CS_COL_DEST, CS_COL_PRESENCE_ID, CS_COL_PRESENCE_DATA, CS_COL_ACCOUNTCODE,
+		CS_COL_CALLSTATE, CS_COL_CALLEE_NAME, CS_COL_CALLEE_NUM, CS_COL_CALLEE_DIRECTION, CS_COL_SENT_CALLEE_NAME,
+		CS_COL_SENT_CALLEE_NUM
+	};
+	cs_view_t *view;
+	int i;
+
+	view = &channel_store.views[SCS_VIEW_CHANNELS];
+	for (i = 0; i < CS_COL_MAX; i++) {
+		cs_view_add(view, 'a', i, CS_COL_NAMES[i]);
+	}
+
+	view = &channel_store.views[SCS_VIEW_BASIC_CALLS];
+	for (i = 0; i < (int) (sizeof(basic_a) / sizeof(basic_a[0])); i++) {
+		cs_view_add(view, 'a', basic_a[i], CS_COL_NAMES[basic_a[i]]);
+	}
+	for (i = 0; i < (int) (sizeof(basic_b) / sizeof(basic_b[0])); i++) {
+		cs_view_add(view, 'b', basic_b[i], CS_COL_NAMES[basic_b[i]]);
+	}
+	cs_view_add(view, 'c', CS_CALL_CREATED_EPOCH, "call_created_epoch");
+
+	view = &channel_store.views[SCS_VIEW_DETAILED_CALLS];
+	for (i = 0; i <= CS_COL_SENT_CALLEE_NUM; i++) {
+		cs_view_add(view, 'a', i, CS_COL_NAMES[i]);
+	}
+	for (i = 0; i <= CS_COL_SENT_CALLEE_NUM; i++) {
+		cs_view_add(view, 'b', i, CS_COL_NAMES[i]);
+	}
+	cs_view_add(view, 'c', CS_CALL_CREATED_EPOCH, "call_created_epoch");
+}
+
+static void channel_store_init(void)
+{
+	const char *p;
+	int i;
+
+	memset(&channel_store, 0, sizeof(channel_store));
+
+	switch_thread_rwlock_create(&channel_store.rwlock, sql_manager.memory_pool);
+	switch_core_hash_init(&channel_store.rows);
+	switch_core_hash_init(&channel_store.callers);
+	switch_core_hash_init(&channel_store.callees);
+
+	for (i = 0; i < CS_IDX_MAX; i++) {
+		switch_core_hash_init(&channel_store.index[i]);
+	}
+
+	for (i = 0; i < CORE_STMT_MAX; i++) {
+		for (p = CORE_STMT_SQL[i]; *p; p++) {
+			if (*p == '?') {
+				channel_store.argc[i]++;
+			}
+		}
+	}
+
+	cs_views_init();
+
+	channel_store.running = 1;
+}
+
+static void channel_store_destroy(void)
+{
+	int i;
+
+	if (!channel_store.running) {
+		return;
+	}
+
+	channel_store_flush();
+
+	switch_thread_rwlock_wrlock(channel_store.rwlock);
+	channel_store.running = 0;
+	switch_thread_rwlock_unlock(channel_store.rwlock);
+
+	switch_core_hash_destroy(&channel_store.rows);
+	switch_core_hash_destroy(&channel_store.callers);
+	switch_core_hash_destroy(&channel_store.callees);
+
+	for (i = 0; i < CS_IDX_MAX; i++) {
+		switch_core_hash_destroy(&channel_store.index[i]);
+	}
+}
+
+/* sql LIKE semantics: % any run, _ any char, ascii case folded like sqlite */
+static int cs_like(const char *str, const char *pat)
+{
+	for (; *pat; pat++, str++) {
+		if (*pat == '%') {
+			while (*pat == '%') {
+				pat++;
+			}
+
+			if (!*pat) {
+				return 1;
+			}
+
+			for (; *str; str++) {
+				/* only recurse where the next literal can start */
+				if ((*pat == '_' || tolower((unsigned char) *pat) == tolower((unsigned char) *str)) && cs_like(str, pat)) {
+					return 1;
+				}
+			}
+
+			return 0;
+		}
+
+		if (!*str || (*pat != '_' && tolower((unsigned char) *pat) != tolower((unsigned char) *str))) {
+			return 0;
+		}
+	}
+
+	return !*str;
+}
+
+/* like is the full pattern, show channels like wraps a pattern without % in %...% before it gets here */
+static switch_bool_t cs_row_like(cs_row_t *row, const char *like)
+{
+	static const cs_col_t cols[] = { CS_COL_UUID, CS_COL_NAME, CS_COL_CID_NAME, CS_COL_CID_NUM, CS_COL_PRESENCE_DATA, CS_COL_ACCOUNTCODE };
+	int i;
+
+	for (i = 0; i < (int) (sizeof(cols) / sizeof(cols[0])); i++) {
+		const char *val = row->col[cols[i]];
+
+		if (val && cs_like(val, like)) {
+			return SWITCH_TRUE;
+		}
+	}
+
+	return SWITCH_FALSE;
+}
+
+/* order by created_epoch like the sql, insertion order breaks the ties within a second */
+static int cs_match_cmp_created(const void *pa, const void *pb)
+{
+	const cs_match_t *a = pa, *b = pb;
+
+	if (a->created != b->created) {
+		return a->created < b->created ? -1 : 1;
+	}
+
+	return a->a->seq < b->a->seq ? -1 : a->a->seq > b->a->seq;
+}
+
+/* order by call_created_epoch, rows without a call (null in the sql) first */
+static int cs_match_cmp_call(const void *pa, const void *pb)
+{
+	const cs_match_t *a = pa, *b = pb;
+
+	if (!a->c != !b->c) {
+		return a->c ? 1 : -1;
+	}
+
+	if (a->c && a->call_created != b->call_created) {
+		return a->call_created < b->call_created ? -1 : 1;
+	}
+
+	if (a->c && a->c->seq != b->c->seq) {
+		return a->c->seq < b->c->seq ? -1 : 1;
+	}
+
+	return cs_match_cmp_created(pa, pb);
+}
+
+static const char *cs_match_col(const cs_match_t *match, const cs_view_t *view, int x)
+{
+	switch (view->src[x]) {
+	case 'a':
+		return match->a->col[view->col[x]];
+	case 'b':
+		return match->b ? match->b->col[view->col[x]] : NULL;
+	default:
+		return match->c ? match->c->col[view->col[x]] : NULL;
+	}
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_channel_store_query(const switch_channel_store_query_t *query,
+																switch_core_db_callback_func_t callback, void *pArg)
+{
+	cs_view_t *view;
+	cs_match_t *matches = NULL;
+	cs_row_t *row;
+	int idx = -1, n = 0, i, x;
+	const char *key = NULL;
+	char **rows = NULL;
+	char *like = NULL;
+
+	if (!channel_store.running || !query || query->view >= SCS_VIEW_MAX || !callback) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	view = &channel_store.views[query->view];
+
+	if (!zstr(query->like)) {
+		like = strchr(query->like, '%') ? strdup(query->like) : switch_mprintf("%%%s%%", query->like);
+	}
+
+	/* walk the narrowest index the filter allows */
+	if (query->call_uuid) {
+		idx = CS_IDX_CALL_UUID;
+		key = query->call_uuid;
+	} else if (query->state) {
+		idx = CS_IDX_STATE;
+		key = query->state;
+	} else if (query->hostname) {
+		idx = CS_IDX_HOSTNAME;
+		key = query->hostname;
+	}
+
+	switch_thread_rwlock_rdlock(channel_store.rwlock);
+
+	if (channel_store.count) {
+		switch_zmalloc(matches, sizeof(*matches) * channel_store.count);
+	}
+
+	for (row = idx > -1 ? switch_core_hash_find(channel_store.index[idx], key) : channel_store.head; row;
+		 row = idx > -1 ? row->inext[idx] : row->next) {
+		cs_call_t *call = NULL;
+		cs_row_t *b = NULL;
+
+		if ((query->hostname && (!row->col[CS_COL_HOSTNAME] || strcmp(query->hostname, row->col[CS_COL_HOSTNAME]))) ||
+			(query->state && (!row->col[CS_COL_STATE] || strcmp(query->state, row->col[CS_COL_STATE]))) ||
+			(query->call_uuid && (!row->col[CS_COL_CALL_UUID] || strcmp(query->call_uuid, row->col[CS_COL_CALL_UUID]))) ||
+			(like && !cs_row_like(row, like))) {
+			continue;
+		}
+
+		if (query->view != SCS_VIEW_CHANNELS) {
+			/* callers carry the call, callees only show up on their caller's row */
+			if ((call = switch_core_hash_find(channel_store.callers, row->col[CS_COL_UUID]))) {
+				if (call->col[CS_CALL_CALLEE_UUID]) {
+					b = switch_core_hash_find(channel_store.rows, call->col[CS_CALL_CALLEE_UUID]);
+				}
+			} else if (switch_core_hash_find(channel_store.callees, row->col[CS_COL_UUID])) {
+				continue;
+			}
+
+			if ((query->flags & SCSQ_BRIDGED) && !b) {
+				continue;
+			}
+		}
+
+		matches[n].a = row;
+		matches[n].b = b;
+		matches[n].c = call;
+		matches[n].created = row->col[CS_COL_CREATED_EPOCH] ? atol(row->col[CS_COL_CREATED_EPOCH]) : 0;
+		matches[n].call_created = call && call->col[CS_CALL_CREATED_EPOCH] ? atol(call->col[CS_CALL_CREATED_EPOCH]) : 0;
+		n++;
+	}
+
+	if (!(query->flags & SCSQ_COUNT) && n) {
+		switch_size_t len = 0;
+		char *p;
+
+		if (n > 1) {
+			qsort(matches, n, sizeof(*matches), (query->flags & SCSQ_ORDER_CALL) ? cs_match_cmp_call : cs_match_cmp_created);
+		}
+
+		/* copy the rows out in one block so the callbacks run after the writers are let back in */
+		for (i = 0; i < n; i++) {
+			for (x = 0; x < view->count; x++) {
+				const char *val = cs_match_col(&matches[i], view, x);
+
+				if (val) {
+					len += strlen(val) + 1;
+				}
+			}
+		}
+
+		switch_zmalloc(rows, sizeof(char *) * n * view->count + len);
+		p = (char *) (rows + n * view->count);
+
+		for (i = 0; i < n; i++) {
+			for (x = 0; x < view->count; x++) {
+				const char *val = cs_match_col(&matches[i], view, x);
+
+				if (val) {
+					len = strlen(val) + 1;
+					memcpy(p, val, len);
+					rows[i * view->count + x] = p;
+					p += len;
+				}
+			}
+		}
+	}
+
+	switch_thread_rwlock_unlock(channel_store.rwlock);
+
+	if (query->flags & SCSQ_COUNT) {
+		char count[32];
+		char *count_argv[1];
+		char *count_name[1] = { "count(*)" };
+
+		switch_snprintf(count, sizeof(count), "%d", n);
+		count_argv[0] = count;
+		callback(pArg, 1, count_argv, count_name);
+	} else {
+		for (i = 0; i < n; i++) {
+			if (callback(pArg, view->count, rows + i * view->count, view->name)) {
+				break;
+			}
+		}
+	}
+
+	switch_safe_free(rows);
+	switch_safe_free(matches);
+	switch_safe_free(like);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+/* queue a core statement to the db unless sql is off or the channel sql mirror is disabled, the store got it at fire time */
+static void core_stmt_run(core_stmt_t s, switch_bool_t sql, ...)
+{
+	const char *args[SWITCH_ODBC_MAX_PARAMS];
+	va_list ap;
+	int i;
+
+	if (!sql || !sql_manager.qm || switch_test_flag((&runtime), SCF_NO_CHANNEL_SQL)) {
+		return;
+	}
+
+	va_start(ap, sql);
+	for (i = 0; i < channel_store.argc[s]; i++) {
+		args[i] = va_arg(ap, const char *);
+	}
+	va_end(ap);
+
+	qm_push_bound(core_stmt(s), args);
+}
+
+/* apply a core statement to the store only, same arguments as its sql */
+static void cs_stmt_run(core_stmt_t s, ...)
+{
+	const char *args[SWITCH_ODBC_MAX_PARAMS];
+	va_list ap;
+	int i;
+
+	va_start(ap, s);
+	for (i = 0; i < channel_store.argc[s]; i++) {
+		args[i] = va_arg(ap, const char *);
+	}
+	va_end(ap);
+
+	channel_store_apply(s, args);
+}
+
+/*
+  switch_event_fire calls this on the firing thread, before the event is queued, so the store follows the channel
+  the moment switch_channel changes state instead of whenever a dispatch thread gets to core_event_handler.
+  The statements and their columns are the ones core_event_handler queues to the db.
+*/
+void switch_core_channel_store_event(switch_event_t *event)
+{
+	const char *uuid;
+
+	if (!channel_store.running) {
+		return;
+	}
+
+	uuid = switch_event_get_header_nil(event, "unique-id");
+
+	switch (event->event_id) {
+	case SWITCH_EVENT_CHANNEL_DESTROY:
+		cs_stmt_run(CORE_STMT_CHANNEL_DELETE, uuid);
+		cs_stmt_run(CORE_STMT_CALLS_DELETE, uuid, uuid);
+		break;
+	case SWITCH_EVENT_CHANNEL_UUID:
+		cs_stmt_run(CORE_STMT_CHANNEL_UUID, uuid, switch_event_get_header_nil(event, "old-unique-id"));
+		cs_stmt_run(CORE_STMT_CHANNEL_CALL_UUID_RENAME, uuid, switch_event_get_header_nil(event, "old-unique-id"));
+		break;
+	case SWITCH_EVENT_CHANNEL_CREATE:
+		{
+			char epoch[32];
+
+			switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+			cs_stmt_run(CORE_STMT_CHANNEL_CREATE,
+						uuid,
+						switch_event_get_header_nil(event, "call-direction"),
+						switch_event_get_header_nil(event, "event-date-local"),
+						epoch,
+						switch_event_get_header_nil(event, "channel-name"),
+						switch_event_get_header_nil(event, "channel-state"),
+						switch_event_get_header_nil(event, "channel-call-state"),
+						switch_event_get_header_nil(event, "caller-dialplan"),
+						switch_event_get_header_nil(event, "caller-context"), switch_core_get_switchname(),
+						switch_event_get_header_nil(event, "caller-caller-id-name"),
+						switch_event_get_header_nil(event, "caller-caller-id-number"),
+						switch_event_get_header_nil(event, "caller-network-addr"),
+						switch_event_get_header_nil(event, "caller-destination-number"),
+						switch_event_get_header_nil(event, "caller-dialplan"),
+						switch_event_get_header_nil(event, "caller-context"));
+		}
+		break;
+	case SWITCH_EVENT_CHANNEL_ANSWER:
+	case SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA:
+	case SWITCH_EVENT_CODEC:
+		cs_stmt_run(CORE_STMT_CHANNEL_CODEC,
+					switch_event_get_header_nil(event, "channel-read-codec-name"),
+					switch_event_get_header_nil(event, "channel-read-codec-rate"),
+					switch_event_get_header_nil(event, "channel-read-codec-bit-rate"),
+					switch_event_get_header_nil(event, "channel-write-codec-name"),
+					switch_event_get_header_nil(event, "channel-write-codec-rate"),
+					switch_event_get_header_nil(event, "channel-write-codec-bit-rate"),
+					uuid);
+		break;
+	case SWITCH_EVENT_CHANNEL_HOLD:
+	case SWITCH_EVENT_CHANNEL_UNHOLD:
+	case SWITCH_EVENT_CHANNEL_EXECUTE:
+		cs_stmt_run(CORE_STMT_CHANNEL_APPLICATION,
+					switch_event_get_header_nil(event, "application"),
+					switch_event_get_header_nil(event, "application-data"),
+					switch_event_get_header_nil(event, "channel-presence-id"),
+					switch_event_get_header_nil(event, "channel-presence-data"),
+					switch_event_get_header_nil(event, "variable_accountcode"),
+					uuid);
+		break;
+	case SWITCH_EVENT_CHANNEL_ORIGINATE:
+		cs_stmt_run(CORE_STMT_CHANNEL_ORIGINATE,
+					switch_event_get_header_nil(event, "channel-presence-id"),
+					switch_event_get_header_nil(event, "channel-presence-data"),
+					switch_event_get_header_nil(event, "variable_accountcode"),
+					switch_event_get_header_nil(event, "channel-call-uuid"),
+					uuid);
+		break;
+	case SWITCH_EVENT_CALL_UPDATE:
+		cs_stmt_run(CORE_STMT_CHANNEL_CALL_UPDATE,
+					switch_event_get_header_nil(event, "caller-callee-id-name"),
+					switch_event_get_header_nil(event, "caller-callee-id-number"),
+					switch_event_get_header_nil(event, "sent-callee-id-name"),
+					switch_event_get_header_nil(event, "sent-callee-id-number"),
+					switch_event_get_header_nil(event, "direction"),
+					switch_event_get_header_nil(event, "caller-caller-id-name"),
+					switch_event_get_header_nil(event, "caller-caller-id-number"),
+					uuid);
+		break;
+	case SWITCH_EVENT_CHANNEL_CALLSTATE:
+		{
+			const char *num = switch_event_get_header(event, "channel-call-state-number");
+			switch_channel_callstate_t callstate = num ? atoi(num) : CCS_DOWN;
+
+			if (callstate != CCS_DOWN && callstate != CCS_HANGUP) {
+				cs_stmt_run(CORE_STMT_CHANNEL_CALLSTATE, switch_event_get_header_nil(event, "channel-call-state"), uuid);
+			}
+		}
+		break;
+	case SWITCH_EVENT_CHANNEL_STATE:
+		{
+			const char *state = switch_event_get_header_nil(event, "channel-state-number");
+			switch_channel_state_t state_i = zstr(state) ? CS_DESTROY : atoi(state);
+
+			switch (state_i) {
+			case CS_NEW:
+			case CS_DESTROY:
+			case CS_REPORTING:
+			case CS_HANGUP:
+			case CS_INIT:
+				break;
+			case CS_ROUTING:
+				cs_stmt_run(CORE_STMT_CHANNEL_STATE_ROUTING,
+							switch_event_get_header_nil(event, "channel-state"),
+							switch_event_get_header_nil(event, "caller-caller-id-name"),
+							switch_event_get_header_nil(event, "caller-caller-id-number"),
+							switch_event_get_header_nil(event, "caller-callee-id-name"),
+							switch_event_get_header_nil(event, "caller-callee-id-number"),
+							switch_event_get_header_nil(event, "sent-callee-id-name"),
+							switch_event_get_header_nil(event, "sent-callee-id-number"),
+							switch_event_get_header_nil(event, "caller-network-addr"),
+							switch_event_get_header_nil(event, "caller-destination-number"),
+							switch_event_get_header_nil(event, "caller-dialplan"),
+							switch_event_get_header_nil(event, "caller-context"),
+							switch_event_get_header_nil(event, "channel-presence-id"),
+							switch_event_get_header_nil(event, "channel-presence-data"),
+							switch_event_get_header_nil(event, "variable_accountcode"),
+							uuid);
+				break;
+			default:
+				cs_stmt_run(CORE_STMT_CHANNEL_STATE, switch_event_get_header_nil(event, "channel-state"), uuid);
+				break;
+			}
+		}
+		break;
+	case SWITCH_EVENT_CHANNEL_BRIDGE:
+		{
+			const char *a_uuid = switch_event_get_header(event, "Bridge-A-Unique-ID");
+			const char *b_uuid = switch_event_get_header(event, "Bridge-B-Unique-ID");
+			char epoch[32];
+
+			if (zstr(a_uuid) || zstr(b_uuid)) {
+				a_uuid = switch_event_get_header_nil(event, "caller-unique-id");
+				b_uuid = switch_event_get_header_nil(event, "other-leg-unique-id");
+			}
+
+			switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+
+			cs_stmt_run(CORE_STMT_CHANNEL_BRIDGE, switch_event_get_header_nil(event, "channel-call-uuid"), a_uuid, b_uuid);
+			cs_stmt_run(CORE_STMT_CALLS_INSERT,
+						switch_event_get_header_nil(event, "channel-call-uuid"),
+						switch_event_get_header_nil(event, "event-date-local"),
+						epoch,
+						a_uuid,
+						b_uuid,
+						switch_core_get_switchname());
+		}
+		break;
+	case SWITCH_EVENT_CHANNEL_UNBRIDGE:
+		{
+			const char *cuuid = switch_event_get_header_nil(event, "caller-unique-id");
+
+			cs_stmt_run(CORE_STMT_CHANNEL_UNBRIDGE, switch_event_get_header_nil(event, "channel-call-uuid"));
+			cs_stmt_run(CORE_STMT_CALLS_DELETE, cuuid, cuuid);
+		}
+		break;
+	case SWITCH_EVENT_CALL_SECURE:
+		{
+			const char *type = switch_event_get_header_nil(event, "secure_type");
+
+			if (!zstr(type)) {
+				cs_stmt_run(CORE_STMT_CHANNEL_SECURE, type, switch_event_get_header_nil(event, "caller-unique-id"));
+			}
+		}
+		break;
+	case SWITCH_EVENT_SHUTDOWN:
+		channel_store_flush();
+		break;
+	default:
+		break;
+	}
+}
+
+/* the columns that come straight from channel variables, set as the variable changes rather than on the next event */
+void switch_core_channel_store_set_var(const char *uuid, switch_event_t *variables, const char *varname)
+{
+	cs_row_t *row;
+	int col;
+
+	if (!channel_store.running || zstr(uuid)) {
+		return;
+	}
+
+	if (!strcasecmp(varname, "presence_id")) {
+		col = CS_COL_PRESENCE_ID;
+	} else if (!strcasecmp(varname, "presence_data")) {
+		col = CS_COL_PRESENCE_DATA;
+	} else if (!strcasecmp(varname, "accountcode")) {
+		col = CS_COL_ACCOUNTCODE;
+	} else {
+		return;
+	}
+
+	switch_thread_rwlock_wrlock(channel_store.rwlock);
+	if (channel_store.running && (row = switch_core_hash_find(channel_store.rows, uuid))) {
+		cs_set(row, col, switch_event_get_header_nil(variables, varname));
+	}
+	switch_thread_rwlock_unlock(channel_store.rwlock);
+}
+
+#define MAX_SQL 5
+#define new_sql()   switch_assert(sql_idx+1 < MAX_SQL); if (exists) sql[sql_idx++]
+#define new_sql_a() switch_assert(sql_idx+1 < MAX_SQL); sql[sql_idx++]
+
+static void core_event_handler(switch_event_t *event)
+{
+	char *sql[MAX_SQL] = { 0 };
+	int sql_idx = 0;
+	char *extra_cols;
+	int exists = 1;
+	char *uuid = NULL;
+
+	switch_assert(event);
+
+	switch (event->event_id) {
+	case SWITCH_EVENT_CHANNEL_UUID:
+	case SWITCH_EVENT_CHANNEL_CREATE:
+	case SWITCH_EVENT_CHANNEL_ANSWER:
+	case SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA:
+	case SWITCH_EVENT_CHANNEL_HOLD:
+	case SWITCH_EVENT_CHANNEL_UNHOLD:
+	case SWITCH_EVENT_CHANNEL_EXECUTE:
+	case SWITCH_EVENT_CHANNEL_ORIGINATE:
+	case SWITCH_EVENT_CALL_UPDATE:
+	case SWITCH_EVENT_CHANNEL_CALLSTATE:
+	case SWITCH_EVENT_CHANNEL_STATE:
+	case SWITCH_EVENT_CHANNEL_BRIDGE:
+	case SWITCH_EVENT_CHANNEL_UNBRIDGE:
+	case SWITCH_EVENT_CALL_SECURE:
+		{
+			if ((uuid = switch_event_get_header(event, "unique-id"))) {
+				exists = switch_ivr_uuid_exists(uuid);
+			}
+		}
+		break;
+	default:
+		break;
+	}
+
+	switch (event->event_id) {
+	case SWITCH_EVENT_ADD_SCHEDULE:
+		{
+			const char *id = switch_event_get_header(event, "task-id");
 			const char *manager = switch_event_get_header(event, "task-sql_manager");
 
 			if (id) {
@@ -2285,81 +3752,80 @@ static void core_event_handler(switch_event_t *event)
 			const char *uuid = switch_event_get_header(event, "unique-id");
 			
 			if (uuid) {
-				new_sql() = switch_mprintf("delete from channels where uuid='%q'",
-										   uuid);
-
-				new_sql() = switch_mprintf("delete from calls where (caller_uuid='%q' or callee_uuid='%q')",
-										   uuid, uuid);
-
+				core_stmt_run(CORE_STMT_CHANNEL_DELETE, SWITCH_TRUE, uuid);
+				core_stmt_run(CORE_STMT_CALLS_DELETE, SWITCH_TRUE, uuid, uuid);
 			}
 		}
 		break;
 	case SWITCH_EVENT_CHANNEL_UUID:
 		{
-			new_sql() = switch_mprintf("update channels set uuid='%q' where uuid='%q'",
-									   switch_event_get_header_nil(event, "unique-id"),
-									   switch_event_get_header_nil(event, "old-unique-id")
-									   );
-
-			new_sql() = switch_mprintf("update channels set call_uuid='%q' where call_uuid='%q'",
-									   switch_event_get_header_nil(event, "unique-id"),
-									   switch_event_get_header_nil(event, "old-unique-id")
-									   );
+			if (exists) {
+				core_stmt_run(CORE_STMT_CHANNEL_UUID, SWITCH_TRUE,
+							  switch_event_get_header_nil(event, "unique-id"),
+							  switch_event_get_header_nil(event, "old-unique-id"));
+
+				core_stmt_run(CORE_STMT_CHANNEL_CALL_UUID_RENAME, SWITCH_TRUE,
+							  switch_event_get_header_nil(event, "unique-id"),
+							  switch_event_get_header_nil(event, "old-unique-id"));
+			}
 			break;
 		}
 	case SWITCH_EVENT_CHANNEL_CREATE:
-		new_sql() = switch_mprintf("insert into channels (uuid,direction,created,created_epoch, name,state,callstate,dialplan,context,hostname,initial_cid_name,initial_cid_num,initial_ip_addr,initial_dest,initial_dialplan,initial_context) "
-								   "values('%q','%q','%q','%ld','%q','%q','%q','%q','%q','%q','%q','%q','%q','%q','%q','%q')",
-								   switch_event_get_header_nil(event, "unique-id"),
-								   switch_event_get_header_nil(event, "call-direction"),
-								   switch_event_get_header_nil(event, "event-date-local"),
-								   (long) switch_epoch_time_now(NULL),
-								   switch_event_get_header_nil(event, "channel-name"),
-								   switch_event_get_header_nil(event, "channel-state"),
-								   switch_event_get_header_nil(event, "channel-call-state"),
-								   switch_event_get_header_nil(event, "caller-dialplan"),
-								   switch_event_get_header_nil(event, "caller-context"), switch_core_get_switchname(),
-								   switch_event_get_header_nil(event, "caller-caller-id-name"),
-								   switch_event_get_header_nil(event, "caller-caller-id-number"),
-								   switch_event_get_header_nil(event, "caller-network-addr"),
-								   switch_event_get_header_nil(event, "caller-destination-number"),
-								   switch_event_get_header_nil(event, "caller-dialplan"),
-								   switch_event_get_header_nil(event, "caller-context")
-								   );
+		if (exists) {
+			char epoch[32];
+
+			switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+			core_stmt_run(CORE_STMT_CHANNEL_CREATE, SWITCH_TRUE,
+						  switch_event_get_header_nil(event, "unique-id"),
+						  switch_event_get_header_nil(event, "call-direction"),
+						  switch_event_get_header_nil(event, "event-date-local"),
+						  epoch,
+						  switch_event_get_header_nil(event, "channel-name"),
+						  switch_event_get_header_nil(event, "channel-state"),
+						  switch_event_get_header_nil(event, "channel-call-state"),
+						  switch_event_get_header_nil(event, "caller-dialplan"),
+						  switch_event_get_header_nil(event, "caller-context"), switch_core_get_switchname(),
+						  switch_event_get_header_nil(event, "caller-caller-id-name"),
+						  switch_event_get_header_nil(event, "caller-caller-id-number"),
+						  switch_event_get_header_nil(event, "caller-network-addr"),
+						  switch_event_get_header_nil(event, "caller-destination-number"),
+						  switch_event_get_header_nil(event, "caller-dialplan"),
+						  switch_event_get_header_nil(event, "caller-context"));
+		}
 		break;
 	case SWITCH_EVENT_CHANNEL_ANSWER:
 	case SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA:
 	case SWITCH_EVENT_CODEC:
-		new_sql() =
-			switch_mprintf
-			("update channels set read_codec='%q',read_rate='%q',read_bit_rate='%q',write_codec='%q',write_rate='%q',write_bit_rate='%q' where uuid='%q'",
-			 switch_event_get_header_nil(event, "channel-read-codec-name"),
-			 switch_event_get_header_nil(event, "channel-read-codec-rate"),
-			 switch_event_get_header_nil(event, "channel-read-codec-bit-rate"),
-			 switch_event_get_header_nil(event, "channel-write-codec-name"),
-			 switch_event_get_header_nil(event, "channel-write-codec-rate"),
-			 switch_event_get_header_nil(event, "channel-write-codec-bit-rate"),
-			 switch_event_get_header_nil(event, "unique-id"));
+		if (exists) {
+			core_stmt_run(CORE_STMT_CHANNEL_CODEC, SWITCH_TRUE,
+						  switch_event_get_header_nil(event, "channel-read-codec-name"),
+						  switch_event_get_header_nil(event, "channel-read-codec-rate"),
+						  switch_event_get_header_nil(event, "channel-read-codec-bit-rate"),
+						  switch_event_get_header_nil(event, "channel-write-codec-name"),
+						  switch_event_get_header_nil(event, "channel-write-codec-rate"),
+						  switch_event_get_header_nil(event, "channel-write-codec-bit-rate"),
+						  switch_event_get_header_nil(event, "unique-id"));
+		}
 		break;
 	case SWITCH_EVENT_CHANNEL_HOLD:
 	case SWITCH_EVENT_CHANNEL_UNHOLD:
 	case SWITCH_EVENT_CHANNEL_EXECUTE: {
 		
-		new_sql() = switch_mprintf("update channels set application='%q',application_data='%q',"
-								   "presence_id='%q',presence_data='%q',accountcode='%q' where uuid='%q'",
-								   switch_event_get_header_nil(event, "application"),
-								   switch_event_get_header_nil(event, "application-data"),
-								   switch_event_get_header_nil(event, "channel-presence-id"),
-								   switch_event_get_header_nil(event, "channel-presence-data"),
-								   switch_event_get_header_nil(event, "variable_accountcode"),
-								   switch_event_get_header_nil(event, "unique-id")
-								   );
+		if (exists) {
+			core_stmt_run(CORE_STMT_CHANNEL_APPLICATION, SWITCH_TRUE,
+						  switch_event_get_header_nil(event, "application"),
+						  switch_event_get_header_nil(event, "application-data"),
+						  switch_event_get_header_nil(event, "channel-presence-id"),
+						  switch_event_get_header_nil(event, "channel-presence-data"),
+						  switch_event_get_header_nil(event, "variable_accountcode"),
+						  switch_event_get_header_nil(event, "unique-id"));
+		}
 
 	}
 		break;
 
 	case SWITCH_EVENT_CHANNEL_ORIGINATE:
-		{
+		if (exists) {
 			if ((extra_cols = parse_presence_data_cols(event))) {
 				new_sql() = switch_mprintf("update channels set "
 										   "presence_id='%q',presence_data='%q',accountcode='%q',call_uuid='%q',%s where uuid='%q'",
@@ -2370,32 +3836,31 @@ static void core_event_handler(switch_event_t *event)
 										   extra_cols,
 										   switch_event_get_header_nil(event, "unique-id"));
 				free(extra_cols);
-			} else {
-				new_sql() = switch_mprintf("update channels set "
-										   "presence_id='%q',presence_data='%q',accountcode='%q',call_uuid='%q' where uuid='%q'",
-										   switch_event_get_header_nil(event, "channel-presence-id"),
-										   switch_event_get_header_nil(event, "channel-presence-data"),
-										   switch_event_get_header_nil(event, "variable_accountcode"),
-										   switch_event_get_header_nil(event, "channel-call-uuid"),
-										   switch_event_get_header_nil(event, "unique-id"));
 			}
 
+			/* the store always takes the fixed columns, the db only when no text form went out above */
+			core_stmt_run(CORE_STMT_CHANNEL_ORIGINATE, !sql_idx,
+						  switch_event_get_header_nil(event, "channel-presence-id"),
+						  switch_event_get_header_nil(event, "channel-presence-data"),
+						  switch_event_get_header_nil(event, "variable_accountcode"),
+						  switch_event_get_header_nil(event, "channel-call-uuid"),
+						  switch_event_get_header_nil(event, "unique-id"));
 		}
 
 		break;
 	case SWITCH_EVENT_CALL_UPDATE:
 		{
-			new_sql() = switch_mprintf("update channels set callee_name='%q',callee_num='%q',sent_callee_name='%q',sent_callee_num='%q',callee_direction='%q',"
-									   "cid_name='%q',cid_num='%q' where uuid='%s'",
-									   switch_event_get_header_nil(event, "caller-callee-id-name"),
-									   switch_event_get_header_nil(event, "caller-callee-id-number"),
-									   switch_event_get_header_nil(event, "sent-callee-id-name"),
-									   switch_event_get_header_nil(event, "sent-callee-id-number"),
-									   switch_event_get_header_nil(event, "direction"),
-									   switch_event_get_header_nil(event, "caller-caller-id-name"),
-									   switch_event_get_header_nil(event, "caller-caller-id-number"),
-									   switch_event_get_header_nil(event, "unique-id")
-									   );
+			if (exists) {
+				core_stmt_run(CORE_STMT_CHANNEL_CALL_UPDATE, SWITCH_TRUE,
+							  switch_event_get_header_nil(event, "caller-callee-id-name"),
+							  switch_event_get_header_nil(event, "caller-callee-id-number"),
+							  switch_event_get_header_nil(event, "sent-callee-id-name"),
+							  switch_event_get_header_nil(event, "sent-callee-id-number"),
+							  switch_event_get_header_nil(event, "direction"),
+							  switch_event_get_header_nil(event, "caller-caller-id-name"),
+							  switch_event_get_header_nil(event, "caller-caller-id-number"),
+							  switch_event_get_header_nil(event, "unique-id"));
+			}
 		}
 		break;
 	case SWITCH_EVENT_CHANNEL_CALLSTATE:
@@ -2414,10 +3879,12 @@ static void core_event_handler(switch_event_t *event)
 											   extra_cols,
 											   switch_event_get_header_nil(event, "unique-id"));
 					free(extra_cols);
-				} else {
-					new_sql() = switch_mprintf("update channels set callstate='%q' where uuid='%q'",
-											   switch_event_get_header_nil(event, "channel-call-state"),
-											   switch_event_get_header_nil(event, "unique-id"));
+				}
+
+				if (exists) {
+					core_stmt_run(CORE_STMT_CHANNEL_CALLSTATE, !sql_idx,
+								  switch_event_get_header_nil(event, "channel-call-state"),
+								  switch_event_get_header_nil(event, "unique-id"));
 				}
 			}
 
@@ -2455,11 +3922,12 @@ static void core_event_handler(switch_event_t *event)
 											   extra_cols,
 											   switch_event_get_header_nil(event, "unique-id"));
 					free(extra_cols);
-					
-				} else {
-					new_sql() = switch_mprintf("update channels set state='%s' where uuid='%s'",
-											   switch_event_get_header_nil(event, "channel-state"),
-											   switch_event_get_header_nil(event, "unique-id"));
+				}
+
+				if (exists) {
+					core_stmt_run(CORE_STMT_CHANNEL_STATE, !sql_idx,
+								  switch_event_get_header_nil(event, "channel-state"),
+								  switch_event_get_header_nil(event, "unique-id"));
 				}
 				break;
 			case CS_ROUTING:
@@ -2485,32 +3953,33 @@ static void core_event_handler(switch_event_t *event)
 											   extra_cols,
 											   switch_event_get_header_nil(event, "unique-id"));
 					free(extra_cols);
-				} else {
-					new_sql() = switch_mprintf("update channels set state='%s',cid_name='%q',cid_num='%q',callee_name='%q',callee_num='%q',"
-											   "sent_callee_name='%q',sent_callee_num='%q',"
-											   "ip_addr='%s',dest='%q',dialplan='%q',context='%q',presence_id='%q',presence_data='%q',accountcode='%q' "
-											   "where uuid='%s'",
-											   switch_event_get_header_nil(event, "channel-state"),
-											   switch_event_get_header_nil(event, "caller-caller-id-name"),
-											   switch_event_get_header_nil(event, "caller-caller-id-number"),
-											   switch_event_get_header_nil(event, "caller-callee-id-name"),
-											   switch_event_get_header_nil(event, "caller-callee-id-number"),
-											   switch_event_get_header_nil(event, "sent-callee-id-name"),
-											   switch_event_get_header_nil(event, "sent-callee-id-number"),
-											   switch_event_get_header_nil(event, "caller-network-addr"),
-											   switch_event_get_header_nil(event, "caller-destination-number"),
-											   switch_event_get_header_nil(event, "caller-dialplan"),
-											   switch_event_get_header_nil(event, "caller-context"),
-											   switch_event_get_header_nil(event, "channel-presence-id"),
-											   switch_event_get_header_nil(event, "channel-presence-data"),
-											   switch_event_get_header_nil(event, "variable_accountcode"),
-											   switch_event_get_header_nil(event, "unique-id"));
+				}
+
+				if (exists) {
+					core_stmt_run(CORE_STMT_CHANNEL_STATE_ROUTING, !sql_idx,
+								  switch_event_get_header_nil(event, "channel-state"),
+								  switch_event_get_header_nil(event, "caller-caller-id-name"),
+								  switch_event_get_header_nil(event, "caller-caller-id-number"),
+								  switch_event_get_header_nil(event, "caller-callee-id-name"),
+								  switch_event_get_header_nil(event, "caller-callee-id-number"),
+								  switch_event_get_header_nil(event, "sent-callee-id-name"),
+								  switch_event_get_header_nil(event, "sent-callee-id-number"),
+								  switch_event_get_header_nil(event, "caller-network-addr"),
+								  switch_event_get_header_nil(event, "caller-destination-number"),
+								  switch_event_get_header_nil(event, "caller-dialplan"),
+								  switch_event_get_header_nil(event, "caller-context"),
+								  switch_event_get_header_nil(event, "channel-presence-id"),
+								  switch_event_get_header_nil(event, "channel-presence-data"),
+								  switch_event_get_header_nil(event, "variable_accountcode"),
+								  switch_event_get_header_nil(event, "unique-id"));
 				}
 				break;
 			default:
-				new_sql() = switch_mprintf("update channels set state='%s' where uuid='%s'",
-										   switch_event_get_header_nil(event, "channel-state"),
-										   switch_event_get_header_nil(event, "unique-id"));
+				if (exists) {
+					core_stmt_run(CORE_STMT_CHANNEL_STATE, SWITCH_TRUE,
+								  switch_event_get_header_nil(event, "channel-state"),
+								  switch_event_get_header_nil(event, "unique-id"));
+				}
 				break;
 			}
 
@@ -2536,20 +4005,22 @@ static void core_event_handler(switch_event_t *event)
 				switch_safe_free(extra_cols);
 			} 
 
-			new_sql() = switch_mprintf("update channels set call_uuid='%q' where uuid='%s' or uuid='%s'",
-									   switch_event_get_header_nil(event, "channel-call-uuid"), a_uuid, b_uuid);
-			
+			if (exists) {
+				char epoch[32];
 
-			new_sql() = switch_mprintf("insert into calls (call_uuid,call_created,call_created_epoch,"
-									   "caller_uuid,callee_uuid,hostname) "
-									   "values ('%s','%s','%ld','%q','%q','%q')",
-									   switch_event_get_header_nil(event, "channel-call-uuid"),
-									   switch_event_get_header_nil(event, "event-date-local"),
-									   (long) switch_epoch_time_now(NULL),
-									   a_uuid,
-									   b_uuid,
-									   switch_core_get_switchname()
-									   );
+				switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+
+				core_stmt_run(CORE_STMT_CHANNEL_BRIDGE, SWITCH_TRUE,
+							  switch_event_get_header_nil(event, "channel-call-uuid"), a_uuid, b_uuid);
+
+				core_stmt_run(CORE_STMT_CALLS_INSERT, SWITCH_TRUE,
+							  switch_event_get_header_nil(event, "channel-call-uuid"),
+							  switch_event_get_header_nil(event, "event-date-local"),
+							  epoch,
+							  a_uuid,
+							  b_uuid,
+							  switch_core_get_switchname());
+			}
 		}
 		break;
 	case SWITCH_EVENT_CHANNEL_UNBRIDGE:
@@ -2562,11 +4033,12 @@ static void core_event_handler(switch_event_t *event)
 				switch_safe_free(extra_cols);
 			} 
 
-			new_sql() = switch_mprintf("update channels set call_uuid=uuid where call_uuid='%s'",
-									   switch_event_get_header_nil(event, "channel-call-uuid"));
-			
-			new_sql() = switch_mprintf("delete from calls where (caller_uuid='%q' or callee_uuid='%q')",
-									   cuuid, cuuid);
+			if (exists) {
+				core_stmt_run(CORE_STMT_CHANNEL_UNBRIDGE, SWITCH_TRUE,
+							  switch_event_get_header_nil(event, "channel-call-uuid"));
+
+				core_stmt_run(CORE_STMT_CALLS_DELETE, SWITCH_TRUE, cuuid, cuuid);
+			}
 			break;
 		}
 	case SWITCH_EVENT_SHUTDOWN:
@@ -2613,9 +4085,9 @@ static void core_event_handler(switch_event_t *event)
 			if (zstr(type)) {
 				break;
 			}
-			new_sql() = switch_mprintf("update channels set secure='%s' where uuid='%s'",
-									   type, switch_event_get_header_nil(event, "caller-unique-id")
-									   );
+			if (exists) {
+				core_stmt_run(CORE_STMT_CHANNEL_SECURE, SWITCH_TRUE, type, switch_event_get_header_nil(event, "caller-unique-id"));
+			}
 			break;
 		}
 	case SWITCH_EVENT_NAT:
@@ -2650,6 +4122,10 @@ static void core_event_handler(switch_event_t *event)
 
 		for (i = 0; i < sql_idx; i++) {
 			if (switch_stristr("update channels", sql[i]) || switch_stristr("delete from channels", sql[i])) {
+				if (switch_test_flag((&runtime), SCF_NO_CHANNEL_SQL)) {
+					switch_safe_free(sql[i]);
+					continue;
+				}
 				switch_sql_queue_manager_push(sql_manager.qm, sql[i], 1, SWITCH_FALSE);
 			} else {
 				switch_sql_queue_manager_push(sql_manager.qm, sql[i], 0, SWITCH_FALSE);
@@ -3599,6 +5075,8 @@ switch_status_t switch_core_sqldb_start(switch_memory_pool_t *pool, switch_bool_
  skip:
 
 	if (sql_manager.manage) {
+		channel_store_init();
+
 #ifdef SWITCH_SQL_BIND_EVERY_EVENT
 		switch_event_bind("core_db", SWITCH_EVENT_ALL, SWITCH_EVENT_SUBCLASS_ANY, core_event_handler, NULL);
 #else
@@ -3675,6 +5153,7 @@ static void switch_core_sqldb_stop_thread(void)
 
 static void switch_core_sqldb_start_thread(void)
 {
+	int i;
 
 	switch_mutex_lock(sql_manager.ctl_mutex);
 	if (sql_manager.manage) {
@@ -3698,6 +5177,9 @@ static void switch_core_sqldb_start_thread(void)
 											   runtime.core_db_inner_pre_trans_execute,
 											   runtime.core_db_inner_post_trans_execute);
 
+			for (i = 0; i < CORE_STMT_MAX; i++) {
+				sql_manager.stmts[i] = switch_sql_queue_manager_prepare(sql_manager.qm, CORE_STMT_SQL[i]);
+			}
 		}
 		switch_sql_queue_manager_start(sql_manager.qm);
 	} else {
@@ -3711,6 +5193,7 @@ void switch_core_sqldb_stop(void)
 	switch_status_t st;
 
 	switch_event_unbind_callback(core_event_handler);
+	channel_store_destroy();
 
 	if (sql_manager.db_thread && sql_manager.db_thread_running) {
 		sql_manager.db_thread_running = -1;
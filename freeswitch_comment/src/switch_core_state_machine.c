@@ -528,13 +528,120 @@ static void check_presence(switch_core_session_t *session)
 
 
 
-SWITCH_DECLARE(void) switch_core_session_run(switch_core_session_t *session)
+/* runs the handlers of a state the session just entered, SWITCH_STATUS_TERM once the state machine is done */
+static switch_status_t session_run_state(switch_core_session_t *session, switch_channel_state_t state)
 {
-	switch_channel_state_t state = CS_NEW, midstate = CS_DESTROY, endstate;
-	const switch_endpoint_interface_t *endpoint_interface;
-	const switch_state_handler_table_t *driver_state_handler = NULL;
+	switch_channel_state_t midstate = state;
+	const switch_state_handler_table_t *driver_state_handler = session->endpoint_interface->state_handler;
 	const switch_state_handler_table_t *application_state_handler = NULL;
 	int silly = 0;
+	int index = 0;
+	int proceed = 1;
+	int global_proceed = 1;
+	int do_extra_handlers = 1;
+	switch_io_event_hook_state_run_t *ptr;
+	switch_status_t rstatus = SWITCH_STATUS_SUCCESS;
+
+	switch_channel_set_running_state(session->channel, state);
+	switch_channel_clear_flag(session->channel, CF_TRANSFER);
+	switch_channel_clear_flag(session->channel, CF_REDIRECT);
+	switch_ivr_parse_all_messages(session);
+
+	if (session->endpoint_interface->io_routines->state_run) {
+		rstatus = session->endpoint_interface->io_routines->state_run(session);
+	}
+	
+	if (rstatus == SWITCH_STATUS_SUCCESS) {
+		for (ptr = session->event_hooks.state_run; ptr; ptr = ptr->next) {
+			if ((rstatus = ptr->state_run(session)) != SWITCH_STATUS_SUCCESS) {
+				break;
+			}
+		}
+	}
+
+	switch (state) {
+	case CS_NEW:		/* Just created, Waiting for first instructions */
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "(%s) State NEW\n", switch_channel_get_name(session->channel));
+		break;
+	case CS_DESTROY:
+		return SWITCH_STATUS_TERM;
+	case CS_REPORTING:	/* Call Detail */
+		{
+			switch_core_session_reporting_state(session);
+			switch_channel_set_state(session->channel, CS_DESTROY);
+		}
+		return SWITCH_STATUS_TERM;
+	case CS_HANGUP:	/* Deactivate and end the thread */
+		{
+			switch_core_session_hangup_state(session, SWITCH_TRUE);
+			if (switch_channel_test_flag(session->channel, CF_VIDEO)) {
+				switch_core_session_wake_video_thread(session);
+			}
+			switch_channel_set_state(session->channel, CS_REPORTING);
+		}
+
+		break;
+	case CS_INIT:		/* Basic setup tasks */
+		{
+			switch_event_t *event;
+
+			STATE_MACRO(init, "INIT");
+			
+			if (switch_event_create(&event, SWITCH_EVENT_CHANNEL_CREATE) == SWITCH_STATUS_SUCCESS) {
+				switch_channel_event_set_data(session->channel, event);
+				switch_event_fire(&event);
+			}
+
+			if (switch_channel_direction(session->channel) == SWITCH_CALL_DIRECTION_OUTBOUND) {
+				if (switch_event_create(&event, SWITCH_EVENT_CHANNEL_ORIGINATE) == SWITCH_STATUS_SUCCESS) {
+					switch_channel_event_set_data(session->channel, event);
+					switch_event_fire(&event);
+				}
+			}
+		}
+		break;
+	case CS_ROUTING:	/* Look for a dialplan and find something to do */
+		STATE_MACRO(routing, "ROUTING");
+		break;
+	case CS_RESET:		/* Reset */
+		STATE_MACRO(reset, "RESET");
+		break;
+		/* These other states are intended for prolonged durations so we do not signal lock for them */
+	case CS_EXECUTE:	/* Execute an Operation */
+		STATE_MACRO(execute, "EXECUTE");
+		break;
+	case CS_EXCHANGE_MEDIA:	/* loop all data back to source */
+		STATE_MACRO(exchange_media, "EXCHANGE_MEDIA");
+		break;
+	case CS_SOFT_EXECUTE:	/* send/recieve data to/from another channel */
+		STATE_MACRO(soft_execute, "SOFT_EXECUTE");
+		break;
+	case CS_PARK:		/* wait in limbo */
+		STATE_MACRO(park, "PARK");
+		break;
+	case CS_CONSUME_MEDIA:	/* wait in limbo */
+		STATE_MACRO(consume_media, "CONSUME_MEDIA");
+		break;
+	case CS_HIBERNATE:	/* sleep */
+		STATE_MACRO(hibernate, "HIBERNATE");
+		break;
+	case CS_NONE:
+		abort();
+		break;
+	}
+
+	check_presence(session);
+
+	if (midstate == CS_DESTROY) {
+		return SWITCH_STATUS_TERM;
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(void) switch_core_session_run(switch_core_session_t *session)
+{
+	switch_channel_state_t state = CS_NEW, endstate;
 	uint32_t new_loops = 500;
 
 	/*
@@ -555,11 +662,8 @@ SWITCH_DECLARE(void) switch_core_session_run(switch_core_session_t *session)
 	switch_assert(session != NULL);
 
 	switch_set_flag(session, SSF_THREAD_RUNNING);
-	endpoint_interface = session->endpoint_interface;
-	switch_assert(endpoint_interface != NULL);
-
-	driver_state_handler = endpoint_interface->state_handler;
-	switch_assert(driver_state_handler != NULL);
+	switch_assert(session->endpoint_interface != NULL);
+	switch_assert(session->endpoint_interface->state_handler != NULL);
 
 	switch_mutex_lock(session->mutex);
 
@@ -572,109 +676,10 @@ SWITCH_DECLARE(void) switch_core_session_run(switch_core_session_t *session)
 			}
 		}
 
-		midstate = state;
 		if (state != switch_channel_get_running_state(session->channel) || state >= CS_HANGUP) {
-			int index = 0;
-			int proceed = 1;
-			int global_proceed = 1;
-			int do_extra_handlers = 1;
-			switch_io_event_hook_state_run_t *ptr;
-			switch_status_t rstatus = SWITCH_STATUS_SUCCESS;
-
-			switch_channel_set_running_state(session->channel, state);
-			switch_channel_clear_flag(session->channel, CF_TRANSFER);
-			switch_channel_clear_flag(session->channel, CF_REDIRECT);
-			switch_ivr_parse_all_messages(session);
-
-			if (session->endpoint_interface->io_routines->state_run) {
-				rstatus = session->endpoint_interface->io_routines->state_run(session);
-			}
-			
-			if (rstatus == SWITCH_STATUS_SUCCESS) {
-				for (ptr = session->event_hooks.state_run; ptr; ptr = ptr->next) {
-					if ((rstatus = ptr->state_run(session)) != SWITCH_STATUS_SUCCESS) {
-						break;
-					}
-				}
-			}
-
-			switch (state) {
-			case CS_NEW:		/* Just created, Waiting for first instructions */
-				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "(%s) State NEW\n", switch_channel_get_name(session->channel));
-				break;
-			case CS_DESTROY:
-				goto done;
-			case CS_REPORTING:	/* Call Detail */
-				{
-					switch_core_session_reporting_state(session);
-					switch_channel_set_state(session->channel, CS_DESTROY);
-				}
-				goto done;
-			case CS_HANGUP:	/* Deactivate and end the thread */
-				{
-					switch_core_session_hangup_state(session, SWITCH_TRUE);
-					if (switch_channel_test_flag(session->channel, CF_VIDEO)) {
-						switch_core_session_wake_video_thread(session);
-					}
-					switch_channel_set_state(session->channel, CS_REPORTING);
-				}
-
-				break;
-			case CS_INIT:		/* Basic setup tasks */
-				{
-					switch_event_t *event;
-
-					STATE_MACRO(init, "INIT");
-					
-					if (switch_event_create(&event, SWITCH_EVENT_CHANNEL_CREATE) == SWITCH_STATUS_SUCCESS) {
-						switch_channel_event_set_data(session->channel, event);
-						switch_event_fire(&event);
-					}
-
-					if (switch_channel_direction(session->channel) == SWITCH_CALL_DIRECTION_OUTBOUND) {
-						if (switch_event_create(&event, SWITCH_EVENT_CHANNEL_ORIGINATE) == SWITCH_STATUS_SUCCESS) {
-							switch_channel_event_set_data(session->channel, event);
-							switch_event_fire(&event);
-						}
-					}
-				}
-				break;
-			case CS_ROUTING:	/* Look for a dialplan and find something to do */
-				STATE_MACRO(routing, "ROUTING");
-				break;
-			case CS_RESET:		/* Reset */
-				STATE_MACRO(reset, "RESET");
-				break;
-				/* These other states are intended for prolonged durations so we do not signal lock for them */
-			case CS_EXECUTE:	/* Execute an Operation */
-				STATE_MACRO(execute, "EXECUTE");
-				break;
-			case CS_EXCHANGE_MEDIA:	/* loop all data back to source */
-				STATE_MACRO(exchange_media, "EXCHANGE_MEDIA");
-				break;
-			case CS_SOFT_EXECUTE:	/* send/recieve data to/from another channel */
-				STATE_MACRO(soft_execute, "SOFT_EXECUTE");
-				break;
-			case CS_PARK:		/* wait in limbo */
-				STATE_MACRO(park, "PARK");
-				break;
-			case CS_CONSUME_MEDIA:	/* wait in limbo */
-				STATE_MACRO(consume_media, "CONSUME_MEDIA");
-				break;
-			case CS_HIBERNATE:	/* sleep */
-				STATE_MACRO(hibernate, "HIBERNATE");
-				break;
-			case CS_NONE:
-				abort();
-				break;
-			}
-
-			check_presence(session);
-
-			if (midstate == CS_DESTROY) {
+			if (session_run_state(session, state) != SWITCH_STATUS_SUCCESS) {
 				break;
 			}
-
 		}
 
 		endstate = switch_channel_get_state(session->channel);
@@ -717,12 +722,133 @@ SWITCH_DECLARE(void) switch_core_session_run(switch_core_session_t *session)
 			}
 		}
 	}
-  done:
+
 	switch_mutex_unlock(session->mutex);
 
 	switch_clear_flag(session, SSF_THREAD_RUNNING);
 }
 
+/* states whose handlers only do bookkeeping, everything else may run an application or a media loop */
+static switch_bool_t state_runs_inline(switch_channel_state_t state)
+{
+	switch (state) {
+	case CS_INIT:
+	case CS_RESET:
+	case CS_HIBERNATE:
+		return SWITCH_TRUE;
+	default:
+		return SWITCH_FALSE;
+	}
+}
+
+/*
+   switch_core_session_run for the session scheduler: instead of waiting on session->cond the session is parked
+   with no thread at all and the next wake puts it back on a worker. On a worker anything that may block
+   (a state that runs applications or media, queued execute events, hangup) is left to a dedicated thread.
+   Called with session->mutex held, returns with it released.
+ */
+switch_core_session_slice_t switch_core_session_run_slice(switch_core_session_t *session, switch_bool_t dedicated)
+{
+	switch_channel_state_t state, endstate;
+
+	switch_assert(session != NULL);
+
+	if (switch_channel_test_flag(session->channel, CF_THREAD_SLEEPING)) {
+		switch_channel_clear_flag(session->channel, CF_THREAD_SLEEPING);
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG1, "%s session resume state: %s!\n",
+						  switch_channel_get_name(session->channel),
+						  switch_channel_state_name(switch_channel_get_running_state(session->channel)));
+		if (!dedicated && switch_core_session_private_event_count(session)) {
+			goto blocking;
+		}
+		switch_ivr_parse_all_events(session);
+		switch_ivr_parse_all_events(session);
+	}
+
+	while ((state = switch_channel_get_state(session->channel)) != CS_DESTROY) {
+
+		if (switch_channel_test_flag(session->channel, CF_BLOCK_STATE)) {
+			if (!dedicated) {
+				goto blocking;
+			}
+			switch_channel_wait_for_flag(session->channel, CF_BLOCK_STATE, SWITCH_FALSE, 0, NULL);
+			if ((state = switch_channel_get_state(session->channel)) == CS_DESTROY) {
+				break;
+			}
+		}
+
+		if (state != switch_channel_get_running_state(session->channel) || state >= CS_HANGUP) {
+			if (!dedicated && !state_runs_inline(state)) {
+				goto blocking;
+			}
+			if (session_run_state(session, state) != SWITCH_STATUS_SUCCESS) {
+				break;
+			}
+		}
+
+		endstate = switch_channel_get_state(session->channel);
+
+		if (endstate != switch_channel_get_running_state(session->channel)) {
+			continue;
+		}
+
+		if (endstate == CS_NEW) {
+			if (!dedicated) {
+				goto blocking;
+			}
+			switch_yield(20000);
+			switch_ivr_parse_all_events(session);
+			if (!--session->sched_new_loops) {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "%s %s Abandoned\n",
+								  session->uuid_str, switch_core_session_get_name(session));
+				switch_channel_set_flag(session->channel, CF_NO_CDR);
+				switch_channel_hangup(session->channel, SWITCH_CAUSE_WRONG_CALL_STATE);
+			}
+			continue;
+		}
+
+		if (!dedicated && switch_core_session_private_event_count(session)) {
+			goto blocking;
+		}
+
+		switch_ivr_parse_all_events(session);
+		switch_ivr_parse_all_events(session);
+
+		if (switch_channel_get_state(session->channel) == switch_channel_get_running_state(session->channel)) {
+			switch_channel_state_thread_lock(session->channel);
+			switch_channel_set_flag(session->channel, CF_THREAD_SLEEPING);
+			if (switch_channel_get_state(session->channel) == switch_channel_get_running_state(session->channel) &&
+				(dedicated || !switch_core_session_private_event_count(session))) {
+				switch_ivr_parse_all_events(session);
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG1, "%s session park state: %s!\n",
+								  switch_channel_get_name(session->channel),
+								  switch_channel_state_name(switch_channel_get_running_state(session->channel)));
+				/* a wake can only get in once both locks are gone, session->mutex goes first so it sees the session parked */
+				session->sched_parked = 1;
+				session->thread_id = 0;
+				switch_mutex_unlock(session->mutex);
+				switch_channel_state_thread_unlock(session->channel);
+				return SCS_SLICE_PARKED;
+			}
+			switch_channel_clear_flag(session->channel, CF_THREAD_SLEEPING);
+			switch_channel_state_thread_unlock(session->channel);
+		}
+	}
+
+	switch_mutex_unlock(session->mutex);
+
+	switch_clear_flag(session, SSF_THREAD_RUNNING);
+
+	return SCS_SLICE_DONE;
+
+ blocking:
+
+	session->thread_id = 0;
+	switch_mutex_unlock(session->mutex);
+
+	return SCS_SLICE_BLOCKING;
+}
+
 SWITCH_DECLARE(void) switch_core_session_destroy_state(switch_core_session_t *session)
 {
 	switch_channel_state_t state = CS_DESTROY, midstate = CS_DESTROY;
@@ -852,6 +978,7 @@ SWITCH_DECLARE(void) switch_core_session_hangup_state(switch_core_session_t *ses
 	STATE_MACRO(hangup, "HANGUP");
 
 	switch_core_media_set_stats(session);
+	switch_core_session_media_trace_hangup(session);
 
 	if ((hook_var = switch_channel_get_variable(session->channel, SWITCH_API_HANGUP_HOOK_VARIABLE))) {
 
@@ -40,6 +40,18 @@
 
 //#define SWITCH_EVENT_RECYCLE
 #define DISPATCH_QUEUE_LEN 10000
+/* events waiting for one binding, past this they are dropped for that binding alone */
+#define BINDING_QUEUE_LEN 4096
+/* events with fewer headers than this are searched linearly, past it they get a hash index */
+#define EVENT_INDEX_MIN 16
+#define EVENT_INTERN_SIZE 256
+#define EVENT_ARENA_CHUNK 4096
+/* an arena that has had more than this thrown away stops taking headers, they go to malloc where they can be freed */
+#define EVENT_ARENA_MAX_WASTE 16384
+/* switch_event_header_t flags, set when that part is interned or in an arena and must not be freed on its own */
+#define EHF_NAME_HELD (1 << 0)
+#define EHF_VALUE_HELD (1 << 1)
+#define EHF_HEADER_HELD (1 << 2)
 //#define DEBUG_DISPATCH_QUEUES
 
 /*! \brief A node to store binded events */
@@ -54,9 +66,43 @@ struct switch_event_node {
 	switch_event_callback_t callback;
 	/*! private data */
 	void *user_data;
+	/*! number of events delivered to this binding */
+	switch_atomic64_t calls;
+	/*! total time spent in the callback (microseconds) */
+	switch_atomic64_t total_usec;
+	/*! slowest single callback (microseconds) */
+	switch_atomic64_t max_usec;
+	/*! events dropped because the queue was full */
+	switch_atomic64_t drops;
+	/*! events waiting for the callback, BINDING_QUEUE_LEN of them at most */
+	switch_event_t **queue;
+	uint32_t head;
+	uint32_t tail;
+	/*! deepest the queue has been */
+	uint32_t high_water;
+	/*! a pool thread is draining the queue */
+	int draining;
+	/*! the thread draining it, so the callback can unbind itself */
+	switch_thread_id_t drainer;
+	/*! unbound, 2 when the drainer frees the node */
+	int unbound;
+	switch_mutex_t *mutex;
+	switch_memory_pool_t *pool;
 	struct switch_event_node *next;
 };
 
+/*! \brief Counters kept for each dispatch shard */
+typedef struct {
+	/*! events queued on this shard */
+	switch_atomic64_t pushed;
+	/*! times the shard was full when an event was fired at it */
+	switch_atomic64_t full;
+	/*! events without a Unique-ID that went to another shard because this one was full */
+	switch_atomic64_t spilled;
+	/*! deepest the shard queue has been, kept by its dispatch thread */
+	uint32_t high_water;
+} switch_event_dispatch_stats_t;
+
 /*! \brief A registered custom event subclass  */
 struct switch_event_subclass {
 	/*! the owner of the subclass */
@@ -90,7 +136,10 @@ static switch_memory_pool_t *RUNTIME_POOL = NULL;
 static switch_memory_pool_t *THRUNTIME_POOL = NULL;
 static switch_thread_t *EVENT_DISPATCH_QUEUE_THREADS[MAX_DISPATCH_VAL] = { 0 };
 static uint8_t EVENT_DISPATCH_QUEUE_RUNNING[MAX_DISPATCH_VAL] = { 0 };
-static switch_queue_t *EVENT_DISPATCH_QUEUE = NULL;
+static switch_queue_t *EVENT_DISPATCH_QUEUES[MAX_DISPATCH_VAL] = { 0 };
+static switch_event_dispatch_stats_t EVENT_DISPATCH_STATS[MAX_DISPATCH_VAL];
+static volatile uint32_t EVENT_DISPATCH_SHARDS = 0;
+static switch_atomic64_t EVENT_DISPATCH_RR = 0;
 static switch_queue_t *EVENT_CHANNEL_DISPATCH_QUEUE = NULL;
 static switch_mutex_t *EVENT_QUEUE_MUTEX = NULL;
 static switch_hash_t *CUSTOM_HASH = NULL;
@@ -126,6 +175,381 @@ static char *my_dup(const char *s)
 #define FREE(ptr) switch_safe_free(ptr)
 #endif
 
+/* Header names that show up on nearly every channel event are interned into one static block
+   so adding them costs neither a malloc nor a free.  The table is filled once at init and
+   is read only after that. */
+static const char *EVENT_COMMON_HEADERS[] = {
+	"Event-Name", "Event-Subclass", "Core-UUID", "FreeSWITCH-Hostname", "FreeSWITCH-Switchname", "FreeSWITCH-IPv4",
+	"FreeSWITCH-IPv6", "Event-Date-Local", "Event-Date-GMT", "Event-Date-Timestamp", "Event-Calling-File",
+	"Event-Calling-Function", "Event-Calling-Line-Number", "Event-Sequence", "Unique-ID", "Call-Direction",
+	"Presence-Call-Direction", "Answer-State", "Channel-State", "Channel-Call-State", "Channel-State-Number",
+	"Channel-Name", "Channel-HIT-Dialplan", "Channel-Presence-ID", "Channel-Presence-Data", "Channel-Call-UUID",
+	"Channel-Read-Codec-Name", "Channel-Read-Codec-Rate", "Channel-Read-Codec-Bit-Rate", "Channel-Write-Codec-Name",
+	"Channel-Write-Codec-Rate", "Channel-Write-Codec-Bit-Rate", "Caller-Direction", "Caller-Logical-Direction",
+	"Caller-Username", "Caller-Dialplan", "Caller-Caller-ID-Name", "Caller-Caller-ID-Number", "Caller-Orig-Caller-ID-Name",
+	"Caller-Orig-Caller-ID-Number", "Caller-Callee-ID-Name", "Caller-Callee-ID-Number", "Caller-Network-Addr",
+	"Caller-ANI", "Caller-Destination-Number", "Caller-Unique-ID", "Caller-Source", "Caller-Context", "Caller-RDNIS",
+	"Caller-Channel-Name", "Caller-Profile-Index", "Caller-Profile-Created-Time", "Caller-Channel-Created-Time",
+	"Caller-Channel-Answered-Time", "Caller-Channel-Progress-Time", "Caller-Channel-Progress-Media-Time",
+	"Caller-Channel-Hangup-Time", "Caller-Channel-Transfer-Time", "Caller-Channel-Resurrect-Time",
+	"Caller-Channel-Bridged-Time", "Caller-Channel-Last-Hold", "Caller-Channel-Hold-Accum", "Caller-Screen-Bit",
+	"Caller-Privacy-Hide-Name", "Caller-Privacy-Hide-Number", "Other-Type", "Other-Leg-Unique-ID", "Bridge-A-Unique-ID",
+	"Bridge-B-Unique-ID", "Application", "Application-Data", "Application-Response", "Application-UUID",
+	"Hangup-Cause", "priority", NULL
+};
+
+static char EVENT_INTERN_BLOCK[4096];
+static const char *EVENT_INTERN_TABLE[EVENT_INTERN_SIZE] = { 0 };
+
+/* Events that are built once, fired and destroyed (everything but CLONE and the EF_UNIQ_HEADERS
+   variable bags, which live on channels and get rewritten all the time) carve their header structs,
+   names and values out of a per event arena that is released in one go on destroy.
+   switch_event_dup of such an event takes a reference on the source arena and points at its strings
+   instead of copying them; since a header value is never changed in place (replacing one just drops
+   the old pointer) the sharing is copy on write for free. Each header carries EHF_*_HELD flags for the
+   parts that must not be freed, array entries are always malloc'd. */
+typedef struct switch_event_arena_chunk {
+	struct switch_event_arena_chunk *next;
+	char *data;
+	switch_size_t used;
+	switch_size_t size;
+} switch_event_arena_chunk_t;
+
+typedef struct switch_event_arena switch_event_arena_t;
+
+struct switch_event_arena {
+	/*! string chunks, newest first, the initial one lives in the same block as the arena */
+	switch_event_arena_chunk_t *chunks;
+	/*! header structs, nothing outside the event points at them so they go with the event rather than the last reference */
+	switch_event_arena_chunk_t *header_chunks;
+	volatile switch_atomic_t refs;
+	/*! arenas of other events whose strings we point into */
+	switch_event_arena_t **shared;
+	uint32_t shared_count;
+	/*! bytes of replaced or deleted headers still sitting in the chunks */
+	switch_size_t wasted;
+};
+
+static struct {
+	switch_atomic64_t arenas;
+	switch_atomic64_t chunks;
+	switch_atomic64_t bytes;
+	switch_atomic64_t shared_values;
+	switch_atomic64_t wasted;
+} EVENT_ARENA_STATS;
+
+static switch_event_arena_t *switch_event_arena_create(switch_size_t size)
+{
+	switch_event_arena_t *arena;
+	switch_event_arena_chunk_t *chunk;
+
+	arena = ALLOC(sizeof(*arena) + sizeof(*chunk) + size);
+	switch_assert(arena);
+	memset(arena, 0, sizeof(*arena));
+
+	chunk = (switch_event_arena_chunk_t *) (arena + 1);
+	chunk->next = NULL;
+	chunk->data = (char *) (chunk + 1);
+	chunk->used = 0;
+	chunk->size = size;
+
+	arena->chunks = chunk;
+	arena->refs = 1;
+
+	switch_atomic64_inc(&EVENT_ARENA_STATS.arenas);
+	switch_atomic64_inc(&EVENT_ARENA_STATS.chunks);
+	switch_atomic64_add(&EVENT_ARENA_STATS.bytes, size);
+
+	return arena;
+}
+
+static void switch_event_arena_free_chunks(switch_event_arena_chunk_t *chunk, switch_event_arena_chunk_t *keep)
+{
+	switch_event_arena_chunk_t *next;
+
+	for (; chunk; chunk = next) {
+		next = chunk->next;
+		if (chunk != keep) {
+			free(chunk);
+		}
+	}
+}
+
+/* the event is gone, its header structs go now, the strings when the last dup pointing at them does */
+static void switch_event_arena_release(switch_event_arena_t *arena, switch_bool_t owner)
+{
+	uint32_t x;
+
+	if (owner) {
+		switch_event_arena_free_chunks(arena->header_chunks, NULL);
+		arena->header_chunks = NULL;
+	}
+
+	if (switch_atomic_dec(&arena->refs)) {
+		return;
+	}
+
+	/* the first chunk came with the arena */
+	switch_event_arena_free_chunks(arena->chunks, (switch_event_arena_chunk_t *) (arena + 1));
+
+	for (x = 0; x < arena->shared_count; x++) {
+		switch_event_arena_release(arena->shared[x], SWITCH_FALSE);
+	}
+
+	FREE(arena->shared);
+	FREE(arena);
+}
+
+static void *switch_event_arena_carve(switch_event_arena_chunk_t **list, switch_size_t len, switch_size_t grow)
+{
+	switch_event_arena_chunk_t *chunk = *list;
+	void *ptr;
+
+	len = (len + 7) & ~((switch_size_t) 7);
+
+	if (!chunk || chunk->used + len > chunk->size) {
+		/* a dup keeps every string chunk of its source alive, so grow in small steps rather than doubling */
+		switch_size_t size = grow < len ? len : grow;
+
+		chunk = ALLOC(sizeof(*chunk) + size);
+		switch_assert(chunk);
+		chunk->data = (char *) (chunk + 1);
+		chunk->used = 0;
+		chunk->size = size;
+		chunk->next = *list;
+		*list = chunk;
+
+		switch_atomic64_inc(&EVENT_ARENA_STATS.chunks);
+		switch_atomic64_add(&EVENT_ARENA_STATS.bytes, size);
+	}
+
+	ptr = chunk->data + chunk->used;
+	chunk->used += len;
+
+	return ptr;
+}
+
+static inline void *switch_event_arena_alloc(switch_event_arena_t *arena, switch_size_t len)
+{
+	return switch_event_arena_carve(&arena->chunks, len, EVENT_ARENA_CHUNK);
+}
+
+static inline switch_event_header_t *switch_event_arena_header(switch_event_arena_t *arena, uint32_t count)
+{
+	return switch_event_arena_carve(&arena->header_chunks, sizeof(switch_event_header_t), count * sizeof(switch_event_header_t));
+}
+
+/* the arena new headers of the event go to, NULL once it has wasted too much to keep growing */
+static inline switch_event_arena_t *switch_event_arena_get(switch_event_t *event)
+{
+	return event->arena && event->arena->wasted <= EVENT_ARENA_MAX_WASTE ? event->arena : NULL;
+}
+
+static void switch_event_waste(switch_event_t *event, switch_size_t len)
+{
+	if (event->arena) {
+		event->arena->wasted += len;
+		switch_atomic64_add(&EVENT_ARENA_STATS.wasted, len);
+	}
+}
+
+/* drop a string the event no longer uses, held strings stay in the arena until it goes */
+static void switch_event_drop(switch_event_t *event, char *str, switch_bool_t held)
+{
+	if (!str) {
+		return;
+	}
+
+	if (held) {
+		switch_event_waste(event, (strlen(str) + 8) & ~((switch_size_t) 7));
+	} else {
+		free(str);
+	}
+}
+
+/* copy str into the event's arena when it has one, *held says where it went (NULL forces malloc) */
+static char *switch_event_strdup(switch_event_t *event, const char *str, switch_bool_t *held)
+{
+	switch_event_arena_t *arena = held ? switch_event_arena_get(event) : NULL;
+	switch_size_t len;
+	char *new;
+
+	if (!arena) {
+		if (held) {
+			*held = SWITCH_FALSE;
+		}
+		return DUP(str);
+	}
+
+	*held = SWITCH_TRUE;
+	len = strlen(str) + 1;
+	new = switch_event_arena_alloc(arena, len);
+
+	return (char *) memcpy(new, str, len);
+}
+
+/* reference the source arena, and every arena it shares, from the arena of a dup */
+static void switch_event_arena_share(switch_event_t *event, switch_event_t *todup)
+{
+	switch_event_arena_t *arena = event->arena, *src = todup->arena;
+	uint32_t x;
+
+	arena->shared = ALLOC(sizeof(switch_event_arena_t *) * (src->shared_count + 1));
+	switch_assert(arena->shared);
+
+	switch_atomic_inc(&src->refs);
+	arena->shared[arena->shared_count++] = src;
+
+	for (x = 0; x < src->shared_count; x++) {
+		switch_atomic_inc(&src->shared[x]->refs);
+		arena->shared[arena->shared_count++] = src->shared[x];
+	}
+}
+
+static void switch_event_intern_init(void)
+{
+	switch_size_t off = 0, len;
+	switch_ssize_t hlen;
+	int x;
+
+	if (EVENT_INTERN_TABLE[0] || *EVENT_INTERN_BLOCK) {
+		return;
+	}
+
+	for (x = 0; EVENT_COMMON_HEADERS[x]; x++) {
+		uint32_t slot;
+
+		len = strlen(EVENT_COMMON_HEADERS[x]) + 1;
+		switch_assert(off + len <= sizeof(EVENT_INTERN_BLOCK));
+		memcpy(EVENT_INTERN_BLOCK + off, EVENT_COMMON_HEADERS[x], len);
+
+		hlen = -1;
+		slot = switch_ci_hashfunc_default(EVENT_COMMON_HEADERS[x], &hlen) & (EVENT_INTERN_SIZE - 1);
+		while (EVENT_INTERN_TABLE[slot]) {
+			slot = (slot + 1) & (EVENT_INTERN_SIZE - 1);
+		}
+		EVENT_INTERN_TABLE[slot] = EVENT_INTERN_BLOCK + off;
+
+		off += len;
+	}
+}
+
+/* set the name of hp, from the intern table when it is a common one */
+static void switch_event_intern_name(switch_event_t *event, switch_event_header_t *hp, const char *name, unsigned long hash)
+{
+	uint32_t slot = hash & (EVENT_INTERN_SIZE - 1);
+	switch_bool_t held = SWITCH_TRUE;
+
+	while (EVENT_INTERN_TABLE[slot]) {
+		if (!strcmp(EVENT_INTERN_TABLE[slot], name)) {
+			hp->name = (char *) EVENT_INTERN_TABLE[slot];
+			goto done;
+		}
+		slot = (slot + 1) & (EVENT_INTERN_SIZE - 1);
+	}
+
+	hp->name = switch_event_strdup(event, name, &held);
+
+  done:
+	if (held) {
+		hp->flags |= EHF_NAME_HELD;
+	} else {
+		hp->flags &= ~EHF_NAME_HELD;
+	}
+}
+
+static switch_event_header_t *switch_event_index_find(switch_event_t *event, const char *header_name, unsigned long hash)
+{
+	uint32_t mask = event->index_size - 1, slot;
+	switch_event_header_t *hp;
+
+	for (slot = hash & mask; (hp = event->index[slot]); slot = (slot + 1) & mask) {
+		if (hp->hash == hash && !strcasecmp(hp->name, header_name)) {
+			return hp;
+		}
+	}
+
+	return NULL;
+}
+
+/* only the first header of a given name in list order is indexed, replace is used when a header is put in front of it */
+static void switch_event_index_put(switch_event_t *event, switch_event_header_t *header, switch_bool_t replace)
+{
+	uint32_t mask = event->index_size - 1, slot;
+	switch_event_header_t *hp;
+
+	for (slot = header->hash & mask; (hp = event->index[slot]); slot = (slot + 1) & mask) {
+		if (hp->hash == header->hash && !strcasecmp(hp->name, header->name)) {
+			if (replace) {
+				event->index[slot] = header;
+			}
+			return;
+		}
+	}
+
+	event->index[slot] = header;
+}
+
+static void switch_event_index_remove(switch_event_t *event, const char *header_name, unsigned long hash)
+{
+	uint32_t mask = event->index_size - 1, slot, next, home;
+	switch_event_header_t *hp;
+
+	for (slot = hash & mask; (hp = event->index[slot]); slot = (slot + 1) & mask) {
+		if (hp->hash == hash && !strcasecmp(hp->name, header_name)) {
+			break;
+		}
+	}
+
+	if (!hp) {
+		return;
+	}
+
+	event->index[slot] = NULL;
+
+	/* shift back the rest of the probe run so later lookups don't stop at the hole */
+	for (next = (slot + 1) & mask; (hp = event->index[next]); next = (next + 1) & mask) {
+		home = hp->hash & mask;
+
+		if ((next > slot && (home <= slot || home > next)) || (next < slot && home <= slot && home > next)) {
+			event->index[slot] = hp;
+			event->index[next] = NULL;
+			slot = next;
+		}
+	}
+}
+
+static void switch_event_index_build(switch_event_t *event)
+{
+	switch_event_header_t *hp;
+	uint32_t size = EVENT_INDEX_MIN * 4;
+
+	while (size < event->header_count * 4) {
+		size <<= 1;
+	}
+
+	FREE(event->index);
+	event->index = calloc(size, sizeof(switch_event_header_t *));
+	switch_assert(event->index);
+	event->index_size = size;
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		switch_event_index_put(event, hp, SWITCH_FALSE);
+	}
+}
+
+/* called every time a header is linked into the list */
+static void switch_event_index_add(switch_event_t *event, switch_event_header_t *header, switch_bool_t top)
+{
+	event->header_count++;
+
+	if (event->index_size && event->header_count * 2 <= event->index_size) {
+		switch_event_index_put(event, header, top);
+	} else if (event->header_count >= EVENT_INDEX_MIN) {
+		switch_event_index_build(event);
+	}
+}
+
 /* make sure this is synced with the switch_event_types_t enum in switch_types.h
    also never put any new ones before EVENT_ALL
 */
@@ -292,6 +716,7 @@ static void *SWITCH_THREAD_FUNC switch_event_dispatch_thread(switch_thread_t *th
 {
 	switch_queue_t *queue = (switch_queue_t *) obj;
 	int my_id = 0;
+	uint32_t depth;
 
 	switch_mutex_lock(EVENT_QUEUE_MUTEX);
 	THREAD_COUNT++;
@@ -328,6 +753,10 @@ static void *SWITCH_THREAD_FUNC switch_event_dispatch_thread(switch_thread_t *th
 			break;
 		}
 
+		if ((depth = switch_queue_size(queue) + 1) > EVENT_DISPATCH_STATS[my_id].high_water) {
+			EVENT_DISPATCH_STATS[my_id].high_water = depth;
+		}
+
 		event = (switch_event_t *) pop;
 		switch_event_deliver(&event);
 		switch_os_yield();
@@ -345,62 +774,185 @@ static void *SWITCH_THREAD_FUNC switch_event_dispatch_thread(switch_thread_t *th
 
 }
 
-static int PENDING = 0;
-
+/*
+  Events are sharded across the dispatch queues by Unique-ID so every event for a given channel is
+  delivered in order by the same dispatch thread, while unrelated events no longer contend on one queue.
+  The shard count is fixed when dispatch starts, a channel never changes shard while its events are queued.
+  A full shard makes the producer wait on it, as a full queue always did.
+*/
 static switch_status_t switch_event_queue_dispatch_event(switch_event_t **eventp)
 {
-
 	switch_event_t *event = *eventp;
+	const char *uuid;
+	uint32_t shards, shard, x;
 
 	if (!SYSTEM_RUNNING) {
 		return SWITCH_STATUS_FALSE;
 	}
 
-	while (event) {
-		int launch = 0;
+	shards = EVENT_DISPATCH_SHARDS;
+
+	if ((uuid = switch_event_get_header(event, "Unique-ID"))) {
+		switch_ssize_t klen = -1;
+
+		shard = switch_hashfunc_default(uuid, &klen) % shards;
+	} else {
+		shard = (uint32_t) (switch_atomic64_inc(&EVENT_DISPATCH_RR) % shards);
+	}
+
+	*eventp = NULL;
 
-		switch_mutex_lock(EVENT_QUEUE_MUTEX);
+	if (switch_queue_trypush(EVENT_DISPATCH_QUEUES[shard], event) == SWITCH_STATUS_SUCCESS) {
+		goto pushed;
+	}
+
+	switch_atomic64_inc(&EVENT_DISPATCH_STATS[shard].full);
+
+	/* nothing to keep in order without a Unique-ID, any shard with room will do */
+	if (!uuid) {
+		for (x = 1; x < shards; x++) {
+			uint32_t next = (shard + x) % shards;
 
-		if (!PENDING && switch_queue_size(EVENT_DISPATCH_QUEUE) > (unsigned int)(DISPATCH_QUEUE_LEN * DISPATCH_THREAD_COUNT)) {
-			if (SOFT_MAX_DISPATCH + 1 > MAX_DISPATCH) {
-				launch++;
-				PENDING++;
+			if (switch_queue_trypush(EVENT_DISPATCH_QUEUES[next], event) == SWITCH_STATUS_SUCCESS) {
+				switch_atomic64_inc(&EVENT_DISPATCH_STATS[shard].spilled);
+				shard = next;
+				goto pushed;
 			}
 		}
+	}
 
-		switch_mutex_unlock(EVENT_QUEUE_MUTEX);
+	switch_queue_push(EVENT_DISPATCH_QUEUES[shard], event);
 
-		if (launch) {
-			if (SOFT_MAX_DISPATCH + 1 < MAX_DISPATCH) {
-				switch_event_launch_dispatch_threads(SOFT_MAX_DISPATCH + 1);
-			}
+  pushed:
+	switch_atomic64_inc(&EVENT_DISPATCH_STATS[shard].pushed);
 
-			switch_mutex_lock(EVENT_QUEUE_MUTEX);
-			PENDING--;
-			switch_mutex_unlock(EVENT_QUEUE_MUTEX);
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void event_node_free(switch_event_node_t *node)
+{
+	switch_memory_pool_t *pool = node->pool;
+
+	while (node->head != node->tail) {
+		switch_event_destroy(&node->queue[node->head++ & (BINDING_QUEUE_LEN - 1)]);
+	}
+
+	FREE(node->queue);
+	FREE(node->subclass_name);
+	FREE(node->id);
+	FREE(node);
+	switch_core_destroy_memory_pool(&pool);
+}
+
+/* one drainer per binding at a time, so a binding sees its events in the order they were queued */
+static void *SWITCH_THREAD_FUNC switch_event_node_thread(switch_thread_t *thread, void *obj)
+{
+	switch_event_node_t *node = (switch_event_node_t *) obj;
+	switch_event_t *event;
+	int unbound;
+
+	switch_mutex_lock(node->mutex);
+	node->drainer = switch_thread_self();
+
+	while (!node->unbound && node->head != node->tail) {
+		switch_time_t started;
+		uint64_t elapsed, max;
+
+		event = node->queue[node->head++ & (BINDING_QUEUE_LEN - 1)];
+		switch_mutex_unlock(node->mutex);
+
+		started = switch_time_ref();
+		node->callback(event);
+		elapsed = (uint64_t) (switch_time_ref() - started);
+
+		switch_atomic64_inc(&node->calls);
+		switch_atomic64_add(&node->total_usec, elapsed);
+		for (max = switch_atomic64_read(&node->max_usec); elapsed > max;) {
+			uint64_t seen = switch_atomic64_cas(&node->max_usec, elapsed, max);
+
+			if (seen == max) {
+				break;
+			}
+			max = seen;
 		}
 
-		*eventp = NULL;
-		switch_queue_push(EVENT_DISPATCH_QUEUE, event);
-		event = NULL;
+		switch_event_destroy(&event);
+		switch_mutex_lock(node->mutex);
+	}
+
+	node->draining = 0;
+	unbound = node->unbound;
+	switch_mutex_unlock(node->mutex);
 
+	if (unbound == 2) {
+		event_node_free(node);
 	}
 
-	return SWITCH_STATUS_SUCCESS;
+	return NULL;
 }
 
+/* takes the event, the caller holds RWLOCK so the node stays bound */
+static void event_node_queue(switch_event_node_t *node, switch_event_t **event)
+{
+	switch_thread_data_t *td;
+	uint32_t depth;
+	int launch = 0;
+
+	(*event)->bind_user_data = node->user_data;
+
+	switch_mutex_lock(node->mutex);
+	if ((depth = node->tail - node->head) == BINDING_QUEUE_LEN) {
+		switch_mutex_unlock(node->mutex);
+		switch_atomic64_inc(&node->drops);
+		switch_event_destroy(event);
+		return;
+	}
+
+	node->queue[node->tail++ & (BINDING_QUEUE_LEN - 1)] = *event;
+	*event = NULL;
+
+	if (++depth > node->high_water) {
+		node->high_water = depth;
+	}
+
+	if (!node->draining) {
+		node->draining = launch = 1;
+	}
+	switch_mutex_unlock(node->mutex);
+
+	if (launch) {
+		switch_zmalloc(td, sizeof(*td));
+		td->alloc = 1;
+		td->func = switch_event_node_thread;
+		td->obj = node;
+		switch_thread_pool_launch_thread(&td);
+	}
+}
+
+/*
+  Each matching binding gets the event on its own bounded queue and a pool thread runs the callbacks,
+  a slow binding only backs up its own queue.  Every binding but the last gets a copy.
+*/
 SWITCH_DECLARE(void) switch_event_deliver(switch_event_t **event)
 {
 	switch_event_types_t e;
-	switch_event_node_t *node;
+	switch_event_node_t *node, *last = NULL;
 
 	if (SYSTEM_RUNNING) {
 		switch_thread_rwlock_rdlock(RWLOCK);
 		for (e = (*event)->event_id;; e = SWITCH_EVENT_ALL) {
 			for (node = EVENT_NODES[e]; node; node = node->next) {
 				if (switch_events_match(*event, node)) {
-					(*event)->bind_user_data = node->user_data;
-					node->callback(*event);
+					if (last) {
+						switch_event_t *dup;
+
+						if (switch_event_dup(&dup, *event) == SWITCH_STATUS_SUCCESS) {
+							event_node_queue(last, &dup);
+						} else {
+							switch_atomic64_inc(&last->drops);
+						}
+					}
+					last = node;
 				}
 			}
 
@@ -408,6 +960,10 @@ SWITCH_DECLARE(void) switch_event_deliver(switch_event_t **event)
 				break;
 			}
 		}
+
+		if (last) {
+			event_node_queue(last, event);
+		}
 		switch_thread_rwlock_unlock(RWLOCK);
 	}
 
@@ -547,18 +1103,18 @@ SWITCH_DECLARE(switch_status_t) switch_event_shutdown(void)
 	if (runtime.events_use_dispatch) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Stopping dispatch queues\n");
 
-		for(x = 0; x < (uint32_t)DISPATCH_THREAD_COUNT; x++) {
-			switch_queue_trypush(EVENT_DISPATCH_QUEUE, NULL);
+		for(x = 0; x < SOFT_MAX_DISPATCH; x++) {
+			switch_queue_trypush(EVENT_DISPATCH_QUEUES[x], NULL);
+			switch_queue_interrupt_all(EVENT_DISPATCH_QUEUES[x]);
 		}
 		
-
-		switch_queue_interrupt_all(EVENT_DISPATCH_QUEUE);
-		
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Stopping dispatch threads\n");
 		
-		for(x = 0; x < (uint32_t)DISPATCH_THREAD_COUNT; x++) {
+		for(x = 0; x < SOFT_MAX_DISPATCH; x++) {
 			switch_status_t st;
-			switch_thread_join(&st, EVENT_DISPATCH_QUEUE_THREADS[x]);
+			if (EVENT_DISPATCH_QUEUE_THREADS[x]) {
+				switch_thread_join(&st, EVENT_DISPATCH_QUEUE_THREADS[x]);
+			}
 		}
 	}
 
@@ -575,9 +1131,11 @@ SWITCH_DECLARE(switch_status_t) switch_event_shutdown(void)
 		void *pop = NULL;
 		switch_event_t *event = NULL;
 
-		while (switch_queue_trypop(EVENT_DISPATCH_QUEUE, &pop) == SWITCH_STATUS_SUCCESS && pop) {
-			event = (switch_event_t *) pop;
-			switch_event_destroy(&event);
+		for(x = 0; x < MAX_DISPATCH && EVENT_DISPATCH_QUEUES[x]; x++) {
+			while (switch_queue_trypop(EVENT_DISPATCH_QUEUES[x], &pop) == SWITCH_STATUS_SUCCESS && pop) {
+				event = (switch_event_t *) pop;
+				switch_event_destroy(&event);
+			}
 		}
 	}
 
@@ -603,23 +1161,17 @@ SWITCH_DECLARE(switch_status_t) switch_event_shutdown(void)
 
 static void check_dispatch(void)
 {
-	if (!EVENT_DISPATCH_QUEUE) {
-		switch_mutex_lock(BLOCK);
-		
-		if (!EVENT_DISPATCH_QUEUE) {
-			switch_queue_create(&EVENT_DISPATCH_QUEUE, DISPATCH_QUEUE_LEN * MAX_DISPATCH, THRUNTIME_POOL);
-			switch_event_launch_dispatch_threads(1);
-			
-			while (!THREAD_COUNT) {
-				switch_cond_next();
-			}
-		}
-		switch_mutex_unlock(BLOCK);
-	}            
+	if (!EVENT_DISPATCH_SHARDS) {
+		switch_event_launch_dispatch_threads(MAX_DISPATCH);
+	}
 }
 
 
 
+/*
+  Starts one dispatch thread per shard.  Whichever comes first, event-dispatch-threads or the first
+  queued event, sets the shard count, it cannot change once events have been hashed onto the shards.
+*/
 SWITCH_DECLARE(void) switch_event_launch_dispatch_threads(uint32_t max)
 {
 	switch_threadattr_t *thd_attr;
@@ -629,25 +1181,33 @@ SWITCH_DECLARE(void) switch_event_launch_dispatch_threads(uint32_t max)
 
 	switch_memory_pool_t *pool = RUNTIME_POOL;
 
-	check_dispatch();
-
 	if (max > MAX_DISPATCH) {
-		return;
+		max = MAX_DISPATCH;
 	}
 
-	if (max < SOFT_MAX_DISPATCH) {
-		return;
+	if (max < 1) {
+		max = 1;
 	}
 
-	for (index = SOFT_MAX_DISPATCH; index < max && index < MAX_DISPATCH; index++) {
-		if (EVENT_DISPATCH_QUEUE_THREADS[index]) {
-			continue;
+	switch_mutex_lock(BLOCK);
+
+	if (EVENT_DISPATCH_SHARDS) {
+		if (max != EVENT_DISPATCH_SHARDS) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Event dispatch already runs %u shards, %u takes effect after a restart\n",
+							  EVENT_DISPATCH_SHARDS, max);
 		}
+		switch_mutex_unlock(BLOCK);
+		return;
+	}
+
+	memset(EVENT_DISPATCH_STATS, 0, sizeof(EVENT_DISPATCH_STATS));
 
+	for (index = 0; index < max; index++) {
+		switch_queue_create(&EVENT_DISPATCH_QUEUES[index], DISPATCH_QUEUE_LEN, THRUNTIME_POOL);
 		switch_threadattr_create(&thd_attr, pool);
 		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
 		switch_threadattr_priority_set(thd_attr, SWITCH_PRI_REALTIME);
-		switch_thread_create(&EVENT_DISPATCH_QUEUE_THREADS[index], thd_attr, switch_event_dispatch_thread, EVENT_DISPATCH_QUEUE, pool);
+		switch_thread_create(&EVENT_DISPATCH_QUEUE_THREADS[index], thd_attr, switch_event_dispatch_thread, EVENT_DISPATCH_QUEUES[index], pool);
 		while(--sanity && !EVENT_DISPATCH_QUEUE_RUNNING[index]) switch_yield(10000);
 
 		if (index == 1) {
@@ -659,6 +1219,48 @@ SWITCH_DECLARE(void) switch_event_launch_dispatch_threads(uint32_t max)
 	}
 
 	SOFT_MAX_DISPATCH = index;
+	/* producers only read the count, every queue it covers exists by now */
+	EVENT_DISPATCH_SHARDS = index;
+	switch_mutex_unlock(BLOCK);
+}
+
+SWITCH_DECLARE(void) switch_event_dispatch_status(switch_stream_handle_t *stream)
+{
+	switch_event_types_t e;
+	switch_event_node_t *node;
+	uint32_t x;
+
+	stream->write_function(stream, "Dispatch shards: %u\n", EVENT_DISPATCH_SHARDS);
+
+	for (x = 0; x < EVENT_DISPATCH_SHARDS; x++) {
+		switch_event_dispatch_stats_t *stats = &EVENT_DISPATCH_STATS[x];
+
+		stream->write_function(stream, "  shard %u: depth %u high-water %u pushed %" SWITCH_UINT64_T_FMT " full %" SWITCH_UINT64_T_FMT " spilled %" SWITCH_UINT64_T_FMT "\n",
+							   x, switch_queue_size(EVENT_DISPATCH_QUEUES[x]), stats->high_water, switch_atomic64_read(&stats->pushed),
+							   switch_atomic64_read(&stats->full), switch_atomic64_read(&stats->spilled));
+	}
+
+	stream->write_function(stream, "\nArena: events %" SWITCH_UINT64_T_FMT " chunks %" SWITCH_UINT64_T_FMT " bytes %" SWITCH_UINT64_T_FMT
+						   " shared values %" SWITCH_UINT64_T_FMT " wasted %" SWITCH_UINT64_T_FMT "\n",
+						   switch_atomic64_read(&EVENT_ARENA_STATS.arenas), switch_atomic64_read(&EVENT_ARENA_STATS.chunks),
+						   switch_atomic64_read(&EVENT_ARENA_STATS.bytes), switch_atomic64_read(&EVENT_ARENA_STATS.shared_values),
+						   switch_atomic64_read(&EVENT_ARENA_STATS.wasted));
+
+	stream->write_function(stream, "\nBindings:\n");
+
+	switch_thread_rwlock_rdlock(RWLOCK);
+	for (e = 0; e <= SWITCH_EVENT_ALL; e++) {
+		for (node = EVENT_NODES[e]; node; node = node->next) {
+			uint64_t calls = switch_atomic64_read(&node->calls);
+
+			stream->write_function(stream, "  %s %s%s%s: calls %" SWITCH_UINT64_T_FMT " avg %" SWITCH_UINT64_T_FMT "us max %" SWITCH_UINT64_T_FMT
+								   "us depth %u high-water %u drops %" SWITCH_UINT64_T_FMT "\n",
+								   node->id, switch_event_name(node->event_id), node->subclass_name ? "::" : "", switch_str_nil(node->subclass_name),
+								   calls, calls ? switch_atomic64_read(&node->total_usec) / calls : 0, switch_atomic64_read(&node->max_usec),
+								   node->tail - node->head, node->high_water, switch_atomic64_read(&node->drops));
+		}
+	}
+	switch_thread_rwlock_unlock(RWLOCK);
 }
 
 SWITCH_DECLARE(switch_status_t) switch_event_init(switch_memory_pool_t *pool)
@@ -677,6 +1279,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_init(switch_memory_pool_t *pool)
 	switch_mutex_init(&POOL_LOCK, SWITCH_MUTEX_NESTED, RUNTIME_POOL);
 	switch_mutex_init(&EVENT_QUEUE_MUTEX, SWITCH_MUTEX_NESTED, RUNTIME_POOL);
 	switch_core_hash_init(&CUSTOM_HASH);
+	switch_event_intern_init();
 
 	if (switch_core_test_flag(SCF_MINIMAL)) {
 		return SWITCH_STATUS_SUCCESS;
@@ -706,7 +1309,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_init(switch_memory_pool_t *pool)
 	switch_queue_create(&EVENT_HEADER_RECYCLE_QUEUE, 250000, THRUNTIME_POOL);
 #endif
 
-	check_dispatch();
+	/* dispatch starts with the first event, after switch.conf had its say on the shard count */
 
 	switch_mutex_lock(EVENT_QUEUE_MUTEX);
 	SYSTEM_RUNNING = 1;
@@ -742,6 +1345,8 @@ SWITCH_DECLARE(switch_status_t) switch_event_create_subclass_detailed(const char
 
 	if (event_id == SWITCH_EVENT_REQUEST_PARAMS || event_id == SWITCH_EVENT_CHANNEL_DATA || event_id == SWITCH_EVENT_MESSAGE) {
 		(*event)->flags |= EF_UNIQ_HEADERS;
+	} else if (event_id != SWITCH_EVENT_CLONE) {
+		(*event)->arena = switch_event_arena_create(EVENT_ARENA_CHUNK);
 	}
 
 	if (event_id != SWITCH_EVENT_CLONE) {
@@ -781,14 +1386,18 @@ SWITCH_DECLARE(switch_status_t) switch_event_rename_header(switch_event_t *event
 
 	for (hp = event->headers; hp; hp = hp->next) {
 		if ((!hp->hash || hash == hp->hash) && !strcasecmp(hp->name, header_name)) {
-			FREE(hp->name);
-			hp->name = DUP(new_header_name);
+			switch_event_drop(event, hp->name, (hp->flags & EHF_NAME_HELD));
 			hlen = -1;
-			hp->hash = switch_ci_hashfunc_default(hp->name, &hlen);
+			hp->hash = switch_ci_hashfunc_default(new_header_name, &hlen);
+			switch_event_intern_name(event, hp, new_header_name, hp->hash);
 			x++;
 		}
 	}
 
+	if (x && event->index_size) {
+		switch_event_index_build(event);
+	}
+
 	return x ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
 }
 
@@ -806,6 +1415,10 @@ SWITCH_DECLARE(switch_event_header_t *) switch_event_get_header_ptr(switch_event
 
 	hash = switch_ci_hashfunc_default(header_name, &hlen);
 
+	if (event->index_size) {
+		return switch_event_index_find(event, header_name, hash);
+	}
+
 	for (hp = event->headers; hp; hp = hp->next) {
 		if ((!hp->hash || hash == hp->hash) && !strcasecmp(hp->name, header_name)) {
 			return hp;
@@ -842,7 +1455,7 @@ SWITCH_DECLARE(char *) switch_event_get_body(switch_event_t *event)
 
 SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *event, const char *header_name, const char *val)
 {
-	switch_event_header_t *hp, *lp = NULL, *tp;
+	switch_event_header_t *hp, *lp = NULL, *tp, *first_left = NULL;
 	switch_status_t status = SWITCH_STATUS_FALSE;
 	int x = 0;
 	switch_ssize_t hlen = -1;
@@ -850,6 +1463,11 @@ SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *even
 
 	tp = event->headers;
 	hash = switch_ci_hashfunc_default(header_name, &hlen);
+
+	if (event->index_size) {
+		switch_event_index_remove(event, header_name, hash);
+	}
+
 	while (tp) {
 		hp = tp;
 		tp = tp->next;
@@ -866,7 +1484,8 @@ SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *even
 			if (hp == event->last_header || !hp->next) {
 				event->last_header = lp;
 			}
-			FREE(hp->name);
+			event->header_count--;
+			switch_event_drop(event, hp->name, (hp->flags & EHF_NAME_HELD));
 
 			if (hp->idx) {
 				int i = 0;
@@ -877,29 +1496,46 @@ SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *even
 				FREE(hp->array);
 			}
 
-			FREE(hp->value);
+			switch_event_drop(event, hp->value, (hp->flags & EHF_VALUE_HELD));
 
-			memset(hp, 0, sizeof(*hp));
+			if ((hp->flags & EHF_HEADER_HELD)) {
+				switch_event_waste(event, sizeof(*hp));
+				memset(hp, 0, sizeof(*hp));
+			} else {
+				memset(hp, 0, sizeof(*hp));
 #ifdef SWITCH_EVENT_RECYCLE
-			if (switch_queue_trypush(EVENT_HEADER_RECYCLE_QUEUE, hp) != SWITCH_STATUS_SUCCESS) {
-				FREE(hp);
-			}
+				if (switch_queue_trypush(EVENT_HEADER_RECYCLE_QUEUE, hp) != SWITCH_STATUS_SUCCESS) {
+					FREE(hp);
+				}
 #else
-			FREE(hp);
+				FREE(hp);
 #endif
+			}
 			status = SWITCH_STATUS_SUCCESS;
 		} else {
+			if (!first_left && (!hp->hash || hash == hp->hash) && !strcasecmp(header_name, hp->name)) {
+				first_left = hp;
+			}
 			lp = hp;
 		}
 	}
 
+	if (first_left && event->index_size) {
+		switch_event_index_put(event, first_left, SWITCH_TRUE);
+	}
+
 	return status;
 }
 
-static switch_event_header_t *new_header(const char *header_name)
+static switch_event_header_t *new_header(switch_event_t *event, const char *header_name)
 {
 	switch_event_header_t *header;
+	switch_event_arena_t *arena;
+	switch_ssize_t hlen = -1;
 
+	if ((arena = switch_event_arena_get(event))) {
+		header = switch_event_arena_header(arena, EVENT_ARENA_CHUNK / sizeof(*header));
+	} else {
 #ifdef SWITCH_EVENT_RECYCLE
 		void *pop;
 		if (EVENT_HEADER_RECYCLE_QUEUE && switch_queue_trypop(EVENT_HEADER_RECYCLE_QUEUE, &pop) == SWITCH_STATUS_SUCCESS) {
@@ -911,9 +1547,14 @@ static switch_event_header_t *new_header(const char *header_name)
 #ifdef SWITCH_EVENT_RECYCLE
 		}
 #endif
+	}
 
 		memset(header, 0, sizeof(*header));
-		header->name = DUP(header_name);
+		if (arena) {
+			header->flags |= EHF_HEADER_HELD;
+		}
+		header->hash = switch_ci_hashfunc_default(header_name, &hlen);
+		switch_event_intern_name(event, header, header_name, header->hash);
 
 		return header;
 
@@ -965,10 +1606,10 @@ SWITCH_DECLARE(int) switch_event_add_array(switch_event_t *event, const char *va
 	return 0;
 }
 
-static switch_status_t switch_event_base_add_header(switch_event_t *event, switch_stack_t stack, const char *header_name, char *data)
+/* data is the event's from here on, held says it is in the arena rather than malloc'd */
+static switch_status_t switch_event_base_add_header(switch_event_t *event, switch_stack_t stack, const char *header_name, char *data, switch_bool_t held)
 {
 	switch_event_header_t *header = NULL;
-	switch_ssize_t hlen = -1;
 	int exists = 0, fly = 0;
 	char *index_ptr;
 	int index = 0;
@@ -993,7 +1634,7 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 
 		if (!(header = switch_event_get_header_ptr(event, header_name)) && index_ptr) {
 
-			header = new_header(header_name);
+			header = new_header(event, header_name);
 
 			if (switch_test_flag(event, EF_UNIQ_HEADERS)) {
 				switch_event_del_header(event, header_name);
@@ -1045,7 +1686,7 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 
 		if (zstr(data)) {
 			switch_event_del_header(event, header_name);
-			FREE(data);
+			switch_event_drop(event, data, held);
 			goto end;
 		}
 
@@ -1055,12 +1696,12 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 
 		if (!strncmp(data, "ARRAY::", 7)) {
 			switch_event_add_array(event, header_name, data);
-			FREE(data);
+			switch_event_drop(event, data, held);
 			goto end;
 		}
 
 
-		header = new_header(header_name);
+		header = new_header(event, header_name);
 	}
 
 	if ((stack & SWITCH_STACK_PUSH) || (stack & SWITCH_STACK_UNSHIFT)) {
@@ -1069,10 +1710,24 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 		char *hv;
 		int i = 0, j = 0;
 
+		/* array entries are always malloc'd */
+		if (held) {
+			char *copy = DUP(data);
+
+			switch_event_drop(event, data, held);
+			data = copy;
+		}
+
 		if (header->value && !header->idx) {
 			m = malloc(sizeof(char *));
 			switch_assert(m);
-			m[0] = header->value;
+			if ((header->flags & EHF_VALUE_HELD)) {
+				m[0] = DUP(header->value);
+				switch_event_drop(event, header->value, SWITCH_TRUE);
+				header->flags &= ~EHF_VALUE_HELD;
+			} else {
+				m[0] = header->value;
+			}
 			header->value = NULL;
 			header->array = m;
 			header->idx++;
@@ -1103,7 +1758,14 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 
 		if (len) {
 			len += 8;
-			hv = realloc(header->value, len);
+			if ((header->flags & EHF_VALUE_HELD)) {
+				/* the old value lives in the arena, it is rebuilt from the array below anyway */
+				switch_event_drop(event, header->value, SWITCH_TRUE);
+				header->flags &= ~EHF_VALUE_HELD;
+				hv = malloc(len);
+			} else {
+				hv = realloc(header->value, len);
+			}
 			switch_assert(hv);
 			header->value = hv;
 
@@ -1126,13 +1788,16 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 		}
 
 	} else {
-		switch_safe_free(header->value);
+		switch_event_drop(event, header->value, (header->flags & EHF_VALUE_HELD));
 		header->value = data;
+		if (held) {
+			header->flags |= EHF_VALUE_HELD;
+		} else {
+			header->flags &= ~EHF_VALUE_HELD;
+		}
 	}
 
 	if (!exists) {
-		header->hash = switch_ci_hashfunc_default(header->name, &hlen);
-
 		if ((stack & SWITCH_STACK_TOP)) {
 			header->next = event->headers;
 			event->headers = header;
@@ -1148,6 +1813,8 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 			}
 			event->last_header = header;
 		}
+
+		switch_event_index_add(event, header, (stack & SWITCH_STACK_TOP) ? SWITCH_TRUE : SWITCH_FALSE);
 	}
 
  end:
@@ -1171,7 +1838,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_add_header(switch_event_t *event, s
 		return SWITCH_STATUS_MEMERR;
 	}
 
-	return switch_event_base_add_header(event, stack, header_name, data);
+	return switch_event_base_add_header(event, stack, header_name, data, SWITCH_FALSE);
 }
 
 SWITCH_DECLARE(switch_status_t) switch_event_set_subclass_name(switch_event_t *event, const char *subclass_name)
@@ -1189,7 +1856,17 @@ SWITCH_DECLARE(switch_status_t) switch_event_set_subclass_name(switch_event_t *e
 SWITCH_DECLARE(switch_status_t) switch_event_add_header_string(switch_event_t *event, switch_stack_t stack, const char *header_name, const char *data)
 {
 	if (data) {
-		return switch_event_base_add_header(event, stack, header_name, (stack & SWITCH_STACK_NODUP) ? (char *)data : DUP(data));
+		switch_bool_t held = SWITCH_FALSE;
+		char *value;
+
+		if ((stack & SWITCH_STACK_NODUP)) {
+			value = (char *) data;
+		} else {
+			/* pushed values end up in the header array, which is malloc'd */
+			value = switch_event_strdup(event, data, (stack & (SWITCH_STACK_PUSH | SWITCH_STACK_UNSHIFT)) ? NULL : &held);
+		}
+
+		return switch_event_base_add_header(event, stack, header_name, value, held);
 	}
 	return SWITCH_STATUS_GENERR;
 }
@@ -1251,22 +1928,32 @@ SWITCH_DECLARE(void) switch_event_destroy(switch_event_t **event)
 				}
 			}
 
-			FREE(this->name);
-			FREE(this->value);
+			if (!(this->flags & EHF_NAME_HELD)) {
+				FREE(this->name);
+			}
 
+			if (!(this->flags & EHF_VALUE_HELD)) {
+				FREE(this->value);
+			}
 
+			if (!(this->flags & EHF_HEADER_HELD)) {
 #ifdef SWITCH_EVENT_RECYCLE
-			if (switch_queue_trypush(EVENT_HEADER_RECYCLE_QUEUE, this) != SWITCH_STATUS_SUCCESS) {
-				FREE(this);
-			}
+				if (switch_queue_trypush(EVENT_HEADER_RECYCLE_QUEUE, this) != SWITCH_STATUS_SUCCESS) {
+					FREE(this);
+				}
 #else
-			FREE(this);
+				FREE(this);
 #endif
+			}
 
 
 		}
 		FREE(ep->body);
 		FREE(ep->subclass_name);
+		FREE(ep->index);
+		if (ep->arena) {
+			switch_event_arena_release(ep->arena, SWITCH_TRUE);
+		}
 #ifdef SWITCH_EVENT_RECYCLE
 		if (switch_queue_trypush(EVENT_RECYCLE_QUEUE, ep) != SWITCH_STATUS_SUCCESS) {
 			FREE(ep);
@@ -1301,7 +1988,7 @@ SWITCH_DECLARE(void) switch_event_merge(switch_event_t *event, switch_event_t *t
 
 SWITCH_DECLARE(switch_status_t) switch_event_dup(switch_event_t **event, switch_event_t *todup)
 {
-	switch_event_header_t *hp;
+	switch_event_header_t *hp, *last;
 
 	if (switch_event_create_subclass(event, SWITCH_EVENT_CLONE, todup->subclass_name) != SWITCH_STATUS_SUCCESS) {
 		return SWITCH_STATUS_GENERR;
@@ -1311,19 +1998,87 @@ SWITCH_DECLARE(switch_status_t) switch_event_dup(switch_event_t **event, switch_
 	(*event)->event_user_data = todup->event_user_data;
 	(*event)->bind_user_data = todup->bind_user_data;
 	(*event)->flags = todup->flags;
+
+	/* the source is already well formed so copy the header list straight across instead of
+	   going back through switch_event_base_add_header, then index it once at the end */
+	last = (*event)->last_header;
+
+	if (todup->arena) {
+		/* strings come from the source, only the header structs need room */
+		(*event)->arena = switch_event_arena_create(0);
+		switch_event_arena_share(*event, todup);
+	}
+
 	for (hp = todup->headers; hp; hp = hp->next) {
+		switch_event_header_t *header;
+
 		if (todup->subclass_name && !strcmp(hp->name, "Event-Subclass")) {
 			continue;
 		}
 
+		if ((*event)->arena) {
+			header = switch_event_arena_header((*event)->arena, todup->header_count);
+			memset(header, 0, sizeof(*header));
+			header->flags = EHF_HEADER_HELD;
+		} else {
+			header = ALLOC(sizeof(*header));
+			switch_assert(header);
+			memset(header, 0, sizeof(*header));
+		}
+
+		/* held strings are interned or in an arena the dup now holds a reference on */
+		if ((hp->flags & EHF_NAME_HELD)) {
+			header->name = hp->name;
+			header->flags |= EHF_NAME_HELD;
+		} else {
+			switch_bool_t held;
+
+			header->name = switch_event_strdup(*event, hp->name, &held);
+			if (held) {
+				header->flags |= EHF_NAME_HELD;
+			}
+		}
+		header->hash = hp->hash;
+
+		if (hp->value) {
+			if ((hp->flags & EHF_VALUE_HELD)) {
+				header->value = hp->value;
+				header->flags |= EHF_VALUE_HELD;
+				switch_atomic64_inc(&EVENT_ARENA_STATS.shared_values);
+			} else {
+				switch_bool_t held;
+
+				header->value = switch_event_strdup(*event, hp->value, &held);
+				if (held) {
+					header->flags |= EHF_VALUE_HELD;
+				}
+			}
+		}
+
 		if (hp->idx) {
 			int i;
+
+			header->array = ALLOC(sizeof(char *) * hp->idx);
+			switch_assert(header->array);
 			for (i = 0; i < hp->idx; i++) {
-				switch_event_add_header_string(*event, SWITCH_STACK_PUSH, hp->name, hp->array[i]);
+				header->array[i] = DUP(hp->array[i]);
 			}
+			header->idx = hp->idx;
+		}
+
+		if (last) {
+			last->next = header;
 		} else {
-			switch_event_add_header_string(*event, SWITCH_STACK_BOTTOM, hp->name, hp->value);
+			(*event)->headers = header;
 		}
+		last = header;
+		(*event)->header_count++;
+	}
+
+	(*event)->last_header = last;
+
+	if ((*event)->header_count >= EVENT_INDEX_MIN) {
+		switch_event_index_build(*event);
 	}
 
 	if (todup->body) {
@@ -1483,6 +2238,72 @@ SWITCH_DECLARE(switch_status_t) switch_event_binary_serialize(switch_event_t *ev
 	return SWITCH_STATUS_SUCCESS;
 }
 
+static char *switch_event_wire_put(char *p, const char *str, uint32_t len)
+{
+	p[0] = (char) (len >> 24);
+	p[1] = (char) (len >> 16);
+	p[2] = (char) (len >> 8);
+	p[3] = (char) len;
+	p += 4;
+
+	if (str) {
+		memcpy(p, str, len);
+		p += len;
+		*p++ = '\0';
+	}
+
+	return p;
+}
+
+/*
+ * Length-prefixed layout shared with esl_event_create_binary():
+ *   [u32 header count] then per header [u32 len][name\0][u32 len][value\0], then [u32 len][body\0]
+ * All lengths are big-endian and exclude the NUL, which is kept so the receiver can point into the buffer.
+ * A missing body is sent as a bare zero length.
+ */
+SWITCH_DECLARE(switch_status_t) switch_event_serialize_binary(switch_event_t *event, char **str, switch_size_t *len)
+{
+	switch_event_header_t *hp;
+	switch_size_t total = 8;
+	uint32_t count = 0;
+	char *buf, *p;
+
+	*str = NULL;
+	*len = 0;
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		total += 10 + strlen(hp->name) + strlen(hp->value);
+		count++;
+	}
+
+	if (event->body) {
+		total += strlen(event->body) + 1;
+	}
+
+	buf = malloc(total);
+	switch_assert(buf);
+
+	p = switch_event_wire_put(buf, NULL, count);
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		p = switch_event_wire_put(p, hp->name, (uint32_t) strlen(hp->name));
+		p = switch_event_wire_put(p, hp->value, (uint32_t) strlen(hp->value));
+	}
+
+	if (event->body) {
+		p = switch_event_wire_put(p, event->body, (uint32_t) strlen(event->body));
+	} else {
+		p = switch_event_wire_put(p, NULL, 0);
+	}
+
+	switch_assert((switch_size_t) (p - buf) == total);
+
+	*str = buf;
+	*len = total;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 
 SWITCH_DECLARE(switch_status_t) switch_event_serialize(switch_event_t *event, char **str, switch_bool_t encode)
 {
@@ -1978,7 +2799,8 @@ SWITCH_DECLARE(switch_status_t) switch_event_fire_detailed(const char *file, con
 		(*event)->event_user_data = user_data;
 	}
 
-
+	/* show channels reads the store, it has to move with the channel and not with the dispatch queue */
+	switch_core_channel_store_event(*event);
 
 	if (runtime.events_use_dispatch) {
 		check_dispatch();
@@ -2037,6 +2859,9 @@ SWITCH_DECLARE(switch_status_t) switch_event_bind_removable(const char *id, swit
 
 	if (event <= SWITCH_EVENT_ALL) {
 		switch_zmalloc(event_node, sizeof(*event_node));
+		switch_zmalloc(event_node->queue, BINDING_QUEUE_LEN * sizeof(*event_node->queue));
+		switch_core_new_memory_pool(&event_node->pool);
+		switch_mutex_init(&event_node->mutex, SWITCH_MUTEX_NESTED, event_node->pool);
 		switch_thread_rwlock_wrlock(RWLOCK);
 		switch_mutex_lock(BLOCK);
 		/* <LOCKED> ----------------------------------------------- */
@@ -2075,9 +2900,34 @@ SWITCH_DECLARE(switch_status_t) switch_event_bind(const char *id, switch_event_t
 }
 
 
+/*
+  The node is off the list, nothing queues on it any more.  Wait out a callback that is running so the
+  caller can unload its module, unless the callback is the one unbinding, then its drainer frees the node.
+*/
+static void event_node_release(switch_event_node_t *node)
+{
+	switch_mutex_lock(node->mutex);
+	node->unbound = 1;
+
+	if (node->draining && switch_thread_equal(node->drainer, switch_thread_self())) {
+		node->unbound = 2;
+		switch_mutex_unlock(node->mutex);
+		return;
+	}
+
+	while (node->draining) {
+		switch_mutex_unlock(node->mutex);
+		switch_cond_next();
+		switch_mutex_lock(node->mutex);
+	}
+	switch_mutex_unlock(node->mutex);
+
+	event_node_free(node);
+}
+
 SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callback_t callback)
 {
-	switch_event_node_t *n, *np, *lnp = NULL;
+	switch_event_node_t *n, *np, *lnp = NULL, *removed = NULL;
 	switch_status_t status = SWITCH_STATUS_FALSE;
 	int id;
 
@@ -2098,9 +2948,8 @@ SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callba
 				}
 
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Event Binding deleted for %s:%s\n", n->id, switch_event_name(n->event_id));
-				FREE(n->subclass_name);
-				FREE(n->id);
-				FREE(n);
+				n->next = removed;
+				removed = n;
 				status = SWITCH_STATUS_SUCCESS;
 			} else {
 				lnp = n;
@@ -2111,6 +2960,11 @@ SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callba
 	switch_thread_rwlock_unlock(RWLOCK);
 	/* </LOCKED> ----------------------------------------------- */
 
+	while ((n = removed)) {
+		removed = n->next;
+		event_node_release(n);
+	}
+
 	return status;
 }
 
@@ -2138,9 +2992,6 @@ SWITCH_DECLARE(switch_status_t) switch_event_unbind(switch_event_node_t **node)
 				EVENT_NODES[n->event_id] = n->next;
 			}
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Event Binding deleted for %s:%s\n", n->id, switch_event_name(n->event_id));
-			FREE(n->subclass_name);
-			FREE(n->id);
-			FREE(n);
 			*node = NULL;
 			status = SWITCH_STATUS_SUCCESS;
 			break;
@@ -2151,6 +3002,10 @@ SWITCH_DECLARE(switch_status_t) switch_event_unbind(switch_event_node_t **node)
 	switch_thread_rwlock_unlock(RWLOCK);
 	/* </LOCKED> ----------------------------------------------- */
 
+	if (status == SWITCH_STATUS_SUCCESS) {
+		event_node_release(n);
+	}
+
 	return status;
 }
 
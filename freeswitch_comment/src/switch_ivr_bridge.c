@@ -263,6 +263,7 @@ static void *audio_bridge_thread(switch_thread_t *thread, void *obj)
 	int silence_val = 0, bypass_media_after_bridge = 0;
 	const char *bridge_answer_timeout = NULL;
 	int bridge_filter_dtmf, answer_timeout, sent_update = 0;
+	int rtp_relay = 0, relaying = 0;
 	time_t answer_limit = 0;
 	const char *exec_app = NULL;
 	const char *exec_data = NULL;
@@ -382,6 +383,9 @@ static void *audio_bridge_thread(switch_thread_t *thread, void *obj)
 
 	bridge_filter_dtmf = switch_true(switch_channel_get_variable(chan_a, "bridge_filter_dtmf"));
 
+	/* generated silence needs decoded audio, so it rules out relaying */
+	rtp_relay = !silence_val && switch_true(switch_channel_get_variable(chan_a, "bridge_rtp_relay"));
+
 	for (;;) {
 		switch_channel_state_t b_state;
 		switch_status_t status;
@@ -615,8 +619,19 @@ static void *audio_bridge_thread(switch_thread_t *thread, void *obj)
 		}
 #endif
 
+		/* same codec on both legs and nobody listening in: hand the encoded frames across without the core codec layer */
+		if (rtp_relay && relaying != (int) switch_core_session_relay_ready(session_a, session_b)) {
+			relaying = !relaying;
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session_a), SWITCH_LOG_DEBUG, "%s %s relaying audio to %s\n",
+							  switch_channel_get_name(chan_a), relaying ? "Start" : "Stop", switch_channel_get_name(chan_b));
+		}
+
 		/* read audio from 1 channel and write it to the other */
-		status = switch_core_session_read_frame(session_a, &read_frame, SWITCH_IO_FLAG_NONE, stream_id);
+		if (relaying) {
+			status = switch_core_session_relay_read(session_a, &read_frame, SWITCH_IO_FLAG_NONE, stream_id);
+		} else {
+			status = switch_core_session_read_frame(session_a, &read_frame, SWITCH_IO_FLAG_NONE, stream_id);
+		}
 
 		if (SWITCH_READ_ACCEPTABLE(status)) {
 			read_frame_count++;
@@ -635,7 +650,8 @@ static void *audio_bridge_thread(switch_thread_t *thread, void *obj)
 			}
 
 			if (status != SWITCH_STATUS_BREAK && !switch_channel_test_flag(chan_a, CF_HOLD) && !switch_channel_test_flag(chan_b, CF_LEG_HOLDING)) {
-				if (switch_core_session_write_frame(session_b, read_frame, SWITCH_IO_FLAG_NONE, stream_id) != SWITCH_STATUS_SUCCESS) {
+				if ((relaying ? switch_core_session_relay_write(session_b, read_frame, SWITCH_IO_FLAG_NONE, stream_id) :
+					 switch_core_session_write_frame(session_b, read_frame, SWITCH_IO_FLAG_NONE, stream_id)) != SWITCH_STATUS_SUCCESS) {
 					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session_a), SWITCH_LOG_DEBUG,
 									  "%s ending bridge by request from write function\n", switch_channel_get_name(chan_b));
 					goto end_of_bridge_loop;
@@ -37,6 +37,16 @@
 #define PERIOD_LEN 250
 #define MAX_FRAME_PADDING 2
 #define MAX_MISSING_SEQ 20
+#define JB_RING_MIN 64
+#define JB_RING_MIN_VIDEO 1024
+#define JB_RING_MAX 16384
+#define JB_MISSING_LEN 1024
+#define JB_SLAB_NODES 4
+#define JB_SLAB_NODES_VIDEO 32
+#define JB_TRANSIT_LEN 256
+#define JB_TRANSIT_EVERY 16
+#define JB_TRANSIT_PCT 95
+#define jb_seq_diff(_a, _b) ((int16_t)((uint16_t)(_a) - (uint16_t)(_b)))
 #define jb_debug(_jb, _level, _format, ...) if (_jb->debug_level >= _level) switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(_jb->session), SWITCH_LOG_ALERT, "JB:%p:%s lv:%d ln:%.4d sz:%.3u/%.3u/%.3u/%.3u c:%.3u %.3u/%.3u/%.3u/%.3u %.2f%% ->" _format, (void *) _jb, (jb->type == SJB_AUDIO ? "aud" : "vid"), _level, __LINE__,  _jb->min_frame_len, _jb->max_frame_len, _jb->frame_len, _jb->complete_frames, _jb->period_count, _jb->consec_good_count, _jb->period_good_count, _jb->consec_miss_count, _jb->period_miss_count, _jb->period_miss_pct, __VA_ARGS__)
 
 //const char *TOKEN_1 = "ONE";
@@ -54,12 +64,18 @@ typedef struct switch_jb_node_s {
 	                                             * 1ʾɼʾ;0ʾɼʾá
 	                                             */
 	uint8_t bad_hits;                           /* òʱδ */
-	struct switch_jb_node_s *prev;              /* ϸڵ */
-	struct switch_jb_node_s *next;              /* ¸ڵ */
+	uint16_t seq;                               /* seq as received in host order, the ring slot key */
+	uint64_t tick;                              /* media trace tick of the put, 0 unless SJB_MEDIA_TRACE */
+	struct switch_jb_node_s *next;              /* free list link */
 } switch_jb_node_t;
 
+typedef struct switch_jb_missing_s {
+	switch_time_t then;                         /* 1 until nacked, then the time of the last nack */
+	uint16_t seq;                               /* host order */
+	uint8_t used;
+} switch_jb_missing_t;
+
 struct switch_jb_s {
-	struct switch_jb_node_s *node_list;         /* ڵϢ */
 	uint32_t last_target_seq;                   /* һҪȡĿseqݴtarget_seq */ 
 	uint32_t highest_read_ts;                   /* ѾjbжȡrtpУtimestamp */
 	uint32_t highest_read_seq;                  /* ѾjbжȡrtpУseq */
@@ -103,11 +119,19 @@ struct switch_jb_s {
 	uint8_t debug_level;                        /* */
 	uint16_t next_seq;                          /* һյİseq+1 */
 	switch_size_t last_len;                     /* */
-	switch_inthash_t *missing_seq_hash;         /* ¼seq hash (nack, time), timeʼֵΪ1 */
-	switch_inthash_t *node_hash;                /* jbseq hash (seq, node) */
+	uint64_t last_tick;                         /* put tick of the packet last read */
+	switch_jb_node_t **ring;                    /* visible nodes, slot = seq & (ring_size - 1) */
+	uint32_t ring_size;                         /* power of two, never less than ring_high - ring_low + 1 */
+	uint16_t ring_low;                          /* lowest visible seq, host order */
+	uint16_t ring_high;                         /* highest seq put since the ring was last empty, host order */
+	switch_jb_node_t *free_nodes;               /* hidden nodes ready for reuse */
+	switch_jb_missing_t *missing;               /* seqs to nack (video only), slot = seq & (JB_MISSING_LEN - 1) */
+	uint32_t missing_count;                     /* */
+	uint16_t missing_low;                       /* */
+	uint16_t missing_high;                      /* */
 	switch_inthash_t *node_hash_ts;             /* jbts hash  (ts, node) */
 	switch_mutex_t *mutex;                      /* */
-	switch_mutex_t *list_mutex;                 /* */
+	switch_mutex_t *ring_mutex;                 /* */
 	switch_memory_pool_t *pool;                 /* */
 	int free_pool;                              /* */
 	int drop_flag;                              /* */
@@ -115,315 +139,312 @@ struct switch_jb_s {
 	switch_jb_type_t type;                      /* */
 	switch_core_session_t *session;             /* */
 	switch_channel_t *channel;                  /* */
+	int32_t *transit;                           /* arrival minus rtp ts in samples of the last JB_TRANSIT_LEN packets (time stretch) */
+	uint32_t transit_count;                     /* */
+	int32_t transit_base;                       /* first transit, the others are kept relative to it */
+	switch_time_t stretch_epoch;                /* arrival of the first packet since reset */
+	uint32_t stretch_samples;                   /* samples per frame */
+	uint32_t stretch_rate;                      /* samples per second */
+	uint32_t stretch_target;                    /* frames the playout delay estimate wants buffered, 0 until known */
+	uint8_t stretch_hold;                       /* the next get yields to audio the reader stretched */
 };
 
 
-static int node_cmp(const void *l, const void *r)
+#define jb_ring_slot(_jb, _seq) (_jb)->ring[(uint16_t)(_seq) & ((_jb)->ring_size - 1)]
+#define jb_missing_slot(_jb, _seq) (&(_jb)->missing[(uint16_t)(_seq) & (JB_MISSING_LEN - 1)])
+
+/* copy only what was received, the body is sized for the largest possible packet */
+static inline void jb_copy_packet(switch_rtp_packet_t *dst, const switch_rtp_packet_t *src, switch_size_t len)
 {
-	switch_jb_node_t *a = (switch_jb_node_t *) l;
-	switch_jb_node_t *b = (switch_jb_node_t *) r;
-	
-	if (!a->visible) return 0;
-	if (!b->visible) return 1;
+	dst->header = src->header;
 
-	return ntohs(a->packet.header.seq) - ntohs(b->packet.header.seq);
+	if (len > sizeof(src->header)) {
+		memcpy(dst->body, src->body, len - sizeof(src->header));
+	}
 }
 
-//http://www.chiark.greenend.org.uk/~sgtatham/algorithms/listsort.c
-/* 鲢 */
-switch_jb_node_t *sort_nodes(switch_jb_node_t *list, int (*cmp)(const void *, const void *)) {
-	switch_jb_node_t *p, *q, *e, *tail;
-	int insize, nmerges, psize, qsize, i;
+/**
+ * jb_ring_resize - grow the ring so that span consecutive seqs map to distinct slots
+ *
+ * @jb: jb pointer
+ * @span: number of seqs from ring_low to the highest seq that has to fit
+ *
+ * Return: none
+ */
+static void jb_ring_resize(switch_jb_t *jb, uint32_t span)
+{
+	switch_jb_node_t **ring;
+	uint32_t size = jb->ring_size, i;
 
-	if (!list) {
-		return NULL;
+	while (size < span && size < JB_RING_MAX) {
+		size <<= 1;
 	}
 
-	insize = 1;
-
-	while (1) {
-		p = list;
-		list = NULL;
-		tail = NULL;
-
-		nmerges = 0;  /* count number of merges we do in this pass */
+	if (size == jb->ring_size) {
+		return;
+	}
 
-		while (p) {
-			nmerges++;  /* there exists a merge to be done */
-			            /* step `insize' places along from p */
-			q = p;
-			psize = 0;
-			for (i = 0; i < insize; i++) {
-				psize++;
-				q = q->next;
-				if (!q) break;
-			}
+	switch_zmalloc(ring, size * sizeof(*ring));
 
-			/* if q hasn't fallen off end, we have two lists to merge */
-			qsize = insize;
-
-			/* now we have two lists; merge them */
-			while (psize > 0 || (qsize > 0 && q)) {
-
-				/* decide whether next switch_jb_node_t of merge comes from p or q */
-				if (psize == 0) {
-					/* p is empty; e must come from q. */
-					e = q; q = q->next; qsize--;
-				} else if (qsize == 0 || !q) {
-					/* q is empty; e must come from p. */
-					e = p; p = p->next; psize--;
-				} else if (cmp(p,q) <= 0) {
-					/* First switch_jb_node_t of p is lower (or same);
-					 * e must come from p. */
-					e = p; p = p->next; psize--;
-				} else {
-					/* First switch_jb_node_t of q is lower; e must come from q. */
-					e = q; q = q->next; qsize--;
-				}
-
-				/* add the next switch_jb_node_t to the merged list */
-				if (tail) {
-					tail->next = e;
-				} else {
-					list = e;
-				}
+	for (i = 0; i < jb->ring_size; i++) {
+		if (jb->ring[i]) {
+			ring[jb->ring[i]->seq & (size - 1)] = jb->ring[i];
+		}
+	}
 
-				/* Maintain reverse pointers in a doubly linked list. */
-				e->prev = tail;
-				
-				tail = e;
-			}
+	jb_debug(jb, 2, "Grow ring from %u to %u slots\n", jb->ring_size, size);
 
-			/* now p has stepped `insize' places along, and q has too */
-			p = q;
-		}
+	free(jb->ring);
+	jb->ring = ring;
+	jb->ring_size = size;
+}
 
-		tail->next = NULL;
+/**
+ * jb_ring_find - look up a visible node by seq
+ *
+ * @jb: jb pointer
+ * @seq: seq in network byte order, as found in the rtp header
+ *
+ * Return: the node or NULL
+ */
+static inline switch_jb_node_t *jb_ring_find(switch_jb_t *jb, uint16_t seq)
+{
+	switch_jb_node_t *node = jb_ring_slot(jb, ntohs(seq));
 
-		/* If we have done only one merge, we're finished. */
-		if (nmerges <= 1)   /* allow for nmerges==0, the empty list case */
-			return list;
+	return (node && node->seq == ntohs(seq)) ? node : NULL;
+}
 
-		/* Otherwise repeat, merging lists twice the size */
-		insize *= 2;
+/* every slot is passed over once per lap of ring_low so this is amortized O(1) */
+static inline void jb_ring_advance(switch_jb_t *jb)
+{
+	while (jb->visible_nodes && jb->ring_low != jb->ring_high && !jb_ring_slot(jb, jb->ring_low)) {
+		jb->ring_low++;
 	}
 }
 
 /**
- * new_node - ڵ
- * 
- * @jb: jbָ
+ * new_node - get a free node
  *
- * nodeпõĽڵøýڵ;ûпýڵ㣬롣
+ * @jb: jb pointer
  *
- * ֵ: 
+ * Nodes are handed out from the free list, which is refilled from the pool one slab at a time.
+ *
+ * Return: node
  */
 static inline switch_jb_node_t *new_node(switch_jb_t *jb)
 {
 	switch_jb_node_t *np;
 
-	switch_mutex_lock(jb->list_mutex);
+	switch_mutex_lock(jb->ring_mutex);
 
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) {
-			break;
-		}
-	}
+	if (!jb->free_nodes) {
+		uint32_t i, n = jb->type == SJB_VIDEO ? JB_SLAB_NODES_VIDEO : JB_SLAB_NODES;
+		switch_jb_node_t *slab = switch_core_alloc(jb->pool, n * sizeof(*slab));
 
-	if (!np) {
-		
-		np = switch_core_alloc(jb->pool, sizeof(*np));
-		
-		np->next = jb->node_list;
-		if (np->next) {
-			np->next->prev = np;
+		for (i = 0; i < n; i++) {
+			slab[i].parent = jb;
+			slab[i].next = jb->free_nodes;
+			jb->free_nodes = &slab[i];
 		}
-		jb->node_list = np;
-		
 	}
 
+	np = jb->free_nodes;
+	jb->free_nodes = np->next;
+
+	switch_mutex_unlock(jb->ring_mutex);
+
 	switch_assert(np);
+	np->next = NULL;
 	np->bad_hits = 0;
-	np->visible = 1;
-	jb->visible_nodes++;
-	np->parent = jb;
-
-	switch_mutex_unlock(jb->list_mutex);
+	np->visible = 0;
 
 	return np;
 }
 
-static inline void push_to_top(switch_jb_t *jb, switch_jb_node_t *node)
-{
-	if (node == jb->node_list) {
-		jb->node_list = node->next;
-	} else if (node->prev) {
-		node->prev->next = node->next;
-	}
-			
-	if (node->next) {
-		node->next->prev = node->prev;
-	}
-
-	node->next = jb->node_list;
-	node->prev = NULL;
-
-	if (node->next) {
-		node->next->prev = node;
-	}
-
-	jb->node_list = node;
-
-	switch_assert(node->next != node);
-	switch_assert(node->prev != node);
-}
-
 /**
- * hide_node - ؽ
- * 
- * @node: jb
- * @pop: Ƿͷ
+ * hide_node - take a node out of the ring and return it to the free list
  *
- * ֵ: 
+ * @node: jb node
+ *
+ * Return: none
  */
-static inline void hide_node(switch_jb_node_t *node, switch_bool_t pop)
+static inline void hide_node(switch_jb_node_t *node)
 {
 	switch_jb_t *jb = node->parent;
 
-	switch_mutex_lock(jb->list_mutex);
+	switch_mutex_lock(jb->ring_mutex);
 
 	if (node->visible) {
 		node->visible = 0;
 		node->bad_hits = 0;
 		jb->visible_nodes--;
 
-		if (pop) {
-            /* ͷ */
-			push_to_top(jb, node);
+		if (jb_ring_slot(jb, node->seq) == node) {
+			jb_ring_slot(jb, node->seq) = NULL;
+		}
+
+		if (jb->node_hash_ts && switch_core_inthash_find(jb->node_hash_ts, node->packet.header.ts) == node) {
+			switch_core_inthash_delete(jb->node_hash_ts, node->packet.header.ts);
+		}
+
+		node->next = jb->free_nodes;
+		jb->free_nodes = node;
+
+		if (node->seq == jb->ring_low) {
+			jb_ring_advance(jb);
 		}
 	}
 
-    /* seq hashts hashɾ */
-	if (jb->node_hash_ts) {
-		switch_core_inthash_delete(jb->node_hash_ts, node->packet.header.ts);
+	switch_mutex_unlock(jb->ring_mutex);
+}
+
+/* hide the lowest node, returns SWITCH_FALSE once the ring is empty */
+static inline switch_bool_t jb_ring_pop_low(switch_jb_t *jb)
+{
+	switch_jb_node_t *np;
+
+	if (!jb->visible_nodes) {
+		return SWITCH_FALSE;
 	}
 
-	switch_core_inthash_delete(jb->node_hash, node->packet.header.seq);
+	if ((np = jb_ring_slot(jb, jb->ring_low))) {
+		hide_node(np);
+	} else {
+		jb->ring_low++;
+	}
 
-	switch_mutex_unlock(jb->list_mutex);
+	return SWITCH_TRUE;
 }
 
 /**
- * sort_free_nodes - jb
- * 
- * @jb: jbָ
+ * hide_nodes - hide every node in the jb
  *
- * ڹ鲢ĹǿýڵǰseqСǰ
+ * @jb: jb pointer
  *
- * ֵ: 
+ * Return: none
  */
-static inline void sort_free_nodes(switch_jb_t *jb)
+static inline void hide_nodes(switch_jb_t *jb)
 {
-	switch_mutex_lock(jb->list_mutex);
-	jb->node_list = sort_nodes(jb->node_list, node_cmp);
-	switch_mutex_unlock(jb->list_mutex);
+	switch_mutex_lock(jb->ring_mutex);
+	while (jb_ring_pop_low(jb));
+	switch_mutex_unlock(jb->ring_mutex);
 }
 
 /**
- * hide_nodes - jbн
- * 
- * @node: jb
+ * jb_ring_insert - make a node visible in the slot of its seq
  *
- * ֵ: 
+ * @jb: jb pointer
+ * @node: node with seq already set
+ *
+ * The ring always covers ring_low..ring_high without two seqs sharing a slot, it grows when a
+ * packet would stretch that window past ring_size.  Nodes more than JB_RING_MAX seqs behind the
+ * newest packet can never be read in order anymore and are let go.
+ *
+ * Return: none
  */
-static inline void hide_nodes(switch_jb_t *jb)
+static inline void jb_ring_insert(switch_jb_t *jb, switch_jb_node_t *node)
 {
-	switch_jb_node_t *np;
+	switch_jb_node_t *dup;
+	uint16_t seq = node->seq;
 
-	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		hide_node(np, SWITCH_FALSE);
+	switch_mutex_lock(jb->ring_mutex);
+
+	if ((dup = jb_ring_find(jb, htons(seq)))) {
+		/* a retransmission of a seq we still hold, the newer copy wins */
+		hide_node(dup);
 	}
-	switch_mutex_unlock(jb->list_mutex);
+
+	if (jb->visible_nodes) {
+		if (jb_seq_diff(seq, jb->ring_high) > 0) {
+			while ((uint16_t)(seq - jb->ring_low) >= JB_RING_MAX && jb_ring_pop_low(jb));
+		} else if (jb_seq_diff(seq, jb->ring_low) < 0 && (uint16_t)(jb->ring_high - seq) >= JB_RING_MAX) {
+			jb_debug(jb, 2, "seq %u is too far behind %u, flushing\n", seq, jb->ring_high);
+			while (jb_ring_pop_low(jb));
+		}
+	}
+
+	if (!jb->visible_nodes) {
+		jb->ring_low = jb->ring_high = seq;
+	} else if (jb_seq_diff(seq, jb->ring_high) > 0) {
+		jb_ring_resize(jb, (uint16_t)(seq - jb->ring_low) + 1);
+		jb->ring_high = seq;
+	} else if (jb_seq_diff(seq, jb->ring_low) < 0) {
+		jb_ring_resize(jb, (uint16_t)(jb->ring_high - seq) + 1);
+		jb->ring_low = seq;
+	}
+
+	jb_ring_slot(jb, seq) = node;
+	node->visible = 1;
+	jb->visible_nodes++;
+
+	switch_mutex_unlock(jb->ring_mutex);
 }
 
 /**
- * drop_ts - ts
- * 
- * @jbp: jbָ
- * @ts: timestampʱ
+ * drop_ts - hide every node of one frame
  *
- * ts൱ڶһ֡İ
+ * @jb: jb pointer
+ * @ts: timestamp of the frame
  *
- * ֵ: 
+ * A frame is a run of consecutive seqs so the walk stops at the first node past it.
+ *
+ * Return: none
  */
 static inline void drop_ts(switch_jb_t *jb, uint32_t ts)
 {
 	switch_jb_node_t *np;
+	uint16_t seq;
 	int x = 0;
 
-	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
-
-		if (ts == np->packet.header.ts) {
-            /* ؽ */
-			hide_node(np, SWITCH_FALSE);
-			x++;
+	switch_mutex_lock(jb->ring_mutex);
+	for (seq = jb->ring_low; jb->visible_nodes; seq++) {
+		if ((np = jb_ring_slot(jb, seq))) {
+			if (ts == np->packet.header.ts) {
+				hide_node(np);
+				x++;
+			} else if (x) {
+				break;
+			}
 		}
-	}
 
-	if (x) {
-        /* jb */
-		sort_free_nodes(jb);
+		if (seq == jb->ring_high) break;
 	}
-
-	switch_mutex_unlock(jb->list_mutex);
+	switch_mutex_unlock(jb->ring_mutex);
 	
 	if (x) jb->complete_frames--;
 }
 
 /**
- * jb_find_lowest_seq - ѰjbָtsĽУseqСĽ
- * 
- * @jb: jbָ
+ * jb_find_lowest_seq - find the lowest seq, optionally only among the nodes of one frame
  *
- * ֵ: 
+ * @jb: jb pointer
+ * @ts: timestamp of the frame or 0 for any
+ *
+ * Return: node or NULL
  */
 static inline switch_jb_node_t *jb_find_lowest_seq(switch_jb_t *jb, uint32_t ts)
 {
 	switch_jb_node_t *np, *lowest = NULL;
-	
-	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
-
-		if (ts && ts != np->packet.header.ts) continue;
+	uint16_t seq;
 
-		if (!lowest || ntohs(lowest->packet.header.seq) > ntohs(np->packet.header.seq)) {
+	switch_mutex_lock(jb->ring_mutex);
+	for (seq = jb->ring_low; jb->visible_nodes; seq++) {
+		if ((np = jb_ring_slot(jb, seq)) && (!ts || ts == np->packet.header.ts)) {
 			lowest = np;
+			break;
 		}
+
+		if (seq == jb->ring_high) break;
 	}
-	switch_mutex_unlock(jb->list_mutex);
+	switch_mutex_unlock(jb->ring_mutex);
 
 	return lowest;
 }
 
+/* timestamps follow seq order, so the oldest frame starts at ring_low */
 static inline switch_jb_node_t *jb_find_lowest_node(switch_jb_t *jb)
 {
-	switch_jb_node_t *np, *lowest = NULL;
-
-	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
-
-		if (!lowest || ntohl(lowest->packet.header.ts) > ntohl(np->packet.header.ts)) {
-			lowest = np;
-		}
-	}
-	switch_mutex_unlock(jb->list_mutex);
-
-	return lowest ? lowest : NULL;
+	return jb_find_lowest_seq(jb, 0);
 }
 
 static inline uint32_t jb_find_lowest_ts(switch_jb_t *jb)
@@ -434,89 +455,116 @@ static inline uint32_t jb_find_lowest_ts(switch_jb_t *jb)
 }
 
 /**
- * thin_frames - "֡"ʹjbĽϡ裬ȶseqСġı
- * 
- * @jbp: jbָ
- * @freq: ļ
- * @max: 󶪰
+ * thin_frames - drop every freq-th frame counting from the oldest until the jb is back under max_frame_len
  *
- * ֵ: 
+ * @jb: jb pointer
+ * @freq: drop interval
+ * @max: most frames to drop
+ *
+ * The oldest frames are the next ones to be read and are left alone, losing them would only turn
+ * into more misses.
+ *
+ * Return: none
  */
 static inline void thin_frames(switch_jb_t *jb, int freq, int max)
 {
 	switch_jb_node_t *node;
-	int i = -1;
+	uint16_t seq;
+	int i = 0;
 	int dropped = 0;
 
-	switch_mutex_lock(jb->list_mutex);
-	node = jb->node_list;
-
-	for (node = jb->node_list; node && jb->complete_frames > jb->max_frame_len && dropped < max; node = node->next) {
+	switch_mutex_lock(jb->ring_mutex);
 
-        /* ֻЧж */
-		if (node->visible) {
-			i++;
-		} else {
-			continue;
-		}
-
-        /* freqж֡ */
-		if ((i % freq) == 0) {
+	for (seq = jb->ring_low; jb->visible_nodes && jb->complete_frames > jb->max_frame_len && dropped < max; seq++) {
+		if ((node = jb_ring_slot(jb, seq)) && (++i % freq) == 0) {
 			drop_ts(jb, node->packet.header.ts);
-			node = jb->node_list;
 			dropped++;
+			/* start over from the new lowest seq */
+			seq = jb->ring_low - 1;
+			continue;
 		}
+
+		if (seq == jb->ring_high) break;
 	}
 
-	sort_free_nodes(jb);
-	switch_mutex_unlock(jb->list_mutex);	
+	switch_mutex_unlock(jb->ring_mutex);	
 }
 
+static inline switch_jb_missing_t *jb_missing_find(switch_jb_t *jb, uint16_t seq)
+{
+	switch_jb_missing_t *mp = jb_missing_slot(jb, seq);
 
+	return (jb->missing_count && mp->used && mp->seq == seq) ? mp : NULL;
+}
 
-#if 0
-static inline switch_jb_node_t *jb_find_highest_node(switch_jb_t *jb)
+static inline void jb_missing_del(switch_jb_t *jb, switch_jb_missing_t *mp)
 {
-	switch_jb_node_t *np, *highest = NULL;
-
-	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
+	mp->used = 0;
 
-		if (!highest || ntohl(highest->packet.header.ts) < ntohl(np->packet.header.ts)) {
-			highest = np;
+	if (--jb->missing_count && mp->seq == jb->missing_low) {
+		while (jb->missing_low != jb->missing_high && !jb_missing_slot(jb, jb->missing_low)->used) {
+			jb->missing_low++;
 		}
 	}
-	switch_mutex_unlock(jb->list_mutex);
-
-	return highest ? highest : NULL;
 }
 
-static inline uint32_t jb_find_highest_ts(switch_jb_t *jb)
+/**
+ * jb_missing_add - mark a seq as missing so switch_jb_pop_nack will ask for it
+ *
+ * @jb: jb pointer
+ * @seq: seq in host byte order
+ *
+ * Return: none
+ */
+static inline void jb_missing_add(switch_jb_t *jb, uint16_t seq)
 {
-	switch_jb_node_t *highest = jb_find_highest_node(jb);
+	switch_jb_missing_t *mp;
+
+	if (jb->missing_count) {
+		if (jb_seq_diff(seq, jb->missing_high) > 0) {
+			/* anything JB_MISSING_LEN behind has expired long ago */
+			while (jb->missing_count && (uint16_t)(seq - jb->missing_low) >= JB_MISSING_LEN) {
+				if ((mp = jb_missing_slot(jb, jb->missing_low))->used) {
+					jb_missing_del(jb, mp);
+				} else {
+					jb->missing_low++;
+				}
+			}
+		} else if (jb_seq_diff(seq, jb->missing_low) < 0 && (uint16_t)(jb->missing_high - seq) >= JB_MISSING_LEN) {
+			return;
+		}
+	}
 
-	return highest ? highest->packet.header.ts : 0;
-}
+	if (!jb->missing_count) {
+		jb->missing_low = jb->missing_high = seq;
+	} else if (jb_seq_diff(seq, jb->missing_high) > 0) {
+		jb->missing_high = seq;
+	} else if (jb_seq_diff(seq, jb->missing_low) < 0) {
+		jb->missing_low = seq;
+	}
 
-static inline switch_jb_node_t *jb_find_penultimate_node(switch_jb_t *jb)
-{
-	switch_jb_node_t *np, *highest = NULL, *second_highest = NULL;
+	mp = jb_missing_slot(jb, seq);
 
-	switch_mutex_lock(jb->list_mutex);
-	for (np = jb->node_list; np; np = np->next) {
-		if (!np->visible) continue;
+	if (!mp->used) {
+		mp->used = 1;
+		mp->seq = seq;
+		jb->missing_count++;
+	}
 
-		if (!highest || ntohl(highest->packet.header.ts) < ntohl(np->packet.header.ts)) {
-			if (highest) second_highest = highest;
-			highest = np;
-		}
+	/* 1 means never nacked */
+	mp->then = 1;
+}
+
+static inline void jb_missing_reset(switch_jb_t *jb)
+{
+	if (jb->missing) {
+		memset(jb->missing, 0, JB_MISSING_LEN * sizeof(*jb->missing));
 	}
-	switch_mutex_unlock(jb->list_mutex);
 
-	return second_highest ? second_highest : highest;
+	jb->missing_count = 0;
+	jb->missing_low = jb->missing_high = 0;
 }
-#endif
+
 
 /**
  * jb_hit - jbеĿseq֡jb
@@ -599,48 +647,6 @@ static inline void jb_miss(switch_jb_t *jb)
 	jb->consec_good_count = 0;
 }
 
-#if 0
-static inline int verify_oldest_frame(switch_jb_t *jb)
-{
-	switch_jb_node_t *lowest = NULL, *np = NULL;
-	int r = 0;
-
-	lowest = jb_find_lowest_node(jb);
-
-	if (!lowest || !(lowest = jb_find_lowest_seq(jb, lowest->packet.header.ts))) {
-		goto end;
-	}
-	
-	switch_mutex_lock(jb->mutex);
-
-	jb->node_list = sort_nodes(jb->node_list, node_cmp);
-
-	for (np = lowest->next; np; np = np->next) {
-			
-		if (!np->visible) continue;
-			
-		if (ntohs(np->packet.header.seq) != ntohs(np->prev->packet.header.seq) + 1) {
-			uint32_t val = (uint32_t)htons(ntohs(np->prev->packet.header.seq) + 1);
-
-			if (!switch_core_inthash_find(jb->missing_seq_hash, val)) {
-				switch_core_inthash_insert(jb->missing_seq_hash, val, (void *)(intptr_t)1);
-			}
-			break;
-		}
-				
-		if (np->packet.header.ts != lowest->packet.header.ts || !np->next) {
-			r = 1;
-		}
-	}
-	
-	switch_mutex_unlock(jb->mutex);
-
- end:
-
-	return r;
-}
-#endif
-
 /**
  * drop_oldest_frame - ֡
  * 
@@ -657,25 +663,60 @@ static inline void drop_oldest_frame(switch_jb_t *jb)
 	jb_debug(jb, 1, "Dropping oldest frame ts:%u\n", ntohl(ts));
 }
 
-#if 0
-static inline void drop_newest_frame(switch_jb_t *jb)
+static int jb_transit_cmp(const void *a, const void *b)
 {
-	uint32_t ts = jb_find_highest_ts(jb);
+	int32_t x = *(const int32_t *) a, y = *(const int32_t *) b;
 
-	drop_ts(jb, ts);
-	jb_debug(jb, 1, "Dropping highest frame ts:%u\n", ntohl(ts));
+	return x < y ? -1 : x > y;
 }
 
-static inline void drop_second_newest_frame(switch_jb_t *jb)
+/**
+ * jb_stretch_transit - feed the playout delay estimate
+ *
+ * The relative transit time (arrival minus rtp ts) of every packet goes into a window, the spread
+ * between the fastest packet and the JB_TRANSIT_PCT percentile is the jitter to absorb.
+ */
+static inline void jb_stretch_transit(switch_jb_t *jb, uint32_t ts)
 {
-	switch_jb_node_t *second_newest = jb_find_penultimate_node(jb);
-	
-	if (second_newest) {
-		drop_ts(jb, second_newest->packet.header.ts);
-		jb_debug(jb, 1, "Dropping second highest frame ts:%u\n", ntohl(second_newest->packet.header.ts));
+	int32_t sorted[JB_TRANSIT_LEN];
+	switch_time_t now = switch_micro_time_now();
+	uint32_t n, spread, target;
+	int32_t transit;
+
+	if (!jb->transit_count) {
+		jb->stretch_epoch = now;
+	}
+
+	transit = (int32_t) ((uint32_t) ((now - jb->stretch_epoch) * jb->stretch_rate / 1000000) - ntohl(ts));
+
+	if (!jb->transit_count) {
+		jb->transit_base = transit;
+	}
+
+	jb->transit[jb->transit_count++ % JB_TRANSIT_LEN] = transit - jb->transit_base;
+
+	if (jb->transit_count % JB_TRANSIT_EVERY) {
+		return;
+	}
+
+	n = jb->transit_count < JB_TRANSIT_LEN ? jb->transit_count : JB_TRANSIT_LEN;
+	memcpy(sorted, jb->transit, n * sizeof(*sorted));
+	qsort(sorted, n, sizeof(*sorted), jb_transit_cmp);
+
+	spread = (uint32_t) (sorted[(n - 1) * JB_TRANSIT_PCT / 100] - sorted[0]);
+	target = (spread + jb->stretch_samples - 1) / jb->stretch_samples;
+
+	if (target < jb->min_frame_len) {
+		target = jb->min_frame_len;
+	} else if (target > jb->max_frame_len) {
+		target = jb->max_frame_len;
+	}
+
+	if (target != jb->stretch_target) {
+		jb_debug(jb, 2, "Playout delay estimate %u samples, target %u frames\n", spread, target);
+		jb->stretch_target = target;
 	}
 }
-#endif
 
 /**
  * add_node - ӽ
@@ -693,12 +734,12 @@ static inline void add_node(switch_jb_t *jb, switch_rtp_packet_t *packet, switch
     /* nodenode */
     switch_jb_node_t *node = new_node(jb);
 
-	node->packet = *packet;
+	node->seq = ntohs(packet->header.seq);
 	node->len = len;
-	memcpy(node->packet.body, packet->body, len);
+	node->tick = switch_test_flag(jb, SJB_MEDIA_TRACE) ? switch_core_media_trace_tick() : 0;
+	jb_copy_packet(&node->packet, packet, len);
 
-    /* nodeseq hashts hash */
-	switch_core_inthash_insert(jb->node_hash, node->packet.header.seq, node);
+	jb_ring_insert(jb, node);
 
 	if (jb->node_hash_ts) {
 		switch_core_inthash_insert(jb->node_hash_ts, node->packet.header.ts, node);
@@ -830,7 +871,7 @@ static inline switch_status_t jb_next_packet_by_seq(switch_jb_t *jb, switch_jb_n
 	}
 
 	if (!jb->target_seq) {                                                          /* ĿseqΪ0 */
-		if ((node = switch_core_inthash_find(jb->node_hash, jb->target_seq))) {
+		if ((node = jb_ring_find(jb, jb->target_seq))) {
 			jb_debug(jb, 2, "FOUND rollover seq: %u\n", ntohs(jb->target_seq));
 		} else if ((node = jb_find_lowest_seq(jb, 0))) {
 			jb_debug(jb, 2, "No target seq using seq: %u as a starting point\n", ntohs(node->packet.header.seq));
@@ -838,7 +879,7 @@ static inline switch_status_t jb_next_packet_by_seq(switch_jb_t *jb, switch_jb_n
 			jb_debug(jb, 1, "%s", "No nodes available....\n");
 		}
 		jb_hit(jb);
-	} else if ((node = switch_core_inthash_find(jb->node_hash, jb->target_seq))) { /* ĿseqΪ0 */
+	} else if ((node = jb_ring_find(jb, jb->target_seq))) { /* ĿseqΪ0 */
 		jb_debug(jb, 2, "FOUND desired seq: %u\n", ntohs(jb->target_seq));
 		jb_hit(jb);
 	} else {                                                                        /* ûҵĿseq */
@@ -868,7 +909,7 @@ static inline switch_status_t jb_next_packet_by_seq(switch_jb_t *jb, switch_jb_n
              */
 			for (x = 0; x < 10; x++) {
 				increment_seq(jb);
-				if ((node = switch_core_inthash_find(jb->node_hash, jb->target_seq))) {
+				if ((node = jb_ring_find(jb, jb->target_seq))) {
 					jb_debug(jb, 2, "FOUND incremental seq: %u\n", ntohs(jb->target_seq));
 
 					if (node->packet.header.m ||  node->packet.header.ts == jb->highest_read_ts) {
@@ -945,11 +986,31 @@ static inline switch_status_t jb_next_packet(switch_jb_t *jb, switch_jb_node_t *
 	}
 }
 
+static inline void jb_read_node(switch_jb_t *jb, switch_jb_node_t *node)
+{
+	if (!jb->read_init || ntohs(node->packet.header.seq) > ntohs(jb->highest_read_seq) || 
+		(ntohs(jb->highest_read_seq) > USHRT_MAX - 10 && ntohs(node->packet.header.seq) <= 10) ) {
+		jb->highest_read_seq = node->packet.header.seq;
+	}
+		
+	if (jb->read_init && htons(node->packet.header.seq) >= htons(jb->highest_read_seq) && (ntohl(node->packet.header.ts) > ntohl(jb->highest_read_ts))) {
+		jb->complete_frames--;
+		jb_debug(jb, 2, "READ frame ts: %u complete=%u/%u n:%u\n", ntohl(node->packet.header.ts), jb->complete_frames , jb->frame_len, jb->visible_nodes);
+		jb->highest_read_ts = node->packet.header.ts;
+	} else if (!jb->read_init) {
+		jb->highest_read_ts = node->packet.header.ts;
+	}
+		
+	if (!jb->read_init) jb->read_init = 1;
+}
+
 static inline void free_nodes(switch_jb_t *jb)
 {
-	switch_mutex_lock(jb->list_mutex);
-	jb->node_list = NULL;
-	switch_mutex_unlock(jb->list_mutex);
+	switch_mutex_lock(jb->ring_mutex);
+	switch_safe_free(jb->ring);
+	switch_safe_free(jb->missing);
+	jb->free_nodes = NULL;
+	switch_mutex_unlock(jb->ring_mutex);
 }
 
 SWITCH_DECLARE(void) switch_jb_ts_mode(switch_jb_t *jb, uint32_t samples_per_frame, uint32_t samples_per_second)
@@ -959,6 +1020,54 @@ SWITCH_DECLARE(void) switch_jb_ts_mode(switch_jb_t *jb, uint32_t samples_per_fra
 	switch_core_inthash_init(&jb->node_hash_ts);
 }
 
+SWITCH_DECLARE(void) switch_jb_stretch_mode(switch_jb_t *jb, uint32_t samples_per_frame, uint32_t samples_per_second)
+{
+	if (jb->type != SJB_AUDIO || !samples_per_frame || !samples_per_second) {
+		return;
+	}
+
+	switch_mutex_lock(jb->mutex);
+	if (!jb->transit) {
+		jb->transit = switch_core_alloc(jb->pool, JB_TRANSIT_LEN * sizeof(*jb->transit));
+	}
+	jb->stretch_samples = samples_per_frame;
+	jb->stretch_rate = samples_per_second;
+	jb->transit_count = 0;
+	jb->stretch_target = 0;
+	switch_set_flag(jb, SJB_TIME_STRETCH);
+	switch_mutex_unlock(jb->mutex);
+}
+
+SWITCH_DECLARE(int) switch_jb_stretch_advice(switch_jb_t *jb)
+{
+	uint32_t target;
+	int advice = 0;
+
+	if (!switch_test_flag(jb, SJB_TIME_STRETCH) || !jb->stretch_target) {
+		return 0;
+	}
+
+	switch_mutex_lock(jb->mutex);
+	target = jb->stretch_target > jb->frame_len ? jb->stretch_target : jb->frame_len;
+
+	/* a frame of slack either way so the reader is not flapping between the two */
+	if (jb->complete_frames > target + 1) {
+		advice = 1;
+	} else if (jb->complete_frames + 1 < target) {
+		advice = -1;
+	}
+	switch_mutex_unlock(jb->mutex);
+
+	return advice;
+}
+
+SWITCH_DECLARE(void) switch_jb_stretch_hold(switch_jb_t *jb)
+{
+	switch_mutex_lock(jb->mutex);
+	jb->stretch_hold = 1;
+	switch_mutex_unlock(jb->mutex);
+}
+
 SWITCH_DECLARE(void) switch_jb_set_session(switch_jb_t *jb, switch_core_session_t *session)
 {
 	const char *var;
@@ -986,6 +1095,11 @@ SWITCH_DECLARE(void) switch_jb_clear_flag(switch_jb_t *jb, switch_jb_flag_t flag
 	switch_clear_flag(jb, flag);
 }
 
+SWITCH_DECLARE(switch_bool_t) switch_jb_test_flag(switch_jb_t *jb, switch_jb_flag_t flag)
+{
+	return switch_test_flag(jb, flag) ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
 SWITCH_DECLARE(int) switch_jb_poll(switch_jb_t *jb)
 {
 	return (jb->complete_frames >= jb->frame_len);
@@ -1006,7 +1120,7 @@ SWITCH_DECLARE(void) switch_jb_debug_level(switch_jb_t *jb, uint8_t level)
  * 
  * @jb: jbָ
  *
- * missing_seq_hashjb
+ * missingjb
  *
  * ֵ: 
  */
@@ -1015,8 +1129,7 @@ SWITCH_DECLARE(void) switch_jb_reset(switch_jb_t *jb)
 
 	if (jb->type == SJB_VIDEO) {
 		switch_mutex_lock(jb->mutex);
-		switch_core_inthash_destroy(&jb->missing_seq_hash);
-		switch_core_inthash_init(&jb->missing_seq_hash);
+		jb_missing_reset(jb);
 		switch_mutex_unlock(jb->mutex);
 
 		if (jb->session) {
@@ -1048,6 +1161,8 @@ SWITCH_DECLARE(void) switch_jb_reset(switch_jb_t *jb)
 	jb->period_miss_inc = 0;
 	jb->target_ts = 0;
 	jb->last_target_ts = 0;
+	jb->transit_count = 0;
+	jb->stretch_hold = 0;
 
 	switch_mutex_lock(jb->mutex);
 	hide_nodes(jb);
@@ -1057,9 +1172,13 @@ SWITCH_DECLARE(void) switch_jb_reset(switch_jb_t *jb)
 SWITCH_DECLARE(switch_status_t) switch_jb_peek_frame(switch_jb_t *jb, uint32_t ts, uint16_t seq, int peek, switch_frame_t *frame)
 {
 	switch_jb_node_t *node = NULL;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	switch_mutex_lock(jb->mutex);
+
 	if (seq) {
 		uint16_t want_seq = seq + peek;
-		node = switch_core_inthash_find(jb->node_hash, htons(want_seq));
+		node = jb_ring_find(jb, htons(want_seq));
 	} else if (ts && jb->samples_per_frame) {
 		uint32_t want_ts = ts + (peek * jb->samples_per_frame);	
 		node = switch_core_inthash_find(jb->node_hash_ts, htonl(want_ts));
@@ -1074,10 +1193,12 @@ SWITCH_DECLARE(switch_status_t) switch_jb_peek_frame(switch_jb_t *jb, uint32_t t
 		if (frame->data && frame->buflen > node->len - 12) {
 			memcpy(frame->data, node->packet.body, node->len - 12);
 		}
-		return SWITCH_STATUS_SUCCESS;
+		status = SWITCH_STATUS_SUCCESS;
 	}
 
-	return SWITCH_STATUS_FALSE;
+	switch_mutex_unlock(jb->mutex);
+
+	return status;
 }
 
 SWITCH_DECLARE(switch_status_t) switch_jb_get_frames(switch_jb_t *jb, uint32_t *min_frame_len, uint32_t *max_frame_len, uint32_t *cur_frame_len, uint32_t *highest_frame_len) 
@@ -1165,11 +1286,12 @@ SWITCH_DECLARE(switch_status_t) switch_jb_create(switch_jb_t **jbp, switch_jb_ty
 	jb->highest_frame_len = jb->frame_len;
 
 	if (jb->type == SJB_VIDEO) {
-		switch_core_inthash_init(&jb->missing_seq_hash);
+		switch_zmalloc(jb->missing, JB_MISSING_LEN * sizeof(*jb->missing));
 	}
-	switch_core_inthash_init(&jb->node_hash);
+	jb->ring_size = jb->type == SJB_VIDEO ? JB_RING_MIN_VIDEO : JB_RING_MIN;
+	switch_zmalloc(jb->ring, jb->ring_size * sizeof(*jb->ring));
 	switch_mutex_init(&jb->mutex, SWITCH_MUTEX_NESTED, pool);
-	switch_mutex_init(&jb->list_mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_mutex_init(&jb->ring_mutex, SWITCH_MUTEX_NESTED, pool);
 
 	*jbp = jb;
 
@@ -1188,11 +1310,6 @@ SWITCH_DECLARE(switch_status_t) switch_jb_destroy(switch_jb_t **jbp)
 	switch_jb_t *jb = *jbp;
 	*jbp = NULL;
 	
-	if (jb->type == SJB_VIDEO) {
-		switch_core_inthash_destroy(&jb->missing_seq_hash);
-	}
-	switch_core_inthash_destroy(&jb->node_hash);
-
 	if (jb->node_hash_ts) {
 		switch_core_inthash_destroy(&jb->node_hash_ts);
 	}
@@ -1222,13 +1339,12 @@ SWITCH_DECLARE(switch_status_t) switch_jb_destroy(switch_jb_t **jbp)
 
 SWITCH_DECLARE(uint32_t) switch_jb_pop_nack(switch_jb_t *jb)
 {
-	switch_hash_index_t *hi = NULL;
+	switch_jb_missing_t *mp, *first = NULL;
 	uint32_t nack = 0;
 	uint16_t blp = 0;
-	uint16_t least = 0;
+	uint16_t least = 0, seq, expire;
+	switch_time_t now;
 	int i = 0;
-	void *val;      /* ֵ */
-	const void *var;/*  */
 
 	if (jb->type != SJB_VIDEO) {
 		return 0;
@@ -1236,62 +1352,35 @@ SWITCH_DECLARE(uint32_t) switch_jb_pop_nack(switch_jb_t *jb)
 
 	switch_mutex_lock(jb->mutex);
 
- top:
-
-    /* seqϣ */
-	for (hi = switch_core_hash_first_iter(jb->missing_seq_hash, hi); hi; hi = switch_core_hash_next(&hi)) {
-		uint16_t seq;
-		//const char *token;
-		switch_time_t then = 0;
-		
-		switch_core_hash_this(hi, &var, NULL, &val);
-		//token = (const char *) val;
-
-		//if (token == TOKEN_2) {
-			//switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "SKIP %u %s\n", ntohs(*((uint16_t *) var)), token);
-			//printf("WTf\n");
-		//	continue;
-		//}
-		
-		seq = ntohs(*((uint16_t *) var));
-		then = (intptr_t) val;
-
-        /* ͬһseq,жΪηnackļʱ */
-		if (then != 1 && switch_time_now() - then < RENACK_TIME) {
-			//jb_debug(jb, 3, "NACKABLE seq %u too soon to repeat\n", seq);
-			continue;
-		}
-		
-		//if (then != 1) {
-		//	jb_debug(jb, 3, "NACKABLE seq %u not too soon to repeat %lu\n", seq, switch_time_now() - then);
-		//}
-
-        /* ϣЧ쳣seq */
-		if (seq < ntohs(jb->target_seq) - jb->frame_len) {
-			jb_debug(jb, 3, "NACKABLE seq %u expired\n", seq);
-			switch_core_inthash_delete(jb->missing_seq_hash, (uint32_t)htons(seq));
-			goto top;
+	now = switch_time_now();
+	expire = ntohs(jb->target_seq) - jb->frame_len;
+
+    /* walk the missing window from the lowest seq, expired ones are dropped on the way, nothing is nackable until reading has started */
+	for (seq = jb->missing_low; jb->missing_count; seq++) {
+		if ((mp = jb_missing_slot(jb, seq))->used) {
+			if (!jb->target_seq || jb_seq_diff(seq, expire) < 0) {
+				jb_debug(jb, 3, "NACKABLE seq %u expired\n", seq);
+				jb_missing_del(jb, mp);
+			} else if (mp->then == 1 || now - mp->then >= RENACK_TIME) {
+				first = mp;
+				break;
+			}
 		}
 
-        /* ȡhashСseq */
-		if (!least || seq < least) {
-			least = seq;
-		}
+		if (seq == jb->missing_high) break;
 	}
 
-	switch_safe_free(hi);
-
-	if (least && switch_core_inthash_delete(jb->missing_seq_hash, (uint32_t)htons(least))) {
+	if (first) {
+		least = first->seq;
 		jb_debug(jb, 3, "Found NACKABLE seq %u\n", least);
 		nack = (uint32_t) htons(least);
 
-        /* ȡnack֮󣬸شseqʱ䣬½nackʱ */
-		switch_core_inthash_insert(jb->missing_seq_hash, nack, (void *) (intptr_t)switch_time_now());
+        /* restart the renack timer of every seq in this nack */
+		first->then = now;
 
 		for(i = 0; i < 16; i++) {
-			if (switch_core_inthash_delete(jb->missing_seq_hash, (uint32_t)htons(least + i + 1))) {
-                /* ȡnack֮󣬸شseqʱ䣬½nackʱ */
-				switch_core_inthash_insert(jb->missing_seq_hash, (uint32_t)htons(least + i + 1), (void *)(intptr_t)switch_time_now());
+			if ((mp = jb_missing_find(jb, (uint16_t)(least + i + 1)))) {
+				mp->then = now;
 				jb_debug(jb, 3, "Found addtl NACKABLE seq %u\n", least + i + 1);
 				blp |= (1 << i);
 			}
@@ -1299,8 +1388,6 @@ SWITCH_DECLARE(uint32_t) switch_jb_pop_nack(switch_jb_t *jb)
 
 		blp = htons(blp);
 		nack |= (uint32_t) blp << 16;
-
-		//jb_frame_inc(jb, 1);
 	}
 	
 	switch_mutex_unlock(jb->mutex);
@@ -1320,6 +1407,7 @@ SWITCH_DECLARE(uint32_t) switch_jb_pop_nack(switch_jb_t *jb)
  */
 SWITCH_DECLARE(switch_status_t) switch_jb_put_packet(switch_jb_t *jb, switch_rtp_packet_t *packet, switch_size_t len)
 {
+	switch_jb_missing_t *mp;
 	uint32_t i;
 	uint16_t want = ntohs(jb->next_seq), got = ntohs(packet->header.seq);/* һҪյıĵseq,ǰյĵseq */
 
@@ -1332,12 +1420,18 @@ SWITCH_DECLARE(switch_status_t) switch_jb_put_packet(switch_jb_t *jb, switch_rtp
 
 	if (!want) want = got;
 
+	if (switch_test_flag(jb, SJB_TIME_STRETCH)) {
+		jb_stretch_transit(jb, packet->header.ts);
+	}
+
 	if (switch_test_flag(jb, SJB_QUEUE_ONLY) || jb->type == SJB_AUDIO) {
 		jb->next_seq = htons(got + 1);
 	} else {
 
         /* missing seq hash  frame length */
-		if (switch_core_inthash_delete(jb->missing_seq_hash, (uint32_t)htons(got))) {
+		if ((mp = jb_missing_find(jb, got))) {
+			jb_missing_del(jb, mp);
+
 			if (got < ntohs(jb->target_seq)) {
 				jb_debug(jb, 2, "got nacked seq %u too late\n", got);
 				jb_frame_inc(jb, 1);
@@ -1366,7 +1460,7 @@ SWITCH_DECLARE(switch_status_t) switch_jb_put_packet(switch_jb_t *jb, switch_rtp
                 /* missing seq hash */
 				for (i = want; i < got; i++) {
 					jb_debug(jb, 2, "MARK MISSING %u ts:%u\n", i, ntohl(packet->header.ts));
-					switch_core_inthash_insert(jb->missing_seq_hash, (uint32_t)htons(i), (void *)(intptr_t)1);/* עֵ1 */
+					jb_missing_add(jb, (uint16_t) i);
 				}
 			}
 		}
@@ -1395,11 +1489,10 @@ SWITCH_DECLARE(switch_status_t) switch_jb_get_packet_by_seq(switch_jb_t *jb, uin
 	switch_status_t status = SWITCH_STATUS_NOTFOUND;
 
 	switch_mutex_lock(jb->mutex);
-	if ((node = switch_core_inthash_find(jb->node_hash, seq))) {
+	if ((node = jb_ring_find(jb, seq))) {
 		jb_debug(jb, 2, "Found buffered seq: %u\n", ntohs(seq));
-		*packet = node->packet;
+		jb_copy_packet(packet, &node->packet, node->len);
 		*len = node->len;
-		memcpy(packet->body, node->packet.body, node->len);
 		status = SWITCH_STATUS_SUCCESS;
 	} else {
 		jb_debug(jb, 2, "Missing buffered seq: %u\n", ntohs(seq));
@@ -1409,11 +1502,54 @@ SWITCH_DECLARE(switch_status_t) switch_jb_get_packet_by_seq(switch_jb_t *jb, uin
 	return status;
 }
 
+SWITCH_DECLARE(switch_status_t) switch_jb_stretch_pull(switch_jb_t *jb, uint8_t pt, switch_rtp_packet_t *packet, switch_size_t *len)
+{
+	switch_jb_node_t *node = NULL;
+	switch_status_t status = SWITCH_STATUS_MORE_DATA;
+
+	switch_mutex_lock(jb->mutex);
+
+	if (!switch_test_flag(jb, SJB_TIME_STRETCH) || !jb->read_init || jb->complete_frames <= jb->frame_len) {
+		goto end;
+	}
+
+	/* only the very next packet, a gap is left for the regular read and its plc */
+	if (jb->samples_per_frame) {
+		node = jb->target_ts ? switch_core_inthash_find(jb->node_hash_ts, jb->target_ts) : NULL;
+	} else {
+		node = jb->target_seq ? jb_ring_find(jb, jb->target_seq) : NULL;
+	}
+
+	if (!node || node->packet.header.pt != pt || jb_next_packet(jb, &node) != SWITCH_STATUS_SUCCESS) {
+		goto end;
+	}
+
+	jb_read_node(jb, node);
+	jb_copy_packet(packet, &node->packet, node->len);
+	*len = node->len;
+	jb->last_len = *len;
+	hide_node(node);
+	status = SWITCH_STATUS_SUCCESS;
+
+	jb_debug(jb, 1, "PULL packet ts:%u seq:%u\n", ntohl(packet->header.ts), ntohs(packet->header.seq));
+
+ end:
+
+	switch_mutex_unlock(jb->mutex);
+
+	return status;
+}
+
 SWITCH_DECLARE(switch_size_t) switch_jb_get_last_read_len(switch_jb_t *jb)
 {
 	return jb->last_len;
 }
 
+SWITCH_DECLARE(uint64_t) switch_jb_get_last_read_tick(switch_jb_t *jb)
+{
+	return jb->last_tick;
+}
+
 /**
  * switch_jb_get_packet - ȡ
  * 
@@ -1431,6 +1567,17 @@ SWITCH_DECLARE(switch_status_t) switch_jb_get_packet(switch_jb_t *jb, switch_rtp
 
 	switch_mutex_lock(jb->mutex);
 
+	if (jb->stretch_hold) {
+		jb->stretch_hold = 0;
+
+		/* handed back like a lost packet so the reader fills the slot from what it stretched */
+		if (jb->last_len) {
+			jb_debug(jb, 2, "%s", "Hold for time stretch\n");
+			plc = 1;
+			switch_goto_status(SWITCH_STATUS_NOTFOUND, end);
+		}
+	}
+
 	if (jb->complete_frames == 0) {
 		switch_goto_status(SWITCH_STATUS_BREAK, end);
 	}
@@ -1497,21 +1644,7 @@ SWITCH_DECLARE(switch_status_t) switch_jb_get_packet(switch_jb_t *jb, switch_rtp
     /* ȡһ */
 	if ((status = jb_next_packet(jb, &node)) == SWITCH_STATUS_SUCCESS) {
 		jb_debug(jb, 2, "Found next frame cur ts: %u seq: %u\n", htonl(node->packet.header.ts), htons(node->packet.header.seq));
-
-		if (!jb->read_init || ntohs(node->packet.header.seq) > ntohs(jb->highest_read_seq) || 
-			(ntohs(jb->highest_read_seq) > USHRT_MAX - 10 && ntohs(node->packet.header.seq) <= 10) ) {
-			jb->highest_read_seq = node->packet.header.seq;
-		}
-		
-		if (jb->read_init && htons(node->packet.header.seq) >= htons(jb->highest_read_seq) && (ntohl(node->packet.header.ts) > ntohl(jb->highest_read_ts))) {
-			jb->complete_frames--;
-			jb_debug(jb, 2, "READ frame ts: %u complete=%u/%u n:%u\n", ntohl(node->packet.header.ts), jb->complete_frames , jb->frame_len, jb->visible_nodes);
-			jb->highest_read_ts = node->packet.header.ts;
-		} else if (!jb->read_init) {
-			jb->highest_read_ts = node->packet.header.ts;
-		}
-		
-		if (!jb->read_init) jb->read_init = 1;
+		jb_read_node(jb, node);
 	} else {
 		if (jb->type == SJB_VIDEO) {
 			switch_jb_reset(jb);
@@ -1550,11 +1683,11 @@ SWITCH_DECLARE(switch_status_t) switch_jb_get_packet(switch_jb_t *jb, switch_rtp
 	if (node) {
 		status = SWITCH_STATUS_SUCCESS;
 		
-		*packet = node->packet;
+		jb_copy_packet(packet, &node->packet, node->len);
 		*len = node->len;
 		jb->last_len = *len;
-		memcpy(packet->body, node->packet.body, node->len);
-		hide_node(node, SWITCH_TRUE);
+		jb->last_tick = node->tick;
+		hide_node(node);
 
 		jb_debug(jb, 1, "GET packet ts:%u seq:%u %s\n", ntohl(packet->header.ts), ntohs(packet->header.seq), packet->header.m ? " <MARK>" : "");
 
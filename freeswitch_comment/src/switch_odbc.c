@@ -537,6 +537,110 @@ SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_handle_exec(switch_odbc_handle_
 	return SWITCH_ODBC_FAIL;
 }
 
+SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_statement_prepare(switch_odbc_handle_t *handle, const char *sql, switch_odbc_statement_handle_t *rstmt)
+{
+#ifdef SWITCH_HAVE_ODBC
+	SQLHSTMT stmt = NULL;
+	char *err_str = NULL;
+
+	*rstmt = NULL;
+
+	if (!db_is_up(handle)) {
+		return SWITCH_ODBC_FAIL;
+	}
+
+	if (SQLAllocHandle(SQL_HANDLE_STMT, handle->con, &stmt) != SQL_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "ERR: [%s]\n[SQLAllocHandle failed.]\n", sql);
+		return SWITCH_ODBC_FAIL;
+	}
+
+	if (SQLPrepare(stmt, (unsigned char *) sql, SQL_NTS) != SQL_SUCCESS) {
+		err_str = switch_odbc_handle_get_error(handle, stmt);
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "ERR: [%s]\n[%s]\n", sql, zstr(err_str) ? "SQLPrepare failed." : err_str);
+		switch_safe_free(err_str);
+		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		return SWITCH_ODBC_FAIL;
+	}
+
+	*rstmt = stmt;
+
+	return SWITCH_ODBC_SUCCESS;
+#else
+	return SWITCH_ODBC_FAIL;
+#endif
+}
+
+SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_statement_execute(switch_odbc_handle_t *handle, switch_odbc_statement_handle_t rstmt,
+																   int argc, const char * const *argv, char **err)
+{
+#ifdef SWITCH_HAVE_ODBC
+	SQLHSTMT stmt = (SQLHSTMT) rstmt;
+	SQLLEN ind[SWITCH_ODBC_MAX_PARAMS];
+	SQLLEN m = 0;
+	char *err_str = NULL, *err2 = NULL;
+	int i, result;
+
+	handle->affected_rows = 0;
+
+	if (argc > SWITCH_ODBC_MAX_PARAMS) {
+		err2 = "Too many parameters.";
+		goto error;
+	}
+
+	SQLFreeStmt(stmt, SQL_RESET_PARAMS);
+
+	for (i = 0; i < argc; i++) {
+		SQLULEN size = argv[i] ? (SQLULEN) strlen(argv[i]) : 0;
+
+		ind[i] = argv[i] ? SQL_NTS : SQL_NULL_DATA;
+
+		if (!SQL_SUCCEEDED(SQLBindParameter(stmt, (SQLUSMALLINT) (i + 1), SQL_PARAM_INPUT, SQL_C_CHAR, SQL_VARCHAR,
+											size ? size : 1, 0, (SQLPOINTER) argv[i], 0, &ind[i]))) {
+			err2 = "SQLBindParameter failed.";
+			goto error;
+		}
+	}
+
+	result = SQLExecute(stmt);
+
+	switch (result) {
+	case SQL_SUCCESS:
+	case SQL_SUCCESS_WITH_INFO:
+	case SQL_NO_DATA:
+		break;
+	default:
+		err2 = "SQLExecute failed.";
+		goto error;
+	}
+
+	SQLRowCount(stmt, &m);
+	handle->affected_rows = (int) m;
+	SQLFreeStmt(stmt, SQL_CLOSE);
+
+	return SWITCH_ODBC_SUCCESS;
+
+  error:
+
+	err_str = switch_odbc_handle_get_error(handle, stmt);
+
+	if (zstr(err_str)) {
+		switch_safe_free(err_str);
+		err_str = strdup(err2);
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "ERR: [prepared statement]\n[%s]\n", switch_str_nil(err_str));
+
+	if (err) {
+		*err = err_str;
+	} else {
+		free(err_str);
+	}
+
+	SQLFreeStmt(stmt, SQL_CLOSE);
+#endif
+	return SWITCH_ODBC_FAIL;
+}
+
 SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_handle_callback_exec_detailed(const char *file, const char *func, int line,
 																			   switch_odbc_handle_t *handle,
 																			   const char *sql, switch_core_db_callback_func_t callback, void *pdata,
@@ -41,6 +41,9 @@ SWITCH_MODULE_LOAD_FUNCTION(core_pcm_load);
 SWITCH_MODULE_SHUTDOWN_FUNCTION(core_pcm_shutdown);
 SWITCH_MODULE_DEFINITION(CORE_PCM_MODULE, core_pcm_load, core_pcm_shutdown, NULL);
 
+/* the fastest bulk g711 routines this cpu runs, picked at load */
+static const g711_kernels_t *g711k;
+
 static switch_status_t switch_raw_init(switch_codec_t *codec, switch_codec_flag_t flags, const switch_codec_settings_t *codec_settings)
 {
 	int encoding, decoding;
@@ -154,9 +157,8 @@ static switch_status_t switch_g711u_encode(switch_codec_t *codec,
 	dbuf = decoded_data;
 	ebuf = encoded_data;
 
-	for (i = 0; i < decoded_data_len / sizeof(short); i++) {
-		ebuf[i] = linear_to_ulaw(dbuf[i]);
-	}
+	i = decoded_data_len / sizeof(short);
+	g711k->linear_to_ulaw(ebuf, dbuf, i);
 
 	*encoded_data_len = i;
 
@@ -181,9 +183,8 @@ static switch_status_t switch_g711u_decode(switch_codec_t *codec,
 		memset(dbuf, 0, codec->implementation->decoded_bytes_per_packet);
 		*decoded_data_len = codec->implementation->decoded_bytes_per_packet;
 	} else {
-		for (i = 0; i < encoded_data_len; i++) {
-			dbuf[i] = ulaw_to_linear(ebuf[i]);
-		}
+		i = encoded_data_len;
+		g711k->ulaw_to_linear(dbuf, ebuf, i);
 
 		*decoded_data_len = i * 2;
 	}
@@ -225,9 +226,8 @@ static switch_status_t switch_g711a_encode(switch_codec_t *codec,
 	dbuf = decoded_data;
 	ebuf = encoded_data;
 
-	for (i = 0; i < decoded_data_len / sizeof(short); i++) {
-		ebuf[i] = linear_to_alaw(dbuf[i]);
-	}
+	i = decoded_data_len / sizeof(short);
+	g711k->linear_to_alaw(ebuf, dbuf, i);
 
 	*encoded_data_len = i;
 
@@ -252,9 +252,8 @@ static switch_status_t switch_g711a_decode(switch_codec_t *codec,
 		memset(dbuf, 0, codec->implementation->decoded_bytes_per_packet);
 		*decoded_data_len = codec->implementation->decoded_bytes_per_packet;
 	} else {
-		for (i = 0; i < encoded_data_len; i++) {
-			dbuf[i] = alaw_to_linear(ebuf[i]);
-		}
+		i = encoded_data_len;
+		g711k->alaw_to_linear(dbuf, ebuf, i);
 
 		*decoded_data_len = i * 2;
 	}
@@ -273,6 +272,9 @@ static void mod_g711_load(switch_loadable_module_interface_t ** module_interface
 	switch_codec_interface_t *codec_interface;
 	int mpf = 10000, spf = 80, bpf = 160, ebpf = 80, count;
 
+	g711k = g711_kernels(0);
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Using %s G.711 routines\n", g711k->name);
+
 	SWITCH_ADD_CODEC(codec_interface, "G.711 ulaw");
 	for (count = 12; count > 0; count--) {
 		switch_core_codec_add_implementation(pool, codec_interface, SWITCH_CODEC_TYPE_AUDIO,	/* enumeration defining the type of the codec */
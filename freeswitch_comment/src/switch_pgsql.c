@@ -573,6 +573,92 @@ SWITCH_DECLARE(switch_pgsql_status_t) switch_pgsql_handle_exec_string_detailed(c
 #endif
 }
 
+#ifdef SWITCH_HAVE_PGSQL
+static switch_pgsql_status_t switch_pgsql_begin(switch_pgsql_handle_t *handle)
+{
+	if (handle->auto_commit == SWITCH_FALSE && handle->in_txn == SWITCH_FALSE) {
+		if (switch_pgsql_send_query(handle, "BEGIN") != SWITCH_PGSQL_SUCCESS) {
+			if (switch_pgsql_finish_results(handle) != SWITCH_PGSQL_SUCCESS) {
+				db_is_up(handle); /* If finish_results failed, maybe the db went dead */
+			}
+			return SWITCH_PGSQL_FAIL;
+		}
+
+		if (switch_pgsql_finish_results(handle) != SWITCH_PGSQL_SUCCESS) {
+			db_is_up(handle);
+			return SWITCH_PGSQL_FAIL;
+		}
+		handle->in_txn = SWITCH_TRUE;
+	}
+
+	return SWITCH_PGSQL_SUCCESS;
+}
+#endif
+
+SWITCH_DECLARE(switch_pgsql_status_t) switch_pgsql_handle_prepare(switch_pgsql_handle_t *handle, const char *name, const char *sql, int nparams)
+{
+#ifdef SWITCH_HAVE_PGSQL
+	char *err_str;
+
+	switch_pgsql_flush(handle);
+
+	if (!db_is_up(handle)) {
+		return SWITCH_PGSQL_FAIL;
+	}
+
+	switch_safe_free(handle->sql);
+	handle->sql = strdup(sql);
+
+	if (!PQsendPrepare(handle->con, name, sql, nparams, NULL)) {
+		err_str = switch_pgsql_handle_get_error(handle);
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Failed to prepare (%s) as %s: %s\n", sql, name, switch_str_nil(err_str));
+		switch_safe_free(err_str);
+		switch_pgsql_finish_results(handle);
+		return SWITCH_PGSQL_FAIL;
+	}
+
+	return switch_pgsql_finish_results(handle);
+#else
+	return SWITCH_PGSQL_FAIL;
+#endif
+}
+
+SWITCH_DECLARE(switch_pgsql_status_t) switch_pgsql_handle_exec_prepared(switch_pgsql_handle_t *handle, const char *name, int nparams, const char * const *values)
+{
+#ifdef SWITCH_HAVE_PGSQL
+	char *err_str;
+
+	switch_pgsql_flush(handle);
+	handle->affected_rows = 0;
+
+	if (!db_is_up(handle)) {
+		return SWITCH_PGSQL_FAIL;
+	}
+
+	if (switch_pgsql_begin(handle) != SWITCH_PGSQL_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error sending BEGIN!\n");
+		return SWITCH_PGSQL_FAIL;
+	}
+
+	switch_safe_free(handle->sql);
+	handle->sql = strdup(name);
+
+	if (!PQsendQueryPrepared(handle->con, name, nparams, values, NULL, NULL, 0)) {
+		err_str = switch_pgsql_handle_get_error(handle);
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Failed to execute prepared statement %s: %s\n", name, switch_str_nil(err_str));
+		switch_safe_free(err_str);
+		if (switch_pgsql_finish_results(handle) != SWITCH_PGSQL_SUCCESS) {
+			db_is_up(handle);
+		}
+		return SWITCH_PGSQL_FAIL;
+	}
+
+	return switch_pgsql_finish_results(handle);
+#else
+	return SWITCH_PGSQL_FAIL;
+#endif
+}
+
 SWITCH_DECLARE(switch_pgsql_status_t) switch_pgsql_handle_exec_base_detailed(const char *file, const char *func, int line,
 																			 switch_pgsql_handle_t *handle, const char *sql, char **err)
 {
@@ -589,21 +675,9 @@ SWITCH_DECLARE(switch_pgsql_status_t) switch_pgsql_handle_exec_base_detailed(con
 		goto error;
 	}
 
-	if (handle->auto_commit == SWITCH_FALSE && handle->in_txn == SWITCH_FALSE) {
-		if (switch_pgsql_send_query(handle, "BEGIN") != SWITCH_PGSQL_SUCCESS) {
-			er = strdup("Error sending BEGIN!");
-			if (switch_pgsql_finish_results(handle) != SWITCH_PGSQL_SUCCESS) {
-				db_is_up(handle); /* If finish_results failed, maybe the db went dead */
-			}
-			goto error;
-		}
-
-		if (switch_pgsql_finish_results(handle) != SWITCH_PGSQL_SUCCESS) {
-			db_is_up(handle);
-			er = strdup("Error sending BEGIN!");
-			goto error;
-		}
-		handle->in_txn = SWITCH_TRUE;
+	if (switch_pgsql_begin(handle) != SWITCH_PGSQL_SUCCESS) {
+		er = strdup("Error sending BEGIN!");
+		goto error;
 	}
 
 	if (switch_pgsql_send_query(handle, sql) != SWITCH_PGSQL_SUCCESS) {
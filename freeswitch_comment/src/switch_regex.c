@@ -33,6 +33,463 @@
 #include <switch.h>
 #include <pcre.h>
 
+/*
+ * Compiled patterns are cached by (pattern, flags) in a few shards, each a hash plus an lru list
+ * under its own lock, so the dialplan stops compiling every condition on every call.
+ * switch_regex_perform hands out the entry's own pcre, so callers can keep passing it to pcre_*,
+ * with a reference held until switch_regex_free.  The handle tables map that pointer back to its
+ * entry.  An entry pushed out of the cache while still referenced is freed by its last user.
+ */
+
+#define REGEX_SHARDS 16
+#define REGEX_DEFAULT_CACHE_SIZE 4096
+
+typedef struct regex_entry_s regex_entry_t;
+typedef struct regex_shard_s regex_shard_t;
+
+struct regex_entry_s {
+	pcre *re;
+	pcre_extra *extra;
+	char *key;
+	uint32_t refs;
+	/* the cache owns the entry while it is in the hash */
+	int cached;
+	regex_shard_t *shard;
+	regex_entry_t *prev;
+	regex_entry_t *next;
+};
+
+struct regex_shard_s {
+	switch_mutex_t *mutex;
+	switch_hash_t *hash;
+	/* most recently used first */
+	regex_entry_t *head;
+	regex_entry_t *tail;
+	uint32_t count;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t errors;
+};
+
+/* cached entries by their pcre pointer, striped by that pointer rather than by the pattern */
+typedef struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *hash;
+} regex_handles_t;
+
+static struct {
+	int ready;
+	/* written with every shard locked, read under any one of them */
+	uint32_t size;
+	int jit;
+	regex_shard_t shards[REGEX_SHARDS];
+	regex_handles_t handles[REGEX_SHARDS];
+} regex_cache;
+
+static regex_handles_t *regex_handles(const void *re, char *key, size_t len)
+{
+	switch_snprintf(key, len, "%p", re);
+	return &regex_cache.handles[((uintptr_t) re >> 4) % REGEX_SHARDS];
+}
+
+static void regex_handle_add(regex_entry_t *entry)
+{
+	char key[32];
+	regex_handles_t *handles = regex_handles(entry->re, key, sizeof(key));
+
+	switch_mutex_lock(handles->mutex);
+	switch_core_hash_insert(handles->hash, key, entry);
+	switch_mutex_unlock(handles->mutex);
+}
+
+static regex_entry_t *regex_handle_find(const void *re)
+{
+	char key[32];
+	regex_handles_t *handles = regex_handles(re, key, sizeof(key));
+	regex_entry_t *entry;
+
+	switch_mutex_lock(handles->mutex);
+	entry = switch_core_hash_find(handles->hash, key);
+	switch_mutex_unlock(handles->mutex);
+
+	return entry;
+}
+
+static void regex_entry_free(regex_entry_t *entry)
+{
+	/* drop the handle before pcre_free can give the address to someone else */
+	if (entry->shard) {
+		char key[32];
+		regex_handles_t *handles = regex_handles(entry->re, key, sizeof(key));
+
+		switch_mutex_lock(handles->mutex);
+		switch_core_hash_delete(handles->hash, key);
+		switch_mutex_unlock(handles->mutex);
+	}
+
+	if (entry->extra) {
+#ifdef PCRE_STUDY_JIT_COMPILE
+		pcre_free_study(entry->extra);
+#else
+		pcre_free(entry->extra);
+#endif
+	}
+	pcre_free(entry->re);
+	free(entry->key);
+	free(entry);
+}
+
+static void regex_lru_unlink(regex_shard_t *shard, regex_entry_t *entry)
+{
+	if (entry->prev) entry->prev->next = entry->next;
+	else shard->head = entry->next;
+
+	if (entry->next) entry->next->prev = entry->prev;
+	else shard->tail = entry->prev;
+
+	entry->prev = entry->next = NULL;
+}
+
+static void regex_lru_push(regex_shard_t *shard, regex_entry_t *entry)
+{
+	entry->next = shard->head;
+	if (shard->head) shard->head->prev = entry;
+	shard->head = entry;
+	if (!shard->tail) shard->tail = entry;
+}
+
+/* call with the shard locked, returns the entries nobody holds any more for freeing after unlock */
+static regex_entry_t *regex_shard_trim(regex_shard_t *shard, uint32_t max)
+{
+	regex_entry_t *entry, *dead = NULL;
+
+	while (shard->count > max && (entry = shard->tail)) {
+		regex_lru_unlink(shard, entry);
+		switch_core_hash_delete(shard->hash, entry->key);
+		entry->cached = 0;
+		shard->count--;
+		shard->evictions++;
+
+		if (!entry->refs) {
+			entry->next = dead;
+			dead = entry;
+		}
+	}
+
+	return dead;
+}
+
+static uint32_t regex_shard_size(uint32_t size)
+{
+	if (size && size < REGEX_SHARDS) {
+		return 1;
+	}
+
+	return size / REGEX_SHARDS;
+}
+
+static void regex_free_list(regex_entry_t *dead)
+{
+	regex_entry_t *entry;
+
+	while ((entry = dead)) {
+		dead = entry->next;
+		regex_entry_free(entry);
+	}
+}
+
+static regex_entry_t *regex_compile_entry(const char *key, const char *pattern, int flags)
+{
+	regex_entry_t *entry;
+	const char *error = NULL;
+	int erroffset = 0;
+	pcre *re;
+
+	re = pcre_compile(pattern, flags, &error, &erroffset, NULL);
+
+	if (error || !re) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "COMPILE ERROR: %d [%s][%s]\n", erroffset, error, pattern);
+		if (re) pcre_free(re);
+		return NULL;
+	}
+
+	switch_zmalloc(entry, sizeof(*entry));
+	entry->re = re;
+	entry->key = strdup(key);
+	entry->refs = 1;
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+	if (regex_cache.jit) {
+		int study = PCRE_STUDY_JIT_COMPILE;
+#ifdef PCRE_STUDY_JIT_PARTIAL_SOFT_COMPILE
+		/* switch_regex_match_partial runs with PCRE_PARTIAL */
+		study |= PCRE_STUDY_JIT_PARTIAL_SOFT_COMPILE;
+#endif
+		entry->extra = pcre_study(re, study, &error);
+	}
+#endif
+
+	return entry;
+}
+
+static uint32_t regex_key_hash(const char *key)
+{
+	uint32_t h = 2166136261u;
+
+	while (*key) {
+		h = (h ^ (uint8_t) *key++) * 16777619u;
+	}
+
+	return h;
+}
+
+/* a referenced compiled pattern, from the cache when it is running */
+static regex_entry_t *regex_acquire(const char *pattern, int flags)
+{
+	char kbuf[512], *key = kbuf;
+	size_t len = strlen(pattern) + 16;
+	regex_shard_t *shard;
+	regex_entry_t *entry, *found, *dead = NULL;
+
+	if (len > sizeof(kbuf)) {
+		switch_malloc(key, len);
+	}
+	switch_snprintf(key, len, "%x/%s", flags, pattern);
+
+	if (!regex_cache.ready) {
+		entry = regex_compile_entry(key, pattern, flags);
+		goto end;
+	}
+
+	shard = &regex_cache.shards[regex_key_hash(key) % REGEX_SHARDS];
+
+	switch_mutex_lock(shard->mutex);
+	if (!regex_cache.size) {
+		switch_mutex_unlock(shard->mutex);
+		entry = regex_compile_entry(key, pattern, flags);
+		goto end;
+	}
+
+	if ((entry = switch_core_hash_find(shard->hash, key))) {
+		regex_lru_unlink(shard, entry);
+		regex_lru_push(shard, entry);
+		entry->refs++;
+		shard->hits++;
+	} else {
+		shard->misses++;
+	}
+	switch_mutex_unlock(shard->mutex);
+
+	if (entry) {
+		goto end;
+	}
+
+	/* compile unlocked, another thread may get the same pattern in first */
+	if (!(entry = regex_compile_entry(key, pattern, flags))) {
+		switch_mutex_lock(shard->mutex);
+		shard->errors++;
+		switch_mutex_unlock(shard->mutex);
+		goto end;
+	}
+
+	switch_mutex_lock(shard->mutex);
+	if ((found = switch_core_hash_find(shard->hash, key))) {
+		regex_lru_unlink(shard, found);
+		regex_lru_push(shard, found);
+		found->refs++;
+		entry->next = dead;
+		dead = entry;
+		entry = found;
+	} else {
+		entry->cached = 1;
+		entry->shard = shard;
+		regex_handle_add(entry);
+		switch_core_hash_insert(shard->hash, key, entry);
+		regex_lru_push(shard, entry);
+		shard->count++;
+		dead = regex_shard_trim(shard, regex_shard_size(regex_cache.size));
+	}
+	switch_mutex_unlock(shard->mutex);
+
+	regex_free_list(dead);
+
+  end:
+	if (key != kbuf) {
+		free(key);
+	}
+
+	return entry;
+}
+
+static void regex_release(regex_entry_t *entry)
+{
+	regex_shard_t *shard = entry->shard;
+	int done;
+
+	if (!shard) {
+		regex_entry_free(entry);
+		return;
+	}
+
+	switch_mutex_lock(shard->mutex);
+	done = !--entry->refs && !entry->cached;
+	switch_mutex_unlock(shard->mutex);
+
+	if (done) {
+		regex_entry_free(entry);
+	}
+}
+
+SWITCH_DECLARE(void) switch_regex_init(switch_memory_pool_t *pool)
+{
+	int i;
+
+	for (i = 0; i < REGEX_SHARDS; i++) {
+		switch_mutex_init(&regex_cache.shards[i].mutex, SWITCH_MUTEX_NESTED, pool);
+		switch_core_hash_init(&regex_cache.shards[i].hash);
+		switch_mutex_init(&regex_cache.handles[i].mutex, SWITCH_MUTEX_NESTED, pool);
+		switch_core_hash_init(&regex_cache.handles[i].hash);
+	}
+
+#ifdef PCRE_CONFIG_JIT
+	pcre_config(PCRE_CONFIG_JIT, &regex_cache.jit);
+#endif
+
+	if (!regex_cache.size) {
+		regex_cache.size = REGEX_DEFAULT_CACHE_SIZE;
+	}
+	regex_cache.ready = 1;
+}
+
+SWITCH_DECLARE(void) switch_regex_shutdown(void)
+{
+	int i;
+
+	if (!regex_cache.ready) {
+		return;
+	}
+
+	switch_regex_cache_flush();
+	regex_cache.ready = 0;
+
+	for (i = 0; i < REGEX_SHARDS; i++) {
+		switch_core_hash_destroy(&regex_cache.shards[i].hash);
+		switch_core_hash_destroy(&regex_cache.handles[i].hash);
+	}
+}
+
+SWITCH_DECLARE(void) switch_regex_cache_set_size(uint32_t size)
+{
+	regex_entry_t *dead[REGEX_SHARDS];
+	int i;
+
+	if (!regex_cache.ready) {
+		regex_cache.size = size;
+		return;
+	}
+
+	/* nothing else holds two shards, so taking them all in order cannot deadlock */
+	for (i = 0; i < REGEX_SHARDS; i++) {
+		switch_mutex_lock(regex_cache.shards[i].mutex);
+	}
+
+	regex_cache.size = size;
+
+	for (i = 0; i < REGEX_SHARDS; i++) {
+		dead[i] = regex_shard_trim(&regex_cache.shards[i], regex_shard_size(size));
+	}
+
+	for (i = REGEX_SHARDS - 1; i >= 0; i--) {
+		switch_mutex_unlock(regex_cache.shards[i].mutex);
+	}
+
+	for (i = 0; i < REGEX_SHARDS; i++) {
+		regex_free_list(dead[i]);
+	}
+}
+
+SWITCH_DECLARE(void) switch_regex_cache_flush(void)
+{
+	regex_entry_t *dead;
+	int i;
+
+	if (!regex_cache.ready) {
+		return;
+	}
+
+	for (i = 0; i < REGEX_SHARDS; i++) {
+		switch_mutex_lock(regex_cache.shards[i].mutex);
+		dead = regex_shard_trim(&regex_cache.shards[i], 0);
+		switch_mutex_unlock(regex_cache.shards[i].mutex);
+		regex_free_list(dead);
+	}
+}
+
+SWITCH_DECLARE(void) switch_regex_cache_stats(switch_regex_cache_stats_t *stats)
+{
+	regex_shard_t *shard;
+	regex_entry_t *entry;
+	int i;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->size = regex_cache.size;
+	stats->jit = regex_cache.jit;
+
+	if (!regex_cache.ready) {
+		return;
+	}
+
+	for (i = 0; i < REGEX_SHARDS; i++) {
+		shard = &regex_cache.shards[i];
+		switch_mutex_lock(shard->mutex);
+		stats->hits += shard->hits;
+		stats->misses += shard->misses;
+		stats->evictions += shard->evictions;
+		stats->errors += shard->errors;
+		stats->entries += shard->count;
+		for (entry = shard->head; entry; entry = entry->next) {
+			if (entry->refs) stats->in_use++;
+		}
+		switch_mutex_unlock(shard->mutex);
+	}
+}
+
+/* strip the /pattern/opts form, tmp holds the pattern when it returns SWITCH_STATUS_SUCCESS */
+static switch_status_t regex_parse(const char **expression, char **tmp, int *flags)
+{
+	char *opts = NULL;
+
+	*flags = 0;
+	*tmp = NULL;
+
+	if (**expression != '/') {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	*tmp = strdup(*expression + 1);
+	switch_assert(*tmp);
+
+	if (!(opts = strrchr(*tmp, '/'))) {
+		/* Note our error */
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
+						  "Regular Expression Error expression[%s] missing ending '/' delimeter\n", *expression);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	*opts++ = '\0';
+	*expression = *tmp;
+
+	if (strchr(opts, 'i')) {
+		*flags |= PCRE_CASELESS;
+	}
+	if (strchr(opts, 's')) {
+		*flags |= PCRE_DOTALL;
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_DECLARE(switch_regex_t *) switch_regex_compile(const char *pattern,
 													  int options, const char **errorptr, int *erroroffset, const unsigned char *tables)
 {
@@ -48,18 +505,24 @@ SWITCH_DECLARE(int) switch_regex_copy_substring(const char *subject, int *ovecto
 
 SWITCH_DECLARE(void) switch_regex_free(void *data)
 {
+	regex_entry_t *entry;
+
+	/* the caller's reference keeps the entry, and so its handle, alive until regex_release */
+	if (data && regex_cache.ready && (entry = regex_handle_find(data))) {
+		regex_release(entry);
+		return;
+	}
+
 	pcre_free(data);
 
 }
 
 SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expression, switch_regex_t **new_re, int *ovector, uint32_t olen)
 {
-	const char *error = NULL;
-	int erroffset = 0;
-	pcre *re = NULL;
+	regex_entry_t *entry = NULL;
 	int match_count = 0;
 	char *tmp = NULL;
-	uint32_t flags = 0;
+	int flags = 0;
 	char abuf[256] = "";
 
 	if (!(field && expression)) {
@@ -72,42 +535,12 @@ SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expressi
 		}
 	}
 
-	if (*expression == '/') {
-		char *opts = NULL;
-		tmp = strdup(expression + 1);
-		assert(tmp);
-		if ((opts = strrchr(tmp, '/'))) {
-			*opts++ = '\0';
-		} else {
-			/* Note our error */
-			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-							  "Regular Expression Error expression[%s] missing ending '/' delimeter\n", expression);
-			goto end;
-		}
-		expression = tmp;
-		if (opts) {
-			if (strchr(opts, 'i')) {
-				flags |= PCRE_CASELESS;
-			}
-			if (strchr(opts, 's')) {
-				flags |= PCRE_DOTALL;
-			}
-		}
-	}
-
-	re = pcre_compile(expression,	/* the pattern */
-					  flags,	/* default options */
-					  &error,	/* for error message */
-					  &erroffset,	/* for error offset */
-					  NULL);	/* use default character tables */
-	if (error) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "COMPILE ERROR: %d [%s][%s]\n", erroffset, error, expression);
-		switch_regex_safe_free(re);
+	if (regex_parse(&expression, &tmp, &flags) != SWITCH_STATUS_SUCCESS || !(entry = regex_acquire(expression, flags))) {
 		goto end;
 	}
 
-	match_count = pcre_exec(re,	/* result of pcre_compile() */
-							NULL,	/* we didn't study the pattern */
+	match_count = pcre_exec(entry->re,	/* result of pcre_compile() */
+							entry->extra,	/* jit code when there is any */
 							field,	/* the subject string */
 							(int) strlen(field),	/* the length of the subject string */
 							0,	/* start at offset 0 in the subject */
@@ -117,12 +550,18 @@ SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expressi
 
 
 	if (match_count <= 0) {
-		switch_regex_safe_free(re);
+		regex_release(entry);
+		*new_re = NULL;
 		match_count = 0;
+	} else if (!entry->shard) {
+		/* not cached, the caller gets the pcre alone and switch_regex_free pcre_frees it */
+		*new_re = (switch_regex_t *) entry->re;
+		entry->re = NULL;
+		regex_entry_free(entry);
+	} else {
+		*new_re = (switch_regex_t *) entry->re;
 	}
 
-	*new_re = (switch_regex_t *) re;
-
   end:
 	switch_safe_free(tmp);
 	return match_count;
@@ -209,53 +648,20 @@ SWITCH_DECLARE(void) switch_capture_regex(switch_regex_t *re, int match_count, c
 
 SWITCH_DECLARE(switch_status_t) switch_regex_match_partial(const char *target, const char *expression, int *partial)
 {
-	const char *error = NULL;	/* Used to hold any errors                                           */
-	int error_offset = 0;		/* Holds the offset of an error                                      */
-	pcre *pcre_prepared = NULL;	/* Holds the compiled regex                                          */
+	regex_entry_t *entry = NULL;	/* Holds the compiled regex                                          */
 	int match_count = 0;		/* Number of times the regex was matched                             */
 	int offset_vectors[255];	/* not used, but has to exist or pcre won't even try to find a match */
 	int pcre_flags = 0;
-	uint32_t flags = 0;
+	int flags = 0;
 	char *tmp = NULL;
 	switch_status_t status = SWITCH_STATUS_FALSE;
 
-	if (*expression == '/') {
-		char *opts = NULL;
-		tmp = strdup(expression + 1);
-		assert(tmp);
-		if ((opts = strrchr(tmp, '/'))) {
-			*opts++ = '\0';
-		} else {
-			/* Note our error */
-			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-							  "Regular Expression Error expression[%s] missing ending '/' delimeter\n", expression);
-			goto end;
-		}
-		expression = tmp;
-		if (opts) {
-			if (strchr(opts, 'i')) {
-				flags |= PCRE_CASELESS;
-			}
-			if (strchr(opts, 's')) {
-				flags |= PCRE_DOTALL;
-			}
-		}
+	if (regex_parse(&expression, &tmp, &flags) != SWITCH_STATUS_SUCCESS) {
+		goto end;
 	}
 
-	/* Compile the expression */
-	pcre_prepared = pcre_compile(expression, flags, &error, &error_offset, NULL);
-
-	/* See if there was an error in the expression */
-	if (error != NULL) {
-		/* Clean up after ourselves */
-		if (pcre_prepared) {
-			pcre_free(pcre_prepared);
-			pcre_prepared = NULL;
-		}
-		/* Note our error */
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-						  "Regular Expression Error expression[%s] error[%s] location[%d]\n", expression, error, error_offset);
-
+	/* Compile the expression, or find it compiled already */
+	if (!(entry = regex_acquire(expression, flags))) {
 		/* We definitely didn't match anything */
 		goto end;
 	}
@@ -266,13 +672,10 @@ SWITCH_DECLARE(switch_status_t) switch_regex_match_partial(const char *target, c
 
 	/* So far so good, run the regex */
 	match_count =
-		pcre_exec(pcre_prepared, NULL, target, (int) strlen(target), 0, pcre_flags, offset_vectors, sizeof(offset_vectors) / sizeof(offset_vectors[0]));
+		pcre_exec(entry->re, entry->extra, target, (int) strlen(target), 0, pcre_flags, offset_vectors, sizeof(offset_vectors) / sizeof(offset_vectors[0]));
 
 	/* Clean up */
-	if (pcre_prepared) {
-		pcre_free(pcre_prepared);
-		pcre_prepared = NULL;
-	}
+	regex_release(entry);
 
 	/* switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "number of matches: %d\n", match_count); */
 
@@ -32,6 +32,7 @@
 
 #include <switch.h>
 #include <switch_resample.h>
+#include <g711.h>
 #ifndef WIN32
 #include <switch_private.h>
 #endif
@@ -52,6 +53,329 @@
 
 #define resample_buffer(a, b, c) a > b ? ((a / 1000) / 2) * c : ((b / 1000) / 2) * c
 
+/*
+ * Rate pairs that reduce to a small ratio (8k, 16k, 48k and friends) skip speex and run an int16
+ * polyphase filter.  The coefficients only depend on the rates and the quality, so each table is
+ * built once, shared by every resampler that needs it and kept until shutdown.  Lengths, cutoffs
+ * and windows follow the speex quality map so the two paths sound the same.
+ */
+
+#define POLY_MAX_FACTOR 12
+
+typedef struct poly_filter_s {
+	uint32_t from_rate;
+	uint32_t to_rate;
+	int quality;
+	/* upsample by up, downsample by down */
+	uint32_t up;
+	uint32_t down;
+	/* taps per phase, a multiple of 8 */
+	uint32_t taps;
+	/* coefficients are Q shift */
+	int shift;
+	int16_t *coefs;
+	struct poly_filter_s *next;
+} poly_filter_t;
+
+typedef struct {
+	poly_filter_t *filter;
+	uint32_t channels;
+	uint32_t phase;
+	/* samples per channel held in hist */
+	uint32_t fill;
+	uint32_t size;
+	int16_t *hist;
+} poly_state_t;
+
+static const struct {
+	uint32_t base_taps;
+	double down_cutoff;
+	double up_cutoff;
+	double beta;
+} poly_quality[] = {
+	{8, 0.830, 0.860, 6.0},
+	{16, 0.850, 0.880, 6.0},
+	{32, 0.882, 0.910, 6.0},
+	{48, 0.895, 0.917, 8.0},
+	{64, 0.921, 0.940, 8.0},
+	{80, 0.922, 0.940, 10.0},
+	{96, 0.940, 0.945, 10.0},
+	{128, 0.950, 0.950, 10.0},
+	{160, 0.960, 0.960, 10.0},
+	{192, 0.968, 0.968, 12.0},
+	{256, 0.975, 0.975, 12.0}
+};
+
+static struct {
+	switch_mutex_t *mutex;
+	poly_filter_t *filters;
+} poly_cache;
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+static double bessel_i0(double x)
+{
+	double sum = 1, term = 1;
+	int k;
+
+	for (k = 1; k < 50; k++) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+		if (term < sum * 1e-12) break;
+	}
+
+	return sum;
+}
+
+static poly_filter_t *poly_filter_build(uint32_t from_rate, uint32_t to_rate, int quality)
+{
+	uint32_t g = gcd(from_rate, to_rate), up = to_rate / g, down = from_rate / g, taps, p, k;
+	double cutoff, half, *h, sum, abs_sum, max_abs_sum = 0;
+	poly_filter_t *filter;
+
+	if (up > POLY_MAX_FACTOR || down > POLY_MAX_FACTOR) {
+		return NULL;
+	}
+
+	/* a lower output rate stretches the filter to cut at the output nyquist */
+	if (down > up) {
+		cutoff = poly_quality[quality].down_cutoff * up / down;
+		taps = (poly_quality[quality].base_taps * down + up - 1) / up;
+	} else {
+		cutoff = poly_quality[quality].up_cutoff;
+		taps = poly_quality[quality].base_taps;
+	}
+	taps = (taps + 7) & ~7;
+	half = taps / 2.0;
+
+	switch_zmalloc(filter, sizeof(*filter));
+	filter->from_rate = from_rate;
+	filter->to_rate = to_rate;
+	filter->quality = quality;
+	filter->up = up;
+	filter->down = down;
+	filter->taps = taps;
+	filter->coefs = malloc(up * taps * sizeof(int16_t));
+	switch_assert(filter->coefs);
+	h = malloc(up * taps * sizeof(double));
+	switch_assert(h);
+
+	/* phase p puts an output p / up of an input sample after tap taps / 2 - 1 */
+	for (p = 0; p < up; p++) {
+		sum = abs_sum = 0;
+
+		for (k = 0; k < taps; k++) {
+			double d = k - (half - 1) - (double) p / up, w = d / half, x = M_PI * cutoff * d, v;
+
+			v = x ? cutoff * sin(x) / x : cutoff;
+			v *= (w >= -1 && w <= 1) ? bessel_i0(poly_quality[quality].beta * sqrt(1 - w * w)) / bessel_i0(poly_quality[quality].beta) : 0;
+			h[p * taps + k] = v;
+			sum += v;
+		}
+
+		/* unity gain at dc for every phase */
+		for (k = 0; k < taps; k++) {
+			h[p * taps + k] /= sum;
+			abs_sum += fabs(h[p * taps + k]);
+		}
+
+		max_abs_sum = MAX(max_abs_sum, abs_sum);
+	}
+
+	/* the int32 accumulator holds sum(|h|) * 2^15 * 2^shift */
+	filter->shift = max_abs_sum < 1.95 ? 15 : 14;
+
+	for (p = 0; p < up; p++) {
+		int32_t total = 0, target = 1 << filter->shift, c;
+		uint32_t center = (uint32_t) half - 1;
+
+		for (k = 0; k < taps; k++) {
+			c = (int32_t) floor(h[p * taps + k] * target + 0.5);
+			c = MIN(MAX(c, -32768), 32767);
+			filter->coefs[p * taps + k] = (int16_t) c;
+			total += c;
+		}
+
+		/* put the rounding error on the biggest tap */
+		if (h[p * taps + center + 1] > h[p * taps + center]) {
+			center++;
+		}
+		c = filter->coefs[p * taps + center] + target - total;
+		filter->coefs[p * taps + center] = (int16_t) MIN(MAX(c, -32768), 32767);
+	}
+
+	free(h);
+
+	return filter;
+}
+
+static poly_filter_t *poly_filter_get(uint32_t from_rate, uint32_t to_rate, int quality)
+{
+	poly_filter_t *filter;
+
+	if (!poly_cache.mutex) {
+		return NULL;
+	}
+
+	switch_mutex_lock(poly_cache.mutex);
+
+	for (filter = poly_cache.filters; filter; filter = filter->next) {
+		if (filter->from_rate == from_rate && filter->to_rate == to_rate && filter->quality == quality) {
+			break;
+		}
+	}
+
+	if (!filter && (filter = poly_filter_build(from_rate, to_rate, quality))) {
+		filter->next = poly_cache.filters;
+		poly_cache.filters = filter;
+	}
+
+	switch_mutex_unlock(poly_cache.mutex);
+
+	return filter;
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+
+static inline int32_t poly_dot(const int16_t *x, const int16_t *h, uint32_t taps)
+{
+	__m128i acc = _mm_setzero_si128();
+	uint32_t k;
+
+	for (k = 0; k < taps; k += 8) {
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (x + k)), _mm_loadu_si128((const __m128i *) (h + k))));
+	}
+
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return _mm_cvtsi128_si32(acc);
+}
+#else
+static inline int32_t poly_dot(const int16_t *x, const int16_t *h, uint32_t taps)
+{
+	int32_t acc = 0;
+	uint32_t k;
+
+	for (k = 0; k < taps; k++) {
+		acc += (int32_t) x[k] * h[k];
+	}
+
+	return acc;
+}
+#endif
+
+static poly_state_t *poly_state_create(poly_filter_t *filter, uint32_t channels)
+{
+	poly_state_t *state;
+
+	switch_zmalloc(state, sizeof(*state));
+	state->filter = filter;
+	state->channels = channels;
+	/* start with a filter's worth of silence like speex, the delay is half the filter */
+	state->fill = filter->taps - 1;
+	state->size = filter->taps + 960;
+	switch_zmalloc(state->hist, state->size * channels * sizeof(int16_t));
+
+	return state;
+}
+
+static void poly_state_destroy(poly_state_t **state)
+{
+	if (state && *state) {
+		free((*state)->hist);
+		free(*state);
+		*state = NULL;
+	}
+}
+
+/* most samples per channel poly_state_process can give for srclen in */
+static uint32_t poly_max_out(poly_state_t *state, uint32_t srclen)
+{
+	return (uint32_t) (((uint64_t) srclen * state->filter->up) / state->filter->down) + 2;
+}
+
+static uint32_t poly_state_process(poly_state_t *state, const int16_t *src, uint32_t srclen, int16_t *dst)
+{
+	poly_filter_t *filter = state->filter;
+	uint32_t channels = state->channels, taps = filter->taps, total = state->fill + srclen;
+	uint32_t c, i, n = 0, pos = 0, phase = 0, skip = filter->down / filter->up, step = filter->down % filter->up;
+	int32_t round = 1 << (filter->shift - 1), acc;
+	int16_t *hist;
+
+	if (total > state->size) {
+		hist = malloc(total * channels * sizeof(int16_t));
+		switch_assert(hist);
+		for (c = 0; c < channels; c++) {
+			memcpy(hist + c * total, state->hist + c * state->size, state->fill * sizeof(int16_t));
+		}
+		free(state->hist);
+		state->hist = hist;
+		state->size = total;
+	}
+
+	for (c = 0; c < channels; c++) {
+		hist = state->hist + c * state->size;
+
+		for (i = 0; i < srclen; i++) {
+			hist[state->fill + i] = src[i * channels + c];
+		}
+
+		/* every channel walks the same positions */
+		for (n = 0, pos = 0, phase = state->phase; pos + taps <= total; n++) {
+			acc = (poly_dot(hist + pos, filter->coefs + phase * taps, taps) + round) >> filter->shift;
+			dst[n * channels + c] = (int16_t) MIN(MAX(acc, -32768), 32767);
+			pos += skip;
+			if ((phase += step) >= filter->up) {
+				phase -= filter->up;
+				pos++;
+			}
+		}
+
+		memmove(hist, hist + pos, (total - pos) * sizeof(int16_t));
+	}
+
+	state->phase = phase;
+	state->fill = total - pos;
+
+	return n;
+}
+
+SWITCH_DECLARE(void) switch_resample_init(switch_memory_pool_t *pool)
+{
+	switch_mutex_init(&poly_cache.mutex, SWITCH_MUTEX_NESTED, pool);
+}
+
+SWITCH_DECLARE(void) switch_resample_shutdown(void)
+{
+	poly_filter_t *filter;
+
+	if (!poly_cache.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(poly_cache.mutex);
+	while ((filter = poly_cache.filters)) {
+		poly_cache.filters = filter->next;
+		free(filter->coefs);
+		free(filter);
+	}
+	switch_mutex_unlock(poly_cache.mutex);
+
+	poly_cache.mutex = NULL;
+}
+
+
 SWITCH_DECLARE(switch_status_t) switch_resample_perform_create(switch_audio_resampler_t **new_resampler,
 															   uint32_t from_rate, uint32_t to_rate,
 															   uint32_t to_size,
@@ -59,24 +383,32 @@ SWITCH_DECLARE(switch_status_t) switch_resample_perform_create(switch_audio_resa
 {
 	int err = 0;
 	switch_audio_resampler_t *resampler;
+	poly_filter_t *filter;
 	double lto_rate, lfrom_rate;
 
 	switch_zmalloc(resampler, sizeof(*resampler));
 
 	if (!channels) channels = 1;
-	
-	resampler->resampler = speex_resampler_init(channels, from_rate, to_rate, quality, &err);
 
-	if (!resampler->resampler) {
+	if (quality < 0) quality = 0;
+	if (quality > 10) quality = 10;
+
+	if (from_rate && to_rate && (filter = poly_filter_get(from_rate, to_rate, quality))) {
+		resampler->poly = poly_state_create(filter, channels);
+	} else {
+		resampler->resampler = speex_resampler_init(channels, from_rate, to_rate, quality, &err);
+	}
+
+	if (!resampler->resampler && !resampler->poly) {
 		free(resampler);
 		return SWITCH_STATUS_GENERR;
 	}
 
 	*new_resampler = resampler;
-	lto_rate = (double) resampler->to_rate;
-	lfrom_rate = (double) resampler->from_rate;
 	resampler->from_rate = from_rate;
 	resampler->to_rate = to_rate;
+	lto_rate = (double) resampler->to_rate;
+	lfrom_rate = (double) resampler->from_rate;
 	resampler->factor = (lto_rate / lfrom_rate);
 	resampler->rfactor = (lfrom_rate / lto_rate);
 	resampler->channels = channels;
@@ -94,12 +426,21 @@ SWITCH_DECLARE(uint32_t) switch_resample_process(switch_audio_resampler_t *resam
 {
 	int to_size = switch_resample_calc_buffer_size(resampler->to_rate, resampler->from_rate, srclen) / 2;
 
+	if (resampler->poly) {
+		to_size = poly_max_out(resampler->poly, srclen);
+	}
+
 	if (to_size > resampler->to_size) {
 		resampler->to_size = to_size;
 		resampler->to = realloc(resampler->to, resampler->to_size * sizeof(int16_t) * resampler->channels);
 		switch_assert(resampler->to);
 	}
 	
+	if (resampler->poly) {
+		resampler->to_len = poly_state_process(resampler->poly, src, srclen, resampler->to);
+		return resampler->to_len;
+	}
+
 	resampler->to_len = resampler->to_size;
 	speex_resampler_process_interleaved_int(resampler->resampler, src, &srclen, resampler->to, &resampler->to_len);
 	return resampler->to_len;
@@ -112,6 +453,7 @@ SWITCH_DECLARE(void) switch_resample_destroy(switch_audio_resampler_t **resample
 		if ((*resampler)->resampler) {
 			speex_resampler_destroy((*resampler)->resampler);
 		}
+		poly_state_destroy((poly_state_t **) &(*resampler)->poly);
 		free((*resampler)->to);
 		free(*resampler);
 		*resampler = NULL;
@@ -188,10 +530,13 @@ SWITCH_DECLARE(int) switch_short_to_float(short *s, float *f, int len)
 
 SWITCH_DECLARE(void) switch_swap_linear(int16_t *buf, int len)
 {
-	int i;
-	for (i = 0; i < len; i++) {
-		buf[i] = ((buf[i] >> 8) & 0x00ff) | ((buf[i] << 8) & 0xff00);
+	static const g711_kernels_t *k = NULL;
+
+	if (!k) {
+		k = g711_kernels(0);
 	}
+
+	k->l16_swap(buf, buf, len);
 }
 
 
@@ -323,6 +668,93 @@ SWITCH_DECLARE(void) switch_mux_channels(int16_t *data, switch_size_t samples, u
 	}
 }
 
+/* pitch periods the time stretch looks for, 2.5ms to 15ms */
+#define STRETCH_MIN_PERIOD(_rate) ((_rate) / 400)
+#define STRETCH_MAX_PERIOD(_rate) ((_rate) * 3 / 200)
+/* two periods must correlate this well to be merged, unless the whole span is about silent */
+#define STRETCH_MIN_CORR 0.6
+#define STRETCH_QUIET_POWER 40000.0
+
+static uint32_t sln_best_period(const int16_t *data, uint32_t samples, uint32_t rate, uint32_t limit)
+{
+	uint32_t min = STRETCH_MIN_PERIOD(rate), max = STRETCH_MAX_PERIOD(rate), step = rate > 8000 ? rate / 8000 : 1;
+	uint32_t p, i, best = 0;
+	double best_score = 0, power = 0;
+
+	if (max > samples / 2) max = samples / 2;
+	if (max > limit) max = limit;
+	if (!min || min > max) return 0;
+
+	/* wideband is searched on an 8khz grid so the cost does not grow with the rate */
+	for (i = 0; i < 2 * max; i += step) {
+		power += (double) data[i] * data[i];
+	}
+
+	if (power / (2 * max / step) < STRETCH_QUIET_POWER) {
+		return max;
+	}
+
+	for (p = min; p <= max; p += step) {
+		double xy = 0, xx = 0, yy = 0, score;
+
+		for (i = 0; i < p; i += step) {
+			xy += (double) data[i] * data[i + p];
+			xx += (double) data[i] * data[i];
+			yy += (double) data[i + p] * data[i + p];
+		}
+
+		if (xy <= 0 || xx == 0 || yy == 0) continue;
+
+		/* normalized correlation squared, kept away from sqrt */
+		score = (xy * xy) / (xx * yy);
+
+		if (score > best_score) {
+			best_score = score;
+			best = p;
+		}
+	}
+
+	if (best_score < STRETCH_MIN_CORR * STRETCH_MIN_CORR) {
+		return 0;
+	}
+
+	return best;
+}
+
+SWITCH_DECLARE(uint32_t) switch_accelerate_sln(int16_t *data, uint32_t samples, uint32_t rate)
+{
+	uint32_t p = sln_best_period(data, samples, rate, samples), i;
+
+	if (!p) return samples;
+
+	/* fade the first period into the second, then drop the second */
+	for (i = 0; i < p; i++) {
+		data[i] = (int16_t) (((int32_t) data[i] * (int32_t) (p - i) + (int32_t) data[i + p] * (int32_t) i) / (int32_t) p);
+	}
+
+	memmove(data + p, data + 2 * p, (samples - 2 * p) * sizeof(int16_t));
+
+	return samples - p;
+}
+
+SWITCH_DECLARE(uint32_t) switch_decelerate_sln(int16_t *data, uint32_t samples, uint32_t max_samples, uint32_t rate)
+{
+	uint32_t p, i;
+
+	if (max_samples <= samples || !(p = sln_best_period(data, samples, rate, max_samples - samples))) {
+		return samples;
+	}
+
+	/* play the first period, fade from the second back into the first, then carry on from the second */
+	memmove(data + 2 * p, data + p, (samples - p) * sizeof(int16_t));
+
+	for (i = 0; i < p; i++) {
+		data[p + i] = (int16_t) (((int32_t) data[2 * p + i] * (int32_t) (p - i) + (int32_t) data[i] * (int32_t) i) / (int32_t) p);
+	}
+
+	return samples + p;
+}
+
 SWITCH_DECLARE(void) switch_change_sln_volume_granular(int16_t *data, uint32_t samples, int32_t vol)
 {
 	double newrate = 0;
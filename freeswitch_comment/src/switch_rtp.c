@@ -59,6 +59,19 @@
 #include <switch_estimators.h>
 
 
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_RECVMMSG)
+#define ENABLE_RTP_REACTOR
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#endif
+
+#ifdef HAVE_SENDMMSG
+#define ENABLE_RTP_TX_BATCH
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#endif
+
 #define JITTER_LEAD_FRAMES 10
 #define READ_INC(rtp_session) switch_mutex_lock(rtp_session->read_mutex); rtp_session->reading++
 #define READ_DEC(rtp_session)  switch_mutex_unlock(rtp_session->read_mutex); rtp_session->reading--
@@ -306,6 +319,9 @@ typedef struct ts_normalize_s {
 	uint32_t delta_ttl;
 } ts_normalize_t;
 
+typedef struct rtp_inbox_s rtp_inbox_t;
+typedef struct rtp_tx_batch_s rtp_tx_batch_t;
+
 struct switch_rtp {
 	/* 
 	 * Two sockets are needed because we might be transcoding protocol families
@@ -316,6 +332,10 @@ struct switch_rtp {
 	switch_socket_t *sock_input, *sock_output, *rtcp_sock_input, *rtcp_sock_output;
 	switch_pollfd_t *read_pollfd, *rtcp_read_pollfd;
 	switch_pollfd_t *jb_pollfd;
+	/* packets the rtp reactor read off sock_input for us */
+	rtp_inbox_t *inbox;
+	/* packets written but not yet handed to the kernel, write_mutex held */
+	rtp_tx_batch_t *txq;
 
 	switch_sockaddr_t *local_addr, *rtcp_local_addr;
 	rtp_msg_t send_msg;
@@ -467,6 +487,8 @@ struct switch_rtp {
 	uint8_t punts;
 	uint8_t clean;
 	uint32_t last_max_vb_frames;
+	uint64_t recv_tick;
+	uint64_t jb_tick;
 #ifdef ENABLE_ZRTP
 	zrtp_session_t *zrtp_session;
 	zrtp_profile_t *zrtp_profile;
@@ -1459,6 +1481,640 @@ static void zrtp_logger(int level, const char *data, int len, int offset)
 }
 #endif
 
+#ifdef ENABLE_RTP_REACTOR
+/*
+ * RTP reactor: a few threads own the rtp sockets through epoll and drain them with recvmmsg
+ * into a ring per session.  The session thread's poll and recvfrom become a look at its ring,
+ * so it only ever enters the kernel to sleep.
+ */
+#define RTP_REACTOR_MAX 64
+#define RTP_REACTOR_EVENTS 128
+#define RTP_REACTOR_BATCH 32
+#define RTP_INBOX_SLOT_LEN 2048
+#define RTP_INBOX_AUDIO 32
+#define RTP_INBOX_VIDEO 256
+
+typedef struct rtp_inbox_slot_s {
+	uint32_t len;
+	socklen_t fromlen;
+	struct sockaddr_storage from;
+	uint8_t data[RTP_INBOX_SLOT_LEN];
+} rtp_inbox_slot_t;
+
+struct rtp_inbox_s {
+	rtp_inbox_slot_t *slots;
+	uint32_t size;
+	/* head is only written by the reactor, tail only by the session thread */
+	uint32_t head;
+	uint32_t tail;
+	int waiting;
+	int attached;
+	int fd;
+	uint32_t reactor;
+	uint32_t idx;
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+};
+
+typedef struct rtp_reactor_s {
+	int epfd;
+	switch_thread_t *thread;
+	switch_mutex_t *mutex;
+	/* epoll events carry an index and generation into here, never a pointer, so a late event can't reach a detached inbox */
+	rtp_inbox_t **inboxes;
+	uint32_t *gens;
+	uint32_t *free_list;
+	uint32_t free_count;
+	uint32_t inbox_max;
+	uint32_t members;
+	uint64_t packets;
+	uint64_t batches;
+	uint64_t wakeups;
+	uint64_t signals;
+	uint64_t dropped;
+} rtp_reactor_t;
+
+static struct {
+	uint32_t threads;
+	uint32_t next;
+	int running;
+	rtp_reactor_t *reactors;
+} rtp_reactor_globals;
+
+static int rtp_inbox_ready(rtp_inbox_t *inbox)
+{
+	return inbox->tail != __atomic_load_n(&inbox->head, __ATOMIC_SEQ_CST);
+}
+
+/* returns how many packets it queued */
+static int rtp_reactor_drain(rtp_reactor_t *reactor, rtp_inbox_t *inbox, struct mmsghdr *msgs, struct iovec *iov)
+{
+	uint32_t head = inbox->head, tail = __atomic_load_n(&inbox->tail, __ATOMIC_ACQUIRE);
+	uint32_t room = inbox->size - (head - tail), want, i;
+	int got, loops = 0, pushed = 0;
+
+	while (loops++ < 4) {
+		if (!room) {
+			/* not keeping up, drop the newest like a full socket buffer would */
+			uint8_t junk[RTP_INBOX_SLOT_LEN];
+
+			for (i = 0; i < RTP_REACTOR_BATCH && recv(inbox->fd, junk, sizeof(junk), MSG_DONTWAIT) >= 0; i++) {
+				reactor->dropped++;
+			}
+			break;
+		}
+
+		want = room < RTP_REACTOR_BATCH ? room : RTP_REACTOR_BATCH;
+
+		for (i = 0; i < want; i++) {
+			rtp_inbox_slot_t *slot = &inbox->slots[(head + i) & (inbox->size - 1)];
+
+			iov[i].iov_base = slot->data;
+			iov[i].iov_len = sizeof(slot->data);
+			memset(&msgs[i], 0, sizeof(msgs[i]));
+			msgs[i].msg_hdr.msg_name = &slot->from;
+			msgs[i].msg_hdr.msg_namelen = sizeof(slot->from);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		if ((got = recvmmsg(inbox->fd, msgs, want, MSG_DONTWAIT, NULL)) <= 0) {
+			break;
+		}
+
+		for (i = 0; i < (uint32_t) got; i++) {
+			rtp_inbox_slot_t *slot = &inbox->slots[(head + i) & (inbox->size - 1)];
+
+			/* a truncated packet is no use to anyone, the session thread skips len 0 */
+			slot->len = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? 0 : msgs[i].msg_len;
+			slot->fromlen = msgs[i].msg_hdr.msg_namelen;
+		}
+
+		head += got;
+		room -= got;
+		pushed += got;
+		__atomic_store_n(&inbox->head, head, __ATOMIC_SEQ_CST);
+
+		reactor->packets += got;
+		reactor->batches++;
+
+		if ((uint32_t) got < want) {
+			break;
+		}
+	}
+
+	return pushed;
+}
+
+/* one signal per sleeping reader, whoever clears waiting first owns the wakeup */
+static void rtp_reactor_wake(rtp_reactor_t *reactor, rtp_inbox_t *inbox)
+{
+	if (__atomic_exchange_n(&inbox->waiting, 0, __ATOMIC_SEQ_CST)) {
+		switch_mutex_lock(inbox->mutex);
+		switch_thread_cond_signal(inbox->cond);
+		switch_mutex_unlock(inbox->mutex);
+		reactor->signals++;
+	}
+}
+
+static void *SWITCH_THREAD_FUNC rtp_reactor_thread(switch_thread_t *thread, void *obj)
+{
+	rtp_reactor_t *reactor = (rtp_reactor_t *) obj;
+	struct epoll_event events[RTP_REACTOR_EVENTS];
+	struct mmsghdr msgs[RTP_REACTOR_BATCH];
+	struct iovec iov[RTP_REACTOR_BATCH];
+	rtp_inbox_t *wake[RTP_REACTOR_EVENTS];
+	int n, i, w;
+
+	while (rtp_reactor_globals.running) {
+		if ((n = epoll_wait(reactor->epfd, events, RTP_REACTOR_EVENTS, 100)) <= 0) {
+			continue;
+		}
+
+		reactor->wakeups++;
+
+		switch_mutex_lock(reactor->mutex);
+		for (i = 0, w = 0; i < n; i++) {
+			uint32_t idx = (uint32_t) (events[i].data.u64 & 0xffffffff);
+			uint32_t gen = (uint32_t) (events[i].data.u64 >> 32);
+
+			if (idx < reactor->inbox_max && reactor->inboxes[idx] && reactor->gens[idx] == gen &&
+				rtp_reactor_drain(reactor, reactor->inboxes[idx], msgs, iov)) {
+				wake[w++] = reactor->inboxes[idx];
+			}
+		}
+
+		/* readers are woken once the whole round is queued, and take everything that arrived with one wakeup */
+		for (i = 0; i < w; i++) {
+			rtp_reactor_wake(reactor, wake[i]);
+		}
+		switch_mutex_unlock(reactor->mutex);
+	}
+
+	return NULL;
+}
+
+static void rtp_reactor_start(switch_memory_pool_t *pool)
+{
+	switch_threadattr_t *thd_attr = NULL;
+	uint32_t i;
+
+	if (!rtp_reactor_globals.threads) {
+		return;
+	}
+
+	rtp_reactor_globals.reactors = switch_core_alloc(pool, sizeof(rtp_reactor_t) * rtp_reactor_globals.threads);
+	rtp_reactor_globals.running = 1;
+
+	for (i = 0; i < rtp_reactor_globals.threads; i++) {
+		rtp_reactor_t *reactor = &rtp_reactor_globals.reactors[i];
+
+		if ((reactor->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "RTP reactor epoll_create failed, sessions will poll their own sockets\n");
+			break;
+		}
+
+		switch_mutex_init(&reactor->mutex, SWITCH_MUTEX_NESTED, pool);
+		switch_threadattr_create(&thd_attr, pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_threadattr_priority_set(thd_attr, SWITCH_PRI_REALTIME);
+		switch_thread_create(&reactor->thread, thd_attr, rtp_reactor_thread, reactor, pool);
+	}
+
+	if (!(rtp_reactor_globals.threads = i)) {
+		rtp_reactor_globals.running = 0;
+		return;
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "RTP reactor started with %u threads\n", rtp_reactor_globals.threads);
+}
+
+static void rtp_reactor_stop(void)
+{
+	switch_status_t st;
+	uint32_t i;
+
+	if (!rtp_reactor_globals.running) {
+		return;
+	}
+
+	rtp_reactor_globals.running = 0;
+
+	for (i = 0; i < rtp_reactor_globals.threads; i++) {
+		rtp_reactor_t *reactor = &rtp_reactor_globals.reactors[i];
+
+		switch_thread_join(&st, reactor->thread);
+		close(reactor->epfd);
+		switch_safe_free(reactor->inboxes);
+		switch_safe_free(reactor->gens);
+		switch_safe_free(reactor->free_list);
+	}
+}
+
+/* flag_mutex held */
+static void rtp_reactor_attach(switch_rtp_t *rtp_session)
+{
+	rtp_inbox_t *inbox = rtp_session->inbox;
+	rtp_reactor_t *reactor;
+	struct epoll_event ev = { 0 };
+	uint32_t idx;
+	int fd;
+
+	if (!rtp_reactor_globals.running || !rtp_session->sock_input || (fd = switch_socket_fd_get(rtp_session->sock_input)) < 0) {
+		return;
+	}
+
+	if (!inbox) {
+		inbox = switch_core_alloc(rtp_session->pool, sizeof(*inbox));
+		inbox->size = rtp_session->flags[SWITCH_RTP_FLAG_VIDEO] ? RTP_INBOX_VIDEO : RTP_INBOX_AUDIO;
+		inbox->slots = switch_core_alloc(rtp_session->pool, inbox->size * sizeof(rtp_inbox_slot_t));
+		inbox->reactor = rtp_reactor_globals.next++ % rtp_reactor_globals.threads;
+		switch_mutex_init(&inbox->mutex, SWITCH_MUTEX_DEFAULT, rtp_session->pool);
+		switch_thread_cond_create(&inbox->cond, rtp_session->pool);
+	} else if (inbox->attached) {
+		return;
+	}
+
+	reactor = &rtp_reactor_globals.reactors[inbox->reactor];
+
+	switch_mutex_lock(reactor->mutex);
+
+	if (!reactor->free_count) {
+		uint32_t max = reactor->inbox_max ? reactor->inbox_max * 2 : 256;
+
+		reactor->inboxes = realloc(reactor->inboxes, max * sizeof(*reactor->inboxes));
+		reactor->gens = realloc(reactor->gens, max * sizeof(*reactor->gens));
+		reactor->free_list = realloc(reactor->free_list, max * sizeof(*reactor->free_list));
+		switch_assert(reactor->inboxes && reactor->gens && reactor->free_list);
+
+		for (idx = max; idx > reactor->inbox_max; idx--) {
+			reactor->inboxes[idx - 1] = NULL;
+			reactor->gens[idx - 1] = 0;
+			reactor->free_list[reactor->free_count++] = idx - 1;
+		}
+
+		reactor->inbox_max = max;
+	}
+
+	idx = reactor->free_list[--reactor->free_count];
+
+	ev.events = EPOLLIN;
+	ev.data.u64 = ((uint64_t) reactor->gens[idx] << 32) | idx;
+
+	if (epoll_ctl(reactor->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		reactor->free_list[reactor->free_count++] = idx;
+	} else {
+		inbox->fd = fd;
+		inbox->idx = idx;
+		inbox->attached = 1;
+		reactor->inboxes[idx] = inbox;
+		reactor->members++;
+	}
+
+	switch_mutex_unlock(reactor->mutex);
+
+	/* published last, the read path only looks at a fully built inbox */
+	rtp_session->inbox = inbox;
+}
+
+/* flag_mutex held, before the socket is shut down or closed */
+static void rtp_reactor_detach(switch_rtp_t *rtp_session)
+{
+	rtp_inbox_t *inbox = rtp_session->inbox;
+	rtp_reactor_t *reactor;
+	struct epoll_event ev = { 0 };
+
+	if (!inbox || !inbox->attached) {
+		return;
+	}
+
+	reactor = &rtp_reactor_globals.reactors[inbox->reactor];
+
+	switch_mutex_lock(reactor->mutex);
+	epoll_ctl(reactor->epfd, EPOLL_CTL_DEL, inbox->fd, &ev);
+	reactor->inboxes[inbox->idx] = NULL;
+	reactor->gens[inbox->idx]++;
+	reactor->free_list[reactor->free_count++] = inbox->idx;
+	reactor->members--;
+	inbox->attached = 0;
+	switch_mutex_unlock(reactor->mutex);
+
+	/* nobody is going to fill it any more */
+	switch_mutex_lock(inbox->mutex);
+	switch_thread_cond_broadcast(inbox->cond);
+	switch_mutex_unlock(inbox->mutex);
+}
+
+static switch_status_t rtp_inbox_wait(rtp_inbox_t *inbox, switch_interval_time_t to)
+{
+	if (rtp_inbox_ready(inbox)) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (to <= 0 || !inbox->attached) {
+		return SWITCH_STATUS_TIMEOUT;
+	}
+
+	/* waiting is set and the ring rechecked under the mutex, the reactor signals under it, so no wakeup is lost */
+	switch_mutex_lock(inbox->mutex);
+	__atomic_store_n(&inbox->waiting, 1, __ATOMIC_SEQ_CST);
+	if (!rtp_inbox_ready(inbox) && inbox->attached) {
+		switch_thread_cond_timedwait(inbox->cond, inbox->mutex, to);
+	}
+	__atomic_store_n(&inbox->waiting, 0, __ATOMIC_SEQ_CST);
+	switch_mutex_unlock(inbox->mutex);
+
+	return rtp_inbox_ready(inbox) ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_TIMEOUT;
+}
+
+static switch_status_t rtp_inbox_pop(rtp_inbox_t *inbox, switch_sockaddr_t *from, void *buf, switch_size_t *bytes)
+{
+	uint32_t tail = inbox->tail, head = __atomic_load_n(&inbox->head, __ATOMIC_ACQUIRE);
+	switch_status_t status = SWITCH_STATUS_BREAK;
+	switch_size_t len = 0;
+
+	while (tail != head) {
+		rtp_inbox_slot_t *slot = &inbox->slots[tail++ & (inbox->size - 1)];
+
+		if (!slot->len || slot->len > *bytes) {
+			continue;
+		}
+
+		memcpy(buf, slot->data, slot->len);
+		len = slot->len;
+		switch_sockaddr_set_native(from, &slot->from, slot->fromlen);
+		status = SWITCH_STATUS_SUCCESS;
+		break;
+	}
+
+	__atomic_store_n(&inbox->tail, tail, __ATOMIC_RELEASE);
+	*bytes = len;
+
+	return status;
+}
+#endif
+
+SWITCH_DECLARE(uint32_t) switch_rtp_set_reactor_threads(uint32_t threads)
+{
+#ifdef ENABLE_RTP_REACTOR
+	if (!global_init) {
+		rtp_reactor_globals.threads = threads > RTP_REACTOR_MAX ? RTP_REACTOR_MAX : threads;
+	}
+
+	return rtp_reactor_globals.threads;
+#else
+	return 0;
+#endif
+}
+
+SWITCH_DECLARE(void) switch_rtp_get_reactor_stats(switch_rtp_reactor_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+#ifdef ENABLE_RTP_REACTOR
+	if (rtp_reactor_globals.running) {
+		uint32_t i;
+
+		stats->threads = rtp_reactor_globals.threads;
+
+		for (i = 0; i < rtp_reactor_globals.threads; i++) {
+			rtp_reactor_t *reactor = &rtp_reactor_globals.reactors[i];
+
+			stats->sockets += reactor->members;
+			stats->packets += reactor->packets;
+			stats->batches += reactor->batches;
+			stats->wakeups += reactor->wakeups;
+			stats->signals += reactor->signals;
+			stats->dropped += reactor->dropped;
+		}
+	}
+#endif
+}
+
+/* the session's own poll, or a look at its inbox when the reactor owns the socket */
+static switch_status_t rtp_read_poll(switch_rtp_t *rtp_session, int32_t *fdr, switch_interval_time_t to)
+{
+#ifdef ENABLE_RTP_REACTOR
+	if (rtp_session->inbox && rtp_session->inbox->attached) {
+		return rtp_inbox_wait(rtp_session->inbox, to);
+	}
+#endif
+
+	return switch_poll(rtp_session->read_pollfd, 1, fdr, to);
+}
+
+static switch_status_t rtp_read_recvfrom(switch_rtp_t *rtp_session, switch_size_t *bytes)
+{
+#ifdef ENABLE_RTP_REACTOR
+	if (rtp_session->inbox && (rtp_session->inbox->attached || rtp_inbox_ready(rtp_session->inbox))) {
+		return rtp_inbox_pop(rtp_session->inbox, rtp_session->from_addr, (void *) &rtp_session->recv_msg, bytes);
+	}
+#endif
+
+	return switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, bytes);
+}
+
+#ifdef ENABLE_RTP_TX_BATCH
+/*
+ * Batched transmit: the packets of one video frame go out in a single sendmmsg, or as one gso
+ * datagram when they are all the same size.  They are queued already encrypted and flushed on
+ * the frame's marker bit, when the batch fills, or at the latest on the session's next read tick.
+ */
+#define RTP_TX_BATCH_MAX 64
+#define RTP_TX_SLOT_LEN 2048
+#define RTP_TX_GSO_MAX 65000
+
+struct rtp_tx_batch_s {
+	uint32_t count;
+	uint32_t size;
+	switch_time_t first;
+	uint32_t lens[RTP_TX_BATCH_MAX];
+	uint8_t *data;
+};
+
+static struct {
+	uint32_t size;
+	int gso;
+} rtp_tx_globals = { 0, 1 };
+
+#ifdef UDP_SEGMENT
+static int rtp_tx_gso_ok(rtp_tx_batch_t *txq)
+{
+	uint32_t i, total = 0;
+
+	/* every segment but the last has to be exactly the segment size */
+	for (i = 0; i < txq->count; i++) {
+		if ((i < txq->count - 1 && txq->lens[i] != txq->lens[0]) || txq->lens[i] > txq->lens[0]) {
+			return 0;
+		}
+		total += txq->lens[i];
+	}
+
+	return total <= RTP_TX_GSO_MAX;
+}
+
+static uint32_t rtp_tx_send_gso(rtp_tx_batch_t *txq, int fd, struct sockaddr_storage *to, socklen_t tolen, struct iovec *iov)
+{
+	char control[CMSG_SPACE(sizeof(uint16_t))] = { 0 };
+	struct msghdr msg = { 0 };
+	struct cmsghdr *cm;
+
+	msg.msg_name = to;
+	msg.msg_namelen = tolen;
+	msg.msg_iov = iov;
+	msg.msg_iovlen = txq->count;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	cm = CMSG_FIRSTHDR(&msg);
+	cm->cmsg_level = IPPROTO_UDP;
+	cm->cmsg_type = UDP_SEGMENT;
+	cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+	*((uint16_t *) CMSG_DATA(cm)) = (uint16_t) txq->lens[0];
+
+	if (sendmsg(fd, &msg, 0) >= 0) {
+		return txq->count;
+	}
+
+	if (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP) {
+		/* no gso here (old kernel, or a nic that can't checksum it), don't ask again */
+		rtp_tx_globals.gso = 0;
+	}
+
+	return 0;
+}
+#endif
+
+/* write_mutex held, SWITCH_STATUS_FALSE when the kernel didn't take all of it */
+static switch_status_t rtp_tx_flush(switch_rtp_t *rtp_session)
+{
+	rtp_tx_batch_t *txq = rtp_session->txq;
+	switch_rtp_tx_batch_numbers_t *stats = &rtp_session->stats.tx_batch;
+	struct mmsghdr msgs[RTP_TX_BATCH_MAX];
+	struct iovec iov[RTP_TX_BATCH_MAX];
+	struct sockaddr_storage to;
+	socklen_t tolen = 0;
+	switch_time_t latency;
+	uint32_t i, sent = 0;
+	int fd = -1, r;
+
+	if (!txq || !txq->count) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (rtp_session->sock_output && rtp_session->remote_addr) {
+		fd = switch_socket_fd_get(rtp_session->sock_output);
+		tolen = switch_sockaddr_get_native(rtp_session->remote_addr, &to, sizeof(to));
+	}
+
+	if (fd >= 0 && tolen) {
+		for (i = 0; i < txq->count; i++) {
+			iov[i].iov_base = txq->data + i * RTP_TX_SLOT_LEN;
+			iov[i].iov_len = txq->lens[i];
+		}
+
+#ifdef UDP_SEGMENT
+		if (txq->count > 1 && rtp_tx_globals.gso && rtp_tx_gso_ok(txq) && (sent = rtp_tx_send_gso(txq, fd, &to, tolen, iov))) {
+			stats->gso_flushes++;
+		}
+#endif
+
+		if (!sent) {
+			memset(msgs, 0, txq->count * sizeof(msgs[0]));
+
+			for (i = 0; i < txq->count; i++) {
+				msgs[i].msg_hdr.msg_name = &to;
+				msgs[i].msg_hdr.msg_namelen = tolen;
+				msgs[i].msg_hdr.msg_iov = &iov[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+		}
+
+		while (sent < txq->count) {
+			if ((r = sendmmsg(fd, msgs + sent, txq->count - sent, 0)) <= 0) {
+				if (r < 0 && errno == EINTR) {
+					continue;
+				}
+				break;
+			}
+			sent += r;
+		}
+	}
+
+	latency = switch_micro_time_now() - txq->first;
+
+	stats->flushes++;
+	stats->packets += sent;
+	stats->errors += txq->count - sent;
+	stats->latency += latency;
+
+	if (txq->count > stats->max_batch) {
+		stats->max_batch = txq->count;
+	}
+
+	if (latency > stats->max_latency) {
+		stats->max_latency = latency;
+	}
+
+	i = txq->count;
+	txq->count = 0;
+
+	return sent == i ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+}
+
+/* write_mutex held; more says the caller has further packets for this tick (a video frame without its marker yet) */
+static switch_status_t rtp_tx_send(switch_rtp_t *rtp_session, void *data, switch_size_t *bytes, int more)
+{
+	rtp_tx_batch_t *txq = rtp_session->txq;
+
+	if (!txq && more && rtp_tx_globals.size > 1) {
+		txq = switch_core_alloc(rtp_session->pool, sizeof(*txq));
+		txq->size = rtp_tx_globals.size;
+		txq->data = switch_core_alloc(rtp_session->pool, txq->size * RTP_TX_SLOT_LEN);
+		rtp_session->txq = txq;
+	}
+
+	if (!txq || *bytes > RTP_TX_SLOT_LEN || (!more && !txq->count)) {
+		rtp_tx_flush(rtp_session);
+		return switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, data, bytes);
+	}
+
+	if (!txq->count) {
+		txq->first = switch_micro_time_now();
+	}
+
+	memcpy(txq->data + txq->count * RTP_TX_SLOT_LEN, data, *bytes);
+	txq->lens[txq->count++] = (uint32_t) *bytes;
+
+	if (more && txq->count < txq->size) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	return rtp_tx_flush(rtp_session);
+}
+#endif
+
+SWITCH_DECLARE(uint32_t) switch_rtp_set_tx_batch(uint32_t packets)
+{
+#ifdef ENABLE_RTP_TX_BATCH
+	rtp_tx_globals.size = packets > RTP_TX_BATCH_MAX ? RTP_TX_BATCH_MAX : packets;
+
+	return rtp_tx_globals.size;
+#else
+	return 0;
+#endif
+}
+
+/* the one place an rtp packet goes to the kernel */
+static switch_status_t rtp_write_sendto(switch_rtp_t *rtp_session, void *data, switch_size_t *bytes, int more)
+{
+#ifdef ENABLE_RTP_TX_BATCH
+	return rtp_tx_send(rtp_session, data, bytes, more);
+#else
+	return switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, data, bytes);
+#endif
+}
+
 SWITCH_DECLARE(void) switch_rtp_init(switch_memory_pool_t *pool)
 {
 #ifdef ENABLE_ZRTP
@@ -1504,6 +2160,9 @@ SWITCH_DECLARE(void) switch_rtp_init(switch_memory_pool_t *pool)
 	srtp_init();
 #endif
 	switch_mutex_init(&port_lock, SWITCH_MUTEX_NESTED, pool);
+#ifdef ENABLE_RTP_REACTOR
+	rtp_reactor_start(pool);
+#endif
 	global_init = 1;
 }
 
@@ -2458,6 +3117,10 @@ SWITCH_DECLARE(void) switch_rtp_shutdown(void)
 	switch_core_hash_destroy(&alloc_hash);
 	switch_mutex_unlock(port_lock);
 
+#ifdef ENABLE_RTP_REACTOR
+	rtp_reactor_stop();
+#endif
+
 #ifdef ENABLE_ZRTP
 	if (zrtp_on) {
 		zrtp_status_t status = zrtp_status_ok;
@@ -2510,10 +3173,13 @@ SWITCH_DECLARE(void) switch_rtp_release_port(const char *ip, switch_port_t port)
 	}
 
 	switch_mutex_lock(port_lock);
-	if ((alloc = switch_core_hash_find(alloc_hash, ip))) {
+	alloc = switch_core_hash_find(alloc_hash, ip);
+	switch_mutex_unlock(port_lock);
+
+	/* allocators live until shutdown and lock per shard, the hash is all port_lock guards */
+	if (alloc) {
 		switch_core_port_allocator_free_port(alloc, port);
 	}
-	switch_mutex_unlock(port_lock);
 
 }
 
@@ -2531,12 +3197,12 @@ SWITCH_DECLARE(switch_port_t) switch_rtp_request_port(const char *ip)
 
 		switch_core_hash_insert(alloc_hash, ip, alloc);
 	}
+	switch_mutex_unlock(port_lock);
 
 	if (switch_core_port_allocator_request_port(alloc, &port) != SWITCH_STATUS_SUCCESS) {
 		port = 0;
 	}
 
-	switch_mutex_unlock(port_lock);
 	return port;
 }
 
@@ -2810,6 +3476,12 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_set_local_address(switch_rtp_t *rtp_s
 
 	switch_socket_create_pollset(&rtp_session->read_pollfd, rtp_session->sock_input, SWITCH_POLLIN | SWITCH_POLLERR, rtp_session->pool);
 
+#ifdef ENABLE_RTP_REACTOR
+	switch_mutex_lock(rtp_session->flag_mutex);
+	rtp_reactor_attach(rtp_session);
+	switch_mutex_unlock(rtp_session->flag_mutex);
+#endif
+
 	if (rtp_session->flags[SWITCH_RTP_FLAG_ENABLE_RTCP]) {
 		if ((status = enable_local_rtcp_socket(rtp_session, err)) == SWITCH_STATUS_SUCCESS) {
 			*err = "Success";
@@ -3016,6 +3688,11 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_set_remote_address(switch_rtp_t *rtp_
 
 	switch_mutex_lock(rtp_session->write_mutex);
 
+#ifdef ENABLE_RTP_TX_BATCH
+	/* whatever is queued was meant for the old address */
+	rtp_tx_flush(rtp_session);
+#endif
+
 	rtp_session->remote_addr = remote_addr;
 
 	if (change_adv_addr) {
@@ -3090,7 +3767,8 @@ static const char *dtls_state_names(dtls_state_t s)
 
 #define cr_keylen 16
 #define cr_saltlen 14
-#define cr_kslen 30
+#define cr_gcm_saltlen 12
+#define cr_kslen_max 46
 
 static int dtls_state_setup(switch_rtp_t *rtp_session, switch_dtls_t *dtls)
 {
@@ -3110,14 +3788,30 @@ static int dtls_state_setup(switch_rtp_t *rtp_session, switch_dtls_t *dtls)
 		dtls_set_state(dtls, DS_FAIL);
 		return -1;
 	} else {
-		uint8_t raw_key_data[cr_kslen*2] = { 0 };
+		uint8_t raw_key_data[cr_kslen_max*2] = { 0 };
 		unsigned char *local_key, *remote_key, *local_salt, *remote_salt;
-		unsigned char local_key_buf[cr_kslen] = {0}, remote_key_buf[cr_kslen] = {0};
+		unsigned char local_key_buf[cr_kslen_max] = {0}, remote_key_buf[cr_kslen_max] = {0};
+		switch_rtp_crypto_key_type_t ctype = AES_CM_128_HMAC_SHA1_80;
+		int keylen = cr_keylen, saltlen = cr_saltlen;
+#ifdef SRTP_AEAD_AES_128_GCM
+		SRTP_PROTECTION_PROFILE *profile = SSL_get_selected_srtp_profile(dtls->ssl);
+
+		/* RFC 7714 section 12, the GCM profiles use a 96 bit salt */
+		if (profile && profile->id == SRTP_AEAD_AES_256_GCM) {
+			ctype = AEAD_AES_256_GCM;
+			keylen = 32;
+			saltlen = cr_gcm_saltlen;
+		} else if (profile && profile->id == SRTP_AEAD_AES_128_GCM) {
+			ctype = AEAD_AES_128_GCM;
+			saltlen = cr_gcm_saltlen;
+		}
+#endif
 		
-		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_INFO, "%s Fingerprint Verified.\n", rtp_type(rtp_session));
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_INFO, "%s Fingerprint Verified, using %s.\n",
+						  rtp_type(rtp_session), switch_core_media_crypto_type2str(ctype));
 
 #ifdef HAVE_OPENSSL_DTLS_SRTP
-		if (!SSL_export_keying_material(dtls->ssl, raw_key_data, sizeof(raw_key_data), "EXTRACTOR-dtls_srtp", 19, NULL, 0, 0)) {
+		if (!SSL_export_keying_material(dtls->ssl, raw_key_data, (keylen + saltlen) * 2, "EXTRACTOR-dtls_srtp", 19, NULL, 0, 0)) {
 			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ERROR, "%s Key material export failure\n", rtp_type(rtp_session));
 			dtls_set_state(dtls, DS_FAIL);
 			return -1;
@@ -3128,29 +3822,29 @@ static int dtls_state_setup(switch_rtp_t *rtp_session, switch_dtls_t *dtls)
 		
 		if ((dtls->type & DTLS_TYPE_CLIENT)) {
 			local_key = raw_key_data;
-			remote_key = local_key + cr_keylen;
-			local_salt = remote_key + cr_keylen;
-			remote_salt = local_salt + cr_saltlen;
+			remote_key = local_key + keylen;
+			local_salt = remote_key + keylen;
+			remote_salt = local_salt + saltlen;
 			
 		} else {
 			remote_key = raw_key_data;
-			local_key = remote_key + cr_keylen;
-			remote_salt = local_key + cr_keylen;
-			local_salt = remote_salt + cr_saltlen;
+			local_key = remote_key + keylen;
+			remote_salt = local_key + keylen;
+			local_salt = remote_salt + saltlen;
 		}
 
-		memcpy(local_key_buf, local_key, cr_keylen);
-		memcpy(local_key_buf + cr_keylen, local_salt, cr_saltlen);
+		memcpy(local_key_buf, local_key, keylen);
+		memcpy(local_key_buf + keylen, local_salt, saltlen);
 
-		memcpy(remote_key_buf, remote_key, cr_keylen);
-		memcpy(remote_key_buf + cr_keylen, remote_salt, cr_saltlen);
+		memcpy(remote_key_buf, remote_key, keylen);
+		memcpy(remote_key_buf + keylen, remote_salt, saltlen);
 		
 		if (dtls == rtp_session->rtcp_dtls && rtp_session->rtcp_dtls != rtp_session->dtls) {
-			switch_rtp_add_crypto_key(rtp_session, SWITCH_RTP_CRYPTO_SEND_RTCP, 0, AES_CM_128_HMAC_SHA1_80, local_key_buf, cr_kslen);
-			switch_rtp_add_crypto_key(rtp_session, SWITCH_RTP_CRYPTO_RECV_RTCP, 0, AES_CM_128_HMAC_SHA1_80, remote_key_buf, cr_kslen);
+			switch_rtp_add_crypto_key(rtp_session, SWITCH_RTP_CRYPTO_SEND_RTCP, 0, ctype, local_key_buf, keylen + saltlen);
+			switch_rtp_add_crypto_key(rtp_session, SWITCH_RTP_CRYPTO_RECV_RTCP, 0, ctype, remote_key_buf, keylen + saltlen);
 		} else {
-			switch_rtp_add_crypto_key(rtp_session, SWITCH_RTP_CRYPTO_SEND, 0, AES_CM_128_HMAC_SHA1_80, local_key_buf, cr_kslen);
-			switch_rtp_add_crypto_key(rtp_session, SWITCH_RTP_CRYPTO_RECV, 0, AES_CM_128_HMAC_SHA1_80, remote_key_buf, cr_kslen);
+			switch_rtp_add_crypto_key(rtp_session, SWITCH_RTP_CRYPTO_SEND, 0, ctype, local_key_buf, keylen + saltlen);
+			switch_rtp_add_crypto_key(rtp_session, SWITCH_RTP_CRYPTO_RECV, 0, ctype, remote_key_buf, keylen + saltlen);
 		}
 	}
 
@@ -3459,7 +4153,11 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_add_dtls(switch_rtp_t *rtp_session, d
 	SSL_CTX_set_read_ahead(dtls->ssl_ctx, 1);
 #ifdef HAVE_OPENSSL_DTLS_SRTP
 	//SSL_CTX_set_tlsext_use_srtp(dtls->ssl_ctx, "SRTP_AES128_CM_SHA1_80:SRTP_AES128_CM_SHA1_32");
+#ifdef SRTP_AEAD_AES_128_GCM
+	SSL_CTX_set_tlsext_use_srtp(dtls->ssl_ctx, "SRTP_AEAD_AES_256_GCM:SRTP_AEAD_AES_128_GCM:SRTP_AES128_CM_SHA1_80");
+#else
 	SSL_CTX_set_tlsext_use_srtp(dtls->ssl_ctx, "SRTP_AES128_CM_SHA1_80");
+#endif
 #endif
 	
 	dtls->type = type;
@@ -3572,19 +4270,20 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_add_crypto_key(switch_rtp_t *rtp_sess
 	err_status_t stat;
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
 	
-	switch_channel_t *channel = switch_core_session_get_channel(rtp_session->session);
+	/* sessionless rtp (tests, standalone endpoints) can be secured too, it just has no channel to report to */
+	switch_channel_t *channel = rtp_session->session ? switch_core_session_get_channel(rtp_session->session) : NULL;
 	switch_event_t *fsevent = NULL;
 	int idx = 0;
 	const char *var;
 	unsigned char b64_key[512] = "";
 
-	if (direction >= SWITCH_RTP_CRYPTO_MAX || keylen > SWITCH_RTP_MAX_CRYPTO_LEN) {
+	if (direction >= SWITCH_RTP_CRYPTO_MAX || keylen > SWITCH_RTP_MAX_CRYPTO_LEN || type >= CRYPTO_INVALID) {
 		return SWITCH_STATUS_FALSE;
 	}
 
 	switch_b64_encode(key, keylen, b64_key, sizeof(b64_key));
 
-	if (switch_true(switch_core_get_variable("rtp_retain_crypto_keys"))) {
+	if (channel && switch_true(switch_core_get_variable("rtp_retain_crypto_keys"))) {
 		switch(direction) {
 			case SWITCH_RTP_CRYPTO_SEND:
 				switch_channel_set_variable(channel, "srtp_local_crypto_key", (const char *)b64_key);
@@ -3628,7 +4327,7 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_add_crypto_key(switch_rtp_t *rtp_sess
 	memset(policy, 0, sizeof(*policy));
 
 	/* many devices can't handle gaps in SRTP streams */
-	if (!((var = switch_channel_get_variable(channel, "srtp_allow_idle_gaps"))
+	if (channel && !((var = switch_channel_get_variable(channel, "srtp_allow_idle_gaps"))
 		  && switch_true(var))
 		&& (!(var = switch_channel_get_variable(channel, "send_silence_when_idle"))
 			|| !(atoi(var)))) {
@@ -3639,58 +4338,43 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_add_crypto_key(switch_rtp_t *rtp_sess
 	case AES_CM_128_HMAC_SHA1_80:
 		crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy->rtp);
 		crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy->rtcp);
-
-		if (switch_channel_direction(channel) == SWITCH_CALL_DIRECTION_OUTBOUND) {
-			switch_channel_set_variable(channel, "rtp_has_crypto", "AES_CM_128_HMAC_SHA1_80");
-		}
 		break;
 	case AES_CM_128_HMAC_SHA1_32:
 		crypto_policy_set_aes_cm_128_hmac_sha1_32(&policy->rtp);
 		crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy->rtcp);
-
-
-		if (switch_channel_direction(channel) == SWITCH_CALL_DIRECTION_OUTBOUND) {
-			switch_channel_set_variable(channel, "rtp_has_crypto", "AES_CM_128_HMAC_SHA1_32");
-		}
 		break;
-
 	case AEAD_AES_256_GCM_8:
 		crypto_policy_set_aes_gcm_256_8_auth(&policy->rtp);
 		crypto_policy_set_aes_gcm_256_8_auth(&policy->rtcp);
-
-		if (switch_channel_direction(channel) == SWITCH_CALL_DIRECTION_OUTBOUND) {
-			switch_channel_set_variable(channel, "rtp_has_crypto", "AEAD_AES_256_GCM_8");
-		}
 		break;
-
 	case AEAD_AES_128_GCM_8:
 		crypto_policy_set_aes_gcm_128_8_auth(&policy->rtp);
 		crypto_policy_set_aes_gcm_128_8_auth(&policy->rtcp);
-
-		if (switch_channel_direction(channel) == SWITCH_CALL_DIRECTION_OUTBOUND) {
-			switch_channel_set_variable(channel, "rtp_has_crypto", "AEAD_AES_128_GCM_8");
-		}
 		break;
-
+	case AEAD_AES_256_GCM:
+		crypto_policy_set_aes_gcm_256_16_auth(&policy->rtp);
+		crypto_policy_set_aes_gcm_256_16_auth(&policy->rtcp);
+		break;
+	case AEAD_AES_128_GCM:
+		crypto_policy_set_aes_gcm_128_16_auth(&policy->rtp);
+		crypto_policy_set_aes_gcm_128_16_auth(&policy->rtcp);
+		break;
 	case AES_CM_256_HMAC_SHA1_80:
 		crypto_policy_set_aes_cm_256_hmac_sha1_80(&policy->rtp);
 		crypto_policy_set_aes_cm_256_hmac_sha1_80(&policy->rtcp);
-		if (switch_channel_direction(channel) == SWITCH_CALL_DIRECTION_OUTBOUND) {
-			switch_channel_set_variable(channel, "rtp_has_crypto", "AES_CM_256_HMAC_SHA1_80");
-		}
 		break;
 	case AES_CM_128_NULL_AUTH:
 		crypto_policy_set_aes_cm_128_null_auth(&policy->rtp);
 		crypto_policy_set_aes_cm_128_null_auth(&policy->rtcp);
-		
-		if (switch_channel_direction(channel) == SWITCH_CALL_DIRECTION_OUTBOUND) {
-			switch_channel_set_variable(channel, "rtp_has_crypto", "AES_CM_128_NULL_AUTH");
-		}
 		break;
 	default:
 		break;
 	}
 
+	if (channel && switch_channel_direction(channel) == SWITCH_CALL_DIRECTION_OUTBOUND) {
+		switch_channel_set_variable(channel, "rtp_has_crypto", switch_core_media_crypto_type2str(crypto_key->type));
+	}
+
 	policy->key = (uint8_t *) crypto_key->key;
 	policy->next = NULL;
 	
@@ -3749,10 +4433,10 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_add_crypto_key(switch_rtp_t *rtp_sess
 		break;
 	}
 
-	if (switch_event_create(&fsevent, SWITCH_EVENT_CALL_SECURE) == SWITCH_STATUS_SUCCESS) {
+	if (channel && switch_event_create(&fsevent, SWITCH_EVENT_CALL_SECURE) == SWITCH_STATUS_SUCCESS) {
 		if (rtp_session->dtls) {
-			switch_event_add_header(fsevent, SWITCH_STACK_BOTTOM, "secure_type", "srtp:dtls:AES_CM_128_HMAC_SHA1_80");
-			switch_channel_set_variable(channel, "rtp_has_crypto", "srtp:dtls:AES_CM_128_HMAC_SHA1_80");
+			switch_event_add_header(fsevent, SWITCH_STACK_BOTTOM, "secure_type", "srtp:dtls:%s", switch_core_media_crypto_type2str(type));
+			switch_channel_set_variable_printf(channel, "rtp_has_crypto", "srtp:dtls:%s", switch_core_media_crypto_type2str(type));
 		} else {
 			switch_event_add_header(fsevent, SWITCH_STACK_BOTTOM, "secure_type", "srtp:sdes:%s", switch_channel_get_variable(channel, "rtp_has_crypto"));
 		}
@@ -4151,6 +4835,17 @@ SWITCH_DECLARE(switch_jb_t *) switch_rtp_get_jitter_buffer(switch_rtp_t *rtp_ses
 	return rtp_session->jb;
 }
 
+SWITCH_DECLARE(uint64_t) switch_rtp_get_recv_tick(switch_rtp_t *rtp_session, uint64_t *jb_tick)
+{
+	if (!rtp_session->flags[SWITCH_RTP_FLAG_MEDIA_TRACE]) {
+		*jb_tick = 0;
+		return 0;
+	}
+
+	*jb_tick = rtp_session->jb_tick;
+	return rtp_session->recv_tick;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_rtp_pause_jitter_buffer(switch_rtp_t *rtp_session, switch_bool_t pause)
 {
 	
@@ -4162,7 +4857,8 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_pause_jitter_buffer(switch_rtp_t *rtp
 		return SWITCH_STATUS_FALSE;
 	}
 
-	if (rtp_session->pause_jb && !pause) {
+	/* nothing is put while paused, so a time stretch reader would pull stale audio until it is dropped */
+	if ((rtp_session->pause_jb && !pause) || switch_jb_test_flag(rtp_session->jb, SJB_TIME_STRETCH)) {
 		switch_jb_reset(rtp_session->jb);
 	}
 
@@ -4272,6 +4968,9 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_activate_jitter_buffer(switch_rtp_t *
 		READ_INC(rtp_session);
 		status = switch_jb_create(&rtp_session->jb, SJB_AUDIO, queue_frames, max_queue_frames, rtp_session->pool);
 		switch_jb_set_session(rtp_session->jb, rtp_session->session);
+		if (rtp_session->flags[SWITCH_RTP_FLAG_MEDIA_TRACE]) {
+			switch_jb_set_flag(rtp_session->jb, SJB_MEDIA_TRACE);
+		}
 		if (switch_true(switch_channel_get_variable_dup(switch_core_session_get_channel(rtp_session->session), "jb_use_timestamps", SWITCH_FALSE, -1))) {
 			switch_jb_ts_mode(rtp_session->jb, samples_per_packet, samples_per_second);
 		}
@@ -4530,6 +5229,9 @@ SWITCH_DECLARE(void) switch_rtp_kill_socket(switch_rtp_t *rtp_session)
 	if (rtp_session->flags[SWITCH_RTP_FLAG_IO]) {
 		rtp_session->flags[SWITCH_RTP_FLAG_IO] = 0;
 		if (rtp_session->sock_input) {
+#ifdef ENABLE_RTP_REACTOR
+			rtp_reactor_detach(rtp_session);
+#endif
 			ping_socket(rtp_session);
 			switch_socket_shutdown(rtp_session->sock_input, SWITCH_SHUTDOWN_READWRITE);
 		}
@@ -4606,6 +5308,10 @@ SWITCH_DECLARE(void) switch_rtp_destroy(switch_rtp_t **rtp_session)
 	READ_INC((*rtp_session));
 	WRITE_INC((*rtp_session));
 
+#ifdef ENABLE_RTP_TX_BATCH
+	rtp_tx_flush(*rtp_session);
+#endif
+
 	(*rtp_session)->ready = 0;
 
 	READ_DEC((*rtp_session));
@@ -4652,6 +5358,10 @@ SWITCH_DECLARE(void) switch_rtp_destroy(switch_rtp_t **rtp_session)
 	}
 
 
+#ifdef ENABLE_RTP_REACTOR
+	rtp_reactor_detach(*rtp_session);
+#endif
+
 	sock = (*rtp_session)->sock_input;
 	(*rtp_session)->sock_input = NULL;
 	switch_socket_close(sock);
@@ -4855,6 +5565,8 @@ SWITCH_DECLARE(void) switch_rtp_set_flag(switch_rtp_t *rtp_session, switch_rtp_f
 		}
 	} else if (flag == SWITCH_RTP_FLAG_NOBLOCK && rtp_session->sock_input) {
 		switch_socket_opt_set(rtp_session->sock_input, SWITCH_SO_NONBLOCK, TRUE);
+	} else if (flag == SWITCH_RTP_FLAG_MEDIA_TRACE && rtp_session->jb) {
+		switch_jb_set_flag(rtp_session->jb, SJB_MEDIA_TRACE);
 	}
 
 }
@@ -4877,6 +5589,8 @@ SWITCH_DECLARE(void) switch_rtp_clear_flag(switch_rtp_t *rtp_session, switch_rtp
 		reset_jitter_seq(rtp_session);
 	} else if (flag == SWITCH_RTP_FLAG_NOBLOCK && rtp_session->sock_input) {
 		switch_socket_opt_set(rtp_session->sock_input, SWITCH_SO_NONBLOCK, FALSE);
+	} else if (flag == SWITCH_RTP_FLAG_MEDIA_TRACE && rtp_session->jb) {
+		switch_jb_clear_flag(rtp_session->jb, SJB_MEDIA_TRACE);
 	}
 }
 
@@ -5158,7 +5872,7 @@ static switch_size_t do_flush(switch_rtp_t *rtp_session, int force, switch_size_
 		do {
 			if (switch_rtp_ready(rtp_session)) {
 				bytes = sizeof(rtp_msg_t);
-				switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, &bytes);
+				rtp_read_recvfrom(rtp_session, &bytes);
 				
 				if (bytes) {
 					int do_cng = 0;
@@ -5312,7 +6026,7 @@ static switch_status_t read_rtp_packet(switch_rtp_t *rtp_session, switch_size_t
 		}
 
         /* жfdǷɶ */
-		poll_status = switch_poll(rtp_session->read_pollfd, 1, &fdr, to);
+		poll_status = rtp_read_poll(rtp_session, &fdr, to);
 		
 		if (rtp_session->flags[SWITCH_RTP_FLAG_USE_TIMER] && rtp_session->timer.interval) {
 			switch_core_timer_sync(&rtp_session->timer);
@@ -5339,7 +6053,13 @@ static switch_status_t read_rtp_packet(switch_rtp_t *rtp_session, switch_size_t
 
 	if (poll_status == SWITCH_STATUS_SUCCESS) {
         /* հ */
-		status = switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, bytes);
+		status = rtp_read_recvfrom(rtp_session, bytes);
+
+		/* a packet headed for the jitter buffer is stamped there and timed from its put when it comes out */
+		if (*bytes && rtp_session->flags[SWITCH_RTP_FLAG_MEDIA_TRACE] && !(rtp_session->jb && !rtp_session->pause_jb && jb_valid(rtp_session))) {
+			rtp_session->recv_tick = switch_core_media_trace_tick();
+			rtp_session->jb_tick = 0;
+		}
 	} else {
 		*bytes = 0;
 	}
@@ -5687,13 +6407,15 @@ static switch_status_t read_rtp_packet(switch_rtp_t *rtp_session, switch_size_t
 						else if (stat == err_status_auth_fail) msg="auth check failed";
 						else msg="";
 						if (errs >= MAX_SRTP_ERRS) {
-							switch_channel_t *channel = switch_core_session_get_channel(rtp_session->session);
+							switch_channel_t *channel = rtp_session->session ? switch_core_session_get_channel(rtp_session->session) : NULL;
 							switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ERROR,
 											  "SRTP %s unprotect failed with code %d (%s) %ld bytes %d errors\n",
 											  rtp_type(rtp_session), stat, msg, (long)*bytes, errs);
-							switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ERROR,
-											  "Ending call due to SRTP error\n");
-							switch_channel_hangup(channel, SWITCH_CAUSE_SRTP_READ_ERROR);
+							if (channel) {
+								switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ERROR,
+												  "Ending call due to SRTP error\n");
+								switch_channel_hangup(channel, SWITCH_CAUSE_SRTP_READ_ERROR);
+							}
 						} else if (errs >= WARN_SRTP_ERRS && !(errs % WARN_SRTP_ERRS)) {
 							switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_WARNING,
 											  "SRTP %s unprotect failed with code %d (%s) %ld bytes %d errors\n",
@@ -5785,7 +6507,7 @@ static switch_status_t read_rtp_packet(switch_rtp_t *rtp_session, switch_size_t
 	}
 	
 	if (rtp_session->flags[SWITCH_RTP_FLAG_BYTESWAP] && check_recv_payload(rtp_session)) {
-		switch_swap_linear((int16_t *)RTP_BODY(rtp_session), (int) *bytes - rtp_header_len);
+		switch_swap_linear((int16_t *)RTP_BODY(rtp_session), (int) (*bytes - rtp_header_len) / 2);
 	}
 
 	if (rtp_session->flags[SWITCH_RTP_FLAG_KILL_JB]) {
@@ -5892,6 +6614,13 @@ static switch_status_t read_rtp_packet(switch_rtp_t *rtp_session, switch_size_t
 			case SWITCH_STATUS_SUCCESS:
 			default:
 				{
+					if (jstatus == SWITCH_STATUS_SUCCESS && rtp_session->flags[SWITCH_RTP_FLAG_MEDIA_TRACE]) {
+						rtp_session->jb_tick = switch_core_media_trace_tick();
+						/* put before the trace was on, time it from here */
+						if (!(rtp_session->recv_tick = switch_jb_get_last_read_tick(rtp_session->jb))) {
+							rtp_session->recv_tick = rtp_session->jb_tick;
+						}
+					}
 					rtp_session->stats.inbound.jb_packet_count++;
 					status = SWITCH_STATUS_SUCCESS;
 					rtp_session->last_rtp_hdr = rtp_session->recv_msg.header;
@@ -6521,6 +7250,15 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 		sleep_mss = rtp_session->timer.interval * 1000;
 	}
 
+#ifdef ENABLE_RTP_TX_BATCH
+	/* the read tick is the longest a half written frame waits */
+	if (rtp_session->txq && rtp_session->txq->count) {
+		switch_mutex_lock(rtp_session->write_mutex);
+		rtp_tx_flush(rtp_session);
+		switch_mutex_unlock(rtp_session->write_mutex);
+	}
+#endif
+
 	READ_INC(rtp_session);
 
 
@@ -6542,7 +7280,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 
             /* Ƶrtp */
 			if (rtp_session->jb && !rtp_session->pause_jb && jb_valid(rtp_session)) {
-				while (switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
+				while (rtp_read_poll(rtp_session, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
                     /* һrtp */
 					status = read_rtp_packet(rtp_session, &bytes, flags, SWITCH_STATUS_SUCCESS, SWITCH_FALSE);
 
@@ -6566,7 +7304,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 				
 			} else if ((rtp_session->flags[SWITCH_RTP_FLAG_AUTOFLUSH] || rtp_session->flags[SWITCH_RTP_FLAG_STICKY_FLUSH])) {
 				
-				if (switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
+				if (rtp_read_poll(rtp_session, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
                     /* һrtp */
 					status = read_rtp_packet(rtp_session, &bytes, flags, SWITCH_STATUS_SUCCESS, SWITCH_FALSE);
 					if (status == SWITCH_STATUS_GENERR) {
@@ -6587,7 +7325,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 					}
 
 					if (bytes) {
-						if (switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
+						if (rtp_read_poll(rtp_session, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
 							rtp_session->hot_hits++;//+= rtp_session->samples_per_interval;
 							
 							switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG10, "%s Hot Hit %d\n", 
@@ -6693,7 +7431,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 			}
 
             /* pt20msܲ */
-            poll_status = switch_poll(rtp_session->read_pollfd, 1, &fdr, pt);
+            poll_status = rtp_read_poll(rtp_session, &fdr, pt);
 
 
 			//if (rtp_session->flags[SWITCH_RTP_FLAG_VIDEO]) {
@@ -7861,7 +8599,7 @@ static int rtp_common_write(switch_rtp_t *rtp_session,
 		send_msg->header.seq = htons(++rtp_session->seq);
 
 		if (rtp_session->flags[SWITCH_RTP_FLAG_BYTESWAP] && send_msg->header.pt == rtp_session->payload) {
-			switch_swap_linear((int16_t *)send_msg->body, (int) datalen);
+			switch_swap_linear((int16_t *)send_msg->body, (int) datalen / 2);
 		}
 
 #ifdef ENABLE_SRTP
@@ -7994,7 +8732,7 @@ static int rtp_common_write(switch_rtp_t *rtp_session,
 		//	//switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "SEND %u\n", ntohs(send_msg->header.seq));
 		//}
 		/* ===========================================ͱ========================================= */
-		if (switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, (void *) send_msg, &bytes) != SWITCH_STATUS_SUCCESS) {
+		if (rtp_write_sendto(rtp_session, (void *) send_msg, &bytes, rtp_session->flags[SWITCH_RTP_FLAG_VIDEO] && !send_msg->header.m) != SWITCH_STATUS_SUCCESS) {
 			rtp_session->seq--;
 			ret = -1;
 			goto end;
@@ -8191,9 +8929,14 @@ SWITCH_DECLARE(int) switch_rtp_write_frame(switch_rtp_t *rtp_session, switch_fra
 
 		}
 
-		if (switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, frame->packet, &bytes) != SWITCH_STATUS_SUCCESS) {
+		/* the tx queue belongs to write_mutex, rtp_common_read flushes it from the read thread */
+		switch_mutex_lock(rtp_session->write_mutex);
+		if (rtp_write_sendto(rtp_session, frame->packet, &bytes, rtp_session->flags[SWITCH_RTP_FLAG_VIDEO] &&
+							 !rtp_session->flags[SWITCH_RTP_FLAG_UDPTL] && !switch_test_flag(frame, SFF_UDPTL_PACKET) && !send_msg->header.m) != SWITCH_STATUS_SUCCESS) {
+			switch_mutex_unlock(rtp_session->write_mutex);
 			return -1;
 		}
+		switch_mutex_unlock(rtp_session->write_mutex);
 
 
 		rtp_session->stats.outbound.raw_bytes += bytes;
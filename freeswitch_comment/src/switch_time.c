@@ -967,6 +967,520 @@ static switch_status_t timer_destroy(switch_timer_t *timer)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+/*
+ * "wheel" timer: every timer registers its own deadline on one of a few hierarchical timer wheels
+ * (one per core) and sleeps on a wait word of its own, the wheel thread wakes exactly the timers that
+ * are due instead of broadcasting a tick to everyone on the interval. A wheel's thread runs at realtime
+ * priority and is only started when the first timer lands on that wheel.
+ */
+
+#define WHEEL_MAX 16
+#define WHEEL_RES 1000	/* usec per level 0 slot */
+#define WHEEL_L0_BITS 8
+#define WHEEL_LN_BITS 6
+#define WHEEL_L0_SLOTS (1 << WHEEL_L0_BITS)
+#define WHEEL_LN_SLOTS (1 << WHEEL_LN_BITS)
+#define WHEEL_L1_SPAN ((uint64_t) WHEEL_L0_SLOTS * WHEEL_LN_SLOTS)
+#define WHEEL_L2_SPAN (WHEEL_L1_SPAN * WHEEL_LN_SLOTS)
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sched.h>
+#define WHEEL_FUTEX
+#endif
+
+typedef struct {
+	uint32_t word;
+#ifndef WHEEL_FUTEX
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+#endif
+} wheel_wait_t;
+
+struct wheel;
+
+typedef struct wheel_timer {
+	switch_time_t base;
+	switch_time_t deadline;
+	switch_interval_time_t period;
+	wheel_wait_t wait;
+	struct wheel *wheel;
+	struct wheel_timer *next;
+} wheel_timer_t;
+
+typedef struct wheel {
+	switch_mutex_t *mutex;
+	wheel_timer_t *l0[WHEEL_L0_SLOTS];
+	wheel_timer_t *l1[WHEEL_LN_SLOTS];
+	wheel_timer_t *l2[WHEEL_LN_SLOTS];
+	uint64_t cur;	/* next level 0 slot to expire, in WHEEL_RES units */
+	switch_time_t armed;	/* when the wheel thread will look again, 0 when it sleeps until kicked */
+	uint32_t pending;
+	volatile int done;
+	wheel_wait_t kick;
+	switch_thread_t *thread;
+} wheel_t;
+
+static struct {
+	wheel_t wheels[WHEEL_MAX];
+	uint32_t count;
+	uint32_t next;
+	int32_t running;
+	switch_mutex_t *mutex;	/* starting and stopping wheel threads */
+	switch_memory_pool_t *pool;
+} WHEELS;
+
+static void wheel_wait_init(wheel_wait_t *w, switch_memory_pool_t *pool)
+{
+	w->word = 0;
+#ifndef WHEEL_FUTEX
+	switch_mutex_init(&w->mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_thread_cond_create(&w->cond, pool);
+#endif
+}
+
+/* sleeps while the word still reads val, no longer than usec when it is not 0 */
+static void wheel_wait(wheel_wait_t *w, uint32_t val, switch_interval_time_t usec)
+{
+#ifdef WHEEL_FUTEX
+	struct timespec ts;
+
+	if (usec) {
+		ts.tv_sec = usec / 1000000;
+		ts.tv_nsec = (usec % 1000000) * 1000;
+	}
+
+	syscall(SYS_futex, &w->word, FUTEX_WAIT_PRIVATE, val, usec ? &ts : NULL, NULL, 0);
+#else
+	switch_mutex_lock(w->mutex);
+	if (w->word == val) {
+		if (usec) {
+			switch_thread_cond_timedwait(w->cond, w->mutex, usec);
+		} else {
+			switch_thread_cond_wait(w->cond, w->mutex);
+		}
+	}
+	switch_mutex_unlock(w->mutex);
+#endif
+}
+
+/* what the waker wrote before bumping the word is visible once the new value is */
+static uint32_t wheel_word(wheel_wait_t *w)
+{
+#ifdef WHEEL_FUTEX
+	return __atomic_load_n(&w->word, __ATOMIC_ACQUIRE);
+#else
+	uint32_t word;
+
+	switch_mutex_lock(w->mutex);
+	word = w->word;
+	switch_mutex_unlock(w->mutex);
+
+	return word;
+#endif
+}
+
+static void wheel_wake(wheel_wait_t *w)
+{
+#ifdef WHEEL_FUTEX
+	__atomic_fetch_add(&w->word, 1, __ATOMIC_RELEASE);
+	syscall(SYS_futex, &w->word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+	switch_mutex_lock(w->mutex);
+	w->word++;
+	switch_thread_cond_signal(w->cond);
+	switch_mutex_unlock(w->mutex);
+#endif
+}
+
+/* files a timer by how far its deadline is from the slot the wheel is on, wheel locked */
+static void wheel_insert(wheel_t *wheel, wheel_timer_t *wt)
+{
+	uint64_t due = (uint64_t) wt->deadline / WHEEL_RES, delta;
+	wheel_timer_t **slot;
+
+	if (due < wheel->cur) {
+		due = wheel->cur;
+	}
+
+	delta = due - wheel->cur;
+
+	if (delta < WHEEL_L0_SLOTS) {
+		slot = &wheel->l0[due & (WHEEL_L0_SLOTS - 1)];
+	} else if (delta < WHEEL_L1_SPAN) {
+		slot = &wheel->l1[(due >> WHEEL_L0_BITS) & (WHEEL_LN_SLOTS - 1)];
+	} else {
+		if (delta >= WHEEL_L2_SPAN) {
+			/* parked on the last slot in reach, it gets filed again from there */
+			due = wheel->cur + WHEEL_L2_SPAN - WHEEL_L1_SPAN;
+		}
+		slot = &wheel->l2[(due >> (WHEEL_L0_BITS + WHEEL_LN_BITS)) & (WHEEL_LN_SLOTS - 1)];
+	}
+
+	wt->next = *slot;
+	*slot = wt;
+}
+
+static void wheel_cascade(wheel_t *wheel, wheel_timer_t **slot)
+{
+	wheel_timer_t *wt = *slot, *next;
+
+	*slot = NULL;
+
+	for (; wt; wt = next) {
+		next = wt->next;
+		wheel_insert(wheel, wt);
+	}
+}
+
+/* takes everything due by now off the wheel onto fired, returns the earliest deadline left or 0, wheel locked */
+static switch_time_t wheel_expire(wheel_t *wheel, switch_time_t now, wheel_timer_t **fired)
+{
+	uint64_t now_slot = (uint64_t) now / WHEEL_RES, x;
+	switch_time_t next = 0;
+
+	if (!wheel->pending) {
+		/* nothing to cascade, skip the slots an idle wheel did not look at */
+		wheel->cur = now_slot;
+		return 0;
+	}
+
+	while (wheel->cur <= now_slot) {
+		wheel_timer_t **slot, *wt;
+		int left = 0;
+
+		if (!(wheel->cur & (WHEEL_L0_SLOTS - 1))) {
+			if (!(wheel->cur & (WHEEL_L1_SPAN - 1))) {
+				wheel_cascade(wheel, &wheel->l2[(wheel->cur >> (WHEEL_L0_BITS + WHEEL_LN_BITS)) & (WHEEL_LN_SLOTS - 1)]);
+			}
+			wheel_cascade(wheel, &wheel->l1[(wheel->cur >> WHEEL_L0_BITS) & (WHEEL_LN_SLOTS - 1)]);
+		}
+
+		for (slot = &wheel->l0[wheel->cur & (WHEEL_L0_SLOTS - 1)]; (wt = *slot); ) {
+			if (wt->deadline <= now || WHEELS.running != 1) {
+				*slot = wt->next;
+				wt->next = *fired;
+				*fired = wt;
+				wheel->pending--;
+			} else {
+				left = 1;
+				slot = &wt->next;
+			}
+		}
+
+		/* what is left is due later in the slot we are in */
+		if (left) {
+			break;
+		}
+
+		wheel->cur++;
+	}
+
+	if (!wheel->pending) {
+		return 0;
+	}
+
+	for (x = wheel->cur; x < wheel->cur + WHEEL_L0_SLOTS; x++) {
+		wheel_timer_t *wt;
+
+		/* a cascade is due before anything further out on level 0 */
+		if (x > wheel->cur && !(x & (WHEEL_L0_SLOTS - 1))) {
+			break;
+		}
+
+		for (wt = wheel->l0[x & (WHEEL_L0_SLOTS - 1)]; wt; wt = wt->next) {
+			if (!next || wt->deadline < next) {
+				next = wt->deadline;
+			}
+		}
+
+		if (next) {
+			return next;
+		}
+	}
+
+	return (switch_time_t) x * WHEEL_RES;
+}
+
+static void wheel_unlink(wheel_t *wheel, wheel_timer_t *wt)
+{
+	wheel_timer_t **levels[3] = { wheel->l0, wheel->l1, wheel->l2 };
+	int sizes[3] = { WHEEL_L0_SLOTS, WHEEL_LN_SLOTS, WHEEL_LN_SLOTS };
+	wheel_timer_t **slot;
+	int l, x;
+
+	for (l = 0; l < 3; l++) {
+		for (x = 0; x < sizes[l]; x++) {
+			for (slot = &levels[l][x]; *slot; slot = &(*slot)->next) {
+				if (*slot == wt) {
+					*slot = wt->next;
+					wheel->pending--;
+					return;
+				}
+			}
+		}
+	}
+}
+
+/* the timers are woken once they are off the wheel and it is unlocked, they may be back on it right away */
+static void wheel_fire(wheel_timer_t *fired)
+{
+	wheel_timer_t *next;
+
+	for (; fired; fired = next) {
+		next = fired->next;
+		wheel_wake(&fired->wait);
+	}
+}
+
+static void *SWITCH_THREAD_FUNC wheel_thread(switch_thread_t *thread, void *obj)
+{
+	wheel_t *wheel = (wheel_t *) obj;
+	wheel_timer_t *fired = NULL;
+
+	while (WHEELS.running == 1) {
+		switch_time_t now, next;
+		uint32_t kick;
+
+		fired = NULL;
+		switch_mutex_lock(wheel->mutex);
+		kick = wheel_word(&wheel->kick);
+		now = switch_mono_micro_time_now();
+		next = wheel_expire(wheel, now, &fired);
+		wheel->armed = next;
+		switch_mutex_unlock(wheel->mutex);
+
+		wheel_fire(fired);
+
+		if (!next || next > now) {
+			wheel_wait(&wheel->kick, kick, next ? next - now : 0);
+		}
+	}
+
+	fired = NULL;
+	switch_mutex_lock(wheel->mutex);
+	wheel_expire(wheel, switch_mono_micro_time_now(), &fired);
+	switch_mutex_unlock(wheel->mutex);
+
+	wheel_fire(fired);
+	wheel->done = 1;
+
+	return NULL;
+}
+
+static void wheel_start(switch_memory_pool_t *pool)
+{
+	uint32_t x;
+
+	memset(&WHEELS, 0, sizeof(WHEELS));
+	switch_mutex_init(&WHEELS.mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_core_new_memory_pool(&WHEELS.pool);
+	WHEELS.count = switch_core_cpu_count();
+
+	if (WHEELS.count < 1) {
+		WHEELS.count = 1;
+	} else if (WHEELS.count > WHEEL_MAX) {
+		WHEELS.count = WHEEL_MAX;
+	}
+
+	WHEELS.running = 1;
+
+	for (x = 0; x < WHEELS.count; x++) {
+		wheel_t *wheel = &WHEELS.wheels[x];
+
+		switch_mutex_init(&wheel->mutex, SWITCH_MUTEX_NESTED, pool);
+		wheel_wait_init(&wheel->kick, pool);
+	}
+}
+
+/* starts the thread of a wheel the first time a timer is put on it */
+static switch_status_t wheel_launch(wheel_t *wheel)
+{
+	switch_threadattr_t *thd_attr = NULL;
+
+	switch_mutex_lock(WHEELS.mutex);
+	if (!wheel->thread && WHEELS.running == 1) {
+		wheel->cur = (uint64_t) switch_mono_micro_time_now() / WHEEL_RES;
+
+		switch_threadattr_create(&thd_attr, WHEELS.pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_threadattr_priority_set(thd_attr, SWITCH_PRI_REALTIME);
+		if (switch_thread_create(&wheel->thread, thd_attr, wheel_thread, wheel, WHEELS.pool) != SWITCH_STATUS_SUCCESS) {
+			wheel->thread = NULL;
+		}
+	}
+	switch_mutex_unlock(WHEELS.mutex);
+
+	return wheel->thread ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+}
+
+static void wheel_stop(void)
+{
+	switch_status_t st;
+	uint32_t x;
+
+	if (WHEELS.running != 1) {
+		return;
+	}
+
+	switch_mutex_lock(WHEELS.mutex);
+	WHEELS.running = 0;
+	switch_mutex_unlock(WHEELS.mutex);
+
+	for (x = 0; x < WHEELS.count; x++) {
+		wheel_t *wheel = &WHEELS.wheels[x];
+
+		if (wheel->thread) {
+			wheel_wake(&wheel->kick);
+			switch_thread_join(&st, wheel->thread);
+		} else {
+			wheel->done = 1;
+		}
+	}
+
+	switch_core_destroy_memory_pool(&WHEELS.pool);
+}
+
+static switch_status_t wheel_timer_init(switch_timer_t *timer)
+{
+	wheel_timer_t *wt;
+	uint32_t x;
+
+	if (WHEELS.running != 1 || timer->interval < 1) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (!(wt = switch_core_alloc(timer->memory_pool, sizeof(*wt)))) {
+		return SWITCH_STATUS_MEMERR;
+	}
+
+#ifdef WHEEL_FUTEX
+	if ((int) (x = (uint32_t) sched_getcpu()) < 0) {
+		x = WHEELS.next++;
+	}
+#else
+	x = WHEELS.next++;
+#endif
+
+	wt->wheel = &WHEELS.wheels[x % WHEELS.count];
+
+	if (wheel_launch(wt->wheel) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	wt->period = (switch_interval_time_t) timer->interval * 1000;
+	wt->base = switch_mono_micro_time_now();
+	wt->deadline = wt->base + wt->period;
+	wheel_wait_init(&wt->wait, timer->memory_pool);
+
+	timer->start = switch_micro_time_now();
+	timer->private_info = wt;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t wheel_timer_step(switch_timer_t *timer)
+{
+	wheel_timer_t *wt = timer->private_info;
+
+	timer->tick++;
+	timer->samplecount += timer->samples;
+	wt->deadline += wt->period;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t wheel_timer_next(switch_timer_t *timer)
+{
+	wheel_timer_t *wt = timer->private_info;
+	wheel_t *wheel = wt->wheel;
+	switch_time_t now = switch_mono_micro_time_now();
+	uint64_t ticks = 1;
+
+	if (now < wt->deadline && WHEELS.running == 1) {
+		uint32_t val = wheel_word(&wt->wait);
+		int kick;
+
+		switch_mutex_lock(wheel->mutex);
+		if (!wheel->pending) {
+			wheel->cur = (uint64_t) now / WHEEL_RES;
+		}
+		wheel_insert(wheel, wt);
+		wheel->pending++;
+		kick = !wheel->armed || wt->deadline < wheel->armed;
+		if (kick) wheel->armed = wt->deadline;
+		switch_mutex_unlock(wheel->mutex);
+
+		if (kick) {
+			wheel_wake(&wheel->kick);
+		}
+
+		while (wheel_word(&wt->wait) == val) {
+			if (WHEELS.running != 1 && wheel->done) {
+				/* the wheel thread is gone, whatever it did not see is ours to take off */
+				switch_mutex_lock(wheel->mutex);
+				if (wheel_word(&wt->wait) == val) {
+					wheel_unlink(wheel, wt);
+				}
+				switch_mutex_unlock(wheel->mutex);
+				break;
+			}
+			wheel_wait(&wt->wait, val, 100000);
+		}
+
+		now = switch_mono_micro_time_now();
+	}
+
+	/* like timerfd, a late caller is told how many periods went by */
+	if (now > wt->deadline) {
+		ticks += (uint64_t) (now - wt->deadline) / wt->period;
+	}
+
+	timer->tick += ticks;
+	timer->samplecount = (uint32_t) (timer->tick * timer->samples);
+	wt->deadline += ticks * wt->period;
+
+	return WHEELS.running == 1 ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+}
+
+static switch_status_t wheel_timer_sync(switch_timer_t *timer)
+{
+	wheel_timer_t *wt = timer->private_info;
+	switch_time_t now = switch_mono_micro_time_now();
+
+	timer->tick = (uint64_t) (now - wt->base) / wt->period;
+	timer->samplecount = (uint32_t) (timer->tick * timer->samples);
+	wt->deadline = wt->base + (timer->tick + 1) * wt->period;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t wheel_timer_check(switch_timer_t *timer, switch_bool_t step)
+{
+	wheel_timer_t *wt = timer->private_info;
+	switch_time_t now = switch_mono_micro_time_now();
+
+	if (now < wt->deadline) {
+		timer->diff = (switch_size_t) ((wt->deadline - now + wt->period - 1) / wt->period);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	timer->diff = 0;
+
+	if (step) {
+		wheel_timer_step(timer);
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t wheel_timer_destroy(switch_timer_t *timer)
+{
+	timer->private_info = NULL;
+	return SWITCH_STATUS_SUCCESS;
+}
+
 static void win32_init_timers(void)
 {
 #ifdef WIN32
@@ -1524,6 +2038,16 @@ SWITCH_MODULE_LOAD_FUNCTION(softtimer_load)
 	timer_interface->timer_check = timer_check;
 	timer_interface->timer_destroy = timer_destroy;
 
+	timer_interface = switch_loadable_module_create_interface(*module_interface, SWITCH_TIMER_INTERFACE);
+	timer_interface->interface_name = "wheel";
+	timer_interface->timer_init = wheel_timer_init;
+	timer_interface->timer_next = wheel_timer_next;
+	timer_interface->timer_step = wheel_timer_step;
+	timer_interface->timer_sync = wheel_timer_sync;
+	timer_interface->timer_check = wheel_timer_check;
+	timer_interface->timer_destroy = wheel_timer_destroy;
+	wheel_start(module_pool);
+
 	if (!switch_test_flag((&runtime), SCF_USE_CLOCK_RT)) {
 		switch_time_set_nanosleep(SWITCH_FALSE);
 	}
@@ -1568,6 +2092,8 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(softtimer_shutdown)
 {
 	globals.use_cond_yield = 0;
 
+	wheel_stop();
+
 	if (globals.RUNNING == 1) {
 		switch_mutex_lock(globals.mutex);
 		globals.RUNNING = -1;
@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+/* the index is private to the module, build it in */
+#include "../../src/mod/dialplans/mod_dialplan_xml/mod_dialplan_xml.c"
+
+// #define BENCHMARK 1
+
+#define EXTENSIONS 10000
+#define CALLS 100000
+
+/* first conditions the index has to get right, the ones it cannot file are tried on every call */
+static const char *conditions[] = {
+  "<condition field=\"destination_number\" expression=\"^1234$\">",
+  "<condition field=\"destination_number\" expression=\"^12(3|4)\">",
+  "<condition field=\"destination_number\" expression=\"^123\\d+$\">",
+  "<condition field=\"destination_number\" expression=\"^10?0\">",
+  "<condition field=\"destination_number\" expression=\"^55+1\">",
+  "<condition field=\"destination_number\" expression=\"^\\+44\">",
+  "<condition field=\"destination_number\" expression=\"^9\">",
+  "<condition field=\"destination_number\" expression=\"^9|^8\">",
+  "<condition field=\"destination_number\" expression=\"^[0-9]{4}$\">",
+  "<condition field=\"destination_number\" expression=\"^${dest}$\">",
+  "<condition field=\"destination_number\" expression=\"^1234$\" break=\"never\">",
+  "<condition field=\"destination_number\" expression=\"^1234$\" break=\"always\">",
+  "<condition field=\"destination_number\" expression=\"^1234$\" wday=\"1-7\">",
+  "<condition field=\"DESTINATION_NUMBER\" expression=\"^4321$\">",
+  "<condition field=\"context\" expression=\"^checks$\">",
+  "<condition field=\"context\" expression=\"^other$\">",
+  "<condition field=\"caller_id_number\" expression=\"^1234$\">",
+  "<condition field=\"destination_number\" expression=\"/^1234$/i\">",
+  "<condition field=\"destination_number\"><expression><![CDATA[^77]]></expression>",
+  "<condition field=\"destination_number\" expression=\"^\\\\\\\\1\">",
+  "<condition field=\"destination_number\" expression=\"\">",
+  NULL
+};
+
+static const char *numbers[] = {
+  "1234", "12345", "1235", "1230", "100", "10", "1000", "551", "5551", "+441234", "9", "91", "8",
+  "4321", "77", "\\1", "", "1234\n", "123", "1", NULL
+};
+
+static switch_xml_t build_context(const char *name, int extensions, int anti, int *indexable)
+{
+  switch_stream_handle_t stream = { 0 };
+  switch_xml_t xml;
+  int x;
+
+  SWITCH_STANDARD_STREAM(stream);
+  stream.write_function(&stream, "<document type=\"freeswitch/xml\"><section name=\"dialplan\"><context name=\"%s\">", name);
+
+  if (indexable) *indexable = 0;
+
+  for ( x = 0; x < extensions; x++) {
+    if (extensions <= 64) {
+      stream.write_function(&stream, "<extension name=\"e%d\"%s>%s%s<action application=\"log\" data=\"%d\"/></condition></extension>",
+                            x, x % 3 ? "" : " continue=\"true\"", conditions[x], anti && x == 0 ? "<anti-action application=\"log\" data=\"no\"/>" : "", x);
+    } else if (x % 100 == 99) {
+      /* a sprinkling of extensions that look at something other than the number */
+      stream.write_function(&stream, "<extension name=\"e%d\"><condition field=\"caller_id_number\" expression=\"^%d$\">"
+                            "<action application=\"log\" data=\"%d\"/></condition></extension>", x, x, x);
+    } else {
+      stream.write_function(&stream, "<extension name=\"e%d\"><condition field=\"destination_number\" expression=\"%s%d%s\">"
+                            "<action application=\"log\" data=\"%d\"/></condition></extension>", x, x % 2 ? "^1" : "^2", x, x % 2 ? "$" : "(\\d+)$", x);
+      if (indexable) (*indexable)++;
+    }
+  }
+
+  stream.write_function(&stream, "</context></section></document>");
+  xml = switch_xml_parse_str_dynamic((char *) stream.data, SWITCH_FALSE);
+
+  return xml;
+}
+
+static int first_condition_matches(switch_xml_t xexten, switch_caller_profile_t *profile)
+{
+  switch_xml_t xcond = switch_xml_child(xexten, "condition"), xexpression;
+  const char *field, *val, *expression;
+  switch_regex_t *re = NULL;
+  int ovector[30], match;
+
+  if (!xcond || !(field = switch_xml_attr(xcond, "field"))) {
+    return 1;
+  }
+
+  if ((xexpression = switch_xml_child(xcond, "expression"))) {
+    expression = switch_str_nil(xexpression->txt);
+  } else {
+    expression = switch_xml_attr_soft(xcond, "expression");
+  }
+
+  if (!(val = switch_caller_get_field_by_name(profile, field))) {
+    val = "";
+  }
+
+  match = switch_regex_perform(val, expression, &re, ovector, sizeof(ovector) / sizeof(ovector[0]));
+  switch_regex_safe_free(re);
+
+  return match;
+}
+
+/* the first extension that would take the call, looking only at first conditions */
+static int route(dp_index_context_t *ctx, switch_caller_profile_t *profile, int indexed, int *evaluated)
+{
+  dp_index_cursor_t cursor;
+  switch_xml_t xexten;
+  uint32_t x = 0;
+
+  if (indexed) {
+    dp_index_open(&cursor, ctx, profile, ctx->extens[0]);
+    xexten = dp_index_next(&cursor);
+  } else {
+    xexten = ctx->extens[0];
+  }
+
+  for (; xexten; xexten = indexed ? dp_index_next(&cursor) : xexten->next) {
+    (*evaluated)++;
+    if (first_condition_matches(xexten, profile)) {
+      for ( x = 0; ctx->extens[x] != xexten; x++);
+      return x;
+    }
+  }
+
+  return -1;
+}
+
+#ifndef BENCHMARK
+/* every extension the index leaves out must be one parse_exten would have failed on its first condition */
+static int index_is_sound(dp_index_context_t *ctx, switch_caller_profile_t *profile, int *candidates)
+{
+  dp_index_cursor_t cursor;
+  switch_xml_t xexten;
+  uint8_t *seen = calloc(ctx->nexten, 1);
+  char key[DP_INDEX_MAX_KEY];
+  int x, exact, good = 1;
+  int last = -1;
+
+  *candidates = 0;
+  dp_index_open(&cursor, ctx, profile, ctx->extens[0]);
+
+  while ((xexten = dp_index_next(&cursor))) {
+    for ( x = 0; ctx->extens[x] != xexten; x++);
+    if (x <= last) good = 0;
+    last = x;
+    seen[x] = 1;
+    (*candidates)++;
+  }
+
+  for ( x = 0; x < (int) ctx->nexten; x++) {
+    if (!seen[x] && (dp_index_key(ctx->extens[x], key, sizeof(key), &exact) < 0 || first_condition_matches(ctx->extens[x], profile))) {
+      diag("extension %d skipped for [%s]\n", x, profile->destination_number);
+      good = 0;
+    }
+  }
+
+  free(seen);
+
+  return good;
+}
+#endif
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  switch_caller_profile_t profile = { 0 };
+  switch_memory_pool_t *pool = NULL;
+  dp_index_t *index = NULL;
+  dp_index_context_t *ctx;
+  char number[32];
+  int x, evaluated = 0, indexable = 0;
+
+#ifndef BENCHMARK
+  int sound = 1, candidates = 0, pruned = 0, same = 1, linear = 0;
+  char key[DP_INDEX_MAX_KEY];
+  int exact = 0;
+
+  dp_index_cursor_t cursor;
+  switch_xml_t xexten;
+
+  plan(1 + 10);
+#else
+  switch_time_t start;
+  switch_time_t usec;
+  int routed = 0;
+
+  plan(1 + 2);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+  switch_mutex_init(&globals.mutex, SWITCH_MUTEX_NESTED, pool);
+
+#ifndef BENCHMARK
+  ok(dp_index_literal("^1234$", key, sizeof(key), &exact) == 4 && exact, "literal: an anchored number is an exact key");
+  ok(dp_index_literal("^10?0", key, sizeof(key), &exact) == 1 && !exact && !strcmp(key, "1"), "literal: an optional digit ends the key before it");
+  ok(dp_index_literal("^\\+44\\d+", key, sizeof(key), &exact) == 3 && !strcmp(key, "+44"), "literal: escaped punctuation is literal, classes end the key");
+  ok(!dp_index_literal("^9|^8", key, sizeof(key), &exact) && !dp_index_literal("1234", key, sizeof(key), &exact), "literal: alternation and unanchored expressions have no key");
+
+  for ( x = 0; x < 2; x++) {
+    const char **n;
+
+    index = dp_index_compile(build_context("checks", (int) (sizeof(conditions) / sizeof(conditions[0])) - 1, x, NULL));
+    ctx = index->contexts;
+    profile.context = "checks";
+
+    for ( n = numbers; *n; n++) {
+      profile.destination_number = (char *) *n;
+      sound &= index_is_sound(ctx, &profile, &candidates);
+      pruned += ctx->nexten - candidates;
+    }
+
+    dp_index_release(&index);
+  }
+
+  ok(sound, "hand written context: only extensions that cannot match are skipped, the rest stay in order");
+  ok(pruned > 0, "hand written context: %d extension evaluations saved", pruned);
+
+  index = dp_index_compile(build_context("generated", 1000, 0, &indexable));
+  ctx = index->contexts;
+  profile.context = "generated";
+  ok(index->indexed == (uint32_t) indexable, "generated context: %u of %u extensions indexed", index->indexed, ctx->nexten);
+
+  sound = 1;
+  for ( x = 0; x < 2000; x++) {
+    switch_snprintf(number, sizeof(number), "%d%d%s", x % 2 ? 1 : 2, x % 1100, x % 7 ? "" : "55");
+    profile.destination_number = number;
+    sound &= index_is_sound(ctx, &profile, &candidates);
+    if (route(ctx, &profile, 1, &evaluated) != route(ctx, &profile, 0, &linear)) {
+      same = 0;
+    }
+  }
+
+  ok(sound, "generated context: only extensions that cannot match are skipped");
+  ok(same, "generated context: routed the same with and without the index (%d vs %d evaluations)", evaluated, linear);
+
+  /* an inline set_profile_var in a continue="true" extension moves the hunt to another number */
+  profile.destination_number = "11";
+  dp_index_open(&cursor, ctx, &profile, ctx->extens[0]);
+  xexten = dp_index_next(&cursor);
+  profile.destination_number = "1501";
+  while ((xexten = dp_index_follow(&cursor, &profile)) && !first_condition_matches(xexten, &profile));
+  ok(xexten == ctx->extens[501], "generated context: the hunt follows a destination_number changed mid hunt");
+
+  dp_index_release(&index);
+#else
+  switch_regex_cache_set_size(EXTENSIONS * 2);
+
+  index = dp_index_compile(build_context("bench", EXTENSIONS, 0, &indexable));
+  ctx = index->contexts;
+  profile.context = "bench";
+  note("mod_dialplan_xml index: %u of %u extensions indexed in %dus\n", index->indexed, ctx->nexten, (int) index->usec);
+
+  start = switch_time_now();
+  for ( x = 0; x < CALLS; x++) {
+    switch_snprintf(number, sizeof(number), "%d%d", x % 2 ? 1 : 2, x % EXTENSIONS);
+    profile.destination_number = number;
+    if (route(ctx, &profile, 1, &evaluated) >= 0) routed++;
+  }
+  usec = switch_time_now() - start;
+
+  note("mod_dialplan_xml indexed: %d calls, %d routed, %d extensions evaluated in %ldus, %.0f calls per second\n",
+       CALLS, routed, evaluated, (long) usec, CALLS * 1000000.0 / (usec ? usec : 1));
+  ok(routed > 0, "Routed with the index");
+
+  /* the linear walk is three orders of magnitude slower, a slice of the calls is enough to compare */
+  routed = evaluated = 0;
+  start = switch_time_now();
+  for ( x = 0; x < CALLS / 100; x++) {
+    switch_snprintf(number, sizeof(number), "%d%d", x % 2 ? 1 : 2, (x * 100) % EXTENSIONS);
+    profile.destination_number = number;
+    if (route(ctx, &profile, 0, &evaluated) >= 0) routed++;
+  }
+  usec = switch_time_now() - start;
+
+  note("mod_dialplan_xml linear: %d calls, %d routed, %d extensions evaluated in %ldus, %.0f calls per second\n",
+       CALLS / 100, routed, evaluated, (long) usec, CALLS / 100 * 1000000.0 / (usec ? usec : 1));
+  ok(routed > 0, "Routed without the index");
+
+  dp_index_release(&index);
+#endif
+
+  switch_core_destroy_memory_pool(&pool);
+  switch_core_destroy();
+
+  done_testing();
+}
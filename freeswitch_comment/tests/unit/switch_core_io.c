@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+static switch_io_routines_t test_io_routines = { 0 };
+static switch_state_handler_table_t test_state_handlers = { 0 };
+static switch_endpoint_interface_t *test_endpoint;
+
+typedef struct {
+  switch_core_session_t *session;
+  switch_status_t status;
+  switch_time_t usec;
+} trace_on_t;
+
+/* the first session to turn trace on calibrates the tick rate, 20ms of sleep */
+static void *SWITCH_THREAD_FUNC trace_on_thread(switch_thread_t *thread, void *obj)
+{
+  trace_on_t *t = (trace_on_t *) obj;
+  switch_time_t start = switch_time_now();
+
+  t->status = switch_core_session_media_trace(t->session, SWITCH_TRUE);
+  t->usec = switch_time_now() - start;
+
+  return NULL;
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  switch_memory_pool_t *pool = NULL;
+  switch_loadable_module_interface_t *module_interface;
+  switch_core_session_t *session;
+  switch_channel_t *channel;
+  switch_thread_t *thread;
+  switch_threadattr_t *thd_attr = NULL;
+  switch_stream_handle_t stream = { 0 };
+  trace_on_t t = { 0 };
+  switch_time_t start, usec;
+  uint64_t t0, t1;
+  int x, rising = 1;
+
+  plan(1 + 6);
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+  module_interface = switch_loadable_module_create_module_interface(pool, "test_endpoint");
+  test_endpoint = switch_loadable_module_create_interface(module_interface, SWITCH_ENDPOINT_INTERFACE);
+  test_endpoint->interface_name = "test";
+  test_endpoint->io_routines = &test_io_routines;
+  test_endpoint->state_handler = &test_state_handlers;
+
+  t0 = switch_core_media_trace_tick();
+  for ( x = 0; x < 1000; x++) {
+    t1 = switch_core_media_trace_tick();
+    rising &= t1 >= t0;
+    t0 = t1;
+  }
+  ok(rising, "media trace: the tick never goes backwards");
+
+  session = switch_core_session_request(test_endpoint, SWITCH_CALL_DIRECTION_OUTBOUND, SOF_NO_LIMITS, NULL);
+  channel = switch_core_session_get_channel(session);
+  switch_channel_set_name(channel, "test/trace");
+  t.session = session;
+
+  switch_threadattr_create(&thd_attr, pool);
+  switch_thread_create(&thread, thd_attr, trace_on_thread, &t, pool);
+
+  /* the totals share the core's global mutex, they must not wait out the calibration */
+  switch_yield(2000);
+  start = switch_time_now();
+  switch_core_media_trace_reset();
+  usec = switch_time_now() - start;
+
+  switch_thread_join(&status, thread);
+
+  ok(t.status == SWITCH_STATUS_SUCCESS && t.usec >= 15000, "media trace: the first session calibrated the tick (%ldus)", (long) t.usec);
+  ok(usec < 10000, "media trace: the totals stayed available during calibration (%ldus)", (long) usec);
+
+  SWITCH_STANDARD_STREAM(stream);
+  switch_core_media_trace_report(session, &stream);
+  ok(stream.data && !strncmp((char *) stream.data, "stage", 5) && !strchr((char *) stream.data, '\n')[1],
+     "media trace: a session with no media reports no stages");
+  switch_safe_free(stream.data);
+
+  switch_core_session_media_trace_hangup(session);
+  ok(!switch_channel_get_variable(channel, "media_trace_read_count"), "media trace: nothing timed, nothing published at hangup");
+
+  SWITCH_STANDARD_STREAM(stream);
+  switch_core_media_trace_report(NULL, &stream);
+  ok(stream.data && !strncmp((char *) stream.data, "sessions: 1\n", 12), "media trace: the hung up session is in the totals");
+  switch_safe_free(stream.data);
+
+  switch_channel_hangup(channel, SWITCH_CAUSE_NORMAL_CLEARING);
+  switch_core_session_destroy(&session);
+
+  switch_core_destroy_memory_pool(&pool);
+  switch_core_destroy();
+
+  done_testing();
+}
@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+#ifdef BENCHMARK
+#define THREADS 8
+#define POOLS 20000
+#else
+#define THREADS 4
+#define POOLS 200
+#endif
+
+/* roughly what a call leaves in its session pool */
+#define ALLOCS 150
+
+#define HERE "unit/switch_core_memory.c:"
+
+typedef struct {
+  const char *tag;
+  switch_memory_pool_tag_stats_t found;
+} tag_lookup_t;
+
+static void tag_callback(const switch_memory_pool_tag_stats_t *stats, void *pvt)
+{
+  tag_lookup_t *lookup = (tag_lookup_t *) pvt;
+
+  if (strstr(stats->tag, lookup->tag)) {
+    lookup->found.pools += stats->pools;
+    lookup->found.created += stats->created;
+    lookup->found.bytes += stats->bytes;
+    if (stats->peak > lookup->found.peak) lookup->found.peak = stats->peak;
+  }
+}
+
+static switch_memory_pool_tag_stats_t tag_stats(const char *tag)
+{
+  tag_lookup_t lookup = { 0 };
+
+  lookup.tag = tag;
+  switch_core_memory_pool_tag_stats(tag_callback, &lookup);
+
+  return lookup.found;
+}
+
+/* destroyed pools sit in the pool thread's queue for a second before they really go */
+static uint32_t wait_for_tag(const char *tag, uint32_t pools)
+{
+  uint32_t live = 0;
+  int x;
+
+  for ( x = 0; x < 100; x++) {
+    if ((live = tag_stats(tag).pools) <= pools) {
+      break;
+    }
+    switch_yield(100000);
+  }
+
+  return live;
+}
+
+static long proc_rss(void)
+{
+  char line[256];
+  long rss = 0;
+  FILE *fp = fopen("/proc/self/status", "r");
+
+  if (!fp) {
+    return 0;
+  }
+
+  while (fgets(line, sizeof(line), fp)) {
+    sscanf(line, "VmRSS: %ld", &rss);
+  }
+
+  fclose(fp);
+
+  return rss;
+}
+
+static void *SWITCH_THREAD_FUNC call_thread(switch_thread_t *thread, void *obj)
+{
+  int *good = (int *) obj;
+  switch_memory_pool_t *pool;
+  char buf[64];
+  int x, y;
+
+  for ( x = 0; x < POOLS; x++) {
+    switch_core_new_memory_pool(&pool);
+
+    for ( y = 0; y < ALLOCS; y++) {
+      char *p = switch_core_alloc(pool, 16 + (x * 7 + y * 13) % 500);
+
+      if (y % 3 == 0) {
+        switch_snprintf(buf, sizeof(buf), "variable_%d_%d", x, y);
+        p = switch_core_strdup(pool, buf);
+        if (strcmp(p, buf)) *good = 0;
+      }
+    }
+
+    switch_core_destroy_memory_pool(&pool);
+  }
+
+  return NULL;
+}
+
+static double run_calls(switch_memory_pool_t *pool, long *rss_kb)
+{
+  switch_thread_t *threads[THREADS];
+  int good[THREADS];
+  switch_threadattr_t *thd_attr = NULL;
+  switch_status_t st;
+  switch_time_t start, usec;
+  long rss0 = proc_rss();
+  int x, ok_all = 1;
+
+  switch_threadattr_create(&thd_attr, pool);
+  switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+  start = switch_time_now();
+
+  for ( x = 0; x < THREADS; x++) {
+    good[x] = 1;
+    switch_thread_create(&threads[x], thd_attr, call_thread, &good[x], pool);
+  }
+
+  for ( x = 0; x < THREADS; x++) {
+    switch_thread_join(&st, threads[x]);
+    ok_all &= good[x];
+  }
+
+  usec = switch_time_now() - start;
+  *rss_kb = proc_rss() - rss0;
+
+  return ok_all ? THREADS * POOLS * 1000000.0 / (usec ? usec : 1) : 0;
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  switch_memory_pool_t *pool = NULL;
+  switch_memory_pool_stats_t stats;
+  long rss_kb;
+  double rate;
+
+#ifndef BENCHMARK
+  switch_memory_pool_stats_t before;
+  switch_memory_pool_t *p = NULL;
+  switch_memory_pool_tag_stats_t ts;
+  int x;
+
+  plan(1 + 9);
+#else
+  double cold;
+  long cold_rss;
+
+  plan(1 + 2);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+
+#ifndef BENCHMARK
+  switch_core_new_memory_pool(&p);
+  for ( x = 0; x < 100; x++) {
+    switch_core_alloc(p, 100);
+  }
+
+  ts = tag_stats(HERE);
+  ok(ts.pools == 2 && ts.bytes >= 100 * 100, "a pool is accounted to the line that created it (%u pools, %d bytes)", ts.pools, (int) ts.bytes);
+
+  switch_core_memory_pool_tag(p, "test_tag");
+  ts = tag_stats("test_tag");
+  ok(ts.pools == 1 && tag_stats(HERE).pools == 1, "tagging a pool moves it to the new tag");
+
+  switch_pool_clear(p);
+  ts = tag_stats("test_tag");
+  ok(ts.bytes == 0 && switch_core_strdup(p, "still here") && tag_stats("test_tag").bytes > 0, "a cleared pool starts over and still allocates");
+
+  switch_core_memory_pool_stats(&before);
+  switch_core_destroy_memory_pool(&p);
+  wait_for_tag("test_tag", 0);
+  ts = tag_stats("test_tag");
+  ok(ts.pools == 0 && ts.peak > 0, "a destroyed pool leaves its tag (peak %d bytes)", (int) ts.peak);
+
+  switch_core_memory_pool_stats(&stats);
+  ok(stats.idle > before.idle, "the allocator of a destroyed pool is kept warm (%u idle)", stats.idle);
+
+  rate = run_calls(pool, &rss_kb);
+  ok(rate > 0, "%d threads each ran %d pools through create, alloc and destroy", THREADS, POOLS);
+  ok(wait_for_tag(HERE, 1) == 1, "every pool was destroyed");
+
+  /* the first run destroyed nothing before it was done, the second finds the allocators it left */
+  switch_core_memory_pool_stats(&before);
+  run_calls(pool, &rss_kb);
+  wait_for_tag(HERE, 1);
+  switch_core_memory_pool_stats(&stats);
+  ok(stats.reused > before.reused, "%" SWITCH_UINT64_T_FMT " of %" SWITCH_UINT64_T_FMT " pools started on a warm allocator",
+     stats.reused - before.reused, stats.created - before.created);
+
+  switch_core_memory_reclaim();
+  switch_core_memory_pool_stats(&stats);
+  ok(stats.idle == 0 && stats.trimmed > before.trimmed, "reclaim hands the idle allocators back to malloc");
+#else
+  switch_core_memory_pool_set_cache(0);
+  cold = run_calls(pool, &cold_rss);
+  wait_for_tag(HERE, 1);
+  ok(cold > 0, "no allocator cache: %.0f pools per second, %ldkB rss growth", cold, cold_rss);
+
+  switch_core_memory_pool_set_cache(512);
+  rate = run_calls(pool, &rss_kb);
+  switch_core_memory_pool_stats(&stats);
+  ok(rate > 0, "allocator cache: %.0f pools per second, %ldkB rss growth", rate, rss_kb);
+
+  note("%d threads x %d pools of %d allocations: %.0f pools/s fresh allocators, %.0f pools/s warm (%" SWITCH_UINT64_T_FMT " reused), rss %ldkB vs %ldkB\n",
+       THREADS, POOLS, ALLOCS, cold, rate, stats.reused, cold_rss, rss_kb);
+#endif
+
+  switch_core_destroy_memory_pool(&pool);
+  switch_core_destroy();
+
+  done_testing();
+}
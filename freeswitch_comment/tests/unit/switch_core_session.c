@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+#include <sys/resource.h>
+
+// #define BENCHMARK 1
+
+#ifdef BENCHMARK
+#define CALLS 2000
+#define ROUNDS 250
+#else
+#define CALLS 50
+#define ROUNDS 10
+#endif
+
+#define WORKERS 4
+
+static switch_io_routines_t test_io_routines = { 0 };
+static switch_state_handler_table_t test_state_handlers = { 0 };
+static switch_endpoint_interface_t *test_endpoint;
+
+typedef struct {
+  int settled;
+  int threads;              /* threads added while the calls were up */
+  long rss_kb;
+  long vsz_kb;
+  double csw_per_sec;
+  int gone;
+} load_result_t;
+
+/* Threads, VmRSS and VmSize from /proc/self/status, sizes in kB */
+static void proc_status(int *threads, long *rss, long *vsz)
+{
+  char line[256];
+  FILE *fp = fopen("/proc/self/status", "r");
+
+  *threads = 0;
+  *rss = *vsz = 0;
+
+  if (!fp) {
+    return;
+  }
+
+  while (fgets(line, sizeof(line), fp)) {
+    sscanf(line, "Threads: %d", threads);
+    sscanf(line, "VmRSS: %ld", rss);
+    sscanf(line, "VmSize: %ld", vsz);
+  }
+
+  fclose(fp);
+}
+
+static switch_core_session_t *new_leg(int x)
+{
+  switch_core_session_t *session;
+  switch_channel_t *channel;
+  char name[64];
+
+  if (!(session = switch_core_session_request(test_endpoint, SWITCH_CALL_DIRECTION_OUTBOUND, SOF_NO_LIMITS, NULL))) {
+    return NULL;
+  }
+
+  channel = switch_core_session_get_channel(session);
+  switch_snprintf(name, sizeof(name), "test/leg%d", x);
+  switch_channel_set_name(channel, name);
+  switch_channel_set_caller_profile(channel, switch_caller_profile_new(switch_core_session_get_pool(session), "test", "XML", name, name, NULL,
+                                                                       NULL, NULL, NULL, "test", "default", name));
+
+  return session;
+}
+
+static int all_asleep(switch_core_session_t **legs, int count)
+{
+  int x;
+
+  for ( x = 0; x < count; x++) {
+    switch_channel_t *channel = switch_core_session_get_channel(legs[x]);
+
+    if (switch_channel_get_running_state(channel) != CS_HIBERNATE || !switch_channel_test_flag(channel, CF_THREAD_SLEEPING)) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/* wait for the session thread pool to let go of the threads a previous run left idle */
+static void settle_threads(int baseline)
+{
+  int threads, x;
+  long rss, vsz;
+
+  for ( x = 0; x < 100; x++) {
+    proc_status(&threads, &rss, &vsz);
+    if (threads <= baseline) {
+      break;
+    }
+    switch_yield(100000);
+  }
+}
+
+/*
+   calls bridged the way a bypass or proxy media bridge does it, both legs hibernate until something
+   happens to them. Every round wakes every leg as a message or an event would.
+ */
+static void run_load(int calls, int rounds, load_result_t *r)
+{
+  switch_core_session_t **legs = calloc(calls * 2, sizeof(*legs));
+  int threads0, threads1, x, y;
+  long rss0, rss1, vsz0, vsz1;
+  struct rusage u0, u1;
+  switch_time_t start, usec;
+
+  memset(r, 0, sizeof(*r));
+  proc_status(&threads0, &rss0, &vsz0);
+
+  for ( x = 0; x < calls; x++) {
+    legs[x * 2] = new_leg(x * 2);
+    legs[x * 2 + 1] = new_leg(x * 2 + 1);
+    switch_ivr_signal_bridge(legs[x * 2], legs[x * 2 + 1]);
+    switch_core_session_thread_launch(legs[x * 2]);
+    switch_core_session_thread_launch(legs[x * 2 + 1]);
+  }
+
+  for ( x = 0; x < 500 && !(r->settled = all_asleep(legs, calls * 2)); x++) {
+    switch_yield(10000);
+  }
+
+  proc_status(&threads1, &rss1, &vsz1);
+  r->threads = threads1 - threads0;
+  r->rss_kb = rss1 - rss0;
+  r->vsz_kb = vsz1 - vsz0;
+
+  getrusage(RUSAGE_SELF, &u0);
+  start = switch_time_now();
+
+  for ( y = 0; y < rounds; y++) {
+    for ( x = 0; x < calls * 2; x++) {
+      switch_core_session_wake_session_thread(legs[x]);
+    }
+    switch_yield(20000);
+  }
+
+  usec = switch_time_now() - start;
+  getrusage(RUSAGE_SELF, &u1);
+  r->csw_per_sec = ((u1.ru_nvcsw + u1.ru_nivcsw) - (u0.ru_nvcsw + u0.ru_nivcsw)) * 1000000.0 / (usec ? usec : 1);
+
+  /* the signal bridge takes the b leg down with the a leg */
+  for ( x = 0; x < calls; x++) {
+    switch_channel_hangup(switch_core_session_get_channel(legs[x * 2]), SWITCH_CAUSE_NORMAL_CLEARING);
+  }
+
+  for ( x = 0; x < 1000 && switch_core_session_count(); x++) {
+    switch_yield(10000);
+  }
+
+  r->gone = !switch_core_session_count();
+
+  free(legs);
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  switch_memory_pool_t *pool = NULL;
+  switch_loadable_module_interface_t *module_interface;
+  switch_core_session_scheduler_stats_t stats;
+  load_result_t classic, sched;
+  int baseline, pause = 0;
+  long rss, vsz;
+
+  plan(1 + 8);
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_session_ctl(SCSC_PAUSE_ALL, &pause);
+  switch_core_new_memory_pool(&pool);
+  module_interface = switch_loadable_module_create_module_interface(pool, "test_endpoint");
+  test_endpoint = switch_loadable_module_create_interface(module_interface, SWITCH_ENDPOINT_INTERFACE);
+  test_endpoint->interface_name = "test";
+  test_endpoint->io_routines = &test_io_routines;
+  test_endpoint->state_handler = &test_state_handlers;
+
+  proc_status(&baseline, &rss, &vsz);
+
+  run_load(CALLS, ROUNDS, &classic);
+  ok(classic.settled && classic.gone, "thread per session: %d calls bridged, woken %d times and hung up", CALLS, ROUNDS);
+  settle_threads(baseline);
+
+  ok(switch_core_session_set_scheduler_threads(WORKERS) == WORKERS, "session scheduler started with %d workers", WORKERS);
+
+  run_load(CALLS, ROUNDS, &sched);
+  switch_core_session_scheduler_stats(&stats);
+  ok(sched.settled, "session scheduler: every leg went to sleep");
+  ok(sched.threads < CALLS * 2, "session scheduler: %d legs asleep on %d threads", CALLS * 2, sched.threads);
+  /* a wake that lands while the leg is still on a worker has nothing to resume */
+  ok(stats.resumes >= (uint64_t) CALLS * ROUNDS, "session scheduler: %" SWITCH_UINT64_T_FMT " of %d wakes resumed a parked leg", stats.resumes, CALLS * 2 * ROUNDS);
+  ok(stats.slices >= stats.resumes, "session scheduler: %" SWITCH_UINT64_T_FMT " slices on the workers, %" SWITCH_UINT64_T_FMT " stolen",
+     stats.slices, stats.steals);
+  ok(sched.gone, "session scheduler: every leg hung up and destroyed (%" SWITCH_UINT64_T_FMT " handoffs to a dedicated thread)", stats.handoffs);
+  ok(stats.parked == 0, "session scheduler: nothing left parked");
+
+#ifdef BENCHMARK
+  note("thread per session: %d legs, %d threads, %ldkB rss %ldkB vsz per call, %.0f context switches per second\n",
+       CALLS * 2, classic.threads, classic.rss_kb / CALLS, classic.vsz_kb / CALLS, classic.csw_per_sec);
+  note("session scheduler:  %d legs, %d threads, %ldkB rss %ldkB vsz per call, %.0f context switches per second\n",
+       CALLS * 2, sched.threads, sched.rss_kb / CALLS, sched.vsz_kb / CALLS, sched.csw_per_sec);
+#endif
+
+  switch_core_destroy_memory_pool(&pool);
+  switch_core_destroy();
+
+  done_testing();
+}
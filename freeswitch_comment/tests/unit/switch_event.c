@@ -15,13 +15,15 @@ int main () {
   unsigned long long micro_total = 0;
   double micro_per = 0;
   double rate_per_sec = 0;
+  int sizes[] = { 10, 100, 300 };
+  int size_count = sizeof(sizes) / sizeof(sizes[0]);
 
 #ifdef BENCHMARK
   switch_time_t small_start_ts, small_end_ts;
 
   plan(2);
 #else
-  plan(2 + ( 2 * loops));
+  plan(7 + ( 3 * loops) + (2 * size_count));
 #endif
 
   status = switch_core_init(SCF_MINIMAL, verbose, &err);
@@ -84,7 +86,189 @@ int main () {
 #endif
 
 
+  /* events carrying a Unique-ID are sharded onto a dispatch queue by that id */
+#ifndef BENCHMARK
+  for ( x = 0; x < loops; x++) {
+    switch_event_t *fire_event = NULL;
+
+    switch_event_create(&fire_event, SWITCH_EVENT_CHANNEL_STATE);
+    switch_event_add_header_string(fire_event, SWITCH_STACK_BOTTOM, "Unique-ID", index[x]);
+    status = switch_event_fire(&fire_event);
+    ok( status == SWITCH_STATUS_SUCCESS && !fire_event, "Fire event");
+  }
+#else
+  small_start_ts = switch_time_now();
+  for ( x = 0; x < loops; x++) {
+    switch_event_t *fire_event = NULL;
+
+    switch_event_create(&fire_event, SWITCH_EVENT_CHANNEL_STATE);
+    switch_event_add_header_string(fire_event, SWITCH_STACK_BOTTOM, "Unique-ID", index[x]);
+    if ( switch_event_fire(&fire_event) != SWITCH_STATUS_SUCCESS) {
+      fail("Failed to fire event");
+    }
+  }
+  small_end_ts = switch_time_now();
+
+  micro_total = small_end_ts - small_start_ts;
+  micro_per = micro_total / (double) loops;
+  rate_per_sec = 1000000 / micro_per;
+  note("switch_event fire: Total %ldus / %ld loops, %.2f us per loop, %.0f loops per second\n", 
+       micro_total, loops, micro_per, rate_per_sec);
+#endif
+
   switch_event_destroy(&event);
+  /* header lookups at sizes on both sides of the point where the event gets a header index */
+  for ( x = 0; x < size_count; x++) {
+    switch_event_t *big_event = NULL;
+    char name[32];
+    int y, misses = 0;
+
+    switch_event_create(&big_event, SWITCH_EVENT_CLONE);
+    for ( y = 0; y < sizes[x]; y++) {
+      switch_snprintf(name, sizeof(name), "variable_test_%d", y);
+      switch_event_add_header_string(big_event, SWITCH_STACK_BOTTOM, name, name);
+    }
+
+#ifndef BENCHMARK
+    for ( y = 0; y < sizes[x]; y++) {
+      switch_snprintf(name, sizeof(name), "VARIABLE_TEST_%d", y);
+      if ( !switch_event_get_header(big_event, name)) {
+        misses++;
+      }
+    }
+    ok( misses == 0, "All %d headers found", sizes[x]);
+
+    switch_event_del_header(big_event, "variable_test_0");
+    switch_snprintf(name, sizeof(name), "variable_test_%d", sizes[x] - 1);
+    ok( !switch_event_get_header(big_event, "variable_test_0") && switch_event_get_header(big_event, name), "Delete header with %d headers", sizes[x]);
+#else
+    small_start_ts = switch_time_now();
+    for ( y = 0; y < loops * 100; y++) {
+      switch_snprintf(name, sizeof(name), "variable_test_%d", y % sizes[x]);
+      if ( !switch_event_get_header(big_event, name)) {
+        misses++;
+      }
+    }
+    small_end_ts = switch_time_now();
+
+    micro_total = small_end_ts - small_start_ts;
+    micro_per = micro_total / (double) (loops * 100);
+    rate_per_sec = 1000000 / micro_per;
+    note("switch_event get_header with %d headers: Total %ldus / %ld loops, %.2f us per loop, %.0f loops per second\n", 
+         sizes[x], micro_total, loops * 100, micro_per, rate_per_sec);
+#endif
+
+    switch_event_destroy(&big_event);
+  }
+#ifndef BENCHMARK
+  /* a dup shares the header strings of its source, it has to survive the source going away */
+  {
+    switch_event_t *src_event = NULL, *dup_event = NULL;
+
+    switch_event_create(&src_event, SWITCH_EVENT_CHANNEL_STATE);
+    switch_event_add_header_string(src_event, SWITCH_STACK_BOTTOM, "Unique-ID", "dup-test");
+    switch_event_dup(&dup_event, src_event);
+    switch_event_destroy(&src_event);
+    is(switch_event_get_header(dup_event, "Unique-ID"), "dup-test", "dup outlives its source");
+    switch_event_destroy(&dup_event);
+  }
+
+  /* values replaced over and over stop filling the arena, pushing onto an arena value moves it to the array */
+  {
+    switch_event_t *arena_event = NULL;
+    char value[64];
+    int y;
+
+    switch_event_create(&arena_event, SWITCH_EVENT_CHANNEL_STATE);
+    for ( y = 0; y < 10000; y++) {
+      switch_snprintf(value, sizeof(value), "replaced value number %d", y);
+      switch_event_del_header(arena_event, "Replaced");
+      switch_event_add_header_string(arena_event, SWITCH_STACK_BOTTOM, "Replaced", value);
+    }
+    is(switch_event_get_header(arena_event, "Replaced"), value, "last of %d replaced values kept", y);
+
+    switch_event_add_header_string(arena_event, SWITCH_STACK_PUSH, "Replaced", "pushed");
+    ok( !strncmp(switch_str_nil(switch_event_get_header(arena_event, "Replaced")), "ARRAY::", 7), "push onto an arena value makes an array");
+    switch_event_destroy(&arena_event);
+  }
+#endif
+
+  /* event socket wire formats, binary is length prefixed so it has to match the event byte for byte */
+  {
+    switch_event_t *wire_event = NULL;
+    char name[32], *buf = NULL;
+    switch_size_t len = 0;
+    int y;
+
+    switch_event_create(&wire_event, SWITCH_EVENT_CHANNEL_STATE);
+    switch_event_add_header_string(wire_event, SWITCH_STACK_BOTTOM, "Unique-ID", "wire-test");
+    for ( y = 0; y < 100; y++) {
+      switch_snprintf(name, sizeof(name), "variable_test_%d", y);
+      switch_event_add_header_string(wire_event, SWITCH_STACK_BOTTOM, name, name);
+    }
+    switch_event_set_body(wire_event, "wire body");
+
+#ifndef BENCHMARK
+    {
+      switch_event_header_t *hp;
+      switch_size_t expect = 8;
+      uint32_t count = 0, sent;
+
+      for (hp = wire_event->headers; hp; hp = hp->next) {
+        expect += 10 + strlen(hp->name) + strlen(hp->value);
+        count++;
+      }
+      expect += strlen(wire_event->body) + 1;
+
+      status = switch_event_serialize_binary(wire_event, &buf, &len);
+      sent = ((uint8_t) buf[0] << 24) | ((uint8_t) buf[1] << 16) | ((uint8_t) buf[2] << 8) | (uint8_t) buf[3];
+      ok( status == SWITCH_STATUS_SUCCESS && len == expect, "Binary event is %d bytes", (int) len);
+      ok( sent == count && !strcmp(buf + len - 10, "wire body"), "Binary event carries %d headers and the body", (int) count);
+      switch_safe_free(buf);
+    }
+#else
+    small_start_ts = switch_time_now();
+    for ( y = 0; y < loops * 100; y++) {
+      switch_event_serialize(wire_event, &buf, SWITCH_TRUE);
+      switch_safe_free(buf);
+    }
+    small_end_ts = switch_time_now();
+
+    micro_total = small_end_ts - small_start_ts;
+    micro_per = micro_total / (double) (loops * 100);
+    rate_per_sec = 1000000 / micro_per;
+    note("switch_event serialize plain: Total %ldus / %ld loops, %.2f us per loop, %.0f loops per second\n", 
+         micro_total, loops * 100, micro_per, rate_per_sec);
+
+    small_start_ts = switch_time_now();
+    for ( y = 0; y < loops * 100; y++) {
+      switch_event_serialize_json(wire_event, &buf);
+      switch_safe_free(buf);
+    }
+    small_end_ts = switch_time_now();
+
+    micro_total = small_end_ts - small_start_ts;
+    micro_per = micro_total / (double) (loops * 100);
+    rate_per_sec = 1000000 / micro_per;
+    note("switch_event serialize json: Total %ldus / %ld loops, %.2f us per loop, %.0f loops per second\n", 
+         micro_total, loops * 100, micro_per, rate_per_sec);
+
+    small_start_ts = switch_time_now();
+    for ( y = 0; y < loops * 100; y++) {
+      switch_event_serialize_binary(wire_event, &buf, &len);
+      switch_safe_free(buf);
+    }
+    small_end_ts = switch_time_now();
+
+    micro_total = small_end_ts - small_start_ts;
+    micro_per = micro_total / (double) (loops * 100);
+    rate_per_sec = 1000000 / micro_per;
+    note("switch_event serialize binary: Total %ldus / %ld loops, %.2f us per loop, %.0f loops per second\n", 
+         micro_total, loops * 100, micro_per, rate_per_sec);
+#endif
+
+    switch_event_destroy(&wire_event);
+  }
   /* END LOOPS */
   
   end_ts = switch_time_now();
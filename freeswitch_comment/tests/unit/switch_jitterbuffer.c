@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <switch.h>
+#include <switch_jitterbuffer.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+/* A trace stands in for a capture: frames of packets with the loss and reorder of a bad link */
+typedef struct {
+  const char *name;
+  switch_jb_type_t type;
+  uint16_t first_seq;
+  int frames;
+  int max_packets;   /* packets per frame are 1..max_packets */
+  int loss;          /* per mille */
+  int reorder;       /* per mille, swap with the next packet */
+} trace_t;
+
+typedef struct {
+  uint16_t seq;
+  uint32_t ts;
+  int m;
+} trace_pkt_t;
+
+typedef struct {
+  int put;
+  int got;
+  int out_of_order;
+  int bad_payload;
+  int nacks;
+  int false_nacks;
+  switch_time_t usec;
+} replay_stats_t;
+
+static uint32_t rnd_state;
+
+static uint32_t rnd(void)
+{
+  rnd_state = rnd_state * 1103515245 + 12345;
+  return (rnd_state >> 8) & 0xffff;
+}
+
+static int build_trace(const trace_t *t, trace_pkt_t **pktsp, uint8_t *lost)
+{
+  trace_pkt_t *all, *pkts, tmp;
+  uint16_t seq = t->first_seq;
+  uint32_t ts = 1000;
+  int n = 0, o = 0, f, i;
+
+  rnd_state = 42;
+  all = calloc(t->frames * t->max_packets, sizeof(*all));
+  pkts = calloc(t->frames * t->max_packets, sizeof(*pkts));
+
+  for ( f = 0; f < t->frames; f++) {
+    int k = 1 + rnd() % t->max_packets;
+
+    for ( i = 0; i < k; i++) {
+      all[n].seq = seq++;
+      all[n].ts = ts;
+      all[n].m = (i == k - 1);
+      n++;
+    }
+    ts += t->type == SJB_VIDEO ? 3000 : 160;
+  }
+
+  for ( i = 0; i + 1 < n; i++) {
+    if ((int)(rnd() % 1000) < t->reorder) {
+      tmp = all[i]; all[i] = all[i + 1]; all[i + 1] = tmp;
+    }
+  }
+
+  for ( i = 0; i < n; i++) {
+    if ((int)(rnd() % 1000) < t->loss) {
+      if (lost) lost[all[i].seq] = 1;
+      continue;
+    }
+    pkts[o++] = all[i];
+  }
+
+  free(all);
+  *pktsp = pkts;
+
+  return o;
+}
+
+static void replay(const trace_t *t, switch_jb_flag_t flags, replay_stats_t *stats)
+{
+  switch_jb_t *jb = NULL;
+  switch_rtp_packet_t packet, out;
+  switch_size_t len;
+  trace_pkt_t *pkts = NULL;
+  uint8_t *lost = calloc(65536, 1);
+  int n, i, have_last = 0;
+  uint16_t last = 0;
+  switch_time_t start;
+
+  memset(stats, 0, sizeof(*stats));
+  n = build_trace(t, &pkts, lost);
+
+  switch_jb_create(&jb, t->type, t->type == SJB_VIDEO ? 1 : 3, t->type == SJB_VIDEO ? 30 : 10, NULL);
+  if (flags) switch_jb_set_flag(jb, flags);
+
+  memset(&packet, 0, sizeof(packet));
+  packet.header.version = 2;
+
+  start = switch_time_now();
+
+  for ( i = 0; i < n; i++) {
+    packet.header.seq = htons(pkts[i].seq);
+    packet.header.ts = htonl(pkts[i].ts);
+    packet.header.m = pkts[i].m;
+    memset(packet.body, pkts[i].seq & 0xff, 160);
+    switch_jb_put_packet(jb, &packet, 12 + 160);
+    stats->put++;
+
+    if (flags & SJB_QUEUE_ONLY) {
+      continue;
+    }
+
+    if (t->type == SJB_VIDEO) {
+      uint32_t nack;
+
+      while ((nack = switch_jb_pop_nack(jb))) {
+        uint16_t seq = ntohs((uint16_t) nack), blp = ntohs((uint16_t) (nack >> 16));
+        int b;
+
+        stats->nacks++;
+        if (!lost[seq]) stats->false_nacks++;
+
+        for ( b = 0; b < 16; b++) {
+          if ((blp & (1 << b)) && !lost[(uint16_t)(seq + b + 1)]) stats->false_nacks++;
+        }
+      }
+    }
+
+    do {
+      len = sizeof(out);
+      if (switch_jb_get_packet(jb, &out, &len) != SWITCH_STATUS_SUCCESS) {
+        break;
+      }
+
+      stats->got++;
+
+      if (have_last && (int16_t)(ntohs(out.header.seq) - last) <= 0) {
+        stats->out_of_order++;
+      }
+
+      if (len != 12 + 160 || (uint8_t) out.body[0] != (ntohs(out.header.seq) & 0xff)) {
+        stats->bad_payload++;
+      }
+
+      last = ntohs(out.header.seq);
+      have_last = 1;
+    } while (t->type == SJB_VIDEO);
+  }
+
+  stats->usec = switch_time_now() - start;
+
+  if (flags & SJB_QUEUE_ONLY) {
+    /* a send side buffer answers retransmit requests for what it still holds */
+    for ( i = n - 1; i >= 0 && i >= n - 16; i--) {
+      if (switch_jb_get_packet_by_seq(jb, htons(pkts[i].seq), &out, &len) == SWITCH_STATUS_SUCCESS) {
+        stats->got++;
+      }
+    }
+    if (switch_jb_get_packet_by_seq(jb, htons(pkts[0].seq), &out, &len) == SWITCH_STATUS_SUCCESS) {
+      stats->out_of_order++;
+    }
+  }
+
+  switch_jb_destroy(&jb);
+  free(pkts);
+  free(lost);
+}
+
+#ifndef BENCHMARK
+static void put_at(switch_jb_t *jb, uint16_t seq, uint32_t ts)
+{
+  switch_rtp_packet_t packet;
+
+  memset(&packet, 0, sizeof(packet));
+  packet.header.version = 2;
+  packet.header.seq = htons(seq);
+  packet.header.ts = htonl(ts);
+  memset(packet.body, seq & 0xff, 160);
+  switch_jb_put_packet(jb, &packet, 12 + 160);
+}
+
+/* audio arriving in bursts of 4 every 80ms, the playout delay estimate has to cover 3 frames of spread */
+static void stretch_checks(void)
+{
+  switch_jb_t *jb = NULL;
+  switch_rtp_packet_t out;
+  switch_size_t len;
+  int i;
+
+  switch_jb_create(&jb, SJB_AUDIO, 1, 50, NULL);
+  switch_jb_stretch_mode(jb, 160, 8000);
+
+  for ( i = 0; i < 32; i++) {
+    put_at(jb, 100 + i, 1000 + i * 160);
+    if (i % 4 == 3) switch_yield(80000);
+  }
+
+  ok(switch_jb_stretch_advice(jb) == 1, "stretch: a full buffer asks to accelerate");
+
+  len = sizeof(out);
+  switch_jb_get_packet(jb, &out, &len);
+  switch_jb_stretch_hold(jb);
+  len = sizeof(out);
+  ok(switch_jb_get_packet(jb, &out, &len) == SWITCH_STATUS_NOTFOUND, "stretch: a held slot reads as plc");
+  len = sizeof(out);
+  ok(switch_jb_get_packet(jb, &out, &len) == SWITCH_STATUS_SUCCESS && ntohs(out.header.seq) == 101, "stretch: the hold did not consume a packet");
+  len = sizeof(out);
+  ok(switch_jb_stretch_pull(jb, 8, &out, &len) != SWITCH_STATUS_SUCCESS, "stretch: pull leaves other payload types alone");
+  len = sizeof(out);
+  ok(switch_jb_stretch_pull(jb, 0, &out, &len) == SWITCH_STATUS_SUCCESS && ntohs(out.header.seq) == 102, "stretch: pull takes the next packet early");
+
+  do {
+    len = sizeof(out);
+  } while (switch_jb_get_packet(jb, &out, &len) == SWITCH_STATUS_SUCCESS);
+
+  ok(switch_jb_stretch_advice(jb) == -1, "stretch: a drained buffer asks to decelerate");
+
+  switch_jb_destroy(&jb);
+}
+
+/* with SJB_MEDIA_TRACE every packet carries the tick of its put out of the buffer, for the media trace residence stage */
+static void media_trace_checks(void)
+{
+  switch_jb_t *jb = NULL;
+  switch_rtp_packet_t out;
+  switch_size_t len;
+  uint64_t t0, t1, put1, put2;
+
+  switch_jb_create(&jb, SJB_AUDIO, 1, 50, NULL);
+
+  put_at(jb, 200, 1000);
+  switch_jb_set_flag(jb, SJB_MEDIA_TRACE);
+  t0 = switch_core_media_trace_tick();
+  put_at(jb, 201, 1160);
+  switch_yield(10000);
+  put_at(jb, 202, 1320);
+  t1 = switch_core_media_trace_tick();
+  switch_jb_clear_flag(jb, SJB_MEDIA_TRACE);
+  put_at(jb, 203, 1480);
+
+  len = sizeof(out);
+  ok(switch_jb_get_packet(jb, &out, &len) == SWITCH_STATUS_SUCCESS && !switch_jb_get_last_read_tick(jb), "media trace: a packet put before the flag has no tick");
+  len = sizeof(out);
+  switch_jb_get_packet(jb, &out, &len);
+  put1 = switch_jb_get_last_read_tick(jb);
+  len = sizeof(out);
+  switch_jb_get_packet(jb, &out, &len);
+  put2 = switch_jb_get_last_read_tick(jb);
+  ok(put1 >= t0 && put2 > put1 && put2 <= t1, "media trace: each packet reads back the tick of its own put");
+  len = sizeof(out);
+  ok(switch_jb_get_packet(jb, &out, &len) == SWITCH_STATUS_SUCCESS && !switch_jb_get_last_read_tick(jb), "media trace: clearing the flag stops the stamps");
+
+  switch_jb_destroy(&jb);
+}
+#endif
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  replay_stats_t stats;
+
+#ifndef BENCHMARK
+  trace_t video_clean = { "video clean", SJB_VIDEO, 100, 300, 12, 0, 0 };
+  trace_t video_wrap = { "video seq wrap", SJB_VIDEO, 65000, 300, 12, 0, 0 };
+  trace_t video_loss = { "video 2% loss", SJB_VIDEO, 100, 300, 12, 20, 0 };
+  trace_t video_reorder = { "video 5% reorder", SJB_VIDEO, 100, 300, 12, 0, 50 };
+  trace_t audio_mixed = { "audio loss and reorder", SJB_AUDIO, 100, 3000, 1, 30, 80 };
+  trace_t vbw = { "video send buffer", SJB_VIDEO, 100, 300, 12, 0, 0 };
+
+  plan(23);
+#else
+  trace_t traces[] = {
+    { "video clean", SJB_VIDEO, 100, 20000, 40, 0, 0 },
+    { "video 1% loss", SJB_VIDEO, 100, 20000, 40, 10, 0 },
+    { "video 5% reorder", SJB_VIDEO, 100, 20000, 40, 0, 50 },
+    { "video 2% loss 3% reorder", SJB_VIDEO, 100, 20000, 40, 20, 30 },
+    { "audio 3% loss 8% reorder", SJB_AUDIO, 100, 200000, 1, 30, 80 },
+    { NULL }
+  };
+  int x = 0;
+
+  plan(1 + 5);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+#ifndef BENCHMARK
+  replay(&video_clean, 0, &stats);
+  ok(stats.got >= stats.put - video_clean.max_packets, "%s: read back all but the buffered frame (%d/%d)", video_clean.name, stats.got, stats.put);
+  ok(!stats.out_of_order && !stats.bad_payload, "%s: in seq order with intact payloads", video_clean.name);
+
+  replay(&video_wrap, 0, &stats);
+  ok(stats.got >= stats.put - video_wrap.max_packets, "%s: read back all but the buffered frame (%d/%d)", video_wrap.name, stats.got, stats.put);
+  ok(!stats.out_of_order && !stats.bad_payload, "%s: in seq order with intact payloads", video_wrap.name);
+
+  replay(&video_loss, 0, &stats);
+  ok(stats.nacks > 0, "%s: nacked the gaps (%d nacks)", video_loss.name, stats.nacks);
+  ok(!stats.false_nacks, "%s: only nacked seqs that were lost", video_loss.name);
+  ok(!stats.out_of_order && !stats.bad_payload, "%s: in seq order with intact payloads", video_loss.name);
+
+  replay(&video_reorder, 0, &stats);
+  ok(stats.got > stats.put * 9 / 10, "%s: read back most packets (%d/%d)", video_reorder.name, stats.got, stats.put);
+  ok(!stats.out_of_order && !stats.bad_payload, "%s: reordering is undone", video_reorder.name);
+
+  replay(&audio_mixed, 0, &stats);
+  ok(stats.got > stats.put / 2, "%s: read back packets (%d/%d)", audio_mixed.name, stats.got, stats.put);
+  ok(!stats.out_of_order && !stats.bad_payload, "%s: in seq order with intact payloads", audio_mixed.name);
+
+  replay(&vbw, SJB_QUEUE_ONLY, &stats);
+  ok(stats.got == 16, "%s: the newest packets can be retransmitted", vbw.name);
+  ok(!stats.out_of_order, "%s: the oldest frames were dropped", vbw.name);
+
+  stretch_checks();
+  media_trace_checks();
+#else
+  for ( x = 0; traces[x].name; x++) {
+    replay(&traces[x], 0, &stats);
+    note("switch_jb %s: %d packets put %d read %d nacks in %ldus, %.0f packets per second\n",
+         traces[x].name, stats.put, stats.got, stats.nacks, (long) stats.usec,
+         stats.put * 1000000.0 / (stats.usec ? stats.usec : 1));
+    ok(stats.got > 0 && !stats.bad_payload, "%s: replayed", traces[x].name);
+  }
+#endif
+
+  switch_core_destroy();
+
+  done_testing();
+}
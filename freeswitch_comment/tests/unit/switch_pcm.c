@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <switch.h>
+#include <g711.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+#define FRAME 160
+
+/* every set has to match the per sample routines for every input, at any length and alignment */
+static int check_set(const g711_kernels_t *k)
+{
+  static int16_t lin[65536 + 1], lout[65536 + 1];
+  static uint8_t law[65536 + 1];
+  uint8_t codes[256 + 1];
+  int i, off, n, bad = 0;
+
+  for ( i = 0; i < 65536; i++) {
+    lin[i + 1] = (int16_t) (i - 32768);
+  }
+
+  for ( off = 0; off < 2; off++) {
+    n = 65536 - off;
+
+    k->linear_to_ulaw(law, lin + 1 + off, n);
+    for ( i = 0; i < n; i++) {
+      if (law[i] != linear_to_ulaw(lin[1 + off + i])) bad++;
+    }
+
+    k->linear_to_alaw(law, lin + 1 + off, n);
+    for ( i = 0; i < n; i++) {
+      if (law[i] != linear_to_alaw(lin[1 + off + i])) bad++;
+    }
+  }
+
+  for ( i = 0; i < 256; i++) {
+    codes[i + 1] = (uint8_t) i;
+  }
+
+  k->ulaw_to_linear(lout, codes + 1, 256);
+  for ( i = 0; i < 256; i++) {
+    if (lout[i] != ulaw_to_linear((uint8_t) i)) bad++;
+  }
+
+  k->alaw_to_linear(lout, codes + 1, 255);
+  for ( i = 0; i < 255; i++) {
+    if (lout[i] != alaw_to_linear((uint8_t) i)) bad++;
+  }
+
+  /* in place, the way switch_swap_linear uses it */
+  memcpy(lout, lin, sizeof(lout));
+  k->l16_swap(lout + 1, lout + 1, 65535);
+  for ( i = 1; i < 65536; i++) {
+    if ((uint16_t) lout[i] != (uint16_t) (((uint16_t) lin[i] >> 8) | ((uint16_t) lin[i] << 8))) bad++;
+  }
+
+  return bad;
+}
+
+#ifdef BENCHMARK
+static double ns_per_frame(const g711_kernels_t *k, int op, int loops)
+{
+  int16_t lin[FRAME], lout[FRAME];
+  uint8_t law[FRAME];
+  switch_time_t start;
+  int i;
+
+  for ( i = 0; i < FRAME; i++) {
+    lin[i] = (int16_t) (i * 397 - 30000);
+  }
+  k->linear_to_ulaw(law, lin, FRAME);
+
+  start = switch_time_now();
+  for ( i = 0; i < loops; i++) {
+    switch (op) {
+    case 0: k->linear_to_ulaw(law, lin, FRAME); break;
+    case 1: k->ulaw_to_linear(lout, law, FRAME); break;
+    case 2: k->linear_to_alaw(law, lin, FRAME); break;
+    case 3: k->alaw_to_linear(lout, law, FRAME); break;
+    default: k->l16_swap(lin, lin, FRAME); break;
+    }
+  }
+
+  return (switch_time_now() - start) * 1000.0 / loops;
+}
+#endif
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  const g711_kernels_t *k;
+  int x = 0, sets = 0;
+
+#ifdef BENCHMARK
+  const char *ops[] = { "linear_to_ulaw", "ulaw_to_linear", "linear_to_alaw", "alaw_to_linear", "l16_swap" };
+  int op;
+#endif
+
+  for ( sets = 0; g711_kernels(sets); sets++);
+
+  plan(1 + 1 + sets);
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  ok(sets >= 2 && !strcmp(g711_kernels(sets - 1)->name, "c"), "g711: %d routine sets, plain C last", sets);
+
+  for ( x = 0; (k = g711_kernels(x)); x++) {
+#ifndef BENCHMARK
+    ok(!check_set(k), "g711 %s: bit exact with the per sample routines", k->name);
+#else
+    for ( op = 0; op < 5; op++) {
+      note("g711 %s %s: %.1f ns per %d sample frame\n", k->name, ops[op], ns_per_frame(k, op, 2000000), FRAME);
+    }
+    ok(1, "g711 %s: timed", k->name);
+#endif
+  }
+
+  switch_core_destroy();
+
+  done_testing();
+}
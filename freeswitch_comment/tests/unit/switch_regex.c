@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <switch.h>
+#include <pcre.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+#define PATTERNS 2000
+
+/* a dialplan's worth of conditions, one of which matches the number dialed */
+static int run_dialplan(const char *number, int loops)
+{
+  char pattern[64];
+  int x, y, matched = 0;
+
+  for ( y = 0; y < loops; y++) {
+    for ( x = 0; x < PATTERNS; x++) {
+      switch_snprintf(pattern, sizeof(pattern), "^(%d)(\\d{4})$", 1000 + x);
+      if (switch_regex_match(number, pattern) == SWITCH_STATUS_SUCCESS) {
+        matched++;
+      }
+    }
+  }
+
+  return matched;
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  switch_regex_cache_stats_t stats;
+
+#ifndef BENCHMARK
+  switch_regex_t *re = NULL;
+  int ovector[30], proceed, partial = 1, captures = 0;
+  char substituted[128] = "";
+  uint64_t hits;
+
+  plan(1 + 9);
+#else
+  switch_time_t start;
+  int matched;
+
+  plan(1 + 2);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+#ifndef BENCHMARK
+  proceed = switch_regex_perform("5551234", "^(555)(\\d+)$", &re, ovector, sizeof(ovector) / sizeof(ovector[0]));
+  switch_regex_cache_stats(&stats);
+  hits = stats.hits;
+
+  /* a flush leaves the handle we hold alone */
+  switch_regex_cache_flush();
+  switch_perform_substitution(re, proceed, "$2-$1", "5551234", substituted, sizeof(substituted), ovector);
+  ok(proceed == 3 && !strcmp(substituted, "1234-555"), "regex: captures survive a flush (%s)", substituted);
+
+  /* the handle is the compiled pcre itself, existing callers hand it to pcre_* */
+  ok(!pcre_fullinfo((pcre *) re, NULL, PCRE_INFO_CAPTURECOUNT, &captures) && captures == 2, "regex: handle is a pcre");
+  switch_regex_safe_free(re);
+
+  switch_regex_perform("5551234", "^(555)(\\d+)$", &re, ovector, sizeof(ovector) / sizeof(ovector[0]));
+  switch_regex_safe_free(re);
+  switch_regex_perform("5551234", "^(555)(\\d+)$", &re, ovector, sizeof(ovector) / sizeof(ovector[0]));
+  switch_regex_safe_free(re);
+  switch_regex_cache_stats(&stats);
+  ok(stats.hits == hits + 1 && stats.entries == 1 && !stats.in_use, "regex: the second use is a cache hit");
+
+  ok(!switch_regex_perform("5551234", "^(556)", &re, ovector, sizeof(ovector) / sizeof(ovector[0])) && !re, "regex: no match hands back nothing");
+  ok(switch_regex_match("ABC", "/^abc$/i") == SWITCH_STATUS_SUCCESS, "regex: /i flag");
+  ok(switch_regex_match("ABC", "^abc$") != SWITCH_STATUS_SUCCESS, "regex: same pattern without the flag is its own entry");
+  ok(switch_regex_match_partial("12", "^1234$", &partial) == SWITCH_STATUS_SUCCESS && partial, "regex: partial match");
+
+  switch_regex_match("x", "(");
+  switch_regex_cache_stats(&stats);
+  ok(stats.errors == 1, "regex: compile errors are counted");
+
+  switch_regex_cache_set_size(0);
+  switch_regex_match("5551234", "^555");
+  switch_regex_cache_stats(&stats);
+  ok(!stats.entries, "regex: size 0 turns the cache off");
+#else
+  switch_regex_cache_set_size(0);
+  start = switch_time_now();
+  matched = run_dialplan("10421234", 5);
+  note("switch_regex %d patterns uncached: %.1fus per pass\n", PATTERNS, (switch_time_now() - start) / 5.0);
+  ok(matched == 5, "uncached dialplan");
+
+  switch_regex_cache_set_size(4096);
+  run_dialplan("10421234", 1);
+  start = switch_time_now();
+  matched = run_dialplan("10421234", 50);
+  switch_regex_cache_stats(&stats);
+  note("switch_regex %d patterns cached (jit %s): %.1fus per pass, %" SWITCH_UINT64_T_FMT " hits %" SWITCH_UINT64_T_FMT " misses\n",
+       PATTERNS, stats.jit ? "on" : "off", (switch_time_now() - start) / 50.0, stats.hits, stats.misses);
+  ok(matched == 50, "cached dialplan");
+#endif
+
+  switch_core_destroy();
+
+  done_testing();
+}
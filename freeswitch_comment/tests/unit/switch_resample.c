@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <math.h>
+#include <switch.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+static void tone(int16_t *buf, uint32_t samples, uint32_t channels, uint32_t rate, uint32_t *n)
+{
+  uint32_t i, c;
+
+  for ( i = 0; i < samples; i++, (*n)++) {
+    for ( c = 0; c < channels; c++) {
+      buf[i * channels + c] = c ? 0 : (int16_t) (16000 * sin(2 * M_PI * 1000 * *n / rate));
+    }
+  }
+}
+
+/* run frames of a 1kHz tone through, 20ms at a time, and report the rms of the last half */
+static double run(uint32_t from, uint32_t to, uint32_t channels, int frames, uint32_t *outlen, int *right_quiet)
+{
+  switch_audio_resampler_t *resampler = NULL;
+  int16_t in[960 * 2];
+  uint32_t n = 0, len, i, spf = from / 50;
+  double sum = 0;
+  int f, count = 0;
+
+  *outlen = 0;
+  if (right_quiet) *right_quiet = 1;
+
+  if (switch_resample_create(&resampler, from, to, spf * 2, SWITCH_RESAMPLE_QUALITY, channels) != SWITCH_STATUS_SUCCESS) {
+    return 0;
+  }
+
+  for ( f = 0; f < frames; f++) {
+    tone(in, spf, channels, from, &n);
+    len = switch_resample_process(resampler, in, spf);
+    *outlen += len;
+
+    for ( i = 0; f >= frames / 2 && i < len; i++) {
+      sum += (double) resampler->to[i * channels] * resampler->to[i * channels];
+      count++;
+      if (channels > 1 && resampler->to[i * channels + 1] && right_quiet) *right_quiet = 0;
+    }
+  }
+
+  switch_resample_destroy(&resampler);
+
+  return count ? sqrt(sum / count) : 0;
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  switch_audio_resampler_t *a = NULL;
+
+#ifdef BENCHMARK
+  uint32_t rates[][2] = { { 8000, 16000 }, { 16000, 8000 }, { 8000, 48000 }, { 48000, 8000 }, { 44100, 48000 } };
+  switch_time_t start;
+  int x, y, loops = 20000;
+  int16_t in[960] = { 0 };
+
+  plan(1 + 5);
+#else
+  switch_audio_resampler_t *b = NULL;
+  double rms, want = 16000 / sqrt(2);
+  uint32_t len;
+  int quiet;
+
+  plan(1 + 7);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+#ifndef BENCHMARK
+  switch_resample_create(&a, 8000, 48000, 320, SWITCH_RESAMPLE_QUALITY, 1);
+  switch_resample_create(&b, 44100, 48000, 1764, SWITCH_RESAMPLE_QUALITY, 1);
+  ok(a && a->poly && !a->resampler, "resample: 8k to 48k takes the polyphase path");
+  ok(b && !b->poly && b->resampler, "resample: 44.1k to 48k stays on speex");
+  switch_resample_destroy(&a);
+  switch_resample_destroy(&b);
+
+  rms = run(8000, 16000, 1, 50, &len, NULL);
+  ok(len == 50 * 320, "resample 8k to 16k: %u samples out for 50 frames", len);
+  ok(fabs(rms - want) < want / 100, "resample 8k to 16k: tone level kept (rms %.0f)", rms);
+
+  rms = run(48000, 8000, 1, 50, &len, NULL);
+  ok(len == 50 * 160 && fabs(rms - want) < want / 100, "resample 48k to 8k: %u samples out, rms %.0f", len, rms);
+
+  rms = run(16000, 48000, 2, 50, &len, &quiet);
+  ok(len == 50 * 960 && fabs(rms - want) < want / 100, "resample 16k to 48k stereo: %u samples out, rms %.0f", len, rms);
+  ok(quiet, "resample 16k to 48k stereo: channels do not bleed");
+#else
+  for ( x = 0; x < 5; x++) {
+    uint32_t spf = rates[x][0] / 50;
+
+    start = switch_time_now();
+    for ( y = 0; y < loops; y++) {
+      switch_resample_create(&a, rates[x][0], rates[x][1], spf * 2, SWITCH_RESAMPLE_QUALITY, 1);
+      switch_resample_destroy(&a);
+    }
+    note("resample %u to %u: create/destroy %.2fus\n", rates[x][0], rates[x][1], (switch_time_now() - start) / (double) loops);
+
+    switch_resample_create(&a, rates[x][0], rates[x][1], spf * 2, SWITCH_RESAMPLE_QUALITY, 1);
+    start = switch_time_now();
+    for ( y = 0; y < loops; y++) {
+      switch_resample_process(a, in, spf);
+    }
+    note("resample %u to %u (%s): %.2fus per 20ms frame\n", rates[x][0], rates[x][1], a->poly ? "polyphase" : "speex",
+         (switch_time_now() - start) / (double) loops);
+    ok(a->to_len > 0, "resample %u to %u: timed", rates[x][0], rates[x][1]);
+    switch_resample_destroy(&a);
+  }
+#endif
+
+  switch_core_destroy();
+
+  done_testing();
+}
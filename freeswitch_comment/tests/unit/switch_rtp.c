@@ -0,0 +1,290 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+#define RX_HOST "127.0.0.1"
+#define BASE_PORT 24000
+
+static switch_rtp_t *new_pair_leg(switch_port_t rx_port, switch_port_t tx_port, switch_memory_pool_t *pool)
+{
+  switch_rtp_flag_t flags[SWITCH_RTP_FLAG_INVALID] = { 0 };
+  const char *err = NULL;
+  switch_rtp_t *rtp_session;
+
+  flags[SWITCH_RTP_FLAG_NOBLOCK] = 1;
+
+  rtp_session = switch_rtp_new(RX_HOST, rx_port, RX_HOST, tx_port, 0, 160, 20000, flags, NULL, &err, pool);
+
+  if (!rtp_session) {
+    diag("switch_rtp_new failed [%s]\n", err ? err : "unknown");
+  }
+
+  return rtp_session;
+}
+
+static int drain(switch_rtp_t *rtp_session, int want, switch_time_t deadline)
+{
+  switch_frame_t frame = { 0 };
+  int got = 0;
+
+  while (got < want && switch_time_now() < deadline) {
+    if (switch_rtp_zerocopy_read_frame(rtp_session, &frame, SWITCH_IO_FLAG_NOBLOCK) == SWITCH_STATUS_SUCCESS &&
+        frame.datalen && !switch_test_flag((&frame), SFF_CNG)) {
+      got++;
+    } else {
+      switch_cond_next();
+    }
+  }
+
+  return got;
+}
+
+typedef struct {
+  const char *name;
+  switch_rtp_crypto_key_type_t type;
+} srtp_suite_t;
+
+/* CRYPTO_INVALID runs the same loop in the clear, the baseline the suites are measured against */
+static srtp_suite_t suites[] = {
+  { "plain rtp", CRYPTO_INVALID },
+  { "AES_CM_128_HMAC_SHA1_80", AES_CM_128_HMAC_SHA1_80 },
+  { "AES_CM_256_HMAC_SHA1_80", AES_CM_256_HMAC_SHA1_80 },
+  { "AEAD_AES_128_GCM", AEAD_AES_128_GCM },
+  { "AEAD_AES_256_GCM", AEAD_AES_256_GCM },
+  { NULL }
+};
+
+/* one packet out and back in at a time, so the time spent is protect + unprotect + the loopback */
+static int srtp_round_trip(switch_rtp_crypto_key_type_t type, switch_port_t port, int loops, switch_time_t *usec, switch_memory_pool_t *pool)
+{
+  switch_rtp_t *tx = new_pair_leg(port, port + 2, pool), *rx = new_pair_leg(port + 2, port, pool);
+  switch_frame_flag_t fflags = SFF_NONE;
+  unsigned char key[SWITCH_RTP_MAX_CRYPTO_LEN];
+  unsigned char payload[160];
+  switch_time_t start;
+  int x, keylen, got = 0;
+
+  if (!tx || !rx) {
+    goto end;
+  }
+
+  if (type != CRYPTO_INVALID) {
+    keylen = switch_core_media_crypto_keylen(type);
+
+    for ( x = 0; x < keylen; x++) {
+      key[x] = (unsigned char) (x * 7 + 1);
+    }
+
+    if (switch_rtp_add_crypto_key(tx, SWITCH_RTP_CRYPTO_SEND, 1, type, key, keylen) != SWITCH_STATUS_SUCCESS ||
+        switch_rtp_add_crypto_key(rx, SWITCH_RTP_CRYPTO_RECV, 1, type, key, keylen) != SWITCH_STATUS_SUCCESS) {
+      diag("switch_rtp_add_crypto_key failed for %s\n", switch_core_media_crypto_type2str(type));
+      goto end;
+    }
+  }
+
+  memset(payload, 0x5a, sizeof(payload));
+  start = switch_time_now();
+
+  for ( x = 0; x < loops; x++) {
+    switch_rtp_write_manual(tx, payload, sizeof(payload), 0, 0, 160 * (x + 1), &fflags);
+    got += drain(rx, 1, switch_time_now() + 20000);
+  }
+
+  *usec = switch_time_now() - start;
+
+ end:
+  if (tx) switch_rtp_destroy(&tx);
+  if (rx) switch_rtp_destroy(&rx);
+
+  return got;
+}
+
+#define ALLOC_START 40000
+#define ALLOC_END 40998
+#define ALLOC_PORTS 500
+
+#ifndef BENCHMARK
+static void port_allocator_checks(void)
+{
+  switch_core_port_allocator_t *alloc = NULL;
+  switch_port_t ports[ALLOC_PORTS], port = 0, first = 0;
+  uint8_t *seen = calloc(65536, 1);
+  int x, good = 1, reused = 0;
+
+  switch_core_port_allocator_new("127.0.0.1", ALLOC_START, ALLOC_END, SPF_EVEN, &alloc);
+
+  for ( x = 0; x < ALLOC_PORTS; x++) {
+    if (switch_core_port_allocator_request_port(alloc, &ports[x]) != SWITCH_STATUS_SUCCESS ||
+        ports[x] < ALLOC_START || ports[x] > ALLOC_END || (ports[x] % 2) || seen[ports[x]]++) {
+      good = 0;
+    }
+  }
+
+  ok(good, "port allocator: hands out every even port of the range once");
+  ok(switch_core_port_allocator_request_port(alloc, &port) != SWITCH_STATUS_SUCCESS && !port, "port allocator: an exhausted range fails");
+
+  switch_core_port_allocator_free_port(alloc, ports[7]);
+  ok(switch_core_port_allocator_request_port(alloc, &port) == SWITCH_STATUS_SUCCESS && port == ports[7],
+     "port allocator: a quarantined port is used when nothing else is free");
+
+  switch_core_port_allocator_destroy(&alloc);
+
+  /* with the rest of the range free, a released port sits out its quarantine */
+  switch_core_port_allocator_new("127.0.0.1", ALLOC_START, ALLOC_END, SPF_EVEN, &alloc);
+  switch_core_port_allocator_request_port(alloc, &first);
+  switch_core_port_allocator_free_port(alloc, first);
+
+  for ( x = 0; x < ALLOC_PORTS - 1; x++) {
+    if (switch_core_port_allocator_request_port(alloc, &port) == SWITCH_STATUS_SUCCESS && port == first) {
+      reused++;
+    }
+  }
+
+  ok(!reused, "port allocator: a released port is not reused while fresher ones are free");
+
+  switch_core_port_allocator_destroy(&alloc);
+  free(seen);
+}
+#endif
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_memory_pool_t *pool = NULL;
+  switch_rtp_reactor_stats_t stats = { 0 };
+  switch_frame_flag_t fflags = SFF_NONE;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  unsigned char payload[160];
+  switch_time_t usec = 0;
+  int x = 0, loops = 50;
+
+#ifdef BENCHMARK
+  int pairs = 200, y = 0, total = 0;
+  switch_rtp_t **legs = NULL;
+  switch_time_t start_ts, end_ts;
+  unsigned long long micro_total = 0;
+
+  plan(2 + 5 + 1);
+#else
+  switch_rtp_t *tx = NULL, *rx = NULL;
+  int got = 0;
+
+  plan(5 + 4 + 4);
+#endif
+
+  switch_rtp_set_reactor_threads(1);
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+  switch_rtp_init(pool);
+  memset(payload, 0xff, sizeof(payload));
+
+#ifndef BENCHMARK
+  tx = new_pair_leg(BASE_PORT, BASE_PORT + 2, pool);
+  rx = new_pair_leg(BASE_PORT + 2, BASE_PORT, pool);
+
+  if ( !ok(tx && rx, "Create a loopback rtp pair")) {
+    bail_out(0, "Bail due to failure to bind the loopback pair");
+  }
+
+  for ( x = 0; x < loops; x++) {
+    switch_rtp_write_manual(tx, payload, sizeof(payload), 0, 0, 160, &fflags);
+  }
+
+  got = drain(rx, loops, switch_time_now() + 2000000);
+  ok(got == loops, "Read back every packet written");
+
+  switch_rtp_get_reactor_stats(&stats);
+  ok(stats.threads <= 1, "Reactor thread count respected");
+  ok(!stats.threads || stats.packets >= (uint64_t) loops, "Reactor counted the packets it received");
+
+  switch_rtp_destroy(&tx);
+  switch_rtp_destroy(&rx);
+
+  for ( x = 1; suites[x].name; x++) {
+    got = srtp_round_trip(suites[x].type, BASE_PORT + 4 * x, loops, &usec, pool);
+    ok(got == loops, "%s: every packet authenticated and decrypted (%d/%d)", suites[x].name, got, loops);
+  }
+
+  port_allocator_checks();
+#else
+  legs = calloc(pairs * 2, sizeof(*legs));
+
+  for ( y = 0; y < pairs; y++) {
+    legs[y * 2] = new_pair_leg(BASE_PORT + y * 4, BASE_PORT + y * 4 + 2, pool);
+    legs[y * 2 + 1] = new_pair_leg(BASE_PORT + y * 4 + 2, BASE_PORT + y * 4, pool);
+
+    if ( !legs[y * 2] || !legs[y * 2 + 1]) {
+      bail_out(0, "Bail due to failure to bind pair %d", y);
+    }
+  }
+
+  start_ts = switch_time_now();
+  for ( x = 0; x < loops; x++) {
+    for ( y = 0; y < pairs; y++) {
+      switch_rtp_write_manual(legs[y * 2], payload, sizeof(payload), 0, 0, 160, &fflags);
+    }
+    for ( y = 0; y < pairs; y++) {
+      total += drain(legs[y * 2 + 1], 1, switch_time_now() + 20000);
+    }
+  }
+  end_ts = switch_time_now();
+
+  micro_total = end_ts - start_ts;
+  switch_rtp_get_reactor_stats(&stats);
+  note("switch_rtp reactor: %d/%d packets over %d pairs in %lluus, %.0f packets per second\n",
+       total, pairs * loops, pairs, micro_total, total * 1000000.0 / (micro_total ? micro_total : 1));
+  note("switch_rtp reactor: threads %u packets %" SWITCH_UINT64_T_FMT " batches %" SWITCH_UINT64_T_FMT
+       " wakeups %" SWITCH_UINT64_T_FMT " signals %" SWITCH_UINT64_T_FMT " dropped %" SWITCH_UINT64_T_FMT "\n",
+       stats.threads, stats.packets, stats.batches, stats.wakeups, stats.signals, stats.dropped);
+
+  for ( y = 0; y < pairs * 2; y++) {
+    switch_rtp_destroy(&legs[y]);
+  }
+  free(legs);
+
+  ok(total > 0, "Moved packets through the reactor");
+
+  for ( x = 0; suites[x].name; x++) {
+    total = srtp_round_trip(suites[x].type, BASE_PORT + pairs * 4 + 4 * x, 20000, &usec, pool);
+    note("switch_rtp srtp %s: %d packets in %ldus, %.0f packets per second\n",
+         suites[x].name, total, (long) usec, total * 1000000.0 / (usec ? usec : 1));
+    ok(total > 0, "%s: round trip", suites[x].name);
+  }
+
+  {
+    switch_core_port_allocator_t *alloc = NULL;
+    switch_port_t port = 0;
+
+    switch_core_port_allocator_new("127.0.0.1", ALLOC_START, ALLOC_END, SPF_EVEN, &alloc);
+
+    total = 0;
+    start_ts = switch_time_now();
+    for ( x = 0; x < 1000000; x++) {
+      if (switch_core_port_allocator_request_port(alloc, &port) == SWITCH_STATUS_SUCCESS) {
+        switch_core_port_allocator_free_port(alloc, port);
+        total++;
+      }
+    }
+    micro_total = switch_time_now() - start_ts;
+
+    note("switch_core_port_allocator: %d request/free pairs in %lluus, %.0f per second\n",
+         total, micro_total, total * 1000000.0 / (micro_total ? micro_total : 1));
+    ok(total == 1000000, "Port allocator request/free");
+
+    switch_core_port_allocator_destroy(&alloc);
+  }
+#endif
+
+  /* switch_core_destroy runs switch_rtp_shutdown, which still needs the pool the ports came from */
+  switch_core_destroy();
+
+  done_testing();
+}
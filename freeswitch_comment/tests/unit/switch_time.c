@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+#ifdef BENCHMARK
+#define TIMERS 1000
+#define LOOPS 250
+#else
+#define TIMERS 50
+#define LOOPS 10
+#endif
+
+#define INTERVAL 20
+
+#ifdef BENCHMARK
+typedef struct {
+  const char *name;
+  int tfd;
+} timer_impl_t;
+
+/* "soft" runs off the shared tick and condvar, with tfd 2 it keeps a timerfd per timer */
+static timer_impl_t impls[] = {
+  { "soft", 0 },
+  { "soft", 2 },
+  { "wheel", 0 },
+  { NULL }
+};
+#endif
+
+typedef struct {
+  const char *timer_name;
+  int loops;
+  int ticks_ok;
+  switch_interval_time_t jitter;    /* sum of |wake to wake - interval| */
+  switch_interval_time_t max_jitter;
+  int wakes;
+} timer_run_t;
+
+static void *SWITCH_THREAD_FUNC timer_thread(switch_thread_t *thread, void *obj)
+{
+  timer_run_t *run = (timer_run_t *) obj;
+  switch_timer_t timer = { 0 };
+  switch_time_t last = 0, now;
+  int x;
+
+  if (switch_core_timer_init(&timer, run->timer_name, INTERVAL, 160, NULL) != SWITCH_STATUS_SUCCESS) {
+    return NULL;
+  }
+
+  run->ticks_ok = 1;
+
+  for ( x = 0; x < run->loops; x++) {
+    uint32_t samplecount = timer.samplecount;
+
+    switch_core_timer_next(&timer);
+    now = switch_mono_micro_time_now();
+
+    /* soft only keeps tick current on sync, every implementation moves samplecount */
+    if (timer.samplecount == samplecount) {
+      run->ticks_ok = 0;
+    }
+
+    if (last) {
+      switch_interval_time_t d = now - last - INTERVAL * 1000;
+
+      if (d < 0) d = -d;
+      run->jitter += d;
+      if (d > run->max_jitter) run->max_jitter = d;
+      run->wakes++;
+    }
+
+    last = now;
+  }
+
+  switch_core_timer_destroy(&timer);
+
+  return NULL;
+}
+
+#ifndef BENCHMARK
+static int proc_threads(void)
+{
+  char line[256];
+  int threads = 0;
+  FILE *fp = fopen("/proc/self/status", "r");
+
+  if (!fp) {
+    return 0;
+  }
+
+  while (fgets(line, sizeof(line), fp)) {
+    sscanf(line, "Threads: %d", &threads);
+  }
+
+  fclose(fp);
+
+  return threads;
+}
+#endif
+
+/* one thread per timer, like a session per call */
+static void run_timers(const char *timer_name, int count, int loops, timer_run_t *total, double *cpu_ms, switch_memory_pool_t *pool)
+{
+  switch_thread_t **threads = calloc(count, sizeof(*threads));
+  timer_run_t *runs = calloc(count, sizeof(*runs));
+  switch_threadattr_t *thd_attr = NULL;
+  switch_status_t st;
+  struct timespec c0, c1;
+  int x;
+
+  memset(total, 0, sizeof(*total));
+  total->ticks_ok = 1;
+  switch_threadattr_create(&thd_attr, pool);
+  switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &c0);
+
+  for ( x = 0; x < count; x++) {
+    runs[x].timer_name = timer_name;
+    runs[x].loops = loops;
+    switch_thread_create(&threads[x], thd_attr, timer_thread, &runs[x], pool);
+  }
+
+  for ( x = 0; x < count; x++) {
+    switch_thread_join(&st, threads[x]);
+    total->ticks_ok &= runs[x].ticks_ok;
+    total->jitter += runs[x].jitter;
+    total->wakes += runs[x].wakes;
+    if (runs[x].max_jitter > total->max_jitter) total->max_jitter = runs[x].max_jitter;
+  }
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &c1);
+  *cpu_ms = (c1.tv_sec - c0.tv_sec) * 1000.0 + (c1.tv_nsec - c0.tv_nsec) / 1000000.0;
+
+  free(threads);
+  free(runs);
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  switch_memory_pool_t *pool = NULL;
+  timer_run_t total;
+  double cpu_ms = 0;
+  int x;
+
+#ifndef BENCHMARK
+  switch_timer_t timer = { 0 };
+  switch_time_t start;
+  int good = 1, threads;
+
+  plan(1 + 7);
+#else
+  plan(1 + 3);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  /* keep the soft timer on its matrix so it can be measured, per timer timerfd is switched on below */
+  switch_time_set_timerfd(0);
+  switch_loadable_module_init(SWITCH_FALSE);
+  switch_loadable_module_load_module("", "CORE_SOFTTIMER_MODULE", SWITCH_TRUE, &err);
+  switch_core_new_memory_pool(&pool);
+
+#ifndef BENCHMARK
+  threads = proc_threads();
+  switch_core_timer_init(&timer, "wheel", INTERVAL, 160, pool);
+  threads = proc_threads() - threads;
+  ok(threads == 1, "wheel: the first timer started the thread of its own wheel only (%d)", threads);
+  start = switch_mono_micro_time_now();
+
+  for ( x = 1; x <= LOOPS; x++) {
+    switch_core_timer_next(&timer);
+    if (switch_mono_micro_time_now() < start + x * INTERVAL * 1000 - 1000 || timer.tick != (switch_size_t) x ||
+        timer.samplecount != (uint32_t) x * 160) {
+      good = 0;
+    }
+  }
+
+  ok(good, "wheel: next never returns before the deadline and counts one tick per interval");
+  ok(switch_core_timer_check(&timer, SWITCH_TRUE) != SWITCH_STATUS_SUCCESS && timer.diff == 1, "wheel: check right after a tick is pending");
+
+  switch_yield(INTERVAL * 1000 + 5000);
+  ok(switch_core_timer_check(&timer, SWITCH_TRUE) == SWITCH_STATUS_SUCCESS && timer.tick == LOOPS + 1, "wheel: check steps once the interval is up");
+
+  switch_yield(3 * INTERVAL * 1000);
+  switch_core_timer_next(&timer);
+  ok(timer.tick >= LOOPS + 4, "wheel: a late next counts the intervals it missed (%d)", (int) timer.tick);
+
+  switch_core_timer_destroy(&timer);
+
+  run_timers("wheel", TIMERS, LOOPS, &total, &cpu_ms, pool);
+  ok(total.ticks_ok && total.wakes == TIMERS * (LOOPS - 1), "wheel: %d timers each woken on their own", TIMERS);
+  ok(total.jitter / (total.wakes ? total.wakes : 1) < INTERVAL * 1000, "wheel: timers keep their interval (jitter avg %dus max %dus)",
+     (int) (total.jitter / (total.wakes ? total.wakes : 1)), (int) total.max_jitter);
+#else
+  for ( x = 0; impls[x].name; x++) {
+    switch_time_set_timerfd(impls[x].tfd);
+    run_timers(impls[x].name, TIMERS, LOOPS, &total, &cpu_ms, pool);
+    note("%s%s: %d timers of %dms, wake jitter avg %dus max %dus, %.1fms cpu per second per 1k timers\n",
+         impls[x].name, impls[x].tfd ? " (timerfd)" : "", TIMERS, INTERVAL,
+         (int) (total.jitter / (total.wakes ? total.wakes : 1)), (int) total.max_jitter,
+         cpu_ms / (LOOPS * INTERVAL / 1000.0) * 1000.0 / TIMERS);
+    ok(total.ticks_ok, "%s%s: ticked", impls[x].name, impls[x].tfd ? " (timerfd)" : "");
+  }
+#endif
+
+  switch_core_destroy_memory_pool(&pool);
+  switch_core_destroy();
+
+  done_testing();
+}
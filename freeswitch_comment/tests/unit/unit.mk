@@ -15,3 +15,73 @@ tests_unit_switch_hash_CFLAGS = $(SWITCH_AM_CFLAGS)
 tests_unit_switch_hash_LDADD = $(FSLD)
 tests_unit_switch_hash_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
 
+
+check_PROGRAMS += tests/unit/switch_rtp
+
+tests_unit_switch_rtp_SOURCES = tests/unit/switch_rtp.c
+tests_unit_switch_rtp_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_rtp_LDADD = $(FSLD)
+tests_unit_switch_rtp_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_jitterbuffer
+
+tests_unit_switch_jitterbuffer_SOURCES = tests/unit/switch_jitterbuffer.c
+tests_unit_switch_jitterbuffer_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_jitterbuffer_LDADD = $(FSLD)
+tests_unit_switch_jitterbuffer_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_pcm
+
+tests_unit_switch_pcm_SOURCES = tests/unit/switch_pcm.c
+tests_unit_switch_pcm_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_pcm_LDADD = $(FSLD)
+tests_unit_switch_pcm_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_resample
+
+tests_unit_switch_resample_SOURCES = tests/unit/switch_resample.c
+tests_unit_switch_resample_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_resample_LDADD = $(FSLD)
+tests_unit_switch_resample_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_regex
+
+tests_unit_switch_regex_SOURCES = tests/unit/switch_regex.c
+tests_unit_switch_regex_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_regex_LDADD = $(FSLD)
+tests_unit_switch_regex_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/mod_dialplan_xml
+
+tests_unit_mod_dialplan_xml_SOURCES = tests/unit/mod_dialplan_xml.c
+tests_unit_mod_dialplan_xml_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_mod_dialplan_xml_LDADD = $(FSLD)
+tests_unit_mod_dialplan_xml_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_time
+
+tests_unit_switch_time_SOURCES = tests/unit/switch_time.c
+tests_unit_switch_time_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_time_LDADD = $(FSLD)
+tests_unit_switch_time_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_core_session
+
+tests_unit_switch_core_session_SOURCES = tests/unit/switch_core_session.c
+tests_unit_switch_core_session_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_core_session_LDADD = $(FSLD)
+tests_unit_switch_core_session_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_core_memory
+
+tests_unit_switch_core_memory_SOURCES = tests/unit/switch_core_memory.c
+tests_unit_switch_core_memory_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_core_memory_LDADD = $(FSLD)
+tests_unit_switch_core_memory_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_core_io
+
+tests_unit_switch_core_io_SOURCES = tests/unit/switch_core_io.c
+tests_unit_switch_core_io_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_core_io_LDADD = $(FSLD)
+tests_unit_switch_core_io_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap